@@ -0,0 +1,94 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by the Kdenlive developers                         *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include "core.h"
+#include "logger.hpp"
+#include "timelinebenchmark.hpp"
+#include <QApplication>
+#include <QCommandLineOption>
+#include <QCommandLineParser>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <iostream>
+#include <mlt++/MltFactory.h>
+#include <mlt++/MltRepository.h>
+
+/* Times the operations of the timeline model, and prints the results as JSON.
+   The size of the synthetic timeline can be changed to check how the operations scale,
+   and traces recorded by the logger can be replayed to time real editing sessions. */
+int main(int argc, char **argv)
+{
+    QApplication app(argc, argv);
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Kdenlive timeline model benchmarks"));
+    parser.addHelpOption();
+    const QCommandLineOption tracksOption(QStringLiteral("tracks"), QStringLiteral("Number of tracks"), QStringLiteral("count"), QStringLiteral("4"));
+    const QCommandLineOption clipsOption(QStringLiteral("clips"), QStringLiteral("Number of clips per track"), QStringLiteral("count"), QStringLiteral("200"));
+    const QCommandLineOption groupsOption(QStringLiteral("groups"), QStringLiteral("Number of groups"), QStringLiteral("count"), QStringLiteral("50"));
+    const QCommandLineOption compositionsOption(QStringLiteral("compositions"), QStringLiteral("Number of compositions"), QStringLiteral("count"),
+                                                QStringLiteral("50"));
+    const QCommandLineOption iterationsOption(QStringLiteral("iterations"), QStringLiteral("Number of timed calls of each operation"), QStringLiteral("count"),
+                                              QStringLiteral("500"));
+    const QCommandLineOption traceOption(QStringLiteral("trace"), QStringLiteral("Trace of operations to replay, in the fuzzer format"), QStringLiteral("file"));
+    const QCommandLineOption outputOption(QStringLiteral("output"), QStringLiteral("Write the results to a file instead of the standard output"),
+                                          QStringLiteral("file"));
+    parser.addOptions({tracksOption, clipsOption, groupsOption, compositionsOption, iterationsOption, traceOption, outputOption});
+    parser.process(app);
+
+    std::unique_ptr<Mlt::Repository> repo(Mlt::Factory::init(nullptr));
+    qputenv("MLT_TESTS", QByteArray("1"));
+    Core::build(false);
+    Logger::init();
+    // Don't time the logging of the operations
+    Logger::set_mode(Logger::Mode::Disabled);
+
+    BenchmarkConfig config;
+    config.tracks = qMax(1, parser.value(tracksOption).toInt());
+    config.clipsPerTrack = qMax(0, parser.value(clipsOption).toInt());
+    config.groups = qMax(0, parser.value(groupsOption).toInt());
+    config.compositions = qMax(0, parser.value(compositionsOption).toInt());
+    config.iterations = qMax(1, parser.value(iterationsOption).toInt());
+
+    QJsonArray results;
+    for (const BenchmarkResult &result : runTimelineBenchmarks(config)) {
+        results.append(result.toJson());
+    }
+    for (const QString &trace : parser.values(traceOption)) {
+        results.append(runTraceBenchmark(trace, qMax(1, config.iterations / 100)).toJson());
+    }
+    QJsonObject report;
+    report.insert(QStringLiteral("config"), config.toJson());
+    report.insert(QStringLiteral("results"), results);
+    const QByteArray json = QJsonDocument(report).toJson();
+
+    int exitCode = 0;
+    if (parser.isSet(outputOption)) {
+        QFile file(parser.value(outputOption));
+        if (!file.open(QIODevice::WriteOnly) || file.write(json) != json.size()) {
+            std::cerr << "Cannot write " << parser.value(outputOption).toStdString() << std::endl;
+            exitCode = 1;
+        }
+    } else {
+        std::cout << json.constData();
+    }
+    return exitCode;
+}
@@ -0,0 +1,333 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by the Kdenlive developers                         *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include "timelinebenchmark.hpp"
+#include "bin/model/markerlistmodel.hpp"
+#include "doc/docundostack.hpp"
+#include "fakeit_standalone.hpp"
+#include "fuzzing.hpp"
+#include "logger.hpp"
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <algorithm>
+#include <mlt++/MltProducer.h>
+#include <mlt++/MltProfile.h>
+#include <numeric>
+#include <random>
+#define private public
+#define protected public
+#include "bin/projectclip.h"
+#include "bin/projectfolder.h"
+#include "bin/projectitemmodel.h"
+#include "core.h"
+#include "project/projectmanager.h"
+#include "timeline2/model/compositionmodel.hpp"
+#include "timeline2/model/groupsmodel.hpp"
+#include "timeline2/model/timelineitemmodel.hpp"
+#include "timeline2/model/timelinemodel.hpp"
+#include "timeline2/model/trackmodel.hpp"
+#include "transitions/transitionsrepository.hpp"
+
+using namespace fakeit;
+
+namespace {
+// Clips are 20 frames long, separated by gaps of 10 frames
+const int ClipLength = 20;
+const int ClipSpacing = 30;
+// Moves stay within the gaps, so that the layout of the timeline does not change during the benchmarks
+const int MoveDelta = 5;
+
+QString createColorClip(Mlt::Profile &profile, const std::shared_ptr<ProjectItemModel> &binModel)
+{
+    std::shared_ptr<Mlt::Producer> producer = std::make_shared<Mlt::Producer>(profile, "color", "red");
+    producer->set("length", ClipLength);
+    producer->set("out", ClipLength - 1);
+    QString binId = QString::number(binModel->getFreeClipId());
+    auto binClip = ProjectClip::construct(binId, QIcon(), binModel, producer);
+    binClip->forceLimitedDuration();
+    Fun undo = []() { return true; };
+    Fun redo = []() { return true; };
+    binModel->addItem(binClip, binModel->getRootFolder()->clipId(), undo, redo);
+    return binId;
+}
+
+QString findComposition()
+{
+    for (const auto &transition : TransitionsRepository::get()->getNames()) {
+        if (TransitionsRepository::get()->isComposition(transition.first)) {
+            return transition.first;
+        }
+    }
+    return QString();
+}
+
+// Returns the time spent in the function, in nanoseconds
+template <typename F> qint64 measure(F &&function)
+{
+    QElapsedTimer timer;
+    timer.start();
+    function();
+    return timer.nsecsElapsed();
+}
+
+/* A timeline filled with clips, groups and compositions */
+class SyntheticTimeline
+{
+public:
+    explicit SyntheticTimeline(const BenchmarkConfig &config)
+        : m_profile(new Mlt::Profile())
+        , undoStack(std::make_shared<DocUndoStack>(nullptr))
+        , guideModel(std::make_shared<MarkerListModel>(undoStack))
+    {
+        When(Method(m_pmMock, undoStack)).AlwaysReturn(undoStack);
+        pCore->m_projectManager = &m_pmMock.get();
+        auto binModel = pCore->projectItemModel();
+        binModel->clean();
+        timeline = TimelineItemModel::construct(m_profile.get(), guideModel, undoStack);
+        const QString binId = createColorClip(*m_profile, binModel);
+        for (int i = 0; i < config.tracks; ++i) {
+            tracks.push_back(TrackModel::construct(timeline));
+        }
+        for (int trackId : tracks) {
+            for (int i = 0; i < config.clipsPerTrack; ++i) {
+                int clipId = -1;
+                if (timeline->requestClipInsertion(binId, trackId, i * ClipSpacing, clipId, false)) {
+                    clips.push_back(clipId);
+                }
+            }
+        }
+        if (tracks.size() > 1 && config.clipsPerTrack > 0 && clips.size() >= 2 * size_t(config.clipsPerTrack)) {
+            // Spread the groups over the first two tracks, leaving other clips ungrouped
+            const int count = std::min(config.groups, config.clipsPerTrack);
+            for (int i = 0; i < count; ++i) {
+                const int index = i * config.clipsPerTrack / count;
+                const int first = clips[size_t(index)];
+                const int second = clips[size_t(config.clipsPerTrack + index)];
+                const int groupId = timeline->requestClipsGroup({first, second}, false);
+                if (groupId > -1) {
+                    groups.emplace_back(groupId, first);
+                }
+            }
+        }
+        const QString compositionId = findComposition();
+        if (!compositionId.isEmpty() && tracks.size() > 1) {
+            for (int i = 0; i < config.compositions; ++i) {
+                const int compoId = CompositionModel::construct(timeline, compositionId);
+                const int trackId = tracks[size_t(1 + i % int(tracks.size() - 1))];
+                if (timeline->requestCompositionMove(compoId, trackId, (i * 7) % qMax(1, config.clipsPerTrack) * ClipSpacing, true, false)) {
+                    compositions.push_back(compoId);
+                }
+            }
+        }
+        for (int clipId : clips) {
+            if (!timeline->m_groups->isInGroup(clipId)) {
+                ungroupedClips.push_back(clipId);
+            }
+        }
+    }
+
+    ~SyntheticTimeline()
+    {
+        timeline.reset();
+        pCore->projectItemModel()->clean();
+        pCore->m_projectManager = nullptr;
+    }
+
+    int duration() const { return timeline->duration(); }
+
+private:
+    std::unique_ptr<Mlt::Profile> m_profile;
+    Mock<ProjectManager> m_pmMock;
+
+public:
+    std::shared_ptr<DocUndoStack> undoStack;
+    std::shared_ptr<MarkerListModel> guideModel;
+    std::shared_ptr<TimelineItemModel> timeline;
+    std::vector<int> tracks;
+    std::vector<int> clips;
+    std::vector<int> ungroupedClips;
+    // Pairs of group id and one of its clips
+    std::vector<std::pair<int, int>> groups;
+    std::vector<int> compositions;
+};
+} // namespace
+
+QJsonObject BenchmarkConfig::toJson() const
+{
+    QJsonObject result;
+    result.insert(QStringLiteral("tracks"), tracks);
+    result.insert(QStringLiteral("clipsPerTrack"), clipsPerTrack);
+    result.insert(QStringLiteral("groups"), groups);
+    result.insert(QStringLiteral("compositions"), compositions);
+    result.insert(QStringLiteral("iterations"), iterations);
+    result.insert(QStringLiteral("seed"), int(seed));
+    return result;
+}
+
+QJsonObject BenchmarkResult::toJson() const
+{
+    QJsonObject result;
+    result.insert(QStringLiteral("name"), name);
+    result.insert(QStringLiteral("iterations"), iterations);
+    result.insert(QStringLiteral("failures"), failures);
+    result.insert(QStringLiteral("min_us"), min);
+    result.insert(QStringLiteral("median_us"), median);
+    result.insert(QStringLiteral("mean_us"), mean);
+    result.insert(QStringLiteral("max_us"), max);
+    return result;
+}
+
+BenchmarkResult BenchmarkResult::fromSamples(const QString &name, std::vector<qint64> samples, int failures)
+{
+    BenchmarkResult result;
+    result.name = name;
+    result.failures = failures;
+    result.iterations = int(samples.size());
+    if (samples.empty()) {
+        return result;
+    }
+    std::sort(samples.begin(), samples.end());
+    result.min = samples.front() / 1000.;
+    result.max = samples.back() / 1000.;
+    result.median = samples[samples.size() / 2] / 1000.;
+    result.mean = std::accumulate(samples.begin(), samples.end(), 0.) / samples.size() / 1000.;
+    return result;
+}
+
+std::vector<BenchmarkResult> runTimelineBenchmarks(const BenchmarkConfig &config)
+{
+    std::vector<BenchmarkResult> results;
+    QElapsedTimer buildTimer;
+    buildTimer.start();
+    SyntheticTimeline synthetic(config);
+    results.push_back(BenchmarkResult::fromSamples(QStringLiteral("build"), {buildTimer.nsecsElapsed()}));
+    const std::shared_ptr<TimelineItemModel> &timeline = synthetic.timeline;
+    std::mt19937 gen(config.seed);
+    auto pick = [&gen](const std::vector<int> &items) { return items[std::uniform_int_distribution<size_t>(0, items.size() - 1)(gen)]; };
+    const int iterations = qMax(1, config.iterations);
+
+    if (!synthetic.ungroupedClips.empty()) {
+        std::vector<qint64> samples;
+        int failures = 0;
+        for (int i = 0; i < iterations; ++i) {
+            const int clipId = pick(synthetic.ungroupedClips);
+            const int trackId = timeline->getClipTrackId(clipId);
+            const int position = timeline->getClipPosition(clipId);
+            bool ok = false;
+            samples.push_back(measure([&]() { ok = timeline->requestClipMove(clipId, trackId, position + MoveDelta, true, true, false); }));
+            failures += ok ? 0 : 1;
+            timeline->requestClipMove(clipId, trackId, position, true, true, false);
+        }
+        results.push_back(BenchmarkResult::fromSamples(QStringLiteral("requestClipMove"), samples, failures));
+
+        samples.clear();
+        failures = 0;
+        for (int i = 0; i < iterations; ++i) {
+            const int clipId = pick(synthetic.ungroupedClips);
+            int size = -1;
+            samples.push_back(measure([&]() { size = timeline->requestItemResize(clipId, ClipLength - 1, true, false); }));
+            failures += size == ClipLength - 1 ? 0 : 1;
+            timeline->requestItemResize(clipId, ClipLength, true, false);
+        }
+        results.push_back(BenchmarkResult::fromSamples(QStringLiteral("requestItemResize"), samples, failures));
+    }
+
+    if (!synthetic.groups.empty()) {
+        std::vector<qint64> samples;
+        int failures = 0;
+        for (int i = 0; i < iterations; ++i) {
+            const auto &group = synthetic.groups[std::uniform_int_distribution<size_t>(0, synthetic.groups.size() - 1)(gen)];
+            bool ok = false;
+            samples.push_back(measure([&]() { ok = timeline->requestGroupMove(group.second, group.first, 0, MoveDelta, true, true, false); }));
+            failures += ok ? 0 : 1;
+            if (ok) {
+                timeline->requestGroupMove(group.second, group.first, 0, -MoveDelta, true, true, false);
+            }
+        }
+        results.push_back(BenchmarkResult::fromSamples(QStringLiteral("requestGroupMove"), samples, failures));
+    }
+
+    {
+        std::vector<qint64> samples;
+        std::uniform_int_distribution<int> position(0, qMax(0, synthetic.duration()));
+        for (int i = 0; i < iterations; ++i) {
+            const int pos = position(gen);
+            samples.push_back(measure([&]() { timeline->suggestSnapPoint(pos, 10); }));
+        }
+        results.push_back(BenchmarkResult::fromSamples(QStringLiteral("suggestSnapPoint"), samples));
+
+        samples.clear();
+        for (int i = 0; i < iterations && !synthetic.tracks.empty(); ++i) {
+            const int trackId = pick(synthetic.tracks);
+            const int start = position(gen);
+            samples.push_back(measure([&]() { timeline->getItemsInRange(trackId, start, start + 10 * ClipSpacing); }));
+        }
+        results.push_back(BenchmarkResult::fromSamples(QStringLiteral("getItemsInRange"), samples));
+    }
+
+    if (!synthetic.ungroupedClips.empty()) {
+        // Fill the undo stack with moves going back and forth, then time undoing and redoing them
+        for (int i = 0; i < iterations; ++i) {
+            const int clipId = synthetic.ungroupedClips[size_t(i) % synthetic.ungroupedClips.size()];
+            const int position = timeline->getClipPosition(clipId);
+            timeline->requestClipMove(clipId, timeline->getClipTrackId(clipId), position + (i % 2 == 0 ? MoveDelta : -MoveDelta));
+        }
+        std::vector<qint64> undoSamples;
+        std::vector<qint64> redoSamples;
+        while (synthetic.undoStack->canUndo()) {
+            undoSamples.push_back(measure([&]() { synthetic.undoStack->undo(); }));
+        }
+        while (synthetic.undoStack->canRedo()) {
+            redoSamples.push_back(measure([&]() { synthetic.undoStack->redo(); }));
+        }
+        results.push_back(BenchmarkResult::fromSamples(QStringLiteral("undo"), undoSamples));
+        results.push_back(BenchmarkResult::fromSamples(QStringLiteral("redo"), redoSamples));
+    }
+
+    {
+        // The consistency check walks the whole timeline, a few calls are enough
+        std::vector<qint64> samples;
+        int failures = 0;
+        for (int i = 0; i < qMax(1, iterations / 50); ++i) {
+            bool ok = false;
+            samples.push_back(measure([&]() { ok = timeline->checkConsistency(); }));
+            failures += ok ? 0 : 1;
+        }
+        results.push_back(BenchmarkResult::fromSamples(QStringLiteral("checkConsistency"), samples, failures));
+    }
+    return results;
+}
+
+BenchmarkResult runTraceBenchmark(const QString &path, int iterations)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return BenchmarkResult::fromSamples(QStringLiteral("trace:%1").arg(path), {}, 1);
+    }
+    const std::string trace = file.readAll().toStdString();
+    std::vector<qint64> samples;
+    for (int i = 0; i < qMax(1, iterations); ++i) {
+        samples.push_back(measure([&]() { fuzz(trace); }));
+    }
+    pCore->m_projectManager = nullptr;
+    return BenchmarkResult::fromSamples(QStringLiteral("trace:%1").arg(QFileInfo(path).fileName()), samples);
+}
@@ -0,0 +1,65 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by the Kdenlive developers                         *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#pragma once
+
+#include <QJsonObject>
+#include <QString>
+#include <vector>
+
+/** @brief Size of the synthetic timeline used by the benchmarks */
+struct BenchmarkConfig
+{
+    int tracks{4};
+    int clipsPerTrack{200};
+    // Each group holds one clip of the first two tracks
+    int groups{50};
+    int compositions{50};
+    // Number of timed calls of each operation
+    int iterations{500};
+    unsigned seed{42};
+
+    QJsonObject toJson() const;
+};
+
+/** @brief Timings of one operation, in microseconds */
+struct BenchmarkResult
+{
+    QString name;
+    int iterations{0};
+    // Number of calls where the operation was refused by the model
+    int failures{0};
+    double min{0};
+    double median{0};
+    double mean{0};
+    double max{0};
+
+    QJsonObject toJson() const;
+    /** @brief Builds the result from the duration of each call, in nanoseconds */
+    static BenchmarkResult fromSamples(const QString &name, std::vector<qint64> samples, int failures = 0);
+};
+
+/** @brief Builds a synthetic timeline of the given size, and times the main operations of TimelineModel on it */
+std::vector<BenchmarkResult> runTimelineBenchmarks(const BenchmarkConfig &config);
+
+/** @brief Times the replay of a trace of timeline operations, in the format of fuzz_reproduce.
+    Such traces are written by Logger::print_trace or dumped from its ring buffer on crash. */
+BenchmarkResult runTraceBenchmark(const QString &path, int iterations);
@@ -28,8 +28,14 @@
 #include <mlt++/Mlt.h>
 #include <mutex>
 #include <unordered_map>
+#include <vector>
+
+class QDataStream;
 
 /** @brief This class is the base class for assets (transitions or effets) repositories
+    The parsed assets are cached in a binary file, so that the MLT metadata and the custom XML files
+    do not need to be parsed again on each start. The cache is valid for a given MLT version, Kdenlive
+    version and language, and custom files are parsed again when their size or modification time change.
  */
 
 template <typename AssetType> class AbstractAssetsRepository
@@ -59,6 +65,17 @@ public:
     /* @brief Returns a DomElement representing the asset's properties */
     QDomElement getXml(const QString &assetId) const;
 
+    /* @brief Counters of the last initialization, for the startup timing report */
+    struct InitStats
+    {
+        int mltParsed = 0;   // assets whose MLT metadata was parsed
+        int mltCached = 0;   // assets restored from the cache
+        int filesParsed = 0; // custom XML files parsed
+        int filesCached = 0; // custom XML files restored from the cache
+        qint64 msecs = 0;    // duration of the initialization
+    };
+    const InitStats &initStats() const;
+
 protected:
     struct Info
     {
@@ -108,8 +125,47 @@ protected:
     /* @brief Returns the path to the assets' preferred list*/
     virtual QString assetPreferredListPath() const = 0;
 
+    /* @brief Returns the path of the file caching the parsed assets, or an empty string to disable the cache*/
+    virtual QString assetCachePath() const = 0;
+
+    /* @brief Assets found in one custom XML file, as stored in the cache */
+    struct CustomFile
+    {
+        QString path;
+        qint64 size = -1;
+        qint64 modified = -1;
+        std::vector<Info> assets;
+    };
+
+    /* @brief Content of the assets cache */
+    struct AssetCache
+    {
+        std::unordered_map<QString, Info> mltAssets;
+        // MLT services that cannot be used as assets
+        QSet<QString> mltFailures;
+        // Custom files by path
+        std::unordered_map<QString, CustomFile> files;
+        // Signature of the MLT assets the custom files were parsed with
+        QByteArray mltSignature;
+    };
+
+    /* @brief Returns the description of what the cached assets depend on: versions, translation languages and blacklist */
+    QString cacheKey() const;
+    /* @brief Returns a signature of the ids and versions of the MLT assets, the custom files depending on them must be parsed again when it changes */
+    static QByteArray mltSignature(const std::unordered_map<QString, Info> &mltAssets);
+    /* @brief Reads the cache, returns false if there is none or if it is outdated */
+    bool loadCache(AssetCache &cache) const;
+    void saveCache(const AssetCache &cache) const;
+    static void writeInfo(QDataStream &stream, const Info &info);
+    static void readInfo(QDataStream &stream, Info &info);
+
+    static const quint32 AssetCacheMagic = 0x4b444153; // KDAS
+    static const quint32 AssetCacheVersion = 2;
+
     std::unordered_map<QString, Info> m_assets;
 
+    InitStats m_initStats;
+
     QSet<QString> m_blacklist;
 
     QSet<QString> m_preferred_list;
@@ -22,11 +22,18 @@
 #include "xml/xml.hpp"
 #include "kdenlivesettings.h"
 
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
 #include <QDir>
+#include <QElapsedTimer>
 #include <QFile>
+#include <QSaveFile>
 #include <QStandardPaths>
 #include <QString>
 #include <QTextStream>
+#include <QtConcurrent>
 #include <KLocalizedString>
 
 #include <locale>
@@ -38,6 +45,9 @@ template <typename AssetType> AbstractAssetsRepository<AssetType>::AbstractAsset
 
 template <typename AssetType> void AbstractAssetsRepository<AssetType>::init()
 {
+    QElapsedTimer timer;
+    timer.start();
+    m_initStats = InitStats();
 // Warning: Mlt::Factory::init() resets the locale to the default system value, make sure we keep correct locale
 #ifndef Q_OS_MAC
     setlocale(LC_NUMERIC, nullptr);
@@ -51,6 +61,10 @@ template <typename AssetType> void AbstractAssetsRepository<AssetType>::init()
     // Parse preferred list
     parseAssetList(assetPreferredListPath(), m_preferred_list);
 
+    AssetCache cache;
+    bool cacheChanged = !loadCache(cache);
+    AssetCache newCache;
+
     // Retrieve the list of MLT's available assets.
     QScopedPointer<Mlt::Properties> assets(retrieveListFromMlt());
     int max = assets->count();
@@ -63,17 +77,44 @@ template <typename AssetType> void AbstractAssetsRepository<AssetType>::init()
             // sox effects are not usage directly (parameters not available)
             continue;
         }
+        if (m_blacklist.contains(name)) {
+            qDebug() << name << "is blacklisted";
+            continue;
+        }
+        // Querying the MLT metadata is slow, only do it for services that are not in the cache
+        auto cached = cache.mltAssets.find(name);
+        if (cached != cache.mltAssets.end()) {
+            m_assets[name] = cached->second;
+            newCache.mltAssets[name] = cached->second;
+            m_initStats.mltCached++;
+            continue;
+        }
+        if (cache.mltFailures.contains(name)) {
+            newCache.mltFailures.insert(name);
+            m_initStats.mltCached++;
+            continue;
+        }
         // qDebug() << "trying to parse " <<name <<" blacklist="<<m_blacklist.contains(name);
-        if (!m_blacklist.contains(name) && parseInfoFromMlt(name, info)) {
+        cacheChanged = true;
+        m_initStats.mltParsed++;
+        if (parseInfoFromMlt(name, info)) {
             m_assets[name] = info;
+            newCache.mltAssets[name] = info;
         } else {
-            if (m_blacklist.contains(name)) {
-                qDebug() << name << "is blacklisted";
-            } else {
-                qDebug() << "WARNING : Fails to parse " << name;
-            }
+            qDebug() << "WARNING : Fails to parse " << name;
+            newCache.mltFailures.insert(name);
         }
     }
+    if (newCache.mltAssets.size() != cache.mltAssets.size() || newCache.mltFailures.size() != cache.mltFailures.size()) {
+        // Some services were removed from MLT
+        cacheChanged = true;
+    }
+    // Custom files are parsed against the MLT assets, they cannot be reused if these changed
+    newCache.mltSignature = mltSignature(newCache.mltAssets);
+    if (newCache.mltSignature != cache.mltSignature) {
+        cache.files.clear();
+        cacheChanged = true;
+    }
 
     // We now parse custom effect xml
 
@@ -85,18 +126,56 @@ template <typename AssetType> void AbstractAssetsRepository<AssetType>::init()
        to the same tag, and in that case they must have different ids. We do the parsing in a map from ids to parse info, and then we add them to the asset
        list, while discarding the bare version of each tag (the one with no file associated)
     */
-    std::unordered_map<QString, Info> customAssets;
+    std::vector<CustomFile> files;
     // reverse order to prioritize local install
     QListIterator<QString> dirs_it(asset_dirs);
     for (dirs_it.toBack(); dirs_it.hasPrevious();) { auto dir=dirs_it.previous();
         QDir current_dir(dir);
         QStringList filter;
         filter << QStringLiteral("*.xml");
-        QStringList fileList = current_dir.entryList(filter, QDir::Files);
+        const QFileInfoList fileList = current_dir.entryInfoList(filter, QDir::Files);
         for (const auto &file : fileList) {
-            QString path = current_dir.absoluteFilePath(file);
-            parseCustomAssetFile(path, customAssets);
+            CustomFile custom;
+            custom.path = file.absoluteFilePath();
+            custom.size = file.size();
+            custom.modified = file.lastModified().toMSecsSinceEpoch();
+            files.push_back(std::move(custom));
+        }
+    }
+
+    // Files that did not change since they were cached are not parsed again, the other ones are parsed in parallel
+    QVector<CustomFile *> changedFiles;
+    for (auto &file : files) {
+        auto cached = cache.files.find(file.path);
+        if (cached != cache.files.end() && cached->second.size == file.size && cached->second.modified == file.modified) {
+            file.assets = cached->second.assets;
+            m_initStats.filesCached++;
+        } else {
+            changedFiles << &file;
+        }
+    }
+    QtConcurrent::blockingMap(changedFiles, [this](CustomFile *file) {
+        std::unordered_map<QString, Info> fileAssets;
+        parseCustomAssetFile(file->path, fileAssets);
+        for (auto &asset : fileAssets) {
+            file->assets.push_back(std::move(asset.second));
         }
+    });
+    m_initStats.filesParsed = changedFiles.size();
+    if (!changedFiles.isEmpty() || files.size() != cache.files.size()) {
+        cacheChanged = true;
+    }
+
+    std::unordered_map<QString, Info> customAssets;
+    for (const auto &file : files) {
+        for (const auto &asset : file.assets) {
+            if (customAssets.count(asset.id) > 0) {
+                qDebug() << "Warning: duplicate custom definition of asset" << asset.id << "found. Only last one will be considered. Duplicate found in"
+                         << file.path;
+            }
+            customAssets[asset.id] = asset;
+        }
+        newCache.files[file.path] = file;
     }
 
     // We add the custom assets
@@ -112,6 +191,137 @@ template <typename AssetType> void AbstractAssetsRepository<AssetType>::init()
             qDebug() << "Error: conflicting asset name " << custom.first;
         }*/
     }
+
+    if (cacheChanged) {
+        saveCache(newCache);
+    }
+    m_initStats.msecs = timer.elapsed();
+    qDebug() << "Loaded" << m_assets.size() << "assets in" << m_initStats.msecs << "ms. MLT services:" << m_initStats.mltParsed << "parsed,"
+             << m_initStats.mltCached << "cached. Custom files:" << m_initStats.filesParsed << "parsed," << m_initStats.filesCached << "cached";
+}
+
+template <typename AssetType> const typename AbstractAssetsRepository<AssetType>::InitStats &AbstractAssetsRepository<AssetType>::initStats() const
+{
+    return m_initStats;
+}
+
+template <typename AssetType> QString AbstractAssetsRepository<AssetType>::cacheKey() const
+{
+    QStringList blacklist = m_blacklist.values();
+    blacklist.sort();
+    // The names and descriptions are translated with the languages of KLocalizedString, which do not always follow the locale
+    return QStringLiteral("%1|%2|%3|%4").arg(QCoreApplication::applicationVersion(), QString::fromLatin1(mlt_version_get_string()),
+                                             KLocalizedString::languages().join(QLatin1Char(',')), blacklist.join(QLatin1Char(',')));
+}
+
+template <typename AssetType> QByteArray AbstractAssetsRepository<AssetType>::mltSignature(const std::unordered_map<QString, Info> &mltAssets)
+{
+    QStringList assets;
+    for (const auto &asset : mltAssets) {
+        assets << QStringLiteral("%1:%2").arg(asset.first).arg(asset.second.version);
+    }
+    assets.sort();
+    return QCryptographicHash::hash(assets.join(QLatin1Char(',')).toUtf8(), QCryptographicHash::Md5);
+}
+
+template <typename AssetType> void AbstractAssetsRepository<AssetType>::writeInfo(QDataStream &stream, const Info &info)
+{
+    QString xml;
+    QTextStream xmlStream(&xml);
+    info.xml.save(xmlStream, 0);
+    xmlStream.flush();
+    stream << info.id << info.mltId << info.name << info.description << info.author << info.version_str << qint32(info.version) << qint32(info.type) << xml;
+}
+
+template <typename AssetType> void AbstractAssetsRepository<AssetType>::readInfo(QDataStream &stream, Info &info)
+{
+    qint32 version;
+    qint32 type;
+    QString xml;
+    stream >> info.id >> info.mltId >> info.name >> info.description >> info.author >> info.version_str >> version >> type >> xml;
+    info.version = version;
+    info.type = AssetType(type);
+    QDomDocument doc;
+    doc.setContent(xml, false);
+    info.xml = doc.documentElement();
+}
+
+template <typename AssetType> bool AbstractAssetsRepository<AssetType>::loadCache(AssetCache &cache) const
+{
+    const QString path = assetCachePath();
+    if (path.isEmpty()) {
+        return false;
+    }
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_9);
+    quint32 magic, version;
+    QString key;
+    stream >> magic >> version >> key;
+    if (magic != AssetCacheMagic || version != AssetCacheVersion || key != cacheKey()) {
+        qDebug() << "Assets cache" << path << "is outdated";
+        return false;
+    }
+    quint32 count;
+    stream >> count;
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        Info info;
+        readInfo(stream, info);
+        cache.mltAssets[info.id] = info;
+    }
+    QStringList failures;
+    stream >> failures;
+    cache.mltFailures = failures.toSet();
+    stream >> cache.mltSignature >> count;
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        CustomFile custom;
+        quint32 assetCount;
+        stream >> custom.path >> custom.size >> custom.modified >> assetCount;
+        for (quint32 j = 0; j < assetCount && stream.status() == QDataStream::Ok; ++j) {
+            Info info;
+            readInfo(stream, info);
+            custom.assets.push_back(std::move(info));
+        }
+        cache.files[custom.path] = std::move(custom);
+    }
+    if (stream.status() != QDataStream::Ok) {
+        qDebug() << "Assets cache" << path << "is corrupted";
+        cache = AssetCache();
+        return false;
+    }
+    return true;
+}
+
+template <typename AssetType> void AbstractAssetsRepository<AssetType>::saveCache(const AssetCache &cache) const
+{
+    const QString path = assetCachePath();
+    if (path.isEmpty()) {
+        return;
+    }
+    QFileInfo(path).dir().mkpath(QStringLiteral("."));
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qDebug() << "Cannot write assets cache" << path;
+        return;
+    }
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_9);
+    stream << AssetCacheMagic << AssetCacheVersion << cacheKey() << quint32(cache.mltAssets.size());
+    for (const auto &asset : cache.mltAssets) {
+        writeInfo(stream, asset.second);
+    }
+    stream << cache.mltFailures.values() << cache.mltSignature << quint32(cache.files.size());
+    for (const auto &entry : cache.files) {
+        const CustomFile &custom = entry.second;
+        stream << custom.path << custom.size << custom.modified << quint32(custom.assets.size());
+        for (const auto &info : custom.assets) {
+            writeInfo(stream, info);
+        }
+    }
+    file.commit();
 }
 
 template <typename AssetType> void AbstractAssetsRepository<AssetType>::parseAssetList(const QString &filePath, QSet<QString> &destination)
@@ -0,0 +1,226 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by the Kdenlive developers                         *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include "keyframeinterpolator.hpp"
+
+#include <QLocale>
+#include <QStringList>
+#include <algorithm>
+#include <limits>
+
+namespace {
+// Same formulas as mlt_property.c
+inline double linearInterpolate(double y1, double y2, double t)
+{
+    return y1 + (y2 - y1) * t;
+}
+
+inline double catmullRomInterpolate(double y0, double y1, double y2, double y3, double t)
+{
+    double t2 = t * t;
+    double a0 = -0.5 * y0 + 1.5 * y1 - 1.5 * y2 + 0.5 * y3;
+    double a1 = y0 - 2.5 * y1 + 2 * y2 - 0.5 * y3;
+    double a2 = -0.5 * y0 + 0.5 * y2;
+    double a3 = y1;
+    return a0 * t * t2 + a1 * t2 + a2 * t + a3;
+}
+
+std::vector<double> parseRect(const QString &value)
+{
+    QLocale locale;
+    const QStringList vals = value.split(QLatin1Char(' '), QString::SkipEmptyParts);
+    std::vector<double> result(5, 0.);
+    if (vals.count() < 4) {
+        return result;
+    }
+    for (int i = 0; i < 4; ++i) {
+        result[size_t(i)] = vals.at(i).toDouble();
+    }
+    result[4] = vals.count() > 4 ? locale.toDouble(vals.at(4)) : 1.;
+    return result;
+}
+
+std::vector<double> parseSpline(const QVariant &value)
+{
+    std::vector<double> result;
+    QList<QVariant> data = value.toList();
+    // skip tracking flag
+    if (!data.isEmpty() && data.at(0).canConvert(QVariant::String)) {
+        data.removeFirst();
+    }
+    result.reserve(size_t(data.count()) * 6);
+    for (const QVariant &bpoint : data) {
+        const QList<QVariant> l = bpoint.toList();
+        for (int i = 0; i < 3; ++i) {
+            const QList<QVariant> point = l.at(i).toList();
+            result.push_back(point.at(0).toDouble());
+            result.push_back(point.at(1).toDouble());
+        }
+    }
+    return result;
+}
+} // namespace
+
+KeyframeInterpolator::KeyframeInterpolator(ValueType valueType)
+    : m_valueType(valueType)
+    , m_componentCount(std::numeric_limits<size_t>::max())
+{
+}
+
+void KeyframeInterpolator::append(int frame, mlt_keyframe_type type, const QVariant &value)
+{
+    Key key{frame, type, {}};
+    switch (m_valueType) {
+    case ValueType::Double:
+        key.values.push_back(value.toDouble());
+        break;
+    case ValueType::Rect:
+        key.values = parseRect(value.toString());
+        break;
+    case ValueType::Spline:
+        key.values = parseSpline(value);
+        key.type = mlt_keyframe_linear;
+        break;
+    }
+    m_componentCount = std::min(m_componentCount, key.values.size());
+    m_keys.push_back(std::move(key));
+}
+
+bool KeyframeInterpolator::isEmpty() const
+{
+    return m_keys.empty();
+}
+
+KeyframeInterpolator::ValueType KeyframeInterpolator::valueType() const
+{
+    return m_valueType;
+}
+
+int KeyframeInterpolator::componentCount() const
+{
+    return m_keys.empty() ? 0 : int(m_componentCount);
+}
+
+void KeyframeInterpolator::interpolate(size_t next, int frame, std::vector<double> &values, size_t count) const
+{
+    const Key &k1 = m_keys[next - 1];
+    const Key &k2 = m_keys[next];
+    if (k1.type == mlt_keyframe_discrete) {
+        values.assign(k1.values.begin(), k1.values.begin() + long(count));
+        return;
+    }
+    const double t = double(frame - k1.frame) / double(k2.frame - k1.frame);
+    values.resize(count);
+    if (k1.type == mlt_keyframe_smooth) {
+        // Like MLT, the curve goes through the keyframes around the interval, or repeats its ends
+        const Key &k0 = next >= 2 ? m_keys[next - 2] : k1;
+        const Key &k3 = next + 1 < m_keys.size() ? m_keys[next + 1] : k2;
+        for (size_t i = 0; i < count; ++i) {
+            values[i] = catmullRomInterpolate(k0.values[i], k1.values[i], k2.values[i], k3.values[i], t);
+        }
+    } else {
+        for (size_t i = 0; i < count; ++i) {
+            values[i] = linearInterpolate(k1.values[i], k2.values[i], t);
+        }
+    }
+}
+
+void KeyframeInterpolator::valueAt(int frame, std::vector<double> &values) const
+{
+    if (m_keys.empty()) {
+        values.clear();
+        return;
+    }
+    auto next = std::upper_bound(m_keys.begin(), m_keys.end(), frame, [](int f, const Key &key) { return f < key.frame; });
+    if (next == m_keys.begin()) {
+        values = m_keys.front().values;
+        return;
+    }
+    if (next == m_keys.end()) {
+        values = m_keys.back().values;
+        return;
+    }
+    if ((next - 1)->frame == frame) {
+        values = (next - 1)->values;
+        return;
+    }
+    const size_t ix = size_t(next - m_keys.begin());
+    interpolate(ix, frame, values, std::min(m_keys[ix - 1].values.size(), m_keys[ix].values.size()));
+}
+
+std::vector<double> KeyframeInterpolator::evaluateRange(int start, int end) const
+{
+    std::vector<double> result;
+    if (m_keys.empty() || end <= start) {
+        return result;
+    }
+    const size_t count = m_componentCount;
+    result.reserve(size_t(end - start) * count);
+    std::vector<double> values;
+    // Walk the keyframes along with the frames instead of searching them for each frame
+    size_t next = size_t(std::upper_bound(m_keys.begin(), m_keys.end(), start, [](int f, const Key &key) { return f < key.frame; }) - m_keys.begin());
+    for (int frame = start; frame < end; ++frame) {
+        while (next < m_keys.size() && m_keys[next].frame <= frame) {
+            ++next;
+        }
+        const Key *key = nullptr;
+        if (next == 0) {
+            key = &m_keys.front();
+        } else if (next == m_keys.size() || m_keys[next - 1].frame == frame) {
+            key = &m_keys[next - 1];
+        }
+        if (key != nullptr) {
+            result.insert(result.end(), key->values.begin(), key->values.begin() + long(count));
+        } else {
+            interpolate(next, frame, values, count);
+            result.insert(result.end(), values.begin(), values.end());
+        }
+    }
+    return result;
+}
+
+// static
+QString KeyframeInterpolator::rectToString(const std::vector<double> &values, bool useOpacity)
+{
+    if (values.size() < 5) {
+        return QString();
+    }
+    QString res = QStringLiteral("%1 %2 %3 %4").arg(int(values[0])).arg(int(values[1])).arg(int(values[2])).arg(int(values[3]));
+    if (useOpacity) {
+        QLocale locale;
+        res.append(QStringLiteral(" %1").arg(locale.toString(values[4])));
+    }
+    return res;
+}
+
+// static
+QVariant KeyframeInterpolator::splineToVariant(const std::vector<double> &values)
+{
+    QList<QVariant> vlist;
+    for (size_t i = 0; i + 6 <= values.size(); i += 6) {
+        QList<QVariant> pl;
+        for (size_t j = 0; j < 3; ++j) {
+            pl << QVariant(QList<QVariant>() << QVariant(values[i + 2 * j]) << QVariant(values[i + 2 * j + 1]));
+        }
+        vlist << QVariant(pl);
+    }
+    return vlist;
+}
@@ -0,0 +1,78 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by the Kdenlive developers                         *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef KEYFRAMEINTERPOLATOR_H
+#define KEYFRAMEINTERPOLATOR_H
+
+#include <QVariant>
+#include <mlt++/Mlt.h>
+#include <vector>
+
+/* @brief This class interpolates the keyframes of a parameter without going through Mlt::Properties.
+   Keyframe values are parsed once into typed values, stored as a list of numbers: one for a double parameter, x, y, w, h and opacity
+   for a rectangle, and the normalized coordinates of the handles and points for a rotoscoping spline.
+   The interpolation follows the one of MLT animations: a discrete keyframe holds its value, a linear one interpolates each component
+   and a smooth one uses a Catmull-Rom spline through the neighbouring keyframes. Splines are always interpolated linearly, like the
+   rotoscoping filter does.
+ */
+class KeyframeInterpolator
+{
+public:
+    enum class ValueType { Double, Rect, Spline };
+
+    explicit KeyframeInterpolator(ValueType valueType);
+
+    /* @brief Adds a keyframe, keyframes must be added by increasing frame */
+    void append(int frame, mlt_keyframe_type type, const QVariant &value);
+    bool isEmpty() const;
+    ValueType valueType() const;
+
+    /* @brief Computes the components of the value at a given frame
+       @param values receives the components. For splines, their number depends on the surrounding keyframes
+    */
+    void valueAt(int frame, std::vector<double> &values) const;
+    /* @brief Returns the values of frames start to end (excluded), one after the other, with componentCount() numbers per frame */
+    std::vector<double> evaluateRange(int start, int end) const;
+    /* @brief Returns the number of components per frame returned by evaluateRange */
+    int componentCount() const;
+
+    /* @brief Returns the value of a rect parameter as a string, as stored in keyframes */
+    static QString rectToString(const std::vector<double> &values, bool useOpacity);
+    /* @brief Returns the value of a spline parameter, as stored in keyframes */
+    static QVariant splineToVariant(const std::vector<double> &values);
+
+private:
+    struct Key
+    {
+        int frame;
+        mlt_keyframe_type type;
+        std::vector<double> values;
+    };
+    /* @brief Computes the value between keyframes next - 1 and next */
+    void interpolate(size_t next, int frame, std::vector<double> &values, size_t count) const;
+
+    ValueType m_valueType;
+    std::vector<Key> m_keys;
+    // The smallest number of components of the keyframes
+    size_t m_componentCount;
+};
+
+#endif
@@ -21,6 +21,7 @@
 
 #include "keyframemodel.hpp"
 #include "core.h"
+#include "keyframeinterpolator.hpp"
 #include "doc/docundostack.hpp"
 #include "macros.hpp"
 #include "profiles/profilemodel.hpp"
@@ -41,6 +42,7 @@ KeyframeModel::KeyframeModel(std::weak_ptr<AssetParameterModel> model, const QMo
     , m_index(index)
     , m_lastData()
     , m_lock(QReadWriteLock::Recursive)
+    , m_interpolatorFps(0)
 {
     qDebug() << "Construct keyframemodel. Checking model:" << m_model.expired();
     if (auto ptr = m_model.lock()) {
@@ -373,6 +375,7 @@ Fun KeyframeModel::updateKeyframe_lambda(GenTime pos, KeyframeType type, const Q
         int row = static_cast<int>(std::distance(m_keyframeList.begin(), m_keyframeList.find(pos)));
         m_keyframeList[pos].first = type;
         m_keyframeList[pos].second = value;
+        invalidateInterpolator();
         if (notify) emit dataChanged(index(row), index(row), {ValueRole, NormalizedValueRole, TypeRole});
         return true;
     };
@@ -393,6 +396,7 @@ Fun KeyframeModel::addKeyframe_lambda(GenTime pos, KeyframeType type, const QVar
         if (notify) beginInsertRows(QModelIndex(), insertionRow, insertionRow);
         m_keyframeList[pos].first = type;
         m_keyframeList[pos].second = value;
+        invalidateInterpolator();
         if (notify) endInsertRows();
         return true;
     };
@@ -409,6 +413,7 @@ Fun KeyframeModel::deleteKeyframe_lambda(GenTime pos, bool notify)
         int row = static_cast<int>(std::distance(m_keyframeList.begin(), m_keyframeList.find(pos)));
         if (notify) beginRemoveRows(QModelIndex(), row, row);
         m_keyframeList.erase(pos);
+        invalidateInterpolator();
         if (notify) endRemoveRows();
         qDebug() << "after" << getAnimProperty();
         return true;
@@ -924,98 +929,72 @@ QVariant KeyframeModel::getInterpolatedValue(const GenTime &pos) const
         --it;
         return it->second.second;
     }
-    auto prev = next;
-    --prev;
-    // We now have surrounding keyframes, we use mlt to compute the value
-    Mlt::Properties prop;
-    bool useOpacity = true;
-    if (auto ptr = m_model.lock()) {
-        ptr->passProperties(prop);
-        if (m_paramType == ParamType::AnimatedRect) {
+    // We now have surrounding keyframes, the interpolator computes the value
+    auto interp = interpolator();
+    if (!interp) {
+        return QVariant();
+    }
+    std::vector<double> values;
+    interp->valueAt(pos.frames(pCore->getCurrentFps()), values);
+    switch (interp->valueType()) {
+    case KeyframeInterpolator::ValueType::Double:
+        return values.empty() ? QVariant() : QVariant(values.front());
+    case KeyframeInterpolator::ValueType::Rect: {
+        bool useOpacity = true;
+        if (auto ptr = m_model.lock()) {
             useOpacity = ptr->data(m_index, AssetParameterModel::OpacityRole).toBool();
         }
+        return QVariant(KeyframeInterpolator::rectToString(values, useOpacity));
     }
-    QLocale locale;
-    int p = pos.frames(pCore->getCurrentFps());
-    if (m_paramType == ParamType::KeyframeParam) {
-        prop.anim_set("keyframe", prev->second.second.toDouble(), prev->first.frames(pCore->getCurrentFps()), next->first.frames(pCore->getCurrentFps()),
-                      convertToMltType(prev->second.first));
-        prop.anim_set("keyframe", next->second.second.toDouble(), next->first.frames(pCore->getCurrentFps()), next->first.frames(pCore->getCurrentFps()),
-                      convertToMltType(next->second.first));
-        return QVariant(prop.anim_get_double("keyframe", p));
-    } else if (m_paramType == ParamType::AnimatedRect) {
-        QStringList vals = prev->second.second.toString().split(QLatin1Char(' '));
-        if (vals.count() >= 4) {
-            mlt_rect rect;
-            rect.x = vals.at(0).toInt();
-            rect.y = vals.at(1).toInt();
-            rect.w = vals.at(2).toInt();
-            rect.h = vals.at(3).toInt();
-            if (useOpacity) {
-                if (vals.count()) {
-                    rect.o = locale.toDouble(vals.at(4));
-                } else {
-                    rect.o = 1;
-                }
-            }
-            prop.anim_set("keyframe", rect, prev->first.frames(pCore->getCurrentFps()), next->first.frames(pCore->getCurrentFps()),
-                          convertToMltType(prev->second.first));
-        }
-        vals = next->second.second.toString().split(QLatin1Char(' '));
-        if (vals.count() >= 4) {
-            mlt_rect rect;
-            rect.x = vals.at(0).toInt();
-            rect.y = vals.at(1).toInt();
-            rect.w = vals.at(2).toInt();
-            rect.h = vals.at(3).toInt();
-            if (useOpacity) {
-                if (vals.count() > 4) {
-                    rect.o = locale.toDouble(vals.at(4));
-                } else {
-                    rect.o = 1;
-                }
-            }
-            prop.anim_set("keyframe", rect, next->first.frames(pCore->getCurrentFps()), next->first.frames(pCore->getCurrentFps()),
-                          convertToMltType(next->second.first));
-        }
-        mlt_rect rect = prop.anim_get_rect("keyframe", p);
-        QString res = QStringLiteral("%1 %2 %3 %4").arg((int)rect.x).arg((int)rect.y).arg((int)rect.w).arg((int)rect.h);
-        if (useOpacity) {
-            res.append(QStringLiteral(" %1").arg(locale.toString(rect.o)));
-        }
-        return QVariant(res);
-    } else if (m_paramType == ParamType::Roto_spline) {
-        // interpolate
-        QSize frame = pCore->getCurrentFrameSize();
-        QList<BPoint> p1 = RotoHelper::getPoints(prev->second.second, frame);
-        QList<BPoint> p2 = RotoHelper::getPoints(next->second.second, frame);
-        // relPos should be in [0,1]:
-        // - equal to 0 on prev keyframe
-        // - equal to 1 on next keyframe
-        qreal relPos = 0;
-        if (next->first != prev->first) {
-            relPos = (p - prev->first.frames(pCore->getCurrentFps())) / (qreal)(((next->first - prev->first).frames(pCore->getCurrentFps())));
-        }
-        int count = qMin(p1.count(), p2.count());
-        QList<QVariant> vlist;
-        for (int i = 0; i < count; ++i) {
-            BPoint bp;
-            QList<QVariant> pl;
-            for (int j = 0; j < 3; ++j) {
-                if (p1.at(i)[j] != p2.at(i)[j]) {
-                    bp[j] = QLineF(p1.at(i)[j], p2.at(i)[j]).pointAt(relPos);
-                } else {
-                    bp[j] = p1.at(i)[j];
-                }
-                pl << QVariant(QList<QVariant>() << QVariant(bp[j].x() / frame.width()) << QVariant(bp[j].y() / frame.height()));
-            }
-            vlist << QVariant(pl);
-        }
-        return vlist;
+    case KeyframeInterpolator::ValueType::Spline:
+        return KeyframeInterpolator::splineToVariant(values);
     }
     return QVariant();
 }
 
+std::vector<double> KeyframeModel::evaluateRange(int start, int end) const
+{
+    auto interp = interpolator();
+    return interp ? interp->evaluateRange(start, end) : std::vector<double>();
+}
+
+std::shared_ptr<const KeyframeInterpolator> KeyframeModel::interpolator() const
+{
+    KeyframeInterpolator::ValueType valueType;
+    switch (m_paramType) {
+    case ParamType::KeyframeParam:
+        valueType = KeyframeInterpolator::ValueType::Double;
+        break;
+    case ParamType::AnimatedRect:
+        valueType = KeyframeInterpolator::ValueType::Rect;
+        break;
+    case ParamType::Roto_spline:
+        valueType = KeyframeInterpolator::ValueType::Spline;
+        break;
+    default:
+        return nullptr;
+    }
+    READ_LOCK();
+    QMutexLocker locker(&m_interpolatorMutex);
+    const double fps = pCore->getCurrentFps();
+    if (m_interpolator && qFuzzyCompare(m_interpolatorFps, fps)) {
+        return m_interpolator;
+    }
+    auto interp = std::make_shared<KeyframeInterpolator>(valueType);
+    for (const auto &keyframe : m_keyframeList) {
+        interp->append(keyframe.first.frames(fps), convertToMltType(keyframe.second.first), keyframe.second.second);
+    }
+    m_interpolator = interp;
+    m_interpolatorFps = fps;
+    return m_interpolator;
+}
+
+void KeyframeModel::invalidateInterpolator()
+{
+    QMutexLocker locker(&m_interpolatorMutex);
+    m_interpolator.reset();
+}
+
 void KeyframeModel::sendModification()
 {
     if (auto ptr = m_model.lock()) {
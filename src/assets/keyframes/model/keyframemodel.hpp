@@ -28,14 +28,17 @@
 #include "undohelper.hpp"
 
 #include <QAbstractListModel>
+#include <QMutex>
 #include <QReadWriteLock>
 
 #include <map>
 #include <memory>
+#include <vector>
 
 class AssetParameterModel;
 class DocUndoStack;
 class EffectItemModel;
+class KeyframeInterpolator;
 
 /* @brief This class is the model for a list of keyframes.
    A keyframe is defined by a time, a type and a value
@@ -156,6 +159,10 @@ public:
     /* @brief Return the interpolated value at given pos */
     QVariant getInterpolatedValue(int pos) const;
     QVariant getInterpolatedValue(const GenTime &pos) const;
+    /* @brief Return the interpolated values of frames start to end (excluded), one frame after the other.
+       Each frame has one number for keyframe params, x, y, w, h and opacity for rects, and the normalized
+       coordinates of the spline points for rotoscoping. This is much faster than querying each frame */
+    std::vector<double> evaluateRange(int start, int end) const;
     QVariant updateInterpolated(const QVariant &interpValue, double val);
     /* @brief Return the real value from a normalized one */
     QVariant getNormalizedValue(double newVal) const;
@@ -199,6 +206,11 @@ protected:
     void parseAnimProperty(const QString &prop);
     void parseRotoProperty(const QString &prop);
 
+    /* @brief Returns the interpolator of the current keyframes, built when they changed. nullptr if the parameter type is not supported */
+    std::shared_ptr<const KeyframeInterpolator> interpolator() const;
+    /* @brief Must be called when the keyframes change */
+    void invalidateInterpolator();
+
 private:
     std::weak_ptr<AssetParameterModel> m_model;
     std::weak_ptr<DocUndoStack> m_undoStack;
@@ -208,6 +220,10 @@ private:
     mutable QReadWriteLock m_lock; // This is a lock that ensures safety in case of concurrent access
 
     std::map<GenTime, std::pair<KeyframeType, QVariant>> m_keyframeList;
+    // Typed copy of the keyframes used for interpolation, protected by m_interpolatorMutex
+    mutable QMutex m_interpolatorMutex;
+    mutable std::shared_ptr<const KeyframeInterpolator> m_interpolator;
+    mutable double m_interpolatorFps;
 
 signals:
     void modelChanged();
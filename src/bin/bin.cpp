@@ -66,6 +66,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <QFile>
 #include <QMenu>
 #include <QActionGroup>
+#include <QScrollBar>
 #include <QSlider>
 #include <QTimeLine>
 #include <QUndoCommand>
@@ -1035,6 +1036,9 @@ Bin::Bin(std::shared_ptr<ProjectItemModel> model, QWidget *parent)
 
     m_binTreeViewDelegate = new BinItemDelegate(this);
     m_binListViewDelegate = new BinListItemDelegate(this);
+    m_visibleClipsTimer.setSingleShot(true);
+    m_visibleClipsTimer.setInterval(200);
+    connect(&m_visibleClipsTimer, &QTimer::timeout, this, &Bin::slotPrioritizeVisibleClips);
     // connect(pCore->projectManager(), SIGNAL(projectOpened(Project*)), this, SLOT(setProject(Project*)));
     m_headerInfo = QByteArray::fromBase64(KdenliveSettings::treeviewheaders().toLatin1());
     m_propertiesPanel = new QScrollArea(this);
@@ -1752,6 +1756,10 @@ void Bin::slotInitView(QAction *action)
     m_itemView->setModel(m_proxyModel.get());
     m_itemView->setSelectionModel(m_proxyModel->selectionModel());
     m_proxyModel->setDynamicSortFilter(true);
+    // Keep the jobs of the visible clips first in the queue
+    connect(m_itemView->verticalScrollBar(), &QScrollBar::valueChanged, &m_visibleClipsTimer, static_cast<void (QTimer::*)()>(&QTimer::start));
+    connect(m_proxyModel.get(), &QAbstractItemModel::rowsInserted, &m_visibleClipsTimer, static_cast<void (QTimer::*)()>(&QTimer::start));
+    connect(m_proxyModel.get(), &QAbstractItemModel::layoutChanged, &m_visibleClipsTimer, static_cast<void (QTimer::*)()>(&QTimer::start));
     m_layout->insertWidget(2, m_itemView);
     // Reset drag type to normal
     m_itemModel->setDragType(PlaylistState::Disabled);
@@ -1800,6 +1808,32 @@ void Bin::slotInitView(QAction *action)
     m_itemView->setFocus();
 }
 
+void Bin::slotPrioritizeVisibleClips()
+{
+    if (!m_itemView || !pCore->jobManager()) {
+        return;
+    }
+    std::vector<QString> visibleIds;
+    const QRect viewRect = m_itemView->viewport()->rect();
+    std::function<void(const QModelIndex &)> collectVisible = [&](const QModelIndex &parent) {
+        for (int row = 0; row < m_proxyModel->rowCount(parent); ++row) {
+            const QModelIndex ix = m_proxyModel->index(row, 0, parent);
+            std::shared_ptr<AbstractProjectItem> item = m_itemModel->getBinItemByIndex(m_proxyModel->mapToSource(ix));
+            if (!item) {
+                continue;
+            }
+            if (item->itemType() == AbstractProjectItem::FolderItem) {
+                // Items of collapsed folders have an empty rect
+                collectVisible(ix);
+            } else if (item->itemType() == AbstractProjectItem::ClipItem && m_itemView->visualRect(ix).intersects(viewRect)) {
+                visibleIds.push_back(item->clipId());
+            }
+        }
+    };
+    collectVisible(m_itemView->rootIndex());
+    pCore->jobManager()->prioritizeClips(visibleIds);
+}
+
 void Bin::slotSetIconSize(int size)
 {
     if (!m_itemView) {
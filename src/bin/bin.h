@@ -35,6 +35,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <QListView>
 #include <QMutex>
 #include <QPushButton>
+#include <QTimer>
 #include <QTreeView>
 #include <QListWidget>
 #include <QUrl>
@@ -275,6 +276,8 @@ public:
 private slots:
     void slotAddClip();
     void slotReloadClip();
+    /** @brief Give priority to the jobs of the clips currently visible in the view */
+    void slotPrioritizeVisibleClips();
     /** @brief Set sorting column */
     void slotSetSorting();
     /** @brief Show/hide date column */
@@ -451,6 +454,8 @@ private:
     long m_processedAudio;
     /** @brief Indicates whether audio thumbnail creation is running. */
     QFuture<void> m_audioThumbsThread;
+    /** @brief Delays the update of the clips visible in the view, whose jobs get priority. */
+    QTimer m_visibleClipsTimer;
     QAction *addAction(const QString &name, const QString &text, const QIcon &icon);
     void setupAddClipAction(QMenu *addClipMenu, ClipType::ProducerType type, const QString &name, const QString &text, const QIcon &icon);
     void showClipProperties(const std::shared_ptr<ProjectClip> &clip, bool forceRefresh = false);
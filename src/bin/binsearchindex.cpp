@@ -0,0 +1,147 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by the Kdenlive developers                         *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include "binsearchindex.h"
+
+#include <QMutexLocker>
+#include <algorithm>
+
+std::vector<quint64> BinSearchIndex::trigrams(const std::vector<QString> &texts)
+{
+    std::vector<quint64> result;
+    for (const QString &text : texts) {
+        for (int i = 0; i + 2 < text.size(); ++i) {
+            result.push_back((quint64(text.at(i).unicode()) << 32) | (quint64(text.at(i + 1).unicode()) << 16) | quint64(text.at(i + 2).unicode()));
+        }
+    }
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+}
+
+void BinSearchIndex::update(int itemId, const Entry &entry)
+{
+    IndexedEntry indexed;
+    for (const QString &text : entry.texts) {
+        indexed.texts.push_back(text.toCaseFolded());
+    }
+    indexed.tag = entry.tag.toCaseFolded();
+    indexed.type = entry.type;
+    QMutexLocker lock(&m_mutex);
+    auto it = m_entries.find(itemId);
+    if (it != m_entries.end()) {
+        // Most data changes (thumbnails, jobs progress...) do not touch the searched data
+        if (it->second.texts == indexed.texts && it->second.tag == indexed.tag && it->second.type == indexed.type) {
+            return;
+        }
+        unindex(itemId, it->second);
+    }
+    indexed.trigrams = trigrams(indexed.texts);
+    for (quint64 trigram : indexed.trigrams) {
+        m_trigrams[trigram].insert(itemId);
+    }
+    m_entries[itemId] = std::move(indexed);
+    m_revision++;
+}
+
+void BinSearchIndex::unindex(int itemId, const IndexedEntry &entry)
+{
+    for (quint64 trigram : entry.trigrams) {
+        auto posting = m_trigrams.find(trigram);
+        posting->second.erase(itemId);
+        if (posting->second.empty()) {
+            m_trigrams.erase(posting);
+        }
+    }
+}
+
+void BinSearchIndex::remove(int itemId)
+{
+    QMutexLocker lock(&m_mutex);
+    auto it = m_entries.find(itemId);
+    if (it == m_entries.end()) {
+        return;
+    }
+    unindex(itemId, it->second);
+    m_entries.erase(it);
+    m_revision++;
+}
+
+void BinSearchIndex::clear()
+{
+    QMutexLocker lock(&m_mutex);
+    m_entries.clear();
+    m_trigrams.clear();
+    m_revision++;
+}
+
+std::unordered_set<int> BinSearchIndex::match(const QString &text, const QString &tag, int type) const
+{
+    const QString foldedText = text.toCaseFolded();
+    const QString foldedTag = tag.toCaseFolded();
+    QMutexLocker lock(&m_mutex);
+    std::unordered_set<int> result;
+    auto accept = [&](int itemId, const IndexedEntry &entry) {
+        if ((type > 0 && entry.type != type) || !entry.tag.contains(foldedTag)) {
+            return;
+        }
+        for (const QString &entryText : entry.texts) {
+            if (entryText.contains(foldedText)) {
+                result.insert(itemId);
+                return;
+            }
+        }
+    };
+    if (foldedText.size() < 3) {
+        // Short strings match most of the items anyway
+        for (const auto &entry : m_entries) {
+            accept(entry.first, entry.second);
+        }
+        return result;
+    }
+    // Only the items containing the rarest trigram of the searched text can match
+    const std::unordered_set<int> *candidates = nullptr;
+    for (quint64 trigram : trigrams({foldedText})) {
+        auto posting = m_trigrams.find(trigram);
+        if (posting == m_trigrams.end()) {
+            return result;
+        }
+        if (candidates == nullptr || posting->second.size() < candidates->size()) {
+            candidates = &posting->second;
+        }
+    }
+    for (int itemId : *candidates) {
+        accept(itemId, m_entries.at(itemId));
+    }
+    return result;
+}
+
+quint64 BinSearchIndex::revision() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_revision;
+}
+
+int BinSearchIndex::count() const
+{
+    QMutexLocker lock(&m_mutex);
+    return (int)m_entries.size();
+}
@@ -0,0 +1,83 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by the Kdenlive developers                         *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef BINSEARCHINDEX_H
+#define BINSEARCHINDEX_H
+
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+/**
+ * @class BinSearchIndex
+ * @brief Keeps the searchable data of the bin items, so that the bin filter does not query the model for each row.
+ *
+ * The texts are stored case folded, and each of their trigrams references the items containing it. A search for a
+ * string of at least 3 characters only needs to check the items of its rarest trigram, instead of all the bin items.
+ */
+class BinSearchIndex
+{
+public:
+    /** @brief Searchable data of an item */
+    struct Entry
+    {
+        /** The texts of the searched columns (name, date, description) */
+        QStringList texts;
+        QString tag;
+        int type = 0;
+    };
+
+    /** @brief Adds an item or updates its data */
+    void update(int itemId, const Entry &entry);
+    /** @brief Removes an item from the index */
+    void remove(int itemId);
+    void clear();
+
+    /** @brief Returns the ids of the matching items: the type must be equal unless it is 0, and the tag and one of the
+        texts must contain the searched strings, case insensitively */
+    std::unordered_set<int> match(const QString &text, const QString &tag, int type) const;
+
+    /** @brief Returns a counter increased on each change of the index, to know when search results are outdated */
+    quint64 revision() const;
+    int count() const;
+
+private:
+    struct IndexedEntry
+    {
+        std::vector<QString> texts;
+        QString tag;
+        int type = 0;
+        std::vector<quint64> trigrams;
+    };
+    /** @brief Returns the distinct trigrams of the given case folded texts */
+    static std::vector<quint64> trigrams(const std::vector<QString> &texts);
+    void unindex(int itemId, const IndexedEntry &entry);
+
+    std::unordered_map<int, IndexedEntry> m_entries;
+    std::unordered_map<quint64, std::unordered_set<int>> m_trigrams;
+    quint64 m_revision = 0;
+    mutable QMutex m_mutex;
+};
+
+#endif
@@ -33,6 +33,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "jobs/thumbjob.hpp"
 #include "jobs/cachejob.hpp"
 #include "kdenlivesettings.h"
+#include "lib/audio/audioLevels.h"
 #include "lib/audio/audioStreamInfo.h"
 #include "mltcontroller/clipcontroller.h"
 #include "mltcontroller/clippropertiescontroller.h"
@@ -46,6 +47,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "timecode.h"
 #include "timeline2/model/snapmodel.hpp"
 
+#include "utils/filehash.hpp"
+#include "utils/producerpool.hpp"
 #include "utils/thumbnailcache.hpp"
 #include "xml/xml.hpp"
 #include <QPainter>
@@ -61,6 +64,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <QDir>
 #include <QDomElement>
 #include <QFile>
+#include <QThread>
 #include <memory>
 
 #pragma GCC diagnostic push
@@ -80,7 +84,7 @@ RTTR_REGISTRATION
 ProjectClip::ProjectClip(const QString &id, const QIcon &thumb, const std::shared_ptr<ProjectItemModel> &model, std::shared_ptr<Mlt::Producer> producer)
     : AbstractProjectItem(AbstractProjectItem::ClipItem, id, model)
     , ClipController(id, std::move(producer))
-    , m_thumbsProducer(nullptr)
+    , m_thumbsProducers(nullptr)
 {
     m_markerModel = std::make_shared<MarkerListModel>(id, pCore->projectManager()->undoStack());
     m_clipStatus = StatusReady;
@@ -124,7 +128,7 @@ void ProjectClip::importEffects(const std::shared_ptr<Mlt::Producer> &producer)
 ProjectClip::ProjectClip(const QString &id, const QDomElement &description, const QIcon &thumb, const std::shared_ptr<ProjectItemModel> &model)
     : AbstractProjectItem(AbstractProjectItem::ClipItem, id, model)
     , ClipController(id)
-    , m_thumbsProducer(nullptr)
+    , m_thumbsProducers(nullptr)
 {
     m_clipStatus = StatusWaiting;
     m_thumbnail = thumb;
@@ -162,7 +166,7 @@ ProjectClip::~ProjectClip()
     m_requestedThumbs.clear();
     m_thumbMutex.unlock();
     m_thumbThread.waitForFinished();
-    audioFrameCache.clear();
+    audioFrameCache.reset();
 }
 
 void ProjectClip::connectEffectStack()
@@ -193,9 +197,9 @@ QString ProjectClip::getXmlProperty(const QDomElement &producer, const QString &
     return value;
 }
 
-void ProjectClip::updateAudioThumbnail(const QVector<double> audioLevels)
+void ProjectClip::updateAudioThumbnail(std::shared_ptr<AudioLevels> audioLevels)
 {
-    audioFrameCache = audioLevels;
+    audioFrameCache = std::move(audioLevels);
     m_audioThumbCreated = true;
 }
 
@@ -315,7 +319,7 @@ void ProjectClip::reloadProducer(bool refreshOnly, bool audioStreamChanged, bool
         // Clear cache first
         ThumbnailCache::get()->invalidateThumbsForClip(clipId(), false);
         pCore->jobManager()->discardJobs(clipId(), AbstractClipJob::THUMBJOB);
-        m_thumbsProducer.reset();
+        m_thumbsProducers.reset();
         pCore->jobManager()->startJob<ThumbJob>({clipId()}, loadjobId, QString(), 150, -1, true, true);
     } else {
         // If another load job is running?
@@ -329,7 +333,7 @@ void ProjectClip::reloadProducer(bool refreshOnly, bool audioStreamChanged, bool
         QDomElement xml = toXml(doc);
         if (!xml.isNull()) {
             pCore->jobManager()->discardJobs(clipId(), AbstractClipJob::THUMBJOB);
-            m_thumbsProducer.reset();
+            m_thumbsProducers.reset();
             ClipType::ProducerType type = clipType();
             if (type != ClipType::Color && type != ClipType::Image && type != ClipType::SlideShow) {
                 xml.removeAttribute("out");
@@ -411,7 +415,9 @@ bool ProjectClip::setProducer(std::shared_ptr<Mlt::Producer> producer, bool repl
     qDebug() << "################### ProjectClip::setproducer";
     QMutexLocker locker(&m_producerMutex);
     updateProducer(producer);
-    m_thumbsProducer.reset();
+    m_thumbMutex.lock();
+    m_thumbsProducers.reset();
+    m_thumbMutex.unlock();
     connectEffectStack();
 
     // Update info
@@ -503,47 +509,68 @@ bool ProjectClip::setProducer(std::shared_ptr<Mlt::Producer> producer, bool repl
     return true;
 }
 
-std::shared_ptr<Mlt::Producer> ProjectClip::thumbProducer()
+std::shared_ptr<Mlt::Producer> ProjectClip::thumbProducer(int timeout)
 {
-    if (m_thumbsProducer) {
-        return m_thumbsProducer;
-    }
     if (clipType() == ClipType::Unknown) {
         return nullptr;
     }
-    QMutexLocker lock(&m_thumbMutex);
+    std::shared_ptr<ProducerPool> pool;
+    m_thumbMutex.lock();
+    if (!m_thumbsProducers) {
+        // Each producer decodes the media on its own, keep a few of them for the jobs and the timeline thumbnails
+        std::weak_ptr<ProjectClip> clip = std::static_pointer_cast<ProjectClip>(shared_from_this());
+        m_thumbsProducers = ProducerPool::construct(
+            [clip]() {
+                auto ptr = clip.lock();
+                return ptr ? ptr->createThumbProducer() : nullptr;
+            },
+            qBound(1, QThread::idealThreadCount() / 2, 3));
+    }
+    pool = m_thumbsProducers;
+    m_thumbMutex.unlock();
+    return pool->acquire(timeout);
+}
+
+std::shared_ptr<Mlt::Producer> ProjectClip::createThumbProducer()
+{
     std::shared_ptr<Mlt::Producer> prod = originalProducer();
     if (!prod->is_valid()) {
         return nullptr;
     }
+    std::shared_ptr<Mlt::Producer> thumbProducer;
     if (KdenliveSettings::gpu_accel()) {
         // TODO: when the original producer changes, we must reload this thumb producer
-        m_thumbsProducer = softClone(ClipController::getPassPropertiesList());
+        thumbProducer = softClone(ClipController::getPassPropertiesList());
+        if (!thumbProducer || !thumbProducer->is_valid()) {
+            return nullptr;
+        }
         Mlt::Filter converter(*prod->profile(), "avcolor_space");
-        m_thumbsProducer->attach(converter);
+        thumbProducer->attach(converter);
     } else {
         QString mltService = m_masterProducer->get("mlt_service");
         const QString mltResource = m_masterProducer->get("resource");
         if (mltService == QLatin1String("avformat")) {
             mltService = QStringLiteral("avformat-novalidate");
         }
-        m_thumbsProducer.reset(new Mlt::Producer(*pCore->thumbProfile(), mltService.toUtf8().constData(), mltResource.toUtf8().constData()));
-        if (m_thumbsProducer->is_valid()) {
-            Mlt::Properties original(m_masterProducer->get_properties());
-            Mlt::Properties cloneProps(m_thumbsProducer->get_properties());
-            cloneProps.pass_list(original, ClipController::getPassPropertiesList());
-            Mlt::Filter scaler(*pCore->thumbProfile(), "swscale");
-            Mlt::Filter padder(*pCore->thumbProfile(), "resize");
-            Mlt::Filter converter(*pCore->thumbProfile(), "avcolor_space");
-            m_thumbsProducer->set("audio_index", -1);
-            // Required to make get_playtime() return > 1
-            m_thumbsProducer->set("out", m_thumbsProducer->get_length() -1);
-            m_thumbsProducer->attach(scaler);
-            m_thumbsProducer->attach(padder);
-            m_thumbsProducer->attach(converter);
+        thumbProducer.reset(new Mlt::Producer(*pCore->thumbProfile(), mltService.toUtf8().constData(), mltResource.toUtf8().constData()));
+        if (!thumbProducer->is_valid()) {
+            // The pool would count an unusable producer as busy
+            return nullptr;
         }
+        Mlt::Properties original(m_masterProducer->get_properties());
+        Mlt::Properties cloneProps(thumbProducer->get_properties());
+        cloneProps.pass_list(original, ClipController::getPassPropertiesList());
+        Mlt::Filter scaler(*pCore->thumbProfile(), "swscale");
+        Mlt::Filter padder(*pCore->thumbProfile(), "resize");
+        Mlt::Filter converter(*pCore->thumbProfile(), "avcolor_space");
+        thumbProducer->set("audio_index", -1);
+        // Required to make get_playtime() return > 1
+        thumbProducer->set("out", thumbProducer->get_length() -1);
+        thumbProducer->attach(scaler);
+        thumbProducer->attach(padder);
+        thumbProducer->attach(converter);
     }
-    return m_thumbsProducer;
+    return thumbProducer;
 }
 
 void ProjectClip::createDisabledMasterProducer()
@@ -904,27 +931,17 @@ const QString ProjectClip::getFileHash()
         fileData = getProducerProperty(QStringLiteral("resource")).toUtf8();
         fileHash = QCryptographicHash::hash(fileData, QCryptographicHash::Md5);
         break;
-    default:
-        QFile file(clipUrl());
-        if (file.open(QIODevice::ReadOnly)) { // write size and hash only if resource points to a file
-            /*
-             * 1 MB = 1 second per 450 files (or faster)
-             * 10 MB = 9 seconds per 450 files (or faster)
-             */
-            if (file.size() > 2000000) {
-                fileData = file.read(1000000);
-                if (file.seek(file.size() - 1000000)) {
-                    fileData.append(file.readAll());
-                }
-            } else {
-                fileData = file.readAll();
-            }
-            file.close();
-            ClipController::setProducerProperty(QStringLiteral("kdenlive:file_size"), QString::number(file.size()));
-            fileHash = QCryptographicHash::hash(fileData, QCryptographicHash::Md5);
+    default: {
+        // The hash is usually already cached by the load job, so the file is not read again here
+        qint64 size = 0;
+        const QString hash = FileHashCache::get()->hash(clipUrl(), &size);
+        if (!hash.isEmpty()) { // write size and hash only if resource points to a file
+            ClipController::setProducerProperty(QStringLiteral("kdenlive:file_size"), QString::number(size));
+            fileHash = QByteArray::fromHex(hash.toLatin1());
         }
         break;
     }
+    }
     if (fileHash.isEmpty()) {
         qDebug() << "// WARNING EMPTY CLIP HASH: ";
         return QString();
@@ -1212,17 +1229,20 @@ int ProjectClip::audioChannels() const
 void ProjectClip::discardAudioThumb()
 {
     QString audioThumbPath = getAudioThumbPath();
+    audioFrameCache.reset();
     if (!audioThumbPath.isEmpty()) {
+        // The timeline waveforms may still map the cache file
+        AudioLevels::releaseMappings(audioThumbPath);
         QFile::remove(audioThumbPath);
+        QFile::remove(getAudioThumbPath(false, true));
     }
-    audioFrameCache.clear();
     qCDebug(KDENLIVE_LOG) << "////////////////////  DISCARD AUIIO THUMBNS";
     m_audioThumbCreated = false;
     refreshAudioInfo();
     pCore->jobManager()->discardJobs(clipId(), AbstractClipJob::AUDIOTHUMBJOB);
 }
 
-const QString ProjectClip::getAudioThumbPath(bool miniThumb)
+const QString ProjectClip::getAudioThumbPath(bool miniThumb, bool legacy)
 {
     if (audioInfo() == nullptr && !miniThumb) {
         return QString();
@@ -1246,7 +1266,8 @@ const QString ProjectClip::getAudioThumbPath(bool miniThumb)
         audioPath.append(QLatin1Char('_') + QString::number(audioInfo()->audio_index()));
     }
     int roundedFps = (int)pCore->getCurrentFps();
-    audioPath.append(QStringLiteral("_%1_audio.png").arg(roundedFps));
+    audioPath.append(QStringLiteral("_%1_audio").arg(roundedFps));
+    audioPath.append(legacy ? QStringLiteral(".png") : QStringLiteral(".levels"));
     return audioPath;
 }
 
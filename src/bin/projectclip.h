@@ -32,8 +32,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <QMutex>
 #include <memory>
 
+class AudioLevels;
 class ClipPropertiesController;
 class ProjectFolder;
+class ProducerPool;
 class ProjectSubClip;
 class QDomElement;
 
@@ -147,8 +149,10 @@ public:
     /** @brief Returns true if this clip already has a producer. */
     bool isReady() const;
 
-    /** @brief Returns this clip's producer. */
-    std::shared_ptr<Mlt::Producer> thumbProducer();
+    /** @brief Returns a producer to extract thumbnails, for the exclusive use of the caller until the returned pointer is released.
+     *  The producers come from a small pool, so that several thumbnails of the clip can be extracted at the same time
+     *  @param timeout maximum time to wait for a free producer in milliseconds. Returns nullptr if none is available by then, or if the media cannot be opened */
+    std::shared_ptr<Mlt::Producer> thumbProducer(int timeout);
 
     /** @brief Recursively disable/enable bin effects. */
     void setBinEffectsEnabled(bool enabled) override;
@@ -167,9 +171,8 @@ public:
     /** @brief Returns true if we are using a proxy for this clip. */
     bool hasProxy() const;
 
-    /** Cache for every audio Frame with 10 Bytes */
-    /** format is frame -> channel ->bytes */
-    QVector<double> audioFrameCache;
+    /** Audio levels of the clip, with one value per frame and per channel */
+    std::shared_ptr<AudioLevels> audioFrameCache;
     bool audioThumbCreated() const;
 
     void setWaitingStatus(const QString &id);
@@ -185,8 +188,10 @@ public:
     QStringList subClipIds() const;
     /** @brief Delete cached audio thumb - needs to be recreated */
     void discardAudioThumb();
-    /** @brief Get path for this clip's audio thumbnail */
-    const QString getAudioThumbPath(bool miniThumb = false);
+    /** @brief Get path for this clip's audio thumbnail
+        @param miniThumb if true, returns the path of the waveform image displayed in monitor, otherwise the path of the audio levels cache
+        @param legacy if true, returns the path of the image used by older versions to store the audio levels */
+    const QString getAudioThumbPath(bool miniThumb = false, bool legacy = false);
     /** @brief Returns true if this producer has audio and can be splitted on timeline*/
     bool isSplittable() const;
 
@@ -245,7 +250,7 @@ protected:
 public slots:
     /* @brief Store the audio thumbnails once computed. Note that the parameter is a value and not a reference, fill free to use it as a sink (use std::move to
      * avoid copy). */
-    void updateAudioThumbnail(const QVector<double> audioLevels);
+    void updateAudioThumbnail(std::shared_ptr<AudioLevels> audioLevels);
     /** @brief Delete the proxy file */
     void deleteProxy();
 
@@ -255,7 +260,9 @@ public slots:
 private:
     /** @brief Generate and store file hash if not available. */
     const QString getFileHash();
-    std::shared_ptr<Mlt::Producer> m_thumbsProducer;
+    /** @brief Creates a producer for the thumbnails pool */
+    std::shared_ptr<Mlt::Producer> createThumbProducer();
+    std::shared_ptr<ProducerPool> m_thumbsProducers;
     QMutex m_producerMutex;
     QMutex m_thumbMutex;
     QFuture<void> m_thumbThread;
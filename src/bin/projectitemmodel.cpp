@@ -24,6 +24,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "projectitemmodel.h"
 #include "abstractprojectitem.h"
 #include "binplaylist.hpp"
+#include "binsearchindex.h"
 #include "core.h"
 #include "doc/kdenlivedoc.h"
 #include "filewatcher.hpp"
@@ -55,6 +56,7 @@ ProjectItemModel::ProjectItemModel(QObject *parent)
     , m_lock(QReadWriteLock::Recursive)
     , m_binPlaylist(new BinPlaylist())
     , m_fileWatcher(new FileWatcher())
+    , m_searchIndex(new BinSearchIndex())
     , m_nextId(1)
     , m_blankThumb()
     , m_dragType(PlaylistState::Disabled)
@@ -65,6 +67,7 @@ ProjectItemModel::ProjectItemModel(QObject *parent)
     connect(m_fileWatcher.get(), &FileWatcher::binClipModified, this, &ProjectItemModel::reloadClip);
     connect(m_fileWatcher.get(), &FileWatcher::binClipWaiting, this, &ProjectItemModel::setClipWaiting);
     connect(m_fileWatcher.get(), &FileWatcher::binClipMissing, this, &ProjectItemModel::setClipInvalid);
+    connect(this, &ProjectItemModel::dataChanged, this, &ProjectItemModel::updateSearchIndex);
 }
 
 std::shared_ptr<ProjectItemModel> ProjectItemModel::construct(QObject *parent)
@@ -379,7 +382,7 @@ std::shared_ptr<ProjectClip> ProjectItemModel::getClipByBinID(const QString &bin
     return nullptr;
 }
 
-const QVector<double> ProjectItemModel::getAudioLevelsByBinID(const QString &binId)
+std::shared_ptr<AudioLevels> ProjectItemModel::getAudioLevelsByBinID(const QString &binId)
 {
     READ_LOCK();
     if (binId.contains(QLatin1Char('_'))) {
@@ -391,7 +394,7 @@ const QVector<double> ProjectItemModel::getAudioLevelsByBinID(const QString &bin
             return std::static_pointer_cast<ProjectClip>(c)->audioFrameCache;
         }
     }
-    return QVector<double>();
+    return nullptr;
 }
 
 bool ProjectItemModel::hasClip(const QString &binId)
@@ -586,6 +589,7 @@ void ProjectItemModel::registerItem(const std::shared_ptr<TreeItem> &item)
     auto clip = std::static_pointer_cast<AbstractProjectItem>(item);
     m_binPlaylist->manageBinItemInsertion(clip);
     AbstractTreeModel::registerItem(item);
+    indexItem(clip);
     if (clip->itemType() == AbstractProjectItem::ClipItem) {
         auto clipItem = std::static_pointer_cast<ProjectClip>(clip);
         updateWatcher(clipItem);
@@ -598,12 +602,57 @@ void ProjectItemModel::deregisterItem(int id, TreeItem *item)
     m_binPlaylist->manageBinItemDeletion(clip);
     // TODO : here, we should suspend jobs belonging to the item we delete. They can be restarted if the item is reinserted by undo
     AbstractTreeModel::deregisterItem(id, item);
+    m_searchIndex->remove(id);
     if (clip->itemType() == AbstractProjectItem::ClipItem) {
         auto clipItem = static_cast<ProjectClip *>(clip);
         m_fileWatcher->removeFile(clipItem->clipId());
     }
 }
 
+void ProjectItemModel::indexItem(const std::shared_ptr<AbstractProjectItem> &item)
+{
+    BinSearchIndex::Entry entry;
+    // Same columns as the ones searched by the bin filter
+    entry.texts << item->getData(AbstractProjectItem::DataName).toString() << item->getData(AbstractProjectItem::DataDate).toString()
+                << item->getData(AbstractProjectItem::DataDescription).toString();
+    entry.tag = item->getData(AbstractProjectItem::DataTag).toString();
+    entry.type = item->getData(AbstractProjectItem::ClipType).toInt();
+    m_searchIndex->update(item->getId(), entry);
+}
+
+void ProjectItemModel::updateSearchIndex(const QModelIndex &topLeft, const QModelIndex &bottomRight)
+{
+    READ_LOCK();
+    for (int row = topLeft.row(); row <= bottomRight.row(); ++row) {
+        QModelIndex ix = index(row, 0, topLeft.parent());
+        if (ix.isValid()) {
+            indexItem(getBinItemByIndex(ix));
+        }
+    }
+}
+
+std::unordered_set<int> ProjectItemModel::getSearchResults(const QString &text, const QString &tag, int type) const
+{
+    READ_LOCK();
+    std::unordered_set<int> result = m_searchIndex->match(text, tag, type);
+    std::vector<int> matches(result.begin(), result.end());
+    // Folders containing a match must stay visible. We stop climbing at the first folder already known to be visible
+    for (int id : matches) {
+        auto item = getItemById(id);
+        auto parent = item ? item->parentItem().lock() : nullptr;
+        while (parent && parent != rootItem && result.count(parent->getId()) == 0) {
+            result.insert(parent->getId());
+            parent = parent->parentItem().lock();
+        }
+    }
+    return result;
+}
+
+quint64 ProjectItemModel::searchRevision() const
+{
+    return m_searchIndex->revision();
+}
+
 int ProjectItemModel::getFreeFolderId()
 {
     while (!isIdFree(QString::number(++m_nextId))) {
@@ -32,9 +32,12 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <QIcon>
 #include <QReadWriteLock>
 #include <QSize>
+#include <unordered_set>
 
 class AbstractProjectItem;
+class AudioLevels;
 class BinPlaylist;
+class BinSearchIndex;
 class FileWatcher;
 class MarkerListModel;
 class ProjectClip;
@@ -68,7 +71,7 @@ public:
     /** @brief Returns a clip from the hierarchy, given its id */
     std::shared_ptr<ProjectClip> getClipByBinID(const QString &binId);
     /** @brief Returns audio levels for a clip from its id */
-    const QVector <double>getAudioLevelsByBinID(const QString &binId);
+    std::shared_ptr<AudioLevels> getAudioLevelsByBinID(const QString &binId);
 
     /** @brief Returns a list of clips using the given url */
     QStringList getClipByUrl(const QFileInfo &url) const;
@@ -104,6 +107,14 @@ public:
     /* @brief Convenience method to retrieve a pointer to an element given its index */
     std::shared_ptr<AbstractProjectItem> getBinItemByIndex(const QModelIndex &index) const;
 
+    /** @brief Returns the ids of the items matching the bin filter, and of the folders containing them.
+        @param text must be contained (case insensitive) in the name, date or description of the item
+        @param tag must be contained (case insensitive) in the tags of the item
+        @param type is the required clip type, or 0 to accept any type */
+    std::unordered_set<int> getSearchResults(const QString &text, const QString &tag, int type) const;
+    /** @brief Returns a counter increased each time the searchable data of an item changes */
+    quint64 searchRevision() const;
+
     /* @brief Load the folders given the property containing them */
     bool loadFolders(Mlt::Properties &folders);
 
@@ -220,6 +231,9 @@ protected:
     /* @brief Function to be called when the url of a clip changes */
     void updateWatcher(const std::shared_ptr<ProjectClip> &item);
 
+    /* @brief Stores the searchable data of an item in the search index */
+    void indexItem(const std::shared_ptr<AbstractProjectItem> &item);
+
 public slots:
     /** @brief An item in the list was modified, notify */
     void onItemUpdated(const std::shared_ptr<AbstractProjectItem> &item, int role);
@@ -233,6 +247,10 @@ public slots:
     @param data is a definition of the subclips (keys are subclips' names, value are "in:out")*/
     void loadSubClips(const QString &id, const QString &clipData);
 
+private slots:
+    /** @brief Update the search index of the modified items */
+    void updateSearchIndex(const QModelIndex &topLeft, const QModelIndex &bottomRight);
+
 private:
     /** @brief Return reference to column specific data */
     int mapToColumn(int column) const;
@@ -243,6 +261,8 @@ private:
 
     std::unique_ptr<FileWatcher> m_fileWatcher;
 
+    std::unique_ptr<BinSearchIndex> m_searchIndex;
+
     int m_nextId;
     QIcon m_blankThumb;
     PlaylistState::ClipState m_dragType;
@@ -21,12 +21,14 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "projectsortproxymodel.h"
 #include "abstractprojectitem.h"
+#include "projectitemmodel.h"
 
 #include <QItemSelectionModel>
 
 ProjectSortProxyModel::ProjectSortProxyModel(QObject *parent)
     : QSortFilterProxyModel(parent)
     , m_searchType(0)
+    , m_acceptedRevision(0)
 {
     m_collator.setNumericMode(true);
     m_collator.setCaseSensitivity(Qt::CaseInsensitive);
@@ -38,74 +40,21 @@ ProjectSortProxyModel::ProjectSortProxyModel(QObject *parent)
 // Responsible for item sorting!
 bool ProjectSortProxyModel::filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const
 {
-    if (filterAcceptsRowItself(sourceRow, sourceParent)) {
+    if (m_searchString.isEmpty() && m_searchTag.isEmpty() && m_searchType == 0) {
         return true;
     }
-    // accept if any of the children is accepted on it's own merits
-    return hasAcceptedChildren(sourceRow, sourceParent);
-}
-
-bool ProjectSortProxyModel::filterAcceptsRowItself(int sourceRow, const QModelIndex &sourceParent) const
-{
-    for (int i = 0; i < 3; i++) {
-        QModelIndex index0 = sourceModel()->index(sourceRow, i, sourceParent);
-        if (!index0.isValid()) {
-            return false;
-        }
-        bool typeAccepted = false;
-        bool tagAccepted = false;
-        auto data = sourceModel()->data(index0);
-        if (m_searchType > 0) {
-            QModelIndex indexTag = sourceModel()->index(sourceRow, 3, sourceParent);
-            if (sourceModel()->data(indexTag).toInt() == m_searchType) {
-                typeAccepted = true;
-            }
-        } else {
-            typeAccepted = true;
-        }
-        if (!typeAccepted) {
-            return false;
-        }
-        if (!m_searchTag.isEmpty()) {
-            // Column 4 contains the item tag data
-            QModelIndex indexTag = sourceModel()->index(sourceRow, 4, sourceParent);
-            auto tagData = sourceModel()->data(indexTag);
-            if (tagData.toString().contains(m_searchTag, Qt::CaseInsensitive)) {
-                tagAccepted = true;
-            }
-        } else {
-            tagAccepted = true;
-        }
-        if (tagAccepted && data.toString().contains(m_searchString, Qt::CaseInsensitive)) {
-            return true;
-        }
-    }
-    return false;
-}
-
-bool ProjectSortProxyModel::hasAcceptedChildren(int sourceRow, const QModelIndex &source_parent) const
-{
-    QModelIndex item = sourceModel()->index(sourceRow, 0, source_parent);
-    if (!item.isValid()) {
-        return false;
-    }
-
-    // check if there are children
-    int childCount = item.model()->rowCount(item);
-    if (childCount == 0) {
+    QModelIndex index0 = sourceModel()->index(sourceRow, 0, sourceParent);
+    if (!index0.isValid()) {
         return false;
     }
-
-    for (int i = 0; i < childCount; ++i) {
-        if (filterAcceptsRowItself(i, item)) {
-            return true;
-        }
-        // recursive call -> NOTICE that this is depth-first searching, you're probably better off with breadth first search...
-        if (hasAcceptedChildren(i, item)) {
-            return true;
-        }
+    auto *model = static_cast<ProjectItemModel *>(sourceModel());
+    // The results of the search index are shared by all the rows, they only need to be computed again when the bin content changes
+    quint64 revision = model->searchRevision();
+    if (m_acceptedRevision != revision) {
+        m_acceptedItems = model->getSearchResults(m_searchString, m_searchTag, m_searchType);
+        m_acceptedRevision = revision;
     }
-    return false;
+    return m_acceptedItems.count(model->getBinItemByIndex(index0)->getId()) > 0;
 }
 
 bool ProjectSortProxyModel::lessThan(const QModelIndex &left, const QModelIndex &right) const
@@ -144,12 +93,14 @@ QItemSelectionModel *ProjectSortProxyModel::selectionModel()
 void ProjectSortProxyModel::slotSetSearchString(const QString &str)
 {
     m_searchString = str;
+    m_acceptedRevision = 0;
     invalidateFilter();
 }
 
 void ProjectSortProxyModel::slotSetSearchTag(const QString &str, bool reload)
 {
     m_searchTag = str;
+    m_acceptedRevision = 0;
     if (reload) {
         invalidateFilter();
     }
@@ -158,6 +109,7 @@ void ProjectSortProxyModel::slotSetSearchTag(const QString &str, bool reload)
 void ProjectSortProxyModel::slotSetSearchType(const int type, bool reload)
 {
     m_searchType = type;
+    m_acceptedRevision = 0;
     if (reload) {
         invalidateFilter();
     }
@@ -24,6 +24,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <QCollator>
 #include <QSortFilterProxyModel>
+#include <unordered_set>
 
 class QItemSelectionModel;
 
@@ -60,8 +61,6 @@ protected:
     bool filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const override;
     /** @brief Reimplemented to show folders first  */
     bool lessThan(const QModelIndex &left, const QModelIndex &right) const override;
-    bool filterAcceptsRowItself(int source_row, const QModelIndex &source_parent) const;
-    bool hasAcceptedChildren(int source_row, const QModelIndex &source_parent) const;
 
 private:
     QItemSelectionModel *m_selection;
@@ -69,6 +68,10 @@ private:
     QString m_searchTag;
     int m_searchType;
     QCollator m_collator;
+    /** @brief Ids of the items matching the filter and of the folders containing them, computed on demand by the source model's search index */
+    mutable std::unordered_set<int> m_acceptedItems;
+    /** @brief Search revision of the source model for which m_acceptedItems was computed, or 0 if it has to be computed */
+    mutable quint64 m_acceptedRevision;
 
 signals:
     /** @brief Emitted when the row changes, used to prepare action for selected item  */
@@ -29,6 +29,7 @@ the Free Software Foundation, either version 3 of the License, or
 #include "timeline2/model/timelineitemmodel.hpp"
 #include "timeline2/view/timelinecontroller.h"
 #include "timeline2/view/timelinewidget.h"
+#include "utils/mediaprobecache.hpp"
 
 #include <mlt++/MltRepository.h>
 
@@ -742,6 +743,8 @@ void Core::triggerAction(const QString &name)
 
 void Core::clean()
 {
+    // The background probe checks use the core, finish them while it still exists
+    MediaProbeCache::get()->shutdown();
     m_self.reset();
 }
 
@@ -0,0 +1,246 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by the Kdenlive developers                         *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include "autosavejournal.h"
+#include "kdenlive_debug.h"
+
+#include <QDataStream>
+#include <QFile>
+#include <QMutexLocker>
+#include <QtConcurrent>
+#include <algorithm>
+
+namespace {
+const char JournalMagic[] = "KDAJ";
+const quint32 JournalVersion = 1;
+const int HeaderSize = 8;
+// Size of the size and checksum preceding each record
+const int RecordHeaderSize = 6;
+
+enum RecordType : quint8 { SnapshotRecord = 0, DeltaRecord = 1 };
+
+/* Returns a record replacing removed bytes at prefix by inserted */
+QByteArray encodeRecord(RecordType type, quint32 prefix, quint32 removed, const QByteArray &inserted, const QString &operation)
+{
+    QByteArray payload;
+    QDataStream stream(&payload, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_5_9);
+    stream << quint8(type) << prefix << removed << inserted << operation;
+    QByteArray record;
+    QDataStream out(&record, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_5_9);
+    out << quint32(payload.size()) << qChecksum(payload.constData(), uint(payload.size()));
+    record.append(payload);
+    return record;
+}
+} // namespace
+
+AutoSaveJournal::AutoSaveJournal()
+    : m_snapshotSize(0)
+    , m_recordsSize(0)
+    , m_records(0)
+{
+    m_pool.setMaxThreadCount(1);
+}
+
+AutoSaveJournal::~AutoSaveJournal()
+{
+    waitForDone();
+}
+
+void AutoSaveJournal::save(const QString &fileName, const QString &scene, const QMap<QString, QString> &replacements, const QString &operation)
+{
+    QtConcurrent::run(&m_pool, this, &AutoSaveJournal::write, fileName, scene, replacements, operation);
+}
+
+void AutoSaveJournal::reset()
+{
+    waitForDone();
+    QMutexLocker lock(&m_mutex);
+    m_fileName.clear();
+    m_scene.clear();
+    m_snapshotSize = 0;
+    m_recordsSize = 0;
+    m_records = 0;
+}
+
+void AutoSaveJournal::waitForDone()
+{
+    m_pool.waitForDone();
+}
+
+void AutoSaveJournal::write(const QString &fileName, QString scene, const QMap<QString, QString> &replacements, const QString &operation)
+{
+    QMapIterator<QString, QString> i(replacements);
+    while (i.hasNext()) {
+        i.next();
+        scene.replace(i.key(), i.value());
+    }
+    const QByteArray data = scene.toUtf8();
+    QMutexLocker lock(&m_mutex);
+    // Compact when replaying the records would cost more than reading the snapshot again
+    bool compact = fileName != m_fileName || m_scene.isEmpty() || m_records >= MaxRecords || m_recordsSize > m_snapshotSize;
+    if (!compact && data == m_scene) {
+        return;
+    }
+    bool ok = compact ? writeSnapshot(fileName, data, operation) : appendDelta(fileName, data, operation);
+    if (!ok) {
+        qCDebug(KDENLIVE_LOG) << "ERROR; CANNOT WRITE AUTOSAVE JOURNAL" << fileName;
+        // Start again from a snapshot on next save
+        m_scene.clear();
+        return;
+    }
+    m_fileName = fileName;
+    m_scene = data;
+}
+
+bool AutoSaveJournal::writeSnapshot(const QString &fileName, const QByteArray &scene, const QString &operation)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+    QByteArray header(JournalMagic, 4);
+    QDataStream stream(&header, QIODevice::Append);
+    stream.setVersion(QDataStream::Qt_5_9);
+    stream << JournalVersion;
+    const QByteArray record = encodeRecord(SnapshotRecord, 0, 0, scene, operation);
+    if (file.write(header) != header.size() || file.write(record) != record.size() || !file.flush()) {
+        return false;
+    }
+    m_snapshotSize = record.size();
+    m_recordsSize = 0;
+    m_records = 0;
+    return true;
+}
+
+bool AutoSaveJournal::appendDelta(const QString &fileName, const QByteArray &scene, const QString &operation)
+{
+    // Only keep the range that differs between the previous and the new scene
+    const int common = std::min(scene.size(), m_scene.size());
+    const int prefix = int(std::mismatch(scene.constBegin(), scene.constBegin() + common, m_scene.constBegin()).first - scene.constBegin());
+    const int maxSuffix = common - prefix;
+    int suffix = 0;
+    while (suffix < maxSuffix && scene.at(scene.size() - 1 - suffix) == m_scene.at(m_scene.size() - 1 - suffix)) {
+        suffix++;
+    }
+    const QByteArray inserted = scene.mid(prefix, scene.size() - prefix - suffix);
+    const QByteArray record = encodeRecord(DeltaRecord, quint32(prefix), quint32(m_scene.size() - prefix - suffix), inserted, operation);
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        return false;
+    }
+    if (file.write(record) != record.size() || !file.flush()) {
+        return false;
+    }
+    m_recordsSize += record.size();
+    m_records++;
+    return true;
+}
+
+// static
+bool AutoSaveJournal::isJournal(const QByteArray &data)
+{
+    return data.startsWith(QByteArray(JournalMagic, 4));
+}
+
+// static
+QByteArray AutoSaveJournal::replay(const QByteArray &data, QStringList *operations, bool *ok)
+{
+    QByteArray scene;
+    bool hasSnapshot = false;
+    if (operations) {
+        operations->clear();
+    }
+    if (isJournal(data) && data.size() >= HeaderSize) {
+        QDataStream header(data.mid(4, 4));
+        quint32 version;
+        header >> version;
+        int pos = HeaderSize;
+        while (version == JournalVersion && data.size() - pos >= RecordHeaderSize) {
+            QDataStream recordHeader(data.mid(pos, RecordHeaderSize));
+            recordHeader.setVersion(QDataStream::Qt_5_9);
+            quint32 size;
+            quint16 checksum;
+            recordHeader >> size >> checksum;
+            pos += RecordHeaderSize;
+            if (qint64(size) > data.size() - pos) {
+                // Truncated record, the application stopped while writing it
+                break;
+            }
+            const QByteArray payload = data.mid(pos, int(size));
+            pos += int(size);
+            if (qChecksum(payload.constData(), uint(payload.size())) != checksum) {
+                break;
+            }
+            QDataStream stream(payload);
+            stream.setVersion(QDataStream::Qt_5_9);
+            quint8 type;
+            quint32 prefix;
+            quint32 removed;
+            QByteArray inserted;
+            QString operation;
+            stream >> type >> prefix >> removed >> inserted >> operation;
+            if (stream.status() != QDataStream::Ok) {
+                break;
+            }
+            if (type == SnapshotRecord) {
+                scene = inserted;
+                hasSnapshot = true;
+                if (operations) {
+                    operations->clear();
+                }
+            } else if (hasSnapshot && qint64(prefix) + removed <= scene.size()) {
+                scene.replace(int(prefix), int(removed), inserted);
+            } else {
+                break;
+            }
+            if (operations && !operation.isEmpty()) {
+                operations->append(operation);
+            }
+        }
+    }
+    if (ok) {
+        *ok = hasSnapshot;
+    }
+    return scene;
+}
+
+// static
+bool AutoSaveJournal::restore(QFile *file)
+{
+    if (!file->seek(0)) {
+        return false;
+    }
+    const QByteArray data = file->readAll();
+    if (!isJournal(data)) {
+        file->seek(0);
+        return true;
+    }
+    bool ok;
+    const QByteArray scene = replay(data, nullptr, &ok);
+    if (!ok || !file->resize(0) || !file->seek(0) || file->write(scene) != scene.size()) {
+        return false;
+    }
+    file->flush();
+    file->seek(0);
+    return true;
+}
@@ -0,0 +1,97 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by the Kdenlive developers                         *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef AUTOSAVEJOURNAL_H
+#define AUTOSAVEJOURNAL_H
+
+#include <QByteArray>
+#include <QMap>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+
+class QFile;
+
+/**
+ * @class AutoSaveJournal
+ * @brief Writes the autosave file of a document incrementally, on a worker thread.
+ *
+ * Instead of rewriting the whole scene at each autosave, the journal starts with a snapshot of
+ * the scene, followed by one record per autosave containing only the part of the scene that
+ * changed since the previous one, and the name of the last undo operation. When the records
+ * become too large compared to the snapshot, the file is compacted into a new snapshot.
+ * The replacement patterns, the comparison and the writing all happen on the worker thread,
+ * so that the GUI thread only has to produce the scene.
+ * On recovery, restore() replays the records into a regular project file.
+ */
+class AutoSaveJournal
+{
+public:
+    AutoSaveJournal();
+    ~AutoSaveJournal();
+
+    /** @brief Queue the save of a scene in the journal file
+        @param fileName the journal file, a new file always starts with a snapshot
+        @param replacements patterns replaced in the scene before saving it
+        @param operation the name of the last undo operation, for information
+    */
+    void save(const QString &fileName, const QString &scene, const QMap<QString, QString> &replacements, const QString &operation);
+    /** @brief Waits for the pending saves and forgets the journal content, the next save writes a new snapshot.
+        Must be called when the file was modified outside of the journal */
+    void reset();
+    /** @brief Waits until all queued saves are written */
+    void waitForDone();
+
+    /** @brief Returns true if the data is a journal rather than a project file */
+    static bool isJournal(const QByteArray &data);
+    /** @brief Rebuilds the last saved scene from journal data. A truncated last record is ignored
+        @param operations if not null, receives the operations recorded since the snapshot
+        @param ok is set to false if the journal has no valid snapshot
+    */
+    static QByteArray replay(const QByteArray &data, QStringList *operations = nullptr, bool *ok = nullptr);
+    /** @brief Replaces the content of an opened journal file by the scene it contains, so that it can be loaded as a project.
+        Does nothing if the file is not a journal. Returns false if the journal could not be replayed */
+    static bool restore(QFile *file);
+
+    /** @brief Maximum number of records after a snapshot before compacting */
+    static const int MaxRecords = 500;
+
+private:
+    /** @brief Called on the worker thread to write a scene */
+    void write(const QString &fileName, QString scene, const QMap<QString, QString> &replacements, const QString &operation);
+    bool writeSnapshot(const QString &fileName, const QByteArray &scene, const QString &operation);
+    bool appendDelta(const QString &fileName, const QByteArray &scene, const QString &operation);
+
+    /** @brief A single thread, so that the saves are written in order */
+    QThreadPool m_pool;
+    /** @brief This mutex protects the state below, which describes the content of the file */
+    QMutex m_mutex;
+    QString m_fileName;
+    /** @brief The scene of the last save */
+    QByteArray m_scene;
+    /** @brief Size of the snapshot and of the records written after it */
+    qint64 m_snapshotSize;
+    qint64 m_recordsSize;
+    int m_records;
+};
+
+#endif
@@ -23,6 +23,7 @@
 #include "kdenlivesettings.h"
 #include "kthumb.h"
 #include "titler/titlewidget.h"
+#include "utils/filehash.hpp"
 
 #include <KMessageBox>
 #include <KRecentDirs>
@@ -30,7 +31,6 @@
 #include <klocalizedstring.h>
 
 #include "kdenlive_debug.h"
-#include <QCryptographicHash>
 #include <QFile>
 #include <QFileDialog>
 #include <QFontDatabase>
@@ -722,14 +722,36 @@ void DocumentChecker::slotSearchClips()
     bool fixed = false;
     m_ui.recursiveSearch->setChecked(true);
     // TODO: make non modal
-    QTreeWidgetItem *child = m_ui.treeWidget->topLevelItem(ix);
     QDir searchDir(newpath);
+    // Index the folder once for all the missing clips, and hash the files that can match them in parallel
+    FileIndex index(newpath);
+    std::vector<qint64> sizes;
+    auto addSize = [&sizes](QTreeWidgetItem *item) {
+        // Clips without hash are searched by name
+        if (!item->data(0, hashRole).toString().isEmpty()) {
+            sizes.push_back(FileIndex::sizeFromString(item->data(0, sizeRole).toString()));
+        }
+    };
+    for (int i = 0; i < m_ui.treeWidget->topLevelItemCount(); ++i) {
+        QTreeWidgetItem *item = m_ui.treeWidget->topLevelItem(i);
+        const int status = item->data(0, statusRole).toInt();
+        if (status == SOURCEMISSING) {
+            for (int j = 0; j < item->childCount(); ++j) {
+                addSize(item->child(j));
+            }
+        } else if (status == CLIPMISSING) {
+            addSize(item);
+        }
+    }
+    index.prepare(sizes);
+    FileHashCache::get()->save();
+    QTreeWidgetItem *child = m_ui.treeWidget->topLevelItem(ix);
     while (child != nullptr) {
         if (child->data(0, statusRole).toInt() == SOURCEMISSING) {
             for (int j = 0; j < child->childCount(); ++j) {
                 QTreeWidgetItem *subchild = child->child(j);
                 QString clipPath =
-                    searchFileRecursively(searchDir, subchild->data(0, sizeRole).toString(), subchild->data(0, hashRole).toString(), subchild->text(1));
+                    searchFile(index, searchDir, subchild->data(0, sizeRole).toString(), subchild->data(0, hashRole).toString(), subchild->text(1));
                 if (!clipPath.isEmpty()) {
                     fixed = true;
                     subchild->setText(1, clipPath);
@@ -743,7 +765,7 @@ void DocumentChecker::slotSearchClips()
             QString clipPath;
             if (type != ClipType::SlideShow) {
                 // Slideshows cannot be found with hash / size
-                clipPath = searchFileRecursively(searchDir, child->data(0, sizeRole).toString(), child->data(0, hashRole).toString(), child->text(1));
+                clipPath = searchFile(index, searchDir, child->data(0, sizeRole).toString(), child->data(0, hashRole).toString(), child->text(1));
             }
             if (clipPath.isEmpty()) {
                 clipPath = searchPathRecursively(searchDir, QUrl::fromLocalFile(child->text(1)).fileName(), type);
@@ -854,48 +876,12 @@ QString DocumentChecker::searchPathRecursively(const QDir &dir, const QString &f
     return foundFileName;
 }
 
-QString DocumentChecker::searchFileRecursively(const QDir &dir, const QString &matchSize, const QString &matchHash, const QString &fileName) const
+QString DocumentChecker::searchFile(const FileIndex &index, const QDir &dir, const QString &matchSize, const QString &matchHash, const QString &fileName) const
 {
     if (matchSize.isEmpty() && matchHash.isEmpty()) {
         return searchPathRecursively(dir, QUrl::fromLocalFile(fileName).fileName());
     }
-    QString foundFileName;
-    QByteArray fileData;
-    QByteArray fileHash;
-    QStringList filesAndDirs = dir.entryList(QDir::Files | QDir::Readable);
-    for (int i = 0; i < filesAndDirs.size() && foundFileName.isEmpty(); ++i) {
-        QFile file(dir.absoluteFilePath(filesAndDirs.at(i)));
-        if (QString::number(file.size()) == matchSize) {
-            if (file.open(QIODevice::ReadOnly)) {
-                /*
-                 * 1 MB = 1 second per 450 files (or faster)
-                 * 10 MB = 9 seconds per 450 files (or faster)
-                 */
-                if (file.size() > 1000000 * 2) {
-                    fileData = file.read(1000000);
-                    if (file.seek(file.size() - 1000000)) {
-                        fileData.append(file.readAll());
-                    }
-                } else {
-                    fileData = file.readAll();
-                }
-                file.close();
-                fileHash = QCryptographicHash::hash(fileData, QCryptographicHash::Md5);
-                if (QString::fromLatin1(fileHash.toHex()) == matchHash) {
-                    return file.fileName();
-                }
-            }
-        }
-        ////qCDebug(KDENLIVE_LOG) << filesAndDirs.at(i) << file.size() << fileHash.toHex();
-    }
-    filesAndDirs = dir.entryList(QDir::Dirs | QDir::Readable | QDir::Executable | QDir::NoDotAndDotDot);
-    for (int i = 0; i < filesAndDirs.size() && foundFileName.isEmpty(); ++i) {
-        foundFileName = searchFileRecursively(dir.absoluteFilePath(filesAndDirs.at(i)), matchSize, matchHash, fileName);
-        if (!foundFileName.isEmpty()) {
-            break;
-        }
-    }
-    return foundFileName;
+    return index.find(FileIndex::sizeFromString(matchSize), matchHash, fileName);
 }
 
 void DocumentChecker::slotEditItem(QTreeWidgetItem *item, int)
@@ -27,6 +27,8 @@
 #include <QDomElement>
 #include <QUrl>
 
+class FileIndex;
+
 class DocumentChecker : public QObject
 {
     Q_OBJECT
@@ -64,7 +66,8 @@ private:
     QDialog *m_dialog;
     QPair<QString, QString> m_rootReplacement;
     QString searchPathRecursively(const QDir &dir, const QString &fileName, ClipType::ProducerType type = ClipType::Unknown) const;
-    QString searchFileRecursively(const QDir &dir, const QString &matchSize, const QString &matchHash, const QString &fileName) const;
+    /** @brief Returns the indexed file matching a clip size and hash, or looks for a file with the same name if the clip has no size and hash */
+    QString searchFile(const FileIndex &index, const QDir &dir, const QString &matchSize, const QString &matchHash, const QString &fileName) const;
     void checkStatus();
     QMap<QString, QString> m_missingTitleImages;
     QMap<QString, QString> m_missingTitleFonts;
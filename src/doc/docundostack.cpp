@@ -20,12 +20,154 @@
  ***************************************************************************/
 
 #include "docundostack.hpp"
+#include "kdenlivesettings.h"
+#include "undohelper.hpp"
 #include <QUndoCommand>
 #include <QUndoGroup>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace {
+size_t commandCost(const QUndoCommand *cmd)
+{
+    size_t cost = 0;
+    if (auto *functional = dynamic_cast<const FunctionalUndoCommand *>(cmd)) {
+        cost = functional->memoryCost();
+    }
+    for (int i = 0; i < cmd->childCount(); ++i) {
+        cost += commandCost(cmd->child(i));
+    }
+    return cost;
+}
+} // namespace
+
+/* @brief A command of the stack, sharing the ownership of the pushed command so that it survives the stack being rebuilt.
+   Its cost is added to the total of the stack while it exists.
+*/
+class DocUndoStack::Entry : public QUndoCommand
+{
+public:
+    Entry(std::shared_ptr<QUndoCommand> command, DocUndoStack &stack)
+        : m_command(std::move(command))
+        , m_stack(stack)
+        , m_cost(commandCost(m_command.get()))
+    {
+        setText(m_command->text());
+        m_stack.m_memoryCost += m_cost;
+    }
+    ~Entry() override { m_stack.m_memoryCost -= m_cost; }
+
+    void undo() override
+    {
+        if (!m_stack.m_rebuilding) {
+            m_command->undo();
+            setObsolete(m_command->isObsolete());
+        }
+    }
+    void redo() override
+    {
+        if (!m_stack.m_rebuilding) {
+            m_command->redo();
+            setObsolete(m_command->isObsolete());
+        }
+    }
+    int id() const override { return m_command->id(); }
+    bool mergeWith(const QUndoCommand *other) override
+    {
+        auto *entry = dynamic_cast<const Entry *>(other);
+        // Commands that were not merged when pushed must stay separate
+        if (m_stack.m_rebuilding || entry == nullptr || !m_command->mergeWith(entry->m_command.get())) {
+            return false;
+        }
+        setText(m_command->text());
+        setObsolete(m_command->isObsolete());
+        m_stack.m_memoryCost -= m_cost;
+        m_cost = commandCost(m_command.get());
+        m_stack.m_memoryCost += m_cost;
+        return true;
+    }
+
+    const std::shared_ptr<QUndoCommand> &command() const { return m_command; }
+    size_t cost() const { return m_cost; }
+
+private:
+    std::shared_ptr<QUndoCommand> m_command;
+    DocUndoStack &m_stack;
+    size_t m_cost;
+};
 
 DocUndoStack::DocUndoStack(QUndoGroup *parent)
     : QUndoStack(parent)
+    , m_memoryLimit(size_t(KdenliveSettings::undomemorylimit()) * 1024 * 1024)
+    , m_memoryCost(0)
+    , m_rebuilding(false)
+{
+}
+
+DocUndoStack::~DocUndoStack()
 {
+    // The entries update m_memoryCost, they must be deleted before it
+    clear();
+}
+
+void DocUndoStack::setMemoryLimit(size_t bytes)
+{
+    m_memoryLimit = bytes;
+    enforceMemoryLimit();
+}
+
+size_t DocUndoStack::memoryCost() const
+{
+    return m_memoryCost;
+}
+
+void DocUndoStack::enforceMemoryLimit()
+{
+    if (m_memoryLimit == 0 || m_memoryCost <= m_memoryLimit) {
+        return;
+    }
+    // The last done command is always kept, and commands that were undone are kept since they may be redone
+    const int current = index();
+    size_t cost = m_memoryCost;
+    int dropped = 0;
+    while (dropped < current - 1 && cost > m_memoryLimit) {
+        cost -= static_cast<const Entry *>(command(dropped))->cost();
+        ++dropped;
+    }
+    if (dropped == 0) {
+        return;
+    }
+    std::vector<std::shared_ptr<QUndoCommand>> kept;
+    kept.reserve(size_t(count() - dropped));
+    for (int i = dropped; i < count(); ++i) {
+        kept.push_back(static_cast<const Entry *>(command(i))->command());
+    }
+    const int clean = cleanIndex();
+
+    // QUndoStack cannot remove its first commands, so it is rebuilt with the kept ones, without executing them again
+    m_rebuilding = true;
+    blockSignals(true);
+    clear();
+    for (const auto &cmd : kept) {
+        QUndoStack::push(new Entry(cmd, *this));
+    }
+    if (clean >= dropped) {
+        setIndex(clean - dropped);
+        setClean();
+    } else {
+        // The saved state cannot be reached anymore
+        resetClean();
+    }
+    setIndex(current - dropped);
+    blockSignals(false);
+    m_rebuilding = false;
+    emit indexChanged(index());
+    emit cleanChanged(isClean());
+    emit canUndoChanged(canUndo());
+    emit canRedoChanged(canRedo());
+    emit undoTextChanged(undoText());
+    emit redoTextChanged(redoText());
 }
 
 // TODO: custom undostack everywhere do that
@@ -34,5 +176,6 @@ void DocUndoStack::push(QUndoCommand *cmd)
     if (index() < count()) {
         emit invalidate();
     }
-    QUndoStack::push(cmd);
+    QUndoStack::push(new Entry(std::shared_ptr<QUndoCommand>(cmd), *this));
+    enforceMemoryLimit();
 }
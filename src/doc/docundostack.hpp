@@ -26,14 +26,37 @@
 class QUndoGroup;
 class QUndoCommand;
 
+/** @class DocUndoStack
+    @brief The undo stack of a document, which limits the memory used by its commands.
+    When the estimated memory of the commands exceeds the limit, the oldest done commands are removed from the stack and
+    cannot be undone anymore. Since QUndoStack cannot remove single commands, the pushed commands are wrapped in entries
+    sharing their ownership, which allows to rebuild the stack without the oldest ones.
+ */
 class DocUndoStack : public QUndoStack
 {
     Q_OBJECT
 public:
     explicit DocUndoStack(QUndoGroup *parent = Q_NULLPTR);
+    ~DocUndoStack() override;
     void push(QUndoCommand *cmd);
+
+    /** @brief Set the maximum memory used by the commands, in bytes. 0 means no limit */
+    void setMemoryLimit(size_t bytes);
+    /** @brief Returns the estimated memory used by the commands, in bytes */
+    size_t memoryCost() const;
+
 signals:
     void invalidate();
+
+private:
+    class Entry;
+    /** @brief Remove the oldest commands until the memory limit is respected */
+    void enforceMemoryLimit();
+    size_t m_memoryLimit;
+    /** @brief Sum of the costs of the entries, updated when they are created and deleted */
+    size_t m_memoryCost;
+    /** @brief True while the stack is rebuilt, the commands must not be executed again */
+    bool m_rebuilding;
 };
 
 #endif
@@ -18,6 +18,7 @@
  ***************************************************************************/
 
 #include "kdenlivedoc.h"
+#include "autosavejournal.h"
 #include "bin/bin.h"
 #include "bin/bincommands.h"
 #include "bin/binplaylist.hpp"
@@ -40,6 +41,7 @@
 #include "project/projectcommands.h"
 #include "titler/titlewidget.h"
 #include "transitions/transitionsrepository.hpp"
+#include "utils/filehash.hpp"
 
 #include <config-kdenlive.h>
 
@@ -297,6 +299,8 @@ KdenliveDoc::~KdenliveDoc()
     // Clean up guide model
     m_guideModel.reset();
     // qCDebug(KDENLIVE_LOG) << "// DEL CLP MAN done";
+    // Wait for the pending autosaves before removing the file
+    m_autoSaveJournal.reset();
     if (m_autosave) {
         if (!m_autosave->fileName().isEmpty()) {
             m_autosave->remove();
@@ -448,7 +452,7 @@ bool KdenliveDoc::autoGenerateImageProxy(int width) const
            width > m_documentProperties.value(QStringLiteral("proxyimageminsize")).toInt();
 }
 
-void KdenliveDoc::slotAutoSave(const QString &scene)
+void KdenliveDoc::slotAutoSave(const QString &scene, const QMap<QString, QString> &replacements)
 {
     if (m_autosave != nullptr) {
         if (!m_autosave->isOpen() && !m_autosave->open(QIODevice::ReadWrite)) {
@@ -462,14 +466,42 @@ void KdenliveDoc::slotAutoSave(const QString &scene)
             KMessageBox::error(QApplication::activeWindow(), i18n("Cannot write to file %1, scene list is corrupted.", m_autosave->fileName()));
             return;
         }
+        if (KdenliveSettings::autosavejournal()) {
+            // The autosave file stays open to keep its lock, the journal writes it on a worker thread
+            if (!m_autoSaveJournal) {
+                m_autoSaveJournal.reset(new AutoSaveJournal());
+            }
+            m_autoSaveJournal->save(m_autosave->fileName(), scene, replacements, m_commandStack->undoText());
+            return;
+        }
+        if (m_autoSaveJournal) {
+            // Journal was disabled, wait for its last writes
+            m_autoSaveJournal.reset();
+        }
+        QString fullScene = scene;
+        QMapIterator<QString, QString> i(replacements);
+        while (i.hasNext()) {
+            i.next();
+            fullScene.replace(i.key(), i.value());
+        }
         m_autosave->resize(0);
-        if (m_autosave->write(scene.toUtf8()) < 0) {
+        if (m_autosave->write(fullScene.toUtf8()) < 0) {
             pCore->displayMessage(i18n("Cannot create autosave file %1", m_autosave->fileName()), ErrorMessage);
         };
         m_autosave->flush();
     }
 }
 
+void KdenliveDoc::clearAutoSave()
+{
+    if (m_autoSaveJournal) {
+        m_autoSaveJournal->reset();
+    }
+    if (m_autosave != nullptr) {
+        m_autosave->resize(0);
+    }
+}
+
 void KdenliveDoc::setZoom(int horizontal, int vertical)
 {
     m_documentProperties[QStringLiteral("zoom")] = QString::number(horizontal);
@@ -801,47 +833,9 @@ const QString KdenliveDoc::description() const
 
 QString KdenliveDoc::searchFileRecursively(const QDir &dir, const QString &matchSize, const QString &matchHash) const
 {
-    QString foundFileName;
-    QByteArray fileData;
-    QByteArray fileHash;
-    QStringList filesAndDirs = dir.entryList(QDir::Files | QDir::Readable);
-    for (int i = 0; i < filesAndDirs.size() && foundFileName.isEmpty(); ++i) {
-        QFile file(dir.absoluteFilePath(filesAndDirs.at(i)));
-        if (file.open(QIODevice::ReadOnly)) {
-            if (QString::number(file.size()) == matchSize) {
-                /*
-                 * 1 MB = 1 second per 450 files (or faster)
-                 * 10 MB = 9 seconds per 450 files (or faster)
-                 */
-                if (file.size() > 1000000 * 2) {
-                    fileData = file.read(1000000);
-                    if (file.seek(file.size() - 1000000)) {
-                        fileData.append(file.readAll());
-                    }
-                } else {
-                    fileData = file.readAll();
-                }
-                file.close();
-                fileHash = QCryptographicHash::hash(fileData, QCryptographicHash::Md5);
-                if (QString::fromLatin1(fileHash.toHex()) == matchHash) {
-                    return file.fileName();
-                }
-                qCDebug(KDENLIVE_LOG) << filesAndDirs.at(i) << "size match but not hash";
-            }
-        }
-        ////qCDebug(KDENLIVE_LOG) << filesAndDirs.at(i) << file.size() << fileHash.toHex();
-    }
-    filesAndDirs = dir.entryList(QDir::Dirs | QDir::Readable | QDir::Executable | QDir::NoDotAndDotDot);
-    for (int i = 0; i < filesAndDirs.size() && foundFileName.isEmpty(); ++i) {
-        foundFileName = searchFileRecursively(dir.absoluteFilePath(filesAndDirs.at(i)), matchSize, matchHash);
-        if (!foundFileName.isEmpty()) {
-            break;
-        }
-    }
-    return foundFileName;
+    return FileIndex(dir.absolutePath()).find(FileIndex::sizeFromString(matchSize), matchHash);
 }
 
-
 QStringList KdenliveDoc::getBinFolderClipIds(const QString &folderId) const
 {
     return pCore->bin()->getBinFolderClipIds(folderId);
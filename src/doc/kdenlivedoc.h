@@ -38,6 +38,7 @@
 #include "gentime.h"
 #include "timecode.h"
 
+class AutoSaveJournal;
 class MainWindow;
 class TrackInfo;
 class ProjectClip;
@@ -157,6 +158,8 @@ public:
     int clipsCount() const;
     /** @brief Returns a list of project tags (color / description) */
     QMap <QString, QString> getProjectTags();
+    /** @brief Empties the autosave file, after the project was saved */
+    void clearAutoSave();
 
 private:
     QUrl m_url;
@@ -187,6 +190,8 @@ private:
     QMap<QString, QString> m_documentProperties;
     QMap<QString, QString> m_documentMetadata;
     std::shared_ptr<MarkerListModel> m_guideModel;
+    /** @brief Writes the autosave file incrementally, if enabled */
+    std::unique_ptr<AutoSaveJournal> m_autoSaveJournal;
 
     QString searchFileRecursively(const QDir &dir, const QString &matchSize, const QString &matchHash) const;
 
@@ -216,8 +221,9 @@ public slots:
     void slotProxyCurrentItem(bool doProxy, QList<std::shared_ptr<ProjectClip>> clipList = QList<std::shared_ptr<ProjectClip>>(), bool force = false,
                               QUndoCommand *masterCommand = nullptr);
     /** @brief Saves the current project at the autosave location.
-     * @description The autosave files are in ~/.kde/data/stalefiles/kdenlive/ */
-    void slotAutoSave(const QString &scene);
+     * @description The autosave files are in ~/.kde/data/stalefiles/kdenlive/
+     * @param replacements patterns to replace in the scene before saving it */
+    void slotAutoSave(const QString &scene, const QMap<QString, QString> &replacements = QMap<QString, QString>());
     /** @brief Groups were changed, save to MLT. */
     void groupsChanged(const QString &groups);
 
@@ -28,6 +28,7 @@
 #include <KLocalizedString>
 #include <QDir>
 #include <QFile>
+#include <QMutex>
 #include <QStandardPaths>
 #include <QTextStream>
 #include <mlt++/Mlt.h>
@@ -120,6 +121,9 @@ void EffectsRepository::parseCustomAssetFile(const QString &file_name, std::unor
             result.type = EffectType::Hidden;
         } else if (type == QLatin1String("custom")) {
             // Old type effect, update to customVideo / customAudio
+            // Custom files are parsed in parallel on startup, query MLT for one file at a time
+            static QMutex metadataMutex;
+            QMutexLocker lock(&metadataMutex);
             const QString effectTag = currentEffect.attribute(QStringLiteral("tag"));
             QScopedPointer<Mlt::Properties> metadata(getMetadata(effectTag));
             if (metadata && metadata->is_valid()) {
@@ -162,6 +166,11 @@ void EffectsRepository::parseType(QScopedPointer<Mlt::Properties> &metadata, Inf
     }
 }
 
+QString EffectsRepository::assetCachePath() const
+{
+    return QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation)).absoluteFilePath(QStringLiteral("effects.cache"));
+}
+
 QString EffectsRepository::assetBlackListPath() const
 {
     return QStringLiteral(":data/blacklisted_effects.txt");
@@ -76,6 +76,9 @@ protected:
 
     QStringList assetDirs() const override;
 
+    /* @brief Returns the path of the file caching the parsed effects*/
+    QString assetCachePath() const override;
+
     void parseType(QScopedPointer<Mlt::Properties> &metadata, Info &res) override;
 
     /* @brief Returns the metadata associated with the given asset*/
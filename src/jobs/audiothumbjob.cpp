@@ -27,12 +27,13 @@
 #include "doc/kthumb.h"
 #include "kdenlivesettings.h"
 #include "klocalizedstring.h"
+#include "lib/audio/audioLevels.h"
 #include "lib/audio/audioStreamInfo.h"
 #include "macros.hpp"
 #include "utils/thumbnailcache.hpp"
 #include <QScopedPointer>
-#include <QTemporaryFile>
 #include <QProcess>
+#include <algorithm>
 #include <memory>
 #include <mlt++/MltProducer.h>
 
@@ -66,19 +67,13 @@ bool AudioThumbJob::computeWithMlt()
     audioProducer->set("video_index", "-1");
     Mlt::Filter chans(*m_prod->profile(), "audiochannels");
     Mlt::Filter converter(*m_prod->profile(), "audioconvert");
-    Mlt::Filter levels(*m_prod->profile(), "audiolevel");
     audioProducer->attach(chans);
     audioProducer->attach(converter);
-    audioProducer->attach(levels);
 
     int last_val = 0;
     double framesPerSecond = audioProducer->get_fps();
     mlt_audio_format audioFormat = mlt_audio_s16;
-    QStringList keys;
-    keys.reserve(m_channels);
-    for (int i = 0; i < m_channels; i++) {
-        keys << "meta.media.audio_level." + QString::number(i);
-    }
+    std::vector<int> peaks((size_t)m_channels, 0);
 
     for (int z = 0; z < m_lengthInFrames; ++z) {
         int val = (int)(100.0 * z / m_lengthInFrames);
@@ -89,10 +84,16 @@ bool AudioThumbJob::computeWithMlt()
         QScopedPointer<Mlt::Frame> mltFrame(audioProducer->get_frame());
         if ((mltFrame != nullptr) && mltFrame->is_valid() && (mltFrame->get_int("test_audio") == 0)) {
             int samples = mlt_sample_calculator(float(framesPerSecond), m_frequency, z);
-            mltFrame->get_audio(audioFormat, m_frequency, m_channels, samples);
-            for (int channel = 0; channel < m_channels; ++channel) {
-                double level = 256 * qMin(mltFrame->get_double(keys.at(channel).toUtf8().constData()) * 0.9, 1.0);
-                m_audioLevels << level;
+            int frequency = m_frequency;
+            int channels = m_channels;
+            const auto *data = static_cast<const qint16 *>(mltFrame->get_audio(audioFormat, frequency, channels, samples));
+            // Reduce the samples like the FFmpeg pipe does, so that the levels don't depend on the backend
+            std::fill(peaks.begin(), peaks.end(), 0);
+            if (data != nullptr && channels == m_channels) {
+                AudioLevels::accumulatePeaks(data, samples, m_channels, peaks.data());
+            }
+            for (int peak : peaks) {
+                m_audioLevels << AudioLevels::levelFromPeak(peak);
             }
         } else if (!m_audioLevels.isEmpty()) {
             for (int channel = 0; channel < m_channels; channel++) {
@@ -140,113 +141,80 @@ bool AudioThumbJob::computeWithFFMPEG()
     }
     if (!m_dataInCache && !m_done) {
         m_audioLevels.clear();
-        std::vector<std::unique_ptr<QTemporaryFile>> channelFiles;
-        for (int i = 0; i < m_channels; i++) {
-            std::unique_ptr<QTemporaryFile> channelTmpfile(new QTemporaryFile());
-            if (!channelTmpfile->open()) {
-                m_errorMessage.append(i18n("Audio thumbs: cannot create temporary file, check disk space and permissions\n"));
-                return false;
-            }
-            channelTmpfile->close();
-            channelFiles.emplace_back(std::move(channelTmpfile));
-        }
-        // Always create audio thumbs from the original source file, because proxy 
+        // Always create audio thumbs from the original source file, because proxy
         // can have a different audio config (channels / mono/ stereo)
-        QStringList args {QStringLiteral("-hide_banner"), QStringLiteral("-i"), QUrl::fromLocalFile(filePath).toLocalFile(), QStringLiteral("-progress")};
-#ifdef Q_OS_WIN
-        args << QStringLiteral("-");
-#else
-        args << QStringLiteral("/dev/stdout");
-#endif
-        bool isFFmpeg = KdenliveSettings::ffmpegpath().contains(QLatin1String("ffmpeg"));
-        args << QStringLiteral("-filter_complex:a");
-        if (m_channels == 1) {
-            //TODO: this does not correcty generate the correct stream data
-            args << QStringLiteral("aformat=channel_layouts=mono,%1=100").arg(isFFmpeg ? "aresample=async" : "sample_rates");
-            args << QStringLiteral("-map") << QStringLiteral("0:a%1").arg(m_audioStream > 0 ? ":" + QString::number(m_audioStream) : QString())
-             << QStringLiteral("-c:a") << QStringLiteral("pcm_s16le") << QStringLiteral("-frames:v") 
-             << QStringLiteral("1") << QStringLiteral("-y") << QStringLiteral("-f") << QStringLiteral("data")
-             << channelFiles[0]->fileName();
-        } else {
-            QString aformat = QStringLiteral("[0:a%1]%2=100,channelsplit=channel_layout=%3")
-                              .arg(m_audioStream > 0 ? ":" + QString::number(m_audioStream) : QString())
-                              .arg(isFFmpeg ? "aresample=async" : "aformat=sample_rates=")
-                              .arg(m_channels > 2 ? "5.1" : "stereo");
-            for (int i = 0; i < m_channels; ++i) {
-                aformat.append(QStringLiteral("[0:%1]").arg(i));
-            }
-            args << aformat;
-            args << QStringLiteral("-frames:v") << QStringLiteral("1");
-            for (int i = 0; i < m_channels; i++) {
-                // Channel 1
-                args << QStringLiteral("-map") << QStringLiteral("[0:%1]").arg(i) << QStringLiteral("-c:a") << QStringLiteral("pcm_s16le") << QStringLiteral("-y")
-                 << QStringLiteral("-f") << QStringLiteral("data") << channelFiles[size_t(i)]->fileName();
-            }
-        }
+        // Decoded audio is read from a pipe and reduced to one peak per frame on the fly,
+        // so that memory use does not depend on the clip length
+        QStringList args {QStringLiteral("-hide_banner"), QStringLiteral("-nostdin"), QStringLiteral("-nostats"), QStringLiteral("-loglevel"), QStringLiteral("error"),
+                          QStringLiteral("-i"), QUrl::fromLocalFile(filePath).toLocalFile()};
+        args << QStringLiteral("-map") << QStringLiteral("0:a%1").arg(m_audioStream > 0 ? ":" + QString::number(m_audioStream) : QString());
+        args << QStringLiteral("-vn") << QStringLiteral("-ac") << QString::number(m_channels) << QStringLiteral("-ar") << QString::number(m_frequency);
+        args << QStringLiteral("-c:a") << QStringLiteral("pcm_s16le") << QStringLiteral("-f") << QStringLiteral("s16le") << QStringLiteral("pipe:1");
         m_ffmpegProcess.reset(new QProcess);
-        connect(m_ffmpegProcess.get(), &QProcess::readyReadStandardOutput, this, &AudioThumbJob::updateFfmpegProgress, Qt::UniqueConnection);
         connect(this, &AudioThumbJob::jobCanceled, [&]() {
             if (m_ffmpegProcess) {
                 m_ffmpegProcess->kill();
             }
         });
+        m_ffmpegProcess->setReadChannel(QProcess::StandardOutput);
         m_ffmpegProcess->start(KdenliveSettings::ffmpegpath(), args);
-        m_ffmpegProcess->waitForFinished(-1);
-        if (m_ffmpegProcess->exitStatus() != QProcess::CrashExit) {
-            int dataSize = 0;
-            std::vector<const qint16 *> rawChannels;
-            std::vector<QByteArray> sourceChannels;
-            for (auto &channelFile : channelFiles) {
-                channelFile->open();
-                sourceChannels.emplace_back(channelFile->readAll());
-                QByteArray &res = sourceChannels.back();
-                channelFile->close();
-                if (dataSize == 0) {
-                    dataSize = res.size();
-                }
-                if (res.isEmpty() || res.size() != dataSize) {
-                    // Something went wrong, abort
-                    m_errorMessage.append(i18n("Audio thumbs: error reading audio thumbnail created with FFmpeg\n"));
-                    return false;
-                }
-                rawChannels.emplace_back((const qint16 *)res.constData());
-            }
+        if (m_ffmpegProcess->waitForStarted()) {
+            const double samplesPerFrame = m_frequency / pCore->getCurrentFps();
+            const int sampleSize = 2 * m_channels;
+            // Read 64k samples at once
+            const qint64 blockSize = 65536 * sampleSize;
+            std::vector<int> peaks((size_t)m_channels, 0);
+            QByteArray pending;
+            qint64 samplesRead = 0;
+            qint64 frameStart = 0;
+            qint64 frameEnd = qint64(samplesPerFrame);
             int progress = 0;
-            std::vector<long> channelsData;
-            double offset = (double)dataSize / (2.0 * m_lengthInFrames);
-            int intraOffset = 1;
-            if (offset > 1000) {
-                intraOffset = offset / 60;
-            } else if (offset > 250) {
-                intraOffset = offset / 10;
-            }
-            double factor = 800.0 / 32768;
-            for (int i = 0; i < m_lengthInFrames; i++) {
-                channelsData.resize((size_t)rawChannels.size());
-                std::fill(channelsData.begin(), channelsData.end(), 0);
-                int pos = (int)(i * offset);
-                int steps = 0;
-                for (int j = 0; j < (int)offset && (pos + j < dataSize); j += intraOffset) {
-                    steps++;
-                    for (size_t k = 0; k < rawChannels.size(); k++) {
-                    channelsData[k] += abs(rawChannels[k][pos + j]);
-                    }
-                }
-                for (long &k : channelsData) {
-                    if (steps != 0) {
-                        k /= steps;
-                    }
-                    m_audioLevels << (int)((double)k * factor);
+            auto storeFrame = [&]() {
+                for (int &peak : peaks) {
+                    m_audioLevels << AudioLevels::levelFromPeak(peak);
+                    peak = 0;
                 }
-                int p = 80 + (i * 20 / m_lengthInFrames);
+                frameStart = frameEnd;
+                frameEnd = qint64((m_audioLevels.size() / m_channels + 1) * samplesPerFrame);
+                int p = m_lengthInFrames > 0 ? qMin(100, int(100. * m_audioLevels.size() / m_channels / m_lengthInFrames)) : 0;
                 if (p != progress) {
                     emit jobProgress(p);
                     progress = p;
                 }
+            };
+            while (m_ffmpegProcess->state() != QProcess::NotRunning || m_ffmpegProcess->bytesAvailable() > 0) {
+                if (m_ffmpegProcess->bytesAvailable() == 0) {
+                    m_ffmpegProcess->waitForReadyRead(1000);
+                    continue;
+                }
+                pending.append(m_ffmpegProcess->read(blockSize));
+                int available = pending.size() / sampleSize;
+                const auto *samples = reinterpret_cast<const qint16 *>(pending.constData());
+                int offset = 0;
+                while (offset < available) {
+                    int count = (int)qMin<qint64>(available - offset, frameEnd - samplesRead);
+                    AudioLevels::accumulatePeaks(samples + offset * m_channels, count, m_channels, peaks.data());
+                    offset += count;
+                    samplesRead += count;
+                    if (samplesRead >= frameEnd) {
+                        storeFrame();
+                    }
+                }
+                // Keep incomplete samples for the next block
+                pending.remove(0, available * sampleSize);
             }
+            if (samplesRead > frameStart) {
+                // Last partial frame
+                storeFrame();
+            }
+        }
+        m_ffmpegProcess->waitForFinished(-1);
+        if (m_ffmpegProcess->exitStatus() != QProcess::CrashExit && m_ffmpegProcess->exitCode() == 0 && !m_audioLevels.isEmpty()) {
             m_done = true;
             return true;
         }
+        m_audioLevels.clear();
+        m_errorMessage.append(i18n("Audio thumbs: error reading audio thumbnail created with FFmpeg\n"));
     }
     QString err = m_ffmpegProcess->readAllStandardError();
     m_ffmpegProcess.reset();
@@ -303,20 +271,21 @@ bool AudioThumbJob::startJob()
     }
     m_cachePath = m_binClip->getAudioThumbPath();
 
-    // checking for cached thumbs
-    QImage image(m_cachePath);
-    if (!image.isNull()) {
-        // convert cached image
-        int n = image.width() * image.height();
-        for (int i = 0; i < n; i++) {
-            QRgb p = image.pixel(i / m_channels, i % m_channels);
-            m_audioLevels << qRed(p);
-            m_audioLevels << qGreen(p);
-            m_audioLevels << qBlue(p);
-            m_audioLevels << qAlpha(p);
+    // checking for cached levels
+    m_levels = AudioLevels::load(m_cachePath);
+    if (!m_levels) {
+        // Older versions stored the levels packed in an image, convert it to the new format
+        const QString legacyPath = m_binClip->getAudioThumbPath(false, true);
+        QImage image(legacyPath);
+        if (!image.isNull()) {
+            m_levels = AudioLevels::fromLegacyImage(image, m_channels);
+            if (m_levels && m_levels->save(m_cachePath)) {
+                QFile::remove(legacyPath);
+                m_levels = AudioLevels::load(m_cachePath);
+            }
         }
     }
-    if (!m_audioLevels.isEmpty()) {
+    if (m_levels) {
         m_dataInCache = true;
     }
     
@@ -335,28 +304,17 @@ bool AudioThumbJob::startJob()
     Q_ASSERT(ok == m_done);
 
     if (ok && m_done && !m_dataInCache && !m_audioLevels.isEmpty()) {
-        // Put into an image for caching.
-        int count = m_audioLevels.size();
-        image = QImage((int)lrint((count + 3) / 4.0 / m_channels), m_channels, QImage::Format_ARGB32);
-        int n = image.width() * image.height();
-        for (int i = 0; i < n; i++) {
-            QRgb p;
-            if ((4 * i + 3) < count) {
-                p = qRgba(m_audioLevels.at(4 * i), m_audioLevels.at(4 * i + 1), m_audioLevels.at(4 * i + 2),
-                          m_audioLevels.at(4 * i + 3));
-            } else {
-                int last = m_audioLevels.last();
-                int r = (4 * i + 0) < count ? m_audioLevels.at(4 * i + 0) : last;
-                int g = (4 * i + 1) < count ? m_audioLevels.at(4 * i + 1) : last;
-                int b = (4 * i + 2) < count ? m_audioLevels.at(4 * i + 2) : last;
-                int a = last;
-                p = qRgba(r, g, b, a);
+        // Store the levels in the cache, and use the mapped file so that we don't keep a copy in memory
+        m_levels = AudioLevels::fromLevels(m_audioLevels, m_channels);
+        m_audioLevels.clear();
+        if (m_levels && m_levels->save(m_cachePath)) {
+            auto cached = AudioLevels::load(m_cachePath);
+            if (cached) {
+                m_levels = cached;
             }
-            image.setPixel(i / m_channels, i % m_channels, p);
         }
-        image.save(m_cachePath);
-        m_successful = true;
-        return true;
+        m_successful = m_levels != nullptr;
+        return m_successful;
     } else if (ok && m_thumbInCache && m_done) {
         m_successful = true;
         return true;
@@ -378,12 +336,12 @@ bool AudioThumbJob::commitResult(Fun &undo, Fun &redo)
     if (!m_successful) {
         return false;
     }
-    QVector <double>old = m_binClip->audioFrameCache;
+    std::shared_ptr<AudioLevels> old = m_binClip->audioFrameCache;
     QImage oldImage = m_binClip->thumbnail(m_thumbSize.width(), m_thumbSize.height()).toImage();
     QImage result = ThumbnailCache::get()->getAudioThumbnail(m_clipId);
 
     // note that the image is moved into lambda, it won't be available from this class anymore
-    auto operation = [clip = m_binClip, audio = std::move(m_audioLevels), image = std::move(result)]() {
+    auto operation = [clip = m_binClip, audio = std::move(m_levels), image = std::move(result)]() {
         clip->updateAudioThumbnail(audio);
         if (!image.isNull() && clip->clipType() == ClipType::Audio) {
             clip->setThumbnail(image);
@@ -29,6 +29,7 @@
 /* @brief This class represents the job that corresponds to computing the audio thumb of a clip (waveform)
  */
 
+class AudioLevels;
 class ProjectClip;
 namespace Mlt {
 class Producer;
@@ -73,5 +74,7 @@ private:
     bool m_done{false}, m_successful{false};
     int m_channels, m_frequency, m_lengthInFrames, m_audioStream;
     QVector <double>m_audioLevels;
+    /* @brief The levels cache, loaded from disk or built from m_audioLevels */
+    std::shared_ptr<AudioLevels> m_levels;
     std::unique_ptr<QProcess> m_ffmpegProcess;
 };
@@ -25,15 +25,79 @@
 #include "bin/projectsubclip.h"
 #include "core.h"
 #include "doc/kthumb.h"
+#include "kdenlivesettings.h"
 #include "klocalizedstring.h"
 #include "macros.hpp"
 #include "utils/thumbnailcache.hpp"
+#include <QElapsedTimer>
 #include <QImage>
 #include <QScopedPointer>
 #include <mlt++/MltProducer.h>
+#include <mlt++/MltProfile.h>
 
+#include <numeric>
 #include <set>
 
+ThumbnailDecodePlanner::ThumbnailDecodePlanner(int tolerance)
+    : m_tolerance(qMax(0, tolerance))
+{
+}
+
+ThumbnailDecodePlanner::Step ThumbnailDecodePlanner::next(int pos) const
+{
+    if (m_position < 0 || pos <= m_position) {
+        return {Action::Seek, pos};
+    }
+    if (pos - m_position <= m_tolerance) {
+        return {Action::Reuse, m_position};
+    }
+    // Decoding forward can stop as soon as we are within tolerance
+    int target = pos - m_tolerance;
+    int distance = target - m_position;
+    bool forward;
+    if (m_seekCost < 0 || m_frameCost < 0) {
+        // Not measured yet, do what MLT would do anyway
+        forward = distance <= MaxForwardStep;
+    } else {
+        forward = distance * m_frameCost < m_seekCost;
+    }
+    return forward ? Step{Action::Forward, target} : Step{Action::Seek, pos};
+}
+
+void ThumbnailDecodePlanner::done(const Step &step, double msecs, int frames)
+{
+    // Exponential moving averages, the decoding cost changes with the content
+    auto average = [](double &value, double sample) { value = value < 0 ? sample : 0.7 * value + 0.3 * sample; };
+    switch (step.action) {
+    case Action::Seek:
+        average(m_seekCost, msecs);
+        break;
+    case Action::Forward:
+        if (frames > 0) {
+            average(m_frameCost, msecs / frames);
+        }
+        break;
+    case Action::Reuse:
+        break;
+    }
+    m_position = step.position;
+}
+
+int ThumbnailDecodePlanner::position() const
+{
+    return m_position;
+}
+
+double ThumbnailDecodePlanner::seekCost() const
+{
+    return m_seekCost;
+}
+
+double ThumbnailDecodePlanner::frameCost() const
+{
+    return m_frameCost;
+}
+
 CacheJob::CacheJob(const QString &binId, int imageHeight, int thumbsCount, int inPoint, int outPoint)
     : AbstractClipJob(CACHEJOB, binId)
     , m_fullWidth(imageHeight * pCore->getCurrentDar() + 0.5)
@@ -74,7 +138,14 @@ bool CacheJob::startJob()
         m_done = true;
         return true;
     }
-    m_prod = m_binClip->thumbProducer();
+    // Give the producer back to the clip's pool on every exit, the job itself is kept by the job manager
+    struct ProducerRelease
+    {
+        std::shared_ptr<Mlt::Producer> &producer;
+        ~ProducerRelease() { producer.reset(); }
+    } producerRelease{m_prod};
+    // Rather fail than block a worker thread forever if the producers of the clip are all in use
+    m_prod = m_binClip->thumbProducer(30000);
     if ((m_prod == nullptr) || !m_prod->is_valid()) {
         qDebug() << "********\nCOULD NOT READ THUMB PRODUCER\n********";
         return false;
@@ -89,6 +160,25 @@ bool CacheJob::startJob()
     }
     int size = (int)frames.size();
     int count = 0;
+    const int width = pCore->thumbProfile()->width();
+    const int height = pCore->thumbProfile()->height();
+    auto decode = [this, width, height](int pos) {
+        m_prod->seek(pos);
+        QScopedPointer<Mlt::Frame> frame(m_prod->get_frame());
+        if (frame == nullptr || !frame->is_valid()) {
+            return QImage();
+        }
+        frame->set("deinterlace_method", "onefield");
+        frame->set("top_field_first", -1);
+        frame->set("rescale.interp", "nearest");
+        // Decode at the size of the thumbnails rather than at the size of the source
+        return KThumb::getFrame(frame.data(), width, height);
+    };
+    ThumbnailDecodePlanner planner(KdenliveSettings::thumbnailtolerance());
+    QImage last;
+    // Thumbnails are written to the persistent cache at once, which is much faster than one by one
+    std::vector<std::pair<int, QImage>> results;
+    QElapsedTimer timer;
     for (int i : frames) {
         if (m_done) {
             break;
@@ -98,16 +188,34 @@ bool CacheJob::startJob()
         if (ThumbnailCache::get()->hasThumbnail(m_clipId, i)) {
             continue;
         }
-        m_prod->seek(i);
-        QScopedPointer<Mlt::Frame> frame(m_prod->get_frame());
-        frame->set("deinterlace_method", "onefield");
-        frame->set("top_field_first", -1);
-        frame->set("rescale.interp", "nearest");
-        if (frame != nullptr && frame->is_valid()) {
-            QImage result = KThumb::getFrame(frame.data());
-            ThumbnailCache::get()->storeThumbnail(m_clipId, i, result, true);
+        const ThumbnailDecodePlanner::Step step = planner.next(i);
+        timer.start();
+        int decoded = 0;
+        if (step.action == ThumbnailDecodePlanner::Action::Seek) {
+            last = decode(step.position);
+            decoded = 1;
+        } else if (step.action == ThumbnailDecodePlanner::Action::Forward) {
+            // Go through the intermediate frames in small jumps, so that the producer keeps decoding instead of seeking
+            int current = planner.position();
+            while (current < step.position) {
+                current = qMin(current + ThumbnailDecodePlanner::MaxForwardStep, step.position);
+                last = decode(current);
+            }
+            decoded = step.position - planner.position();
+        }
+        const double elapsed = timer.nsecsElapsed() / 1000000.;
+        planner.done(step, elapsed, decoded);
+        m_decodeCosts.push_back(elapsed);
+        if (!last.isNull()) {
+            ThumbnailCache::get()->storeThumbnail(m_clipId, i, last, false);
+            results.emplace_back(i, last);
         }
     }
+    ThumbnailCache::get()->storeThumbnails(m_clipId, results);
+    if (!m_decodeCosts.empty()) {
+        qDebug() << "// Extracted" << m_decodeCosts.size() << "thumbnails for clip" << m_clipId << "in"
+                 << std::accumulate(m_decodeCosts.begin(), m_decodeCosts.end(), 0.) / m_decodeCosts.size() << "ms per thumbnail";
+    }
     m_done = true;
     return true;
 }
@@ -120,3 +228,8 @@ bool CacheJob::commitResult(Fun &undo, Fun &redo)
     m_resultConsumed = true;
     return m_done;
 }
+
+const std::vector<double> &CacheJob::decodeCosts() const
+{
+    return m_decodeCosts;
+}
@@ -24,6 +24,7 @@
 #include "abstractclipjob.h"
 
 #include <memory>
+#include <vector>
 
 /* @brief This class represents the job that corresponds to computing the thumb of a clip
  */
@@ -33,6 +34,53 @@ namespace Mlt {
 class Producer;
 }
 
+/** @class ThumbnailDecodePlanner
+    @brief Decides how the thumbnails of a clip are reached while decoding them in increasing order.
+
+    Seeking in long-GOP footage decodes all the frames from the previous keyframe, so seeking to
+    each thumbnail is much slower than decoding forward when thumbnails are close to each other.
+    MLT does not expose the keyframe positions, so the choice relies on the measured cost of a seek
+    and of one decoded frame. A thumbnail may also show a frame up to tolerance frames before its
+    position, which allows reusing the last decoded frame or stopping the forward decoding earlier.
+ */
+class ThumbnailDecodePlanner
+{
+public:
+    enum class Action {
+        Reuse,   // the last decoded frame is close enough
+        Forward, // decode frame by frame from the last decoded one
+        Seek     // seek to the thumbnail position
+    };
+    struct Step
+    {
+        Action action;
+        int position; // frame that will be shown by the thumbnail
+    };
+
+    explicit ThumbnailDecodePlanner(int tolerance);
+
+    /** @brief Returns how to reach the thumbnail at pos. Positions must be queried in increasing order */
+    Step next(int pos) const;
+    /** @brief Records that a step was done, decoding the given number of frames in msecs milliseconds */
+    void done(const Step &step, double msecs, int frames);
+
+    /** @brief Returns the last decoded position, -1 if none */
+    int position() const;
+    /** @brief Average cost of a seek, -1 if unknown */
+    double seekCost() const;
+    /** @brief Average cost of a frame decoded forward, -1 if unknown */
+    double frameCost() const;
+
+    /** @brief Largest jump done without seeking, MLT's avformat producer seeks beyond it */
+    static const int MaxForwardStep = 12;
+
+private:
+    int m_tolerance;
+    int m_position{-1};
+    double m_seekCost{-1};
+    double m_frameCost{-1};
+};
+
 class CacheJob : public AbstractClipJob
 {
     Q_OBJECT
@@ -52,6 +100,9 @@ public:
         By design, the job should store the result of the computation but not share it with the rest of the code. This happens when we call commitResult */
     bool commitResult(Fun &undo, Fun &redo) override;
 
+    /** @brief Returns the time spent decoding each extracted thumbnail, in milliseconds */
+    const std::vector<double> &decodeCosts() const;
+
 private:
     int m_fullWidth;
     int m_imageHeight;
@@ -65,4 +116,5 @@ private:
     int m_outPoint;
     bool m_inCache{false};
     bool m_subClip{false}; // true if we operate on a subclip
+    std::vector<double> m_decodeCosts;
 };
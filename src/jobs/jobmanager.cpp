@@ -21,6 +21,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 #include "jobmanager.h"
+#include "jobscheduler.h"
 #include "bin/abstractprojectitem.h"
 #include "bin/projectclip.h"
 #include "bin/projectitemmodel.h"
@@ -37,6 +38,7 @@ int JobManager::m_currentId = 0;
 JobManager::JobManager(QObject *parent)
     : QAbstractListModel(parent)
     , m_lock(QReadWriteLock::Recursive)
+    , m_scheduler(new JobScheduler())
 {
 }
 
@@ -258,8 +260,18 @@ void JobManager::createJob(const std::shared_ptr<Job_t> &job)
     connect(&job->m_future, &QFutureWatcher<bool>::started, this, &JobManager::updateJobCount);
     connect(&job->m_future, &QFutureWatcher<bool>::finished, [this, id = job->m_id]() { slotManageFinishedJob(id); });
     connect(&job->m_future, &QFutureWatcher<bool>::canceled, [this, id = job->m_id]() { slotManageCanceledJob(id); });
-    job->m_actualFuture = QtConcurrent::mapped(job->m_job, AbstractClipJob::execute);
+    job->m_remaining = int(job->m_job.size());
+    job->m_interface.setExpectedResultCount(int(job->m_job.size()));
+    job->m_actualFuture = job->m_interface.future();
     job->m_future.setFuture(job->m_actualFuture);
+    if (job->m_job.empty()) {
+        job->m_interface.reportStarted();
+        job->m_interface.reportFinished();
+        return;
+    }
+    for (size_t i = 0; i < job->m_job.size(); ++i) {
+        m_scheduler->schedule(job->m_type, job->m_job[i]->clipId(), [job, i]() { executeJob(job, i); });
+    }
 
     // In the unlikely event that the job finished before the signal connection was made, we check manually for finish and cancel
     /*if (job->m_future.isFinished()) {
@@ -272,6 +284,24 @@ void JobManager::createJob(const std::shared_ptr<Job_t> &job)
     }*/
 }
 
+void JobManager::executeJob(const std::shared_ptr<Job_t> &job, size_t index)
+{
+    // The future is reported as started (running) when the first of its clip jobs starts
+    job->m_interface.reportStarted();
+    if (!job->m_interface.isCanceled()) {
+        bool result = AbstractClipJob::execute(job->m_job[index]);
+        job->m_interface.reportResult(result, int(index));
+    }
+    if (--job->m_remaining == 0) {
+        job->m_interface.reportFinished();
+    }
+}
+
+void JobManager::prioritizeClips(const std::vector<QString> &binIds)
+{
+    m_scheduler->setPriorityClips(binIds);
+}
+
 void JobManager::slotManageCanceledJob(int id)
 {
     QReadLocker locker(&m_lock);
@@ -371,7 +401,7 @@ void JobManager::slotManageFinishedJob(int id)
         std::vector<int> children = m_jobsByParents[id];
         for (int cid : children) {
             if (!m_jobs[cid]->m_processed) {
-                QtConcurrent::run(this, &JobManager::createJob, m_jobs[cid]);
+                createJob(m_jobs[cid]);
             }
         }
         m_jobsByParents.erase(id);
@@ -27,15 +27,18 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "definitions.h"
 
 #include <QAbstractListModel>
+#include <QFutureInterface>
 #include <QFutureWatcher>
 #include <QObject>
 #include <QReadWriteLock>
+#include <atomic>
 #include <map>
 #include <memory>
 #include <unordered_map>
 #include <vector>
 
 class AbstractClipJob;
+class JobScheduler;
 
 /**
  * @class JobManager
@@ -52,6 +55,8 @@ struct Job_t
     std::unordered_map<QString, size_t> m_indices;       // keys are binIds, value are ids in the vectors m_job and m_progress;
     QFutureWatcher<bool> m_future;                       // future of the job
     QFuture<bool> m_actualFuture;
+    QFutureInterface<bool> m_interface; // reports the results of the clip jobs run by the scheduler to m_actualFuture
+    std::atomic<int> m_remaining{0};    // number of clip jobs that did not finish yet
     QMutex m_completionMutex; // mutex that is locked during execution of the process
     AbstractClipJob::JOBTYPE m_type;
     QString m_undoString;
@@ -127,14 +132,21 @@ public:
     /** @brief return the message of a given job on a given clip (message, detailed log)*/
     QPair<QString, QString> getJobMessageForClip(int jobId, const QString &binId) const;
 
+    /** @brief Jobs working on these clips start before the others of the same kind.
+     *  This is used for the clips that are visible to the user, the list replaces the previous one.
+     */
+    void prioritizeClips(const std::vector<QString> &binIds);
+
     // Mandatory overloads
     QVariant data(const QModelIndex &index, int role) const override;
     int rowCount(const QModelIndex &parent = QModelIndex()) const override;
 
 protected:
-    // Helper function to launch a given job.
-    // This has to be launched asynchrnously since it blocks until all parents are finished
+    // Helper function to launch a given job, once all its parents are finished.
+    // The clip jobs are queued in the scheduler, so this does not block
     void createJob(const std::shared_ptr<Job_t> &job);
+    // Run the clip job at given index of a job, called from the scheduler threads
+    static void executeJob(const std::shared_ptr<Job_t> &job, size_t index);
 
     void updateJobCount();
 
@@ -159,6 +171,8 @@ private:
     /** @brief List of all the jobs by clip. */
     std::unordered_map<QString, std::vector<int>> m_jobsByClip;
     std::unordered_map<int, std::vector<int>> m_jobsByParents;
+    /** @brief Runs the clip jobs with priorities and bounded concurrency */
+    std::unique_ptr<JobScheduler> m_scheduler;
 
 signals:
     void jobCount(int);
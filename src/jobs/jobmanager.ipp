@@ -20,7 +20,6 @@ You should have received a copy of the GNU General Public License
 along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
-#include <QtConcurrent>
 #include <type_traits>
 template <typename T, typename... Args>
 int JobManager::startJob(const std::vector<QString> &binIds, int parentId, QString undoString,
@@ -51,7 +50,7 @@ int JobManager::startJob(const std::vector<QString> &binIds, int parentId, QStri
         if (parentId != -1) {
             m_jobs[parentId]->m_completionMutex.unlock();
         }
-        QtConcurrent::run(this, &JobManager::createJob, job);
+        createJob(job);
     } else {
         m_jobsByParents[parentId].push_back(jobId);
     }
@@ -0,0 +1,179 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by the Kdenlive developers                         *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include "jobscheduler.h"
+
+#include <QDeadlineTimer>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QThread>
+#include <algorithm>
+
+class JobScheduler::Task : public QRunnable
+{
+public:
+    Task(JobScheduler *scheduler, QString binId, int priority, std::function<void()> function)
+        : m_scheduler(scheduler)
+        , m_binId(std::move(binId))
+        , m_priority(priority)
+        , m_function(std::move(function))
+    {
+    }
+
+    void run() override
+    {
+        m_scheduler->taskStarted(this);
+        m_function();
+    }
+
+    JobScheduler *m_scheduler;
+    QString m_binId;
+    int m_priority;
+    bool m_promoted = false;
+    JobScheduler::Lane m_lane = JobScheduler::Lane::Light;
+    std::function<void()> m_function;
+};
+
+JobScheduler::JobScheduler(int lightThreads, int heavyThreads)
+{
+    const int cores = QThread::idealThreadCount();
+    // Light jobs mostly wait for the disk or decode a few frames, heavy jobs are encoders that already use several cores
+    m_pools[int(Lane::Light)].setMaxThreadCount(lightThreads > 0 ? lightThreads : qMax(2, cores));
+    m_pools[int(Lane::Heavy)].setMaxThreadCount(heavyThreads > 0 ? heavyThreads : qMax(1, cores / 2));
+}
+
+JobScheduler::~JobScheduler()
+{
+    // Drop the tasks that did not start yet and wait for the running ones, which still use our members
+    m_mutex.lock();
+    for (QThreadPool &pool : m_pools) {
+        pool.clear();
+    }
+    m_queued.clear();
+    m_mutex.unlock();
+    waitForDone();
+}
+
+JobScheduler::Lane JobScheduler::laneForJob(AbstractClipJob::JOBTYPE type)
+{
+    switch (type) {
+    case AbstractClipJob::LOADJOB:
+    case AbstractClipJob::THUMBJOB:
+    case AbstractClipJob::AUDIOTHUMBJOB:
+    case AbstractClipJob::CACHEJOB:
+        return Lane::Light;
+    default:
+        return Lane::Heavy;
+    }
+}
+
+int JobScheduler::priorityForJob(AbstractClipJob::JOBTYPE type)
+{
+    switch (type) {
+    case AbstractClipJob::LOADJOB:
+        return 60;
+    case AbstractClipJob::THUMBJOB:
+        return 50;
+    case AbstractClipJob::AUDIOTHUMBJOB:
+        return 40;
+    case AbstractClipJob::CACHEJOB:
+    case AbstractClipJob::CUTJOB:
+    case AbstractClipJob::SPEEDJOB:
+        return 30;
+    case AbstractClipJob::FILTERCLIPJOB:
+    case AbstractClipJob::ANALYSECLIPJOB:
+        return 25;
+    case AbstractClipJob::STABILIZEJOB:
+    case AbstractClipJob::TRANSCODEJOB:
+        return 20;
+    case AbstractClipJob::PROXYJOB:
+        return 10;
+    default:
+        return 0;
+    }
+}
+
+QThreadPool *JobScheduler::pool(Lane lane)
+{
+    return &m_pools[int(lane)];
+}
+
+int JobScheduler::maxThreadCount(Lane lane) const
+{
+    return m_pools[int(lane)].maxThreadCount();
+}
+
+void JobScheduler::schedule(AbstractClipJob::JOBTYPE type, const QString &binId, std::function<void()> task)
+{
+    auto *runnable = new Task(this, binId, priorityForJob(type), std::move(task));
+    runnable->m_lane = laneForJob(type);
+    QMutexLocker lock(&m_mutex);
+    if (m_priorityClips.contains(binId)) {
+        runnable->m_promoted = true;
+    }
+    m_queued[binId].push_back(runnable);
+    pool(runnable->m_lane)->start(runnable, runnable->m_priority + (runnable->m_promoted ? PromotionBoost : 0));
+}
+
+void JobScheduler::setPriorityClips(const std::vector<QString> &binIds)
+{
+    QMutexLocker lock(&m_mutex);
+    m_priorityClips.clear();
+    for (const QString &binId : binIds) {
+        m_priorityClips.insert(binId);
+        auto it = m_queued.find(binId);
+        if (it == m_queued.end()) {
+            continue;
+        }
+        for (Task *task : it->second) {
+            // QThreadPool cannot change the priority of a queued runnable, so we take it back and queue it again
+            if (!task->m_promoted && pool(task->m_lane)->tryTake(task)) {
+                task->m_promoted = true;
+                pool(task->m_lane)->start(task, task->m_priority + PromotionBoost);
+            }
+        }
+    }
+}
+
+void JobScheduler::taskStarted(Task *task)
+{
+    QMutexLocker lock(&m_mutex);
+    auto it = m_queued.find(task->m_binId);
+    if (it == m_queued.end()) {
+        return;
+    }
+    it->second.erase(std::remove(it->second.begin(), it->second.end(), task), it->second.end());
+    if (it->second.empty()) {
+        m_queued.erase(it);
+    }
+}
+
+bool JobScheduler::waitForDone(int msecs)
+{
+    // A duration of -1 never expires, and its remaining time stays -1
+    QDeadlineTimer deadline(msecs);
+    for (QThreadPool &pool : m_pools) {
+        if (!pool.waitForDone(int(deadline.remainingTime()))) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,92 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by the Kdenlive developers                         *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef JOBSCHEDULER_H
+#define JOBSCHEDULER_H
+
+#include "abstractclipjob.h"
+
+#include <QMutex>
+#include <QSet>
+#include <QString>
+#include <QThreadPool>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @class JobScheduler
+ * @brief Runs the clip jobs on dedicated thread pools, ordered by priority.
+ *
+ * Jobs are split in two lanes, each with its own thread pool and concurrency limit:
+ * light jobs (loading, thumbnails, audio thumbnails, cache) that mostly read media and
+ * must be quick to appear in the UI, and heavy jobs (proxy, transcode, stabilize...)
+ * that encode for a long time. This way a batch of proxy encodes cannot delay the
+ * thumbnails of newly imported clips.
+ * Inside a lane, queued jobs are started by decreasing priority, which depends on the
+ * job type. Jobs working on clips that are currently visible to the user are promoted
+ * before all the others of their lane.
+ */
+class JobScheduler
+{
+public:
+    enum class Lane { Light = 0, Heavy = 1 };
+
+    /** @brief Creates the scheduler. A thread count of 0 means using a default value depending on the number of cores */
+    explicit JobScheduler(int lightThreads = 0, int heavyThreads = 0);
+    ~JobScheduler();
+
+    /** @brief Returns the lane where jobs of the given type run */
+    static Lane laneForJob(AbstractClipJob::JOBTYPE type);
+    /** @brief Returns the priority of jobs of the given type, jobs with a higher priority start first */
+    static int priorityForJob(AbstractClipJob::JOBTYPE type);
+
+    /** @brief Queue a task of a job working on a clip. The task is run on one of the threads of the job's lane */
+    void schedule(AbstractClipJob::JOBTYPE type, const QString &binId, std::function<void()> task);
+
+    /** @brief Set the clips that are currently visible to the user.
+        Their queued tasks, and the ones that will be queued later, start before the other tasks of their lane. */
+    void setPriorityClips(const std::vector<QString> &binIds);
+
+    /** @brief Returns the maximum number of tasks running at the same time in a lane */
+    int maxThreadCount(Lane lane) const;
+
+    /** @brief Waits until all queued tasks are done, returns false on timeout */
+    bool waitForDone(int msecs = -1);
+
+private:
+    class Task;
+    /** @brief Called by a task when it starts, after which it cannot be promoted anymore */
+    void taskStarted(Task *task);
+    QThreadPool *pool(Lane lane);
+
+    /** Priority boost of tasks working on the priority clips */
+    static const int PromotionBoost = 1000;
+
+    QThreadPool m_pools[2];
+    /** @brief This mutex protects the queued tasks and the priority clips */
+    QMutex m_mutex;
+    /** @brief The tasks that are waiting in a pool, by clip */
+    std::unordered_map<QString, std::vector<Task *>> m_queued;
+    QSet<QString> m_priorityClips;
+};
+
+#endif
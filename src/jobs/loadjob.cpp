@@ -20,6 +20,7 @@
  ***************************************************************************/
 
 #include "loadjob.hpp"
+#include "bin/bin.h"
 #include "bin/projectclip.h"
 #include "bin/projectfolder.h"
 #include "bin/projectitemmodel.h"
@@ -31,6 +32,8 @@
 #include "macros.hpp"
 #include "profiles/profilemodel.hpp"
 #include "project/dialogs/slideshowclip.h"
+#include "utils/filehash.hpp"
+#include "utils/mediaprobecache.hpp"
 #include "monitor/monitor.h"
 #include "xml/xml.hpp"
 #include <KMessageWidget>
@@ -43,6 +46,7 @@ LoadJob::LoadJob(const QString &binId, const QDomElement &xml, const std::functi
     : AbstractClipJob(LOADJOB, binId)
     , m_xml(xml)
     , m_readyCallBack(readyCallBack)
+    , m_documentRoot(pCore->currentDoc()->documentRoot())
 {
 }
 
@@ -79,6 +83,61 @@ ClipType::ProducerType getTypeForService(const QString &id, const QString &path)
     return ClipType::Unknown;
 }
 
+// Returns the absolute path of a local media file, or an empty string
+QString mediaPath(const QString &resource, const QString &documentRoot)
+{
+    if (resource.isEmpty() || resource.contains(QLatin1Char('?'))) {
+        return QString();
+    }
+    QString path = resource;
+    if (QFileInfo(path).isRelative()) {
+        path.prepend(documentRoot);
+    }
+    return QFileInfo(path).absoluteFilePath();
+}
+
+// Identifies the project settings the probes depend on: the length of clips is given in frames
+QString probeProfileKey(Mlt::Profile &profile)
+{
+    return QStringLiteral("%1/%2").arg(profile.frame_rate_num()).arg(profile.frame_rate_den());
+}
+
+// Opens a media file without probing it, using the properties cached when it was last opened.
+// Returns nullptr if the file is not in the cache or changed since it was probed
+std::shared_ptr<Mlt::Producer> loadProbedMedia(const QString &resource, const QString &service, const QString &binId, const QString &documentRoot)
+{
+    if (!service.isEmpty() && !service.startsWith(QLatin1String("avformat"))) {
+        return nullptr;
+    }
+    const QString path = mediaPath(resource, documentRoot);
+    if (path.isEmpty()) {
+        return nullptr;
+    }
+    // The background check must probe with the frame rate the probe is stored for, even if the project profile changes meanwhile
+    auto profile = std::make_shared<Mlt::Profile>(pCore->getCurrentProfilePath().toUtf8().constData());
+    const QString profileKey = probeProfileKey(*profile.get());
+    const QMap<QString, QString> properties = MediaProbeCache::get()->lookup(path, profileKey);
+    if (properties.isEmpty()) {
+        return nullptr;
+    }
+    // This producer only opens the file when a frame is requested
+    auto producer = std::make_shared<Mlt::Producer>(pCore->getCurrentProfile()->profile(), "avformat-novalidate", resource.toUtf8().constData());
+    if (!producer->is_valid()) {
+        return nullptr;
+    }
+    for (auto it = properties.constBegin(); it != properties.constEnd(); ++it) {
+        producer->set(it.key().toUtf8().constData(), it.value().toUtf8().constData());
+    }
+    // Like MLT's xml producer, present it as a regular avformat producer
+    producer->set("mlt_service", "avformat");
+    // Probe the file again in the background, and reload the clip if the cache was wrong
+    MediaProbeCache::get()->revalidate(
+        path, profileKey,
+        [resource, profile]() { return std::make_shared<Mlt::Producer>(*profile.get(), "avformat", resource.toUtf8().constData()); },
+        [binId]() { QMetaObject::invokeMethod(pCore.get(), [binId]() { pCore->bin()->reloadClip(binId); }, Qt::QueuedConnection); });
+    return producer;
+}
+
 // Read the properties of the xml and pass them to the producer. Note that some properties like resource are ignored
 void processProducerProperties(const std::shared_ptr<Mlt::Producer> &prod, const QDomElement &xml)
 {
@@ -360,12 +419,23 @@ bool LoadJob::startJob()
         m_producer = std::make_shared<Mlt::Producer>(pCore->getCurrentProfile()->profile(), nullptr, m_resource.toUtf8().constData());
         break;
     default:
+        m_producer = loadProbedMedia(m_resource, service, m_clipId, m_documentRoot);
+        if (m_producer) {
+            break;
+        }
         if (!service.isEmpty()) {
             service.append(QChar(':'));
             m_producer = loadResource(m_resource, service);
         } else {
             m_producer = std::make_shared<Mlt::Producer>(pCore->getCurrentProfile()->profile(), nullptr, m_resource.toUtf8().constData());
         }
+        if (m_producer && m_producer->is_valid() && QString(m_producer->get("mlt_service")) == QLatin1String("avformat")) {
+            // Keep the probe before Kdenlive sets its own properties, so that the file does not need to be opened next time
+            const QString path = mediaPath(m_resource, m_documentRoot);
+            if (!path.isEmpty()) {
+                MediaProbeCache::get()->store(path, probeProfileKey(pCore->getCurrentProfile()->profile()), *m_producer.get());
+            }
+        }
         break;
     }
     if (!m_producer || m_producer->is_blank() || !m_producer->is_valid()) {
@@ -500,6 +570,17 @@ bool LoadJob::startJob()
             vindex = -1;
         }
     }
+    if (type != ClipType::Color && type != ClipType::Text && type != ClipType::TextTemplate && type != ClipType::QText && type != ClipType::SlideShow) {
+        // Hash the media file here, so that the clip finds it in the cache instead of reading the file on the GUI thread.
+        // Clips of a project already have their hash
+        if (QString::fromUtf8(m_producer->get("kdenlive:file_hash")).isEmpty()) {
+            const QString path = QString::fromUtf8(m_producer->get("kdenlive:proxy")).length() > 2 ? QString::fromUtf8(m_producer->get("kdenlive:originalurl"))
+                                                                                                 : QString::fromUtf8(m_producer->get("resource"));
+            if (!path.isEmpty()) {
+                FileHashCache::get()->hash(QFileInfo(QFileInfo(path).isRelative() ? m_documentRoot + path : path).absoluteFilePath());
+            }
+        }
+    }
     m_done = m_successful = true;
     return true;
 }
@@ -78,4 +78,6 @@ private:
     std::shared_ptr<Mlt::Producer> m_producer;
     QList<int> m_audio_list, m_video_list;
     QString m_resource;
+    // Read when the job is created, since the document must not be accessed from the job thread
+    QString m_documentRoot;
 };
@@ -31,6 +31,7 @@
 #include <QPainter>
 #include <QScopedPointer>
 #include <mlt++/MltProducer.h>
+#include <mlt++/MltProfile.h>
 
 ThumbJob::ThumbJob(const QString &binId, int imageHeight, int frameNumber, bool persistent, bool reloadAllThumbs)
     : AbstractClipJob(THUMBJOB, binId)
@@ -87,7 +88,14 @@ bool ThumbJob::startJob()
         m_inCache = true;
         return true;
     }
-    m_prod = m_binClip->thumbProducer();
+    // Give the producer back to the clip's pool on every exit, the job itself is kept by the job manager
+    struct ProducerRelease
+    {
+        std::shared_ptr<Mlt::Producer> &producer;
+        ~ProducerRelease() { producer.reset(); }
+    } producerRelease{m_prod};
+    // A slot of the pool may be held by a long cache job, rather fail than block a worker thread forever
+    m_prod = m_binClip->thumbProducer(30000);
     if ((m_prod == nullptr) || !m_prod->is_valid()) {
         qDebug() << "********\nCOULD NOT READ THUMB PRODUCER\n********";
         return false;
@@ -103,7 +111,8 @@ bool ThumbJob::startJob()
     frame->set("top_field_first", -1);
     frame->set("rescale.interp", "nearest");
     if ((frame != nullptr) && frame->is_valid()) {
-        m_result = KThumb::getFrame(frame.data());
+        // Decode at the size of the thumbnails rather than at the size of the source
+        m_result = KThumb::getFrame(frame.data(), pCore->thumbProfile()->width(), pCore->thumbProfile()->height());
         m_done = true;
     }
     return m_done;
@@ -14,6 +14,7 @@ the Free Software Foundation, either version 3 of the License, or
 #include "kdenlive_debug.h"
 #include "klocalizedstring.h"
 #include <QTime>
+#include <QtConcurrent>
 #include <QElapsedTimer>
 #include <cmath>
 #include <iostream>
@@ -28,6 +29,12 @@ AudioCorrelation::AudioCorrelation(std::unique_ptr<AudioEnvelope> mainTrackEnvel
 
 AudioCorrelation::~AudioCorrelation()
 {
+    // The running correlations use the main envelope
+    for (auto it = m_pending.constBegin(); it != m_pending.constEnd(); ++it) {
+        it.key()->waitForFinished();
+        delete it.key()->result();
+        delete it.value();
+    }
     for (AudioEnvelope *envelope : m_children) {
         delete envelope;
     }
@@ -54,26 +61,48 @@ void AudioCorrelation::addChild(AudioEnvelope *envelope)
 }
 
 void AudioCorrelation::slotProcessChild(AudioEnvelope *envelope)
+{
+    // Children are correlated in parallel in the thread pool
+    auto *watcher = new QFutureWatcher<AudioCorrelationInfo *>(this);
+    m_pending.insert(watcher, envelope);
+    connect(watcher, &QFutureWatcher<AudioCorrelationInfo *>::finished, this, &AudioCorrelation::slotChildCorrelated);
+    watcher->setFuture(QtConcurrent::run(this, &AudioCorrelation::computeCorrelation, envelope));
+}
+
+AudioCorrelationInfo *AudioCorrelation::computeCorrelation(AudioEnvelope *envelope)
 {
     // Note that at this point the computation of the envelope of the
     // main track might not be finished. envelope() will block until
     // the computation is done.
-    const size_t sizeMain = m_mainTrackEnvelope->envelope().size();
-    const size_t sizeSub = envelope->envelope().size();
+    const std::vector<qint64> &envMain = m_mainTrackEnvelope->envelope();
+    const std::vector<qint64> &envSub = envelope->envelope();
+    const size_t sizeMain = envMain.size();
+    const size_t sizeSub = envSub.size();
 
     auto *info = new AudioCorrelationInfo(sizeMain, sizeSub);
     qint64 *correlation = info->correlationVector();
-
-    const std::vector<qint64> &envMain = m_mainTrackEnvelope->envelope();
-    const std::vector<qint64> &envSub = envelope->envelope();
     qint64 max = 0;
 
     if (sizeSub > 200) {
-        FFTCorrelation::correlate(&envMain[0], sizeMain, &envSub[0], sizeSub, correlation);
+        m_referenceMutex.lock();
+        if (!m_reference) {
+            m_reference.reset(new FFTCorrelation::Reference(&envMain[0], sizeMain));
+        }
+        m_referenceMutex.unlock();
+        m_reference->correlate(&envSub[0], sizeSub, correlation);
     } else {
         correlate(&envMain[0], sizeMain, &envSub[0], sizeSub, correlation, &max);
         info->setMax(max);
     }
+    return info;
+}
+
+void AudioCorrelation::slotChildCorrelated()
+{
+    auto *watcher = static_cast<QFutureWatcher<AudioCorrelationInfo *> *>(sender());
+    AudioEnvelope *envelope = m_pending.take(watcher);
+    AudioCorrelationInfo *info = watcher->result();
+    watcher->deleteLater();
 
     m_children.append(envelope);
     m_correlations.append(info);
@@ -14,7 +14,11 @@
 #include "audioCorrelationInfo.h"
 #include "audioEnvelope.h"
 #include "definitions.h"
+#include "fftCorrelation.h"
+#include <QFutureWatcher>
 #include <QList>
+#include <QMap>
+#include <QMutex>
 
 /**
   This class does the correlation between two tracks
@@ -68,6 +72,15 @@ private:
     QList<AudioEnvelope *> m_children;
     QList<AudioCorrelationInfo *> m_correlations;
 
+    /** Spectrum of the main envelope shared by the FFT correlations of all children, created by the first one */
+    std::unique_ptr<FFTCorrelation::Reference> m_reference;
+    QMutex m_referenceMutex;
+    /** Correlations running in the thread pool, with the envelope they are aligning */
+    QMap<QFutureWatcher<AudioCorrelationInfo *> *, AudioEnvelope *> m_pending;
+
+    /** @brief Computes the correlation of a child envelope with the main envelope, called from a worker thread */
+    AudioCorrelationInfo *computeCorrelation(AudioEnvelope *envelope);
+
 private slots:
     /**
      This is invoked when the child envelope is computed. This
@@ -78,6 +91,8 @@ private slots:
    */
     void slotProcessChild(AudioEnvelope *envelope);
     void slotAnnounceEnvelope();
+    /** @brief Stores the correlation computed for a child, and emits its shift */
+    void slotChildCorrelated();
 
 signals:
     void gotAudioAlignData(int, int);
@@ -0,0 +1,314 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by the Kdenlive developers                         *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include "audioLevels.h"
+
+#include <QDebug>
+#include <QFile>
+#include <QFileInfo>
+#include <QImage>
+#include <QMultiHash>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QtEndian>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace {
+const char levelsMagic[4] = {'K', 'D', 'A', 'L'};
+const int headerSize = 32;
+const int maxZoomLevels = 16;
+// The levels currently mapping each cache file, by absolute path
+QBasicMutex mappingsMutex;
+using MappingsHash = QMultiHash<QString, AudioLevels *>;
+Q_GLOBAL_STATIC(MappingsHash, mappings)
+} // namespace
+
+AudioLevels::AudioLevels()
+    : m_channels(0)
+    , m_data(nullptr)
+{
+}
+
+AudioLevels::~AudioLevels()
+{
+    QMutexLocker lock(&mappingsMutex);
+    if (m_file && m_data != nullptr) {
+        if (!mappings.isDestroyed()) {
+            mappings->remove(m_file->fileName(), this);
+        }
+        m_file->unmap(const_cast<uchar *>(m_data - headerSize));
+    }
+}
+
+qint64 AudioLevels::dataSize() const
+{
+    return m_frames.empty() ? 0 : qint64(m_offsets.back()) + qint64(m_frames.back()) * m_channels;
+}
+
+void AudioLevels::detach()
+{
+    QWriteLocker lock(&m_dataLock);
+    const quint8 *map = m_data - headerSize;
+    m_buffer = QByteArray(reinterpret_cast<const char *>(m_data), int(dataSize()));
+    m_data = reinterpret_cast<const quint8 *>(m_buffer.constData());
+    m_file->unmap(const_cast<uchar *>(map));
+    m_file.reset();
+}
+
+void AudioLevels::releaseMappings(const QString &path)
+{
+    QMutexLocker lock(&mappingsMutex);
+    const QString key = QFileInfo(path).absoluteFilePath();
+    for (AudioLevels *levels : mappings->values(key)) {
+        levels->detach();
+    }
+    mappings->remove(key);
+}
+
+void AudioLevels::computeLayout(int channels, int frames, int zoomLevels)
+{
+    m_channels = channels;
+    m_frames.clear();
+    m_offsets.clear();
+    int offset = 0;
+    int count = frames;
+    for (int zoom = 0; zoom < zoomLevels; ++zoom) {
+        m_frames.push_back(count);
+        m_offsets.push_back(offset);
+        offset += count * channels;
+        count = (count + 1) / 2;
+    }
+}
+
+void AudioLevels::buildPyramid(int channels, int frames)
+{
+    int zoomLevels = 1;
+    for (int count = frames; count > 1 && zoomLevels < maxZoomLevels; count = (count + 1) / 2) {
+        zoomLevels++;
+    }
+    computeLayout(channels, frames, zoomLevels);
+    int total = m_offsets.back() + m_frames.back() * channels;
+    m_buffer.resize(total);
+    auto *buffer = reinterpret_cast<quint8 *>(m_buffer.data());
+    for (int zoom = 1; zoom < zoomLevels; ++zoom) {
+        const quint8 *source = buffer + m_offsets[size_t(zoom - 1)];
+        quint8 *target = buffer + m_offsets[size_t(zoom)];
+        int sourceFrames = m_frames[size_t(zoom - 1)];
+        for (int i = 0; i < m_frames[size_t(zoom)]; ++i) {
+            const quint8 *first = source + 2 * i * channels;
+            const quint8 *second = (2 * i + 1 < sourceFrames) ? first + channels : first;
+            for (int c = 0; c < channels; ++c) {
+                target[i * channels + c] = std::max(first[c], second[c]);
+            }
+        }
+    }
+    m_data = buffer;
+}
+
+std::shared_ptr<AudioLevels> AudioLevels::fromLevels(const QVector<double> &levels, int channels)
+{
+    if (channels <= 0 || levels.size() < channels) {
+        return nullptr;
+    }
+    std::shared_ptr<AudioLevels> result(new AudioLevels());
+    int frames = levels.size() / channels;
+    result->m_buffer.resize(frames * channels);
+    auto *buffer = reinterpret_cast<quint8 *>(result->m_buffer.data());
+    for (int i = 0; i < frames * channels; ++i) {
+        buffer[i] = quint8(qBound(0., levels.at(i), 255.));
+    }
+    result->buildPyramid(channels, frames);
+    return result;
+}
+
+std::shared_ptr<AudioLevels> AudioLevels::fromLegacyImage(const QImage &image, int channels)
+{
+    if (image.isNull() || channels <= 0) {
+        return nullptr;
+    }
+    // Legacy caches pack 4 consecutive levels in the ARGB components of each pixel, column by column
+    QImage source = image.convertToFormat(QImage::Format_ARGB32);
+    int n = source.width() * source.height();
+    int frames = 4 * n / channels;
+    if (frames == 0) {
+        return nullptr;
+    }
+    std::shared_ptr<AudioLevels> result(new AudioLevels());
+    result->m_buffer.resize(frames * channels);
+    auto *buffer = reinterpret_cast<quint8 *>(result->m_buffer.data());
+    int count = frames * channels;
+    for (int i = 0; i < n; i++) {
+        QRgb p = reinterpret_cast<const QRgb *>(source.constScanLine(i % channels))[i / channels];
+        const int components[4] = {qRed(p), qGreen(p), qBlue(p), qAlpha(p)};
+        for (int j = 0; j < 4 && 4 * i + j < count; ++j) {
+            buffer[4 * i + j] = quint8(components[j]);
+        }
+    }
+    result->buildPyramid(channels, frames);
+    return result;
+}
+
+std::shared_ptr<AudioLevels> AudioLevels::load(const QString &path)
+{
+    std::unique_ptr<QFile> file(new QFile(QFileInfo(path).absoluteFilePath()));
+    if (!file->open(QIODevice::ReadOnly) || file->size() < headerSize) {
+        return nullptr;
+    }
+    uchar *map = file->map(0, file->size());
+    if (map == nullptr) {
+        qDebug() << "Cannot map audio levels cache" << path;
+        return nullptr;
+    }
+    auto readValue = [map](int index) { return qFromLittleEndian<quint32>(map + 4 + 4 * index); };
+    quint32 version = readValue(0);
+    quint32 channels = readValue(1);
+    quint32 frames = readValue(2);
+    quint32 zoomLevels = readValue(3);
+    quint32 bits = readValue(4);
+    if (memcmp(map, levelsMagic, 4) != 0 || version != FormatVersion || bits != 8 || channels == 0 || channels > 64 || zoomLevels == 0 ||
+        zoomLevels > maxZoomLevels || frames > quint32(std::numeric_limits<int>::max()) / channels) {
+        file->unmap(map);
+        return nullptr;
+    }
+    std::shared_ptr<AudioLevels> result(new AudioLevels());
+    result->computeLayout(int(channels), int(frames), int(zoomLevels));
+    qint64 expected = headerSize + result->dataSize();
+    if (file->size() != expected) {
+        qDebug() << "Corrupted audio levels cache" << path;
+        file->unmap(map);
+        return nullptr;
+    }
+    result->m_data = map + headerSize;
+    result->m_file = std::move(file);
+    QMutexLocker lock(&mappingsMutex);
+    mappings->insert(result->m_file->fileName(), result.get());
+    return result;
+}
+
+bool AudioLevels::save(const QString &path) const
+{
+    if (isEmpty()) {
+        return false;
+    }
+    // The file cannot be replaced while it is mapped on Windows
+    releaseMappings(path);
+    QReadLocker lock(&m_dataLock);
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qDebug() << "Cannot write audio levels cache" << path;
+        return false;
+    }
+    char header[headerSize] = {};
+    memcpy(header, levelsMagic, 4);
+    const quint32 values[7] = {FormatVersion, quint32(m_channels), quint32(m_frames.front()), quint32(m_frames.size()), 8, 0, 0};
+    for (int i = 0; i < 7; ++i) {
+        qToLittleEndian<quint32>(values[i], header + 4 + 4 * i);
+    }
+    file.write(header, headerSize);
+    file.write(reinterpret_cast<const char *>(m_data), dataSize());
+    return file.commit();
+}
+
+void AudioLevels::accumulatePeaks(const qint16 *samples, int frames, int channels, int *peaks)
+{
+    int count = frames * channels;
+    int i = 0;
+#ifdef __SSE2__
+    // A block of 8 * channels samples holds a whole number of frames and of 8 samples registers,
+    // so each lane of the n-th register of a block always sees the same channel
+    const int block = 8 * channels;
+    if (channels <= 8 && count >= block) {
+        __m128i maxValues[8];
+        __m128i minValues[8];
+        for (int j = 0; j < channels; ++j) {
+            maxValues[j] = _mm_setzero_si128();
+            minValues[j] = _mm_setzero_si128();
+        }
+        for (; i + block <= count; i += block) {
+            for (int j = 0; j < channels; ++j) {
+                __m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i *>(samples + i + 8 * j));
+                maxValues[j] = _mm_max_epi16(maxValues[j], values);
+                minValues[j] = _mm_min_epi16(minValues[j], values);
+            }
+        }
+        qint16 maxLanes[8];
+        qint16 minLanes[8];
+        for (int j = 0; j < channels; ++j) {
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(maxLanes), maxValues[j]);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(minLanes), minValues[j]);
+            for (int lane = 0; lane < 8; ++lane) {
+                int channel = (8 * j + lane) % channels;
+                peaks[channel] = std::max(peaks[channel], std::max(int(maxLanes[lane]), -int(minLanes[lane])));
+            }
+        }
+    }
+#endif
+    // Remaining samples, i is a multiple of channels here
+    for (; i < count; ++i) {
+        int channel = i % channels;
+        peaks[channel] = std::max(peaks[channel], std::abs(int(samples[i])));
+    }
+}
+
+double AudioLevels::levelFromPeak(int peak)
+{
+    return peak * 255. / 32767;
+}
+
+int AudioLevels::channels() const
+{
+    return m_channels;
+}
+
+int AudioLevels::frames(int zoom) const
+{
+    if (zoom < 0 || zoom >= int(m_frames.size())) {
+        return 0;
+    }
+    return m_frames[size_t(zoom)];
+}
+
+int AudioLevels::zoomLevels() const
+{
+    return int(m_frames.size());
+}
+
+int AudioLevels::zoomForScale(double framesPerPixel) const
+{
+    int zoom = 0;
+    while (zoom + 1 < zoomLevels() && double(1 << (zoom + 1)) <= framesPerPixel) {
+        zoom++;
+    }
+    return zoom;
+}
+
+bool AudioLevels::isEmpty() const
+{
+    return m_data == nullptr || m_frames.empty() || m_frames.front() == 0;
+}
+
+QReadWriteLock &AudioLevels::dataLock() const
+{
+    return m_dataLock;
+}
+
+const quint8 *AudioLevels::data(int zoom) const
+{
+    if (zoom < 0 || zoom >= int(m_frames.size())) {
+        return nullptr;
+    }
+    return m_data + m_offsets[size_t(zoom)];
+}
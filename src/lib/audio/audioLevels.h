@@ -0,0 +1,108 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by the Kdenlive developers                         *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#ifndef AUDIOLEVELS_H
+#define AUDIOLEVELS_H
+
+#include <QByteArray>
+#include <QReadWriteLock>
+#include <QString>
+#include <QVector>
+#include <memory>
+#include <vector>
+
+class QFile;
+class QImage;
+
+/**
+  Audio levels (peaks) of a clip, as displayed by the timeline waveforms.
+  There is one 8 bits value (0-255) per channel and per frame, stored interleaved
+  (frame -> channel). Together with the full resolution data, we keep a pyramid of
+  zoom levels where each level holds the max of two consecutive entries of the
+  previous one, so that zoomed out views don't need to scan all the frames.
+
+  The cache file format is a small header followed by the zoom levels:
+    char[4] magic "KDAL", quint32 version, quint32 channels, quint32 frames,
+    quint32 zoom levels, quint32 bits per sample, quint32[2] reserved,
+  all values in little endian. The file is memory-mapped when loaded.
+  */
+class AudioLevels
+{
+public:
+    /** Version of the cache file format, bump it when changing the layout or the meaning of the values.
+        Version 2 stores peaks instead of averaged amplitudes */
+    static const quint32 FormatVersion = 2;
+
+    ~AudioLevels();
+
+    /** @brief Build the levels from interleaved values, as computed by the audio thumb job. Values are clamped to 0-255 */
+    static std::shared_ptr<AudioLevels> fromLevels(const QVector<double> &levels, int channels);
+    /** @brief Build the levels from a cache image created by older Kdenlive versions (4 values packed in each pixel) */
+    static std::shared_ptr<AudioLevels> fromLegacyImage(const QImage &image, int channels);
+    /** @brief Memory-map a cache file. Returns nullptr if the file is missing, invalid or from another format version */
+    static std::shared_ptr<AudioLevels> load(const QString &path);
+    /** @brief Write the levels and their zoom pyramid to a cache file. The file's current mappings are released first */
+    bool save(const QString &path) const;
+    /** @brief Switch all the levels mapping the given cache file to an in-memory copy, and unmap the file.
+        This must be called before removing or rewriting a cache file, otherwise the file stays locked on Windows and
+        the existing levels keep showing the old data elsewhere. It is called from the audio thumb jobs while the levels
+        may be read by the GUI and render threads, each switch waits until dataLock() is no longer held for reading. */
+    static void releaseMappings(const QString &path);
+    /** @brief Update peaks with the absolute peak of each channel found in frames of interleaved 16 bits samples
+        This is used to reduce decoded audio on the fly, peaks must hold one value per channel */
+    static void accumulatePeaks(const qint16 *samples, int frames, int channels, int *peaks);
+    /** @brief Convert a peak found by accumulatePeaks to the 0-255 scale of the levels, whatever backend decoded the audio */
+    static double levelFromPeak(int peak);
+
+    int channels() const;
+    /** @brief Number of entries per channel at the given zoom level. Level 0 has one entry per frame */
+    int frames(int zoom = 0) const;
+    int zoomLevels() const;
+    /** @brief Returns the best zoom level to display framesPerPixel frames on one pixel */
+    int zoomForScale(double framesPerPixel) const;
+    bool isEmpty() const;
+    /** @brief Returns the level (0-255) of channel at the given entry of the zoom level, 0 if out of range */
+    inline quint8 level(int frame, int channel, int zoom = 0) const
+    {
+        if (zoom < 0 || zoom >= int(m_frames.size()) || frame < 0 || frame >= m_frames[size_t(zoom)] || channel < 0 || channel >= m_channels) {
+            return 0;
+        }
+        return m_data[m_offsets[size_t(zoom)] + frame * m_channels + channel];
+    }
+    /** @brief Returns all the interleaved values of a zoom level */
+    const quint8 *data(int zoom = 0) const;
+    /** @brief Levels shared with other threads must be read with this lock held for reading, as releaseMappings()
+        may switch their data at any time. The values returned by level() and data() are only valid meanwhile. */
+    QReadWriteLock &dataLock() const;
+
+private:
+    AudioLevels();
+    /** @brief Compute the zoom pyramid in m_buffer from the full resolution values already stored in it */
+    void buildPyramid(int channels, int frames);
+    /** @brief Update the frame counts and offsets of each zoom level */
+    void computeLayout(int channels, int frames, int zoomLevels);
+    /** @brief Size in bytes of all the zoom levels */
+    qint64 dataSize() const;
+    /** @brief Copy the mapped data in memory and unmap the cache file */
+    void detach();
+
+    int m_channels;
+    std::vector<int> m_frames;
+    std::vector<int> m_offsets;
+    /** When the levels were computed in memory, we own the data */
+    QByteArray m_buffer;
+    /** When the levels come from a cache file, the data points in the file mapping */
+    std::unique_ptr<QFile> m_file;
+    const quint8 *m_data;
+    /** Protects m_data, m_buffer and m_file against detach() */
+    mutable QReadWriteLock m_dataLock;
+};
+
+#endif
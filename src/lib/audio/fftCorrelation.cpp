@@ -15,6 +15,7 @@ extern "C" {
 }
 
 #include "kdenlive_debug.h"
+#include <QMutexLocker>
 #include <QTime>
 #include <algorithm>
 #include <vector>
@@ -38,48 +39,39 @@ void FFTCorrelation::correlate(const qint64 *left, const size_t leftSize, const
     QElapsedTimer t;
     t.start();
 
-    auto *leftF = new float[leftSize];
-    auto *rightF = new float[rightSize];
-
-    // First the qint64 values need to be normalized to floats
-    // Dividing by the max value is maybe not the best solution, but the
-    // maximum value after correlation should not be larger than the longest
-    // vector since each value should be at most 1
-    qint64 maxLeft = 1;
-    qint64 maxRight = 1;
-    for (size_t i = 0; i < leftSize; ++i) {
-        if (qAbs(left[i]) > maxLeft) {
-            maxLeft = qAbs(left[i]);
-        }
-    }
-    for (size_t i = 0; i < rightSize; ++i) {
-        if (qAbs(right[i]) > maxRight) {
-            maxRight = qAbs(right[i]);
-        }
-    }
+    std::vector<float> leftF(leftSize);
+    std::vector<float> rightF(rightSize);
 
     // One side needs to be reversed, since multiplication in frequency domain (fourier space)
     // calculates the convolution: \sum l[x]r[N-x] and not the correlation: \sum l[x]r[x]
-    for (size_t i = 0; i < leftSize; ++i) {
-        leftF[i] = double(left[i]) / (double)maxLeft;
-    }
-    for (size_t i = 0; i < rightSize; ++i) {
-        rightF[rightSize - 1 - i] = double(right[i]) / (double)maxRight;
-    }
+    normalize(left, leftSize, false, leftF.data());
+    normalize(right, rightSize, true, rightF.data());
 
     // Now we can convolve to get the correlation
-    convolve(leftF, leftSize, rightF, rightSize, out_correlated);
+    convolve(leftF.data(), leftSize, rightF.data(), rightSize, out_correlated);
 
     qCDebug(KDENLIVE_LOG) << "Correlation (FFT based) computed in " << t.elapsed() << " ms.";
-    delete[] leftF;
-    delete[] rightF;
 }
 
-void FFTCorrelation::convolve(const float *left, const size_t leftSize, const float *right, const size_t rightSize, float *out_convolved)
+void FFTCorrelation::normalize(const qint64 *values, size_t size, bool reverse, float *out)
 {
-    QTime time;
-    time.start();
+    // First the qint64 values need to be normalized to floats
+    // Dividing by the max value is maybe not the best solution, but the
+    // maximum value after correlation should not be larger than the longest
+    // vector since each value should be at most 1
+    qint64 max = 1;
+    for (size_t i = 0; i < size; ++i) {
+        if (qAbs(values[i]) > max) {
+            max = qAbs(values[i]);
+        }
+    }
+    for (size_t i = 0; i < size; ++i) {
+        out[reverse ? size - 1 - i : i] = double(values[i]) / (double)max;
+    }
+}
 
+size_t FFTCorrelation::fftSize(size_t leftSize, size_t rightSize)
+{
     // To avoid issues with repetition (we are dealing with cosine waves
     // in the fourier domain) we need to pad the vectors to at least twice their size,
     // otherwise convolution would convolve with the repeated pattern as well
@@ -91,7 +83,15 @@ void FFTCorrelation::convolve(const float *left, const size_t leftSize, const fl
     while (size / 2 < largestSize) {
         size = size << 1;
     }
+    return size;
+}
 
+void FFTCorrelation::convolve(const float *left, const size_t leftSize, const float *right, const size_t rightSize, float *out_convolved)
+{
+    QTime time;
+    time.start();
+
+    const size_t size = fftSize(leftSize, rightSize);
     const size_t fft_size = size / 2 + 1;
     kiss_fftr_cfg fftConfig = kiss_fftr_alloc((int)size, 0, nullptr, nullptr);
     kiss_fftr_cfg ifftConfig = kiss_fftr_alloc((int)size, 1, nullptr, nullptr);
@@ -132,3 +132,119 @@ void FFTCorrelation::convolve(const float *left, const size_t leftSize, const fl
 
     qCDebug(KDENLIVE_LOG) << "FFT convolution computed. Time taken: " << time.elapsed() << " ms";
 }
+
+struct FFTCorrelation::Reference::Plan
+{
+    explicit Plan(size_t fftSize)
+        : size(fftSize)
+        , fftConfig(kiss_fftr_alloc((int)fftSize, 0, nullptr, nullptr))
+        , ifftConfig(kiss_fftr_alloc((int)fftSize, 1, nullptr, nullptr))
+        , data(fftSize)
+        , spectrum(fftSize / 2 + 1)
+    {
+    }
+    ~Plan()
+    {
+        kiss_fftr_free(fftConfig);
+        kiss_fftr_free(ifftConfig);
+    }
+    Plan(const Plan &) = delete;
+    Plan &operator=(const Plan &) = delete;
+
+    const size_t size;
+    // The configurations hold temporary buffers, so a plan must only be used by one thread at a time
+    kiss_fftr_cfg fftConfig;
+    kiss_fftr_cfg ifftConfig;
+    std::vector<float> data;
+    std::vector<kiss_fft_cpx> spectrum;
+};
+
+FFTCorrelation::Reference::Reference(const qint64 *left, size_t leftSize)
+    : m_left(leftSize)
+{
+    normalize(left, leftSize, false, m_left.data());
+}
+
+FFTCorrelation::Reference::~Reference() = default;
+
+size_t FFTCorrelation::Reference::size() const
+{
+    return m_left.size();
+}
+
+std::unique_ptr<FFTCorrelation::Reference::Plan> FFTCorrelation::Reference::acquirePlan(size_t size)
+{
+    {
+        QMutexLocker lock(&m_mutex);
+        auto it = m_idlePlans.find(size);
+        if (it != m_idlePlans.end()) {
+            std::unique_ptr<Plan> plan = std::move(it->second);
+            m_idlePlans.erase(it);
+            return plan;
+        }
+    }
+    return std::unique_ptr<Plan>(new Plan(size));
+}
+
+void FFTCorrelation::Reference::releasePlan(std::unique_ptr<Plan> plan)
+{
+    QMutexLocker lock(&m_mutex);
+    const size_t size = plan->size;
+    m_idlePlans.emplace(size, std::move(plan));
+}
+
+const std::vector<float> &FFTCorrelation::Reference::spectrum(size_t size)
+{
+    QMutexLocker lock(&m_mutex);
+    auto it = m_spectra.find(size);
+    if (it != m_spectra.end()) {
+        // std::map never moves its elements, the reference stays valid
+        return it->second;
+    }
+    lock.unlock();
+    std::unique_ptr<Plan> plan = acquirePlan(size);
+    std::fill(plan->data.begin(), plan->data.end(), 0.f);
+    std::copy(m_left.begin(), m_left.end(), plan->data.begin());
+    kiss_fftr(plan->fftConfig, plan->data.data(), plan->spectrum.data());
+    std::vector<float> spectrum(plan->spectrum.size() * 2);
+    for (size_t i = 0; i < plan->spectrum.size(); ++i) {
+        spectrum[2 * i] = plan->spectrum[i].r;
+        spectrum[2 * i + 1] = plan->spectrum[i].i;
+    }
+    releasePlan(std::move(plan));
+    lock.relock();
+    // If another thread computed the same spectrum meanwhile, keep the first one
+    return m_spectra.emplace(size, std::move(spectrum)).first->second;
+}
+
+void FFTCorrelation::Reference::correlate(const qint64 *right, size_t rightSize, qint64 *out_correlated)
+{
+    std::vector<float> correlatedFloat(m_left.size() + rightSize + 1);
+    correlate(right, rightSize, correlatedFloat.data());
+    for (size_t i = 0; i < correlatedFloat.size(); ++i) {
+        out_correlated[i] = correlatedFloat[i];
+    }
+}
+
+void FFTCorrelation::Reference::correlate(const qint64 *right, size_t rightSize, float *out_correlated)
+{
+    const size_t size = fftSize(m_left.size(), rightSize);
+    const std::vector<float> &leftFFT = spectrum(size);
+    std::unique_ptr<Plan> plan = acquirePlan(size);
+
+    // Same steps as FFTCorrelation::correlate, with the reference already transformed
+    std::fill(plan->data.begin(), plan->data.end(), 0.f);
+    normalize(right, rightSize, true, plan->data.data());
+    kiss_fftr(plan->fftConfig, plan->data.data(), plan->spectrum.data());
+    for (size_t i = 0; i < plan->spectrum.size(); ++i) {
+        const kiss_fft_cpx rightFFT = plan->spectrum[i];
+        plan->spectrum[i].r = leftFFT[2 * i] * rightFFT.r - leftFFT[2 * i + 1] * rightFFT.i;
+        plan->spectrum[i].i = leftFFT[2 * i] * rightFFT.i + leftFFT[2 * i + 1] * rightFFT.r;
+    }
+    kiss_fftri(plan->ifftConfig, plan->spectrum.data(), plan->data.data());
+
+    *out_correlated = 0;
+    const size_t out_size = m_left.size() + rightSize + 1;
+    std::copy(plan->data.begin(), plan->data.begin() + (int)out_size - 1, out_correlated + 1);
+    releasePlan(std::move(plan));
+}
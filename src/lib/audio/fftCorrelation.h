@@ -11,7 +11,12 @@ the Free Software Foundation, either version 3 of the License, or
 #ifndef FFTCORRELATION_H
 #define FFTCORRELATION_H
 
+#include <QMutex>
 #include <QtGlobal>
+#include <map>
+#include <memory>
+#include <vector>
+
 /**
   This class provides methods to calculate convolution
   and correlation of two vectors by means of FFT, which
@@ -36,6 +41,51 @@ public:
     static void correlate(const qint64 *left, const size_t leftSize, const qint64 *right, const size_t rightSize, float *out_correlated);
 
     static void correlate(const qint64 *left, const size_t leftSize, const qint64 *right, const size_t rightSize, qint64 *out_correlated);
+
+    /**
+      Correlates many vectors with the same \c left vector, with the
+      same results as correlate().
+      The spectrum of the reference is computed once per FFT size, and
+      the FFT configurations and buffers are reused by the next calls,
+      so each correlation only costs one forward and one inverse FFT.
+      correlate() can be called from several threads at the same time.
+      */
+    class Reference
+    {
+    public:
+        Reference(const qint64 *left, size_t leftSize);
+        ~Reference();
+
+        size_t size() const;
+        /**
+          \c out_correlated must be a pre-allocated vector of size
+          size() + \c rightSize + 1.
+          */
+        void correlate(const qint64 *right, size_t rightSize, float *out_correlated);
+        void correlate(const qint64 *right, size_t rightSize, qint64 *out_correlated);
+
+    private:
+        struct Plan;
+        /** @brief Returns an idle plan for FFTs of the given size, creating it if needed */
+        std::unique_ptr<Plan> acquirePlan(size_t size);
+        void releasePlan(std::unique_ptr<Plan> plan);
+        /** @brief Returns the spectrum of the reference for FFTs of the given size, computing it if needed */
+        const std::vector<float> &spectrum(size_t size);
+
+        /** Normalized reference vector */
+        std::vector<float> m_left;
+        /** This mutex protects the spectra and the idle plans */
+        QMutex m_mutex;
+        /** Spectra of the reference by FFT size, stored as interleaved (real, imaginary) values */
+        std::map<size_t, std::vector<float>> m_spectra;
+        std::multimap<size_t, std::unique_ptr<Plan>> m_idlePlans;
+    };
+
+private:
+    /** @brief Returns the FFT size to use for convolving vectors of the given sizes */
+    static size_t fftSize(size_t leftSize, size_t rightSize);
+    /** @brief Normalizes \c values by their maximum absolute value into \c out, reversing them if requested */
+    static void normalize(const qint64 *values, size_t size, bool reverse, float *out);
 };
 
 #endif // FFTCORRELATION_H
@@ -10,10 +10,11 @@
 
 #include "fftTools.h"
 
+#include <QtConcurrent>
+#include <algorithm>
 #include <cmath>
-#include <iostream>
-
-#include <QString>
+#include <cstring>
+#include <numeric>
 
 // Uncomment for debugging, like writing a GNU Octave .m file to /tmp
 //#define DEBUG_FFTTOOLS
@@ -24,26 +25,22 @@
 #include <fstream>
 #endif
 
-FFTTools::FFTTools()
-    : m_fftCfgs()
-    , m_windowFunctions()
-{
-}
-FFTTools::~FFTTools()
-{
-    QHash<QString, kiss_fftr_cfg>::iterator i;
-    for (i = m_fftCfgs.begin(); i != m_fftCfgs.end(); ++i) {
-        free(*i);
-    }
-}
+FFTTools::FFTTools() = default;
+
+FFTTools::~FFTTools() = default;
 
-const QString FFTTools::windowSignature(const WindowType windowType, const int size, const float param)
+FFTTools::Plan::Plan(uint windowSize)
+    : size(windowSize)
+    , cfg(kiss_fftr_alloc(int(windowSize), 0, nullptr, nullptr))
+    , input(windowSize)
+    , output(windowSize / 2 + 1)
+    , spectrum(windowSize / 2)
 {
-    return QStringLiteral("s%1_t%2_p%3").arg(size).arg(windowType).arg(param, 0, 'f', 3);
 }
-const QString FFTTools::cfgSignature(const int size)
+
+FFTTools::Plan::~Plan()
 {
-    return QStringLiteral("s%1").arg(size);
+    free(cfg);
 }
 
 // https://cplusplus.syntaxerrors.info/index.php?title=Cannot_declare_member_function_%E2%80%98static_int_Foo::bar%28%29%E2%80%99_to_have_static_linkage
@@ -111,123 +108,141 @@ const QVector<float> FFTTools::window(const WindowType windowType, const int siz
     return QVector<float>();
 }
 
-void FFTTools::fftNormalized(const audioShortVector &audioFrame, const uint channel, const uint numChannels, float *freqSpectrum, const WindowType windowType,
-                             const uint windowSize, const float param)
+const QVector<float> &FFTTools::windowFunction(const WindowType windowType, const uint size, const float param)
 {
+    const auto key = std::make_tuple(int(windowType), size, param);
+    auto it = m_windowFunctions.find(key);
+    if (it == m_windowFunctions.end()) {
 #ifdef DEBUG_FFTTOOLS
-    QTime start = QTime::currentTime();
+        qCDebug(KDENLIVE_LOG) << "Building new window function of type" << windowType << "with size" << size << "and parameter" << param;
 #endif
-
-    const uint numSamples = (uint)audioFrame.size() / numChannels;
-
-    if (((windowSize & 1) != 0u) || windowSize < 2) {
-        return;
+        it = m_windowFunctions.emplace(key, FFTTools::window(windowType, int(size), param)).first;
     }
+    return it->second;
+}
 
-    const QString cfgSig = cfgSignature((int)windowSize);
-    const QString winSig = windowSignature(windowType, (int)windowSize, param);
-
-    // Get the kiss_fft configuration from the config cache
-    // or build a new configuration if the requested one is not available.
-    kiss_fftr_cfg myCfg;
-    if (m_fftCfgs.contains(cfgSig)) {
-#ifdef DEBUG_FFTTOOLS
-        qCDebug(KDENLIVE_LOG) << "Re-using FFT configuration with size " << windowSize;
-#endif
-        myCfg = m_fftCfgs.value(cfgSig);
-    } else {
-#ifdef DEBUG_FFTTOOLS
-        qCDebug(KDENLIVE_LOG) << "Creating FFT configuration with size " << windowSize;
-#endif
-        myCfg = kiss_fftr_alloc((int)windowSize, 0, nullptr, nullptr);
-        m_fftCfgs.insert(cfgSig, myCfg);
-    }
-
-    // Get the window function from the cache
-    // (except for a rectangular window; nothing to do there).
-    QVector<float> window;
-    float windowScaleFactor = 1;
-    if (windowType != FFTTools::Window_Rect) {
-
-        if (m_windowFunctions.contains(winSig)) {
-#ifdef DEBUG_FFTTOOLS
-            qCDebug(KDENLIVE_LOG) << "Re-using window function with signature " << winSig;
-#endif
-            window = m_windowFunctions.value(winSig);
-        } else {
+void FFTTools::preparePlans(const uint count, const uint size)
+{
+    for (auto &plan : m_plans) {
+        if (plan->size != size) {
 #ifdef DEBUG_FFTTOOLS
-            qCDebug(KDENLIVE_LOG) << "Building new window function with signature " << winSig;
+            qCDebug(KDENLIVE_LOG) << "Creating FFT configuration with size " << size;
 #endif
-            window = FFTTools::window(windowType, (int)windowSize, 0);
-            m_windowFunctions.insert(winSig, window);
+            plan.reset(new Plan(size));
         }
-        windowScaleFactor = 1.0 / window[(int)windowSize];
     }
+    while (m_plans.size() < count) {
+        m_plans.emplace_back(new Plan(size));
+    }
+}
 
-    // Prepare frequency space vector. The resulting FFT vector is only half as long.
-    auto *freqData = new kiss_fft_cpx[int(windowSize) / 2];
-    auto *data = new float[(int)windowSize];
+void FFTTools::transform(Plan &plan, const audioShortVector &audioFrame, const uint channel, const uint numChannels, const QVector<float> *window, float *out)
+{
+    const uint numSamples = qMin(uint(audioFrame.size()) / numChannels, plan.size);
+    const qint16 *samples = audioFrame.constData() + channel;
+    float *data = plan.input.data();
 
-    // Copy the first channel's audio into a vector for the FFT display;
-    // Fill the data vector indices that cannot be covered with sample data with 0
-    if (numSamples < windowSize) {
-        std::fill(&data[numSamples], &data[windowSize - 1], 0);
-    }
     // Normalize signals to [0,1] to get correct dB values later on
-    for (uint i = 0; i < numSamples && i < windowSize; ++i) {
-        // Performance note: Benchmarking has shown that using the if/else inside the loop
-        // does not do noticeable worse than keeping it outside (perhaps the branch predictor
-        // is good enough), so it remains in there for better readability.
-        if (windowType != FFTTools::Window_Rect) {
-            data[i] = (float)audioFrame.data()[i * numChannels + channel] / 32767.0f * window[(int)i];
-        } else {
-            data[i] = (float)audioFrame.data()[i * numChannels + channel] / 32767.0f;
+    float windowScaleFactor = 1;
+    if (window != nullptr) {
+        const float *factors = window->constData();
+        for (uint i = 0; i < numSamples; ++i) {
+            data[i] = float(samples[i * numChannels]) / 32767.0f * factors[i];
+        }
+        windowScaleFactor = 1.0f / factors[plan.size];
+    } else {
+        for (uint i = 0; i < numSamples; ++i) {
+            data[i] = float(samples[i * numChannels]) / 32767.0f;
         }
     }
+    // Fill the data vector indices that cannot be covered with sample data with 0
+    std::fill(data + numSamples, data + plan.size, 0.f);
 
     // Calculate the Fast Fourier Transform for the input data
-    kiss_fftr(myCfg, data, freqData);
-
-    // Logarithmic scale: 20 * log ( 2 * magnitude / N ) with magnitude = sqrt(r² + i²)
-    // with N = FFT size (after FFT, 1/2 window size)
-    for (uint i = 0; i < windowSize / 2; ++i) {
-        // Logarithmic scale: 20 * log ( 2 * magnitude / N ) with magnitude = sqrt(r² + i²)
-        // with N = FFT size (after FFT, 1/2 window size)
-        freqSpectrum[i] =
-            20 * log(pow(pow(fabs(freqData[i].r * windowScaleFactor), 2) + pow(fabs(freqData[i].i * windowScaleFactor), 2), .5) / ((float)windowSize / 2.0f)) /
-            log(10);
-        ;
+    kiss_fftr(plan.cfg, data, plan.output.data());
+    decibels(plan.output.data(), out, plan.size / 2, plan.size, windowScaleFactor);
+}
+
+void FFTTools::decibels(const kiss_fft_cpx *freqData, float *out, const uint count, const uint windowSize, const float scale)
+{
+    // 20 * log10(2 * magnitude * scale / N) = 10 * log10(magnitude²) + 20 * log10(2 * scale / N)
+    const float offset = 20.f * std::log10(2.f * scale / float(windowSize));
+    // Tiny power added to all bins (about -300 dB) to avoid log(0) without a branch
+    const float minPower = 1e-30f;
+    for (uint i = 0; i < count; ++i) {
+        const float power = freqData[i].r * freqData[i].r + freqData[i].i * freqData[i].i + minPower;
+        // Split the power in exponent and mantissa m in [1,2[: log10(power) = e * log10(2) + ln(m) * log10(e)
+        quint32 bits;
+        memcpy(&bits, &power, sizeof(bits));
+        const float exponent = float(int(bits >> 23) - 127);
+        bits = (bits & 0x007fffffu) | 0x3f800000u;
+        float mantissa;
+        memcpy(&mantissa, &bits, sizeof(mantissa));
+        // ln(m) = 2 * atanh(t) with t = (m - 1) / (m + 1) in [0, 1/3[, the series converges quickly
+        const float t = (mantissa - 1.f) / (mantissa + 1.f);
+        const float t2 = t * t;
+        const float ln = 2.f * t * (1.f + t2 * (1.f / 3.f + t2 * (1.f / 5.f + t2 * (1.f / 7.f + t2 * (1.f / 9.f)))));
+        out[i] = 10.f * (exponent * 0.30102999566f + ln * 0.43429448190f) + offset;
     }
+}
 
+void FFTTools::fftNormalized(const audioShortVector &audioFrame, const uint channel, const uint numChannels, float *freqSpectrum, const WindowType windowType,
+                             const uint windowSize, const float param)
+{
 #ifdef DEBUG_FFTTOOLS
-    std::ofstream mFile;
-    mFile.open("/tmp/freq.m");
-    if (!mFile) {
-        qCDebug(KDENLIVE_LOG) << "Opening file failed.";
-    } else {
-        mFile << "val = [ ";
+    QTime start = QTime::currentTime();
+#endif
 
-        for (int sample = 0; sample < 256; ++sample) {
-            mFile << data[sample] << ' ';
-        }
-        mFile << " ];\n";
+    if (((windowSize & 1) != 0u) || windowSize < 2 || channel >= numChannels) {
+        return;
+    }
 
-        mFile << "freq = [ ";
-        for (int sample = 0; sample < 256; ++sample) {
-            mFile << freqData[sample].r << '+' << freqData[sample].i << "*i ";
-        }
-        mFile << " ];\n";
+    preparePlans(1, windowSize);
+    // Get the window function from the cache (except for a rectangular window; nothing to do there).
+    const QVector<float> *window = windowType == FFTTools::Window_Rect ? nullptr : &windowFunction(windowType, windowSize, param);
+    transform(*m_plans.front(), audioFrame, channel, numChannels, window, freqSpectrum);
 
-        mFile.close();
-        qCDebug(KDENLIVE_LOG) << "File written.";
+#ifdef DEBUG_FFTTOOLS
+    qCDebug(KDENLIVE_LOG) << "Calculated FFT in " << start.elapsed() << " ms.";
+#endif
+}
+
+void FFTTools::fftNormalizedAllChannels(const audioShortVector &audioFrame, const uint numChannels, float *freqSpectrum, const WindowType windowType,
+                                        const uint windowSize, const float param)
+{
+    if (numChannels < 2) {
+        fftNormalized(audioFrame, 0, 1, freqSpectrum, windowType, windowSize, param);
+        return;
     }
+    if (((windowSize & 1) != 0u) || windowSize < 2) {
+        return;
+    }
+#ifdef DEBUG_FFTTOOLS
+    QTime start = QTime::currentTime();
 #endif
 
+    preparePlans(numChannels, windowSize);
+    const QVector<float> *window = windowType == FFTTools::Window_Rect ? nullptr : &windowFunction(windowType, windowSize, param);
+    // Each channel has its own plan, so the channels do not share any buffer
+    QVector<uint> channels(int(numChannels));
+    std::iota(channels.begin(), channels.end(), 0u);
+    QtConcurrent::blockingMap(channels, [&](uint channel) {
+        Plan &plan = *m_plans[channel];
+        transform(plan, audioFrame, channel, numChannels, window, plan.spectrum.data());
+    });
+
+    const uint bins = windowSize / 2;
+    std::copy(m_plans[0]->spectrum.cbegin(), m_plans[0]->spectrum.cend(), freqSpectrum);
+    for (uint channel = 1; channel < numChannels; ++channel) {
+        const float *spectrum = m_plans[channel]->spectrum.data();
+        for (uint i = 0; i < bins; ++i) {
+            freqSpectrum[i] = qMax(freqSpectrum[i], spectrum[i]);
+        }
+    }
+
 #ifdef DEBUG_FFTTOOLS
-    qCDebug(KDENLIVE_LOG) << "Calculated FFT in " << start.elapsed() << " ms.";
+    qCDebug(KDENLIVE_LOG) << "Calculated FFT of" << numChannels << "channels in " << start.elapsed() << " ms.";
 #endif
-    delete[] freqData;
-    delete[] data;
 }
 
 const QVector<float> FFTTools::interpolatePeakPreserving(const QVector<float> &in, const uint targetSize, uint left, uint right, float fill)
@@ -13,8 +13,11 @@
 
 #include "../../definitions.h"
 #include "../external/kiss_fft/tools/kiss_fftr.h"
-#include <QHash>
 #include <QVector>
+#include <map>
+#include <memory>
+#include <tuple>
+#include <vector>
 
 class FFTTools
 {
@@ -39,12 +42,6 @@ public:
     */
     static const QVector<float> window(const WindowType windowType, const int size, const float param = 0);
 
-    static const QString windowSignature(const WindowType windowType, const int size, const float param = 0);
-
-    /** Returns a signature for a kiss_fft configuration
-        used as a hash in the cache */
-    static const QString cfgSignature(const int size);
-
     /** Calculates the Fourier Transformation of the input audio frame.
         The resulting values will be given in relative decibel: The maximum power is 0 dB, lower powers have
         negative dB values.
@@ -57,6 +54,18 @@ public:
     void fftNormalized(const audioShortVector &audioFrame, const uint channel, const uint numChannels, float *freqSpectrum, const WindowType windowType,
                        const uint windowSize, const float param = 0);
 
+    /** Same as fftNormalized, for all the channels of the frame. The channels are transformed in parallel,
+        and freqSpectrum receives for each frequency the value of the loudest channel.
+    */
+    void fftNormalizedAllChannels(const audioShortVector &audioFrame, const uint numChannels, float *freqSpectrum, const WindowType windowType,
+                                  const uint windowSize, const float param = 0);
+
+    /** Converts the output of a FFT of size windowSize to relative decibel: 20 * log10(2 * magnitude * scale / windowSize)
+        with magnitude = sqrt(r² + i²). The loop has no branch nor function call, so that the compiler can vectorize it.
+        Zero magnitudes give a very low value instead of -infinity.
+    */
+    static void decibels(const kiss_fft_cpx *freqData, float *out, const uint count, const uint windowSize, const float scale = 1);
+
     /** This is linear interpolation with the special property that it preserves peaks, which is required
         for e.g. showing correct Decibel values (where the peak values are of interest because of clipping which
         may occur for too strong frequencies; The lower values are smeared by the window function anyway).
@@ -74,8 +83,32 @@ public:
     static const QVector<float> interpolatePeakPreserving(const QVector<float> &in, const uint targetSize, uint left = 0, uint right = 0, float fill = 0.0);
 
 private:
-    QHash<QString, kiss_fftr_cfg> m_fftCfgs;          // FFT cfg cache
-    QHash<QString, QVector<float>> m_windowFunctions; // Window function cache
+    /** Work buffers and FFT configuration to transform one channel.
+        kiss_fftr configurations contain scratch memory, so each channel transformed in parallel needs its own plan. */
+    struct Plan
+    {
+        explicit Plan(uint windowSize);
+        ~Plan();
+        Plan(const Plan &) = delete;
+        Plan &operator=(const Plan &) = delete;
+
+        uint size;
+        kiss_fftr_cfg cfg;
+        std::vector<float> input;
+        std::vector<kiss_fft_cpx> output;
+        std::vector<float> spectrum;
+    };
+
+    /** Returns the window function from the cache, or builds it */
+    const QVector<float> &windowFunction(const WindowType windowType, const uint size, const float param);
+    /** Makes sure that there are at least count plans of the given size */
+    void preparePlans(const uint count, const uint size);
+    /** Windows and transforms one channel, writing the spectrum into out. window is nullptr for the rectangular window */
+    static void transform(Plan &plan, const audioShortVector &audioFrame, const uint channel, const uint numChannels, const QVector<float> *window,
+                          float *out);
+
+    std::vector<std::unique_ptr<Plan>> m_plans;
+    std::map<std::tuple<int, uint, float>, QVector<float>> m_windowFunctions;
 };
 
 #endif // FFTTOOLS_H
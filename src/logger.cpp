@@ -25,6 +25,8 @@
 #include "timeline2/model/timelineitemmodel.hpp"
 #include "timeline2/model/timelinemodel.hpp"
 #include <QString>
+#include <cstdio>
+#include <cstring>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
@@ -37,6 +39,7 @@
 #pragma GCC diagnostic ignored "-Wpedantic"
 #include <rttr/registration>
 #pragma GCC diagnostic pop
+#include <qplatformdefs.h>
 
 thread_local bool Logger::is_executing = false;
 std::mutex Logger::mut;
@@ -46,9 +49,41 @@ std::unordered_map<std::string, std::vector<Logger::Constr>> Logger::constr;
 std::unordered_map<std::string, std::string> Logger::translation_table;
 std::unordered_map<std::string, std::string> Logger::back_translation_table;
 int Logger::dump_count = 0;
+const size_t Logger::RingSlots;
+const size_t Logger::RingMaxArgs;
+const size_t Logger::RingPayloadSize;
+std::atomic<Logger::Mode> Logger::current_mode{Logger::Mode::Full};
+std::unique_ptr<Logger::RingSlot[]> Logger::ring;
+std::atomic<uint64_t> Logger::ring_head{0};
+std::string Logger::ring_file;
+std::unordered_map<std::string, std::unordered_set<size_t>> Logger::ring_refs;
+std::vector<std::pair<const void *, std::string>> Logger::ring_timelines;
 
 thread_local size_t Logger::result_awaiting = INT_MAX;
 
+namespace {
+bool isIthParamARef(const rttr::method &method, size_t i)
+{
+    QString sig = QString::fromStdString(method.get_signature().to_string());
+    int deb = sig.indexOf("(");
+    int end = sig.lastIndexOf(")");
+    sig = sig.mid(deb + 1, deb - end - 1);
+    QStringList args = sig.split(QStringLiteral(","));
+    return args[(int)i].contains("&") && !args[(int)i].contains("const &");
+}
+std::string quoted(const std::string &input)
+{
+#if __cpp_lib_quoted_string_io
+    std::stringstream ss;
+    ss << std::quoted(input);
+    return ss.str();
+#else
+    // very incomplete implem
+    return "\"" + input + "\"";
+#endif
+}
+} // namespace
+
 void Logger::init()
 {
     std::string cur_ind = "a";
@@ -76,14 +111,27 @@ void Logger::init()
         incr_ind(incr_ind);
     }
 
+    // Parsing the signatures is slow, so the ring buffer uses the parameters passed by reference computed here
+    auto store_refs = [](const rttr::method &m) {
+        std::unordered_set<size_t> &refs = ring_refs[m.get_name().to_string()];
+        for (const auto &a : m.get_parameter_infos()) {
+            if (isIthParamARef(m, a.get_index())) {
+                // The instance is inserted as first argument
+                refs.insert(a.get_index() + 1);
+            }
+        }
+    };
+
     for (const auto &m : rttr::type::get<TimelineModel>().get_methods()) {
         translation_table[m.get_name().to_string()] = cur_ind;
         incr_ind(incr_ind);
+        store_refs(m);
     }
 
     for (const auto &m : rttr::type::get<TimelineFunctions>().get_methods()) {
         translation_table[m.get_name().to_string()] = cur_ind;
         incr_ind(incr_ind);
+        store_refs(m);
     }
 
     for (const auto &i : translation_table) {
@@ -91,10 +139,25 @@ void Logger::init()
     }
 }
 
-bool Logger::start_logging()
+void Logger::set_mode(Mode mode, const std::string &dumpFile)
 {
     std::unique_lock<std::mutex> lk(mut);
-    if (is_executing) {
+    if (mode == Mode::RingBuffer && !ring) {
+        ring.reset(new RingSlot[RingSlots]);
+    }
+    ring_file = dumpFile;
+    current_mode = mode;
+}
+
+Logger::Mode Logger::mode()
+{
+    return current_mode;
+}
+
+bool Logger::start_logging()
+{
+    // is_executing is thread local, no need to lock
+    if (current_mode == Mode::Disabled || is_executing) {
         return false;
     }
     is_executing = true;
@@ -102,7 +165,6 @@ bool Logger::start_logging()
 }
 void Logger::stop_logging()
 {
-    std::unique_lock<std::mutex> lk(mut);
     is_executing = false;
 }
 std::string Logger::get_ptr_name(const rttr::variant &ptr)
@@ -121,6 +183,10 @@ std::string Logger::get_ptr_name(const rttr::variant &ptr)
 
 void Logger::log_res(rttr::variant result)
 {
+    if (current_mode != Mode::Full) {
+        // Results are only used to generate test cases
+        return;
+    }
     std::unique_lock<std::mutex> lk(mut);
     Q_ASSERT(result_awaiting < invoks.size());
     invoks[result_awaiting].res = std::move(result);
@@ -128,40 +194,87 @@ void Logger::log_res(rttr::variant result)
 
 void Logger::log_create_producer(const std::string &type, std::vector<rttr::variant> args)
 {
-    std::unique_lock<std::mutex> lk(mut);
     for (auto &a : args) {
         // this will rewove shared/weak/unique ptrs
         if (a.get_type().is_wrapper()) {
             a = a.extract_wrapped_value();
         }
-        const std::string class_name = a.get_type().get_name().to_string();
     }
+    if (current_mode == Mode::RingBuffer) {
+        ring_constr(type, type, args);
+        return;
+    }
+    std::unique_lock<std::mutex> lk(mut);
     constr[type].push_back({type, std::move(args)});
     operations.emplace_back(ConstrId{type, constr[type].size() - 1});
 }
 
-namespace {
-bool isIthParamARef(const rttr::method &method, size_t i)
-{
-    QString sig = QString::fromStdString(method.get_signature().to_string());
-    int deb = sig.indexOf("(");
-    int end = sig.lastIndexOf(")");
-    sig = sig.mid(deb + 1, deb - end - 1);
-    QStringList args = sig.split(QStringLiteral(","));
-    return args[(int)i].contains("&") && !args[(int)i].contains("const &");
-}
-std::string quoted(const std::string &input)
+std::string Logger::fuzz_args(const std::vector<rttr::variant> &args, const std::unordered_set<size_t> &refs)
 {
-#if __cpp_lib_quoted_string_io
     std::stringstream ss;
-    ss << std::quoted(input);
+    bool deb = true;
+    size_t i = 0;
+    for (const auto &a : args) {
+        if (deb) {
+            deb = false;
+            i = 0;
+        } else {
+            ss << " ";
+            ++i;
+        }
+        if (refs.count(i) > 0) {
+            continue;
+        } else if (a.get_type() == rttr::type::get<int>()) {
+            ss << a.convert<int>();
+        } else if (a.get_type() == rttr::type::get<double>()) {
+            ss << a.convert<double>();
+        } else if (a.get_type() == rttr::type::get<float>()) {
+            ss << a.convert<float>();
+        } else if (a.get_type() == rttr::type::get<size_t>()) {
+            ss << a.convert<size_t>();
+        } else if (a.get_type() == rttr::type::get<bool>()) {
+            ss << (a.convert<bool>() ? "1" : "0");
+        } else if (a.get_type().is_enumeration()) {
+            ss << a.convert<int>();
+        } else if (a.can_convert<QString>()) {
+            std::string out = a.convert<QString>().toStdString();
+            if (out.empty()) {
+                out = "$$";
+            }
+            ss << out;
+        } else if (a.can_convert<std::string>()) {
+            std::string out = a.convert<std::string>();
+            if (out.empty()) {
+                out = "$$";
+            }
+            ss << out;
+        } else if (a.can_convert<std::unordered_set<int>>()) {
+            auto set = a.convert<std::unordered_set<int>>();
+            ss << set.size() << " ";
+            bool beg = true;
+            for (int s : set) {
+                if (beg)
+                    beg = false;
+                else
+                    ss << " ";
+                ss << s;
+            }
+        } else if (a.get_type().is_pointer()) {
+            if (a.can_convert<TimelineModel *>()) {
+                ss << get_id_from_ptr(a.convert<TimelineModel *>());
+            } else if (a.can_convert<TimelineItemModel *>()) {
+                ss << get_id_from_ptr(static_cast<TimelineModel *>(a.convert<TimelineItemModel *>()));
+            } else if (a.can_convert<ProjectItemModel *>()) {
+                // only one binModel, we skip the parameter since it's unambiguous
+            } else {
+                std::cout << "Error: unhandled ptr type " << a.get_type().get_name().to_string() << std::endl;
+            }
+        } else {
+            std::cout << "Error: unhandled arg type " << a.get_type().get_name().to_string() << std::endl;
+        }
+    }
     return ss.str();
-#else
-    // very incomplete implem
-    return "\"" + input + "\"";
-#endif
 }
-} // namespace
 
 void Logger::print_trace()
 {
@@ -217,71 +330,6 @@ void Logger::print_trace()
         }
         return ss.str();
     };
-    auto process_args_fuzz = [&](const std::vector<rttr::variant> &args, const std::unordered_set<size_t> &refs = {}) {
-        std::stringstream ss;
-        bool deb = true;
-        size_t i = 0;
-        for (const auto &a : args) {
-            if (deb) {
-                deb = false;
-                i = 0;
-            } else {
-                ss << " ";
-                ++i;
-            }
-            if (refs.count(i) > 0) {
-                continue;
-            } else if (a.get_type() == rttr::type::get<int>()) {
-                ss << a.convert<int>();
-            } else if (a.get_type() == rttr::type::get<double>()) {
-                ss << a.convert<double>();
-            } else if (a.get_type() == rttr::type::get<float>()) {
-                ss << a.convert<float>();
-            } else if (a.get_type() == rttr::type::get<size_t>()) {
-                ss << a.convert<size_t>();
-            } else if (a.get_type() == rttr::type::get<bool>()) {
-                ss << (a.convert<bool>() ? "1" : "0");
-            } else if (a.get_type().is_enumeration()) {
-                ss << a.convert<int>();
-            } else if (a.can_convert<QString>()) {
-                std::string out = a.convert<QString>().toStdString();
-                if (out.empty()) {
-                    out = "$$";
-                }
-                ss << out;
-            } else if (a.can_convert<std::string>()) {
-                std::string out = a.convert<std::string>();
-                if (out.empty()) {
-                    out = "$$";
-                }
-                ss << out;
-            } else if (a.can_convert<std::unordered_set<int>>()) {
-                auto set = a.convert<std::unordered_set<int>>();
-                ss << set.size() << " ";
-                bool beg = true;
-                for (int s : set) {
-                    if (beg)
-                        beg = false;
-                    else
-                        ss << " ";
-                    ss << s;
-                }
-            } else if (a.get_type().is_pointer()) {
-                if (a.can_convert<TimelineModel *>()) {
-                    ss << get_id_from_ptr(a.convert<TimelineModel *>());
-                } else if (a.can_convert<TimelineItemModel *>()) {
-                    ss << get_id_from_ptr(static_cast<TimelineModel *>(a.convert<TimelineItemModel *>()));
-                } else if (a.can_convert<ProjectItemModel *>()) {
-                    // only one binModel, we skip the parameter since it's unambiguous
-                } else {
-                    std::cout << "Error: unhandled ptr type " << a.get_type().get_name().to_string() << std::endl;
-                }
-            } else {
-                std::cout << "Error: unhandled arg type " << a.get_type().get_name().to_string() << std::endl;
-            }
-        }
-        return ss.str();
-    };
     std::ofstream fuzz_file;
     fuzz_file.open("fuzz_case_" + std::to_string(dump_count) + ".txt");
     std::ofstream test_file;
@@ -365,7 +413,7 @@ void Logger::print_trace()
                     }
                     std::swap(refs, new_refs);
                 }
-                fuzz_file << translation_table[invok_name] << " " << process_args_fuzz(args, refs) << std::endl;
+                fuzz_file << translation_table[invok_name] << " " << fuzz_args(args, refs) << std::endl;
             } else {
                 std::cout << "ERROR: unknown method " << invok_name << std::endl;
             }
@@ -374,7 +422,7 @@ void Logger::print_trace()
             ConstrId id = o.convert<Logger::ConstrId>();
             std::string constr_name = std::string("constr_") + id.type;
             if (translation_table.count(constr_name) > 0) {
-                fuzz_file << translation_table[constr_name] << " " << process_args_fuzz(constr[id.type][id.id].second) << std::endl;
+                fuzz_file << translation_table[constr_name] << " " << fuzz_args(constr[id.type][id.id].second) << std::endl;
             } else {
                 std::cout << "ERROR: unknown constructor " << constr_name << std::endl;
             }
@@ -415,12 +463,260 @@ void Logger::print_trace()
     test_file << "pCore->m_projectManager = nullptr;" << std::endl;
     test_file << "}" << std::endl;
 }
+void Logger::ring_constr(const std::string &type, const rttr::variant &inst, const std::vector<rttr::variant> &args)
+{
+    auto it = translation_table.find(std::string("constr_") + type);
+    if (it == translation_table.end()) {
+        return;
+    }
+    if (type == "TimelineModel") {
+        // Timelines are needed to find the id of the timeline passed to the other operations. They are rarely created, so they are formatted right away
+        std::unique_lock<std::mutex> lk(mut);
+        ring_timelines.emplace_back(inst.convert<TimelineModel *>(), it->second + " " + fuzz_args(args));
+        return;
+    }
+    ring_record(it->second.c_str(), nullptr, args);
+}
+
+void Logger::ring_invok(const rttr::variant &inst, const std::string &method, const std::vector<rttr::variant> &args)
+{
+    // The tables are not modified after init, so they can be read without locking
+    auto it = translation_table.find(method);
+    auto refs = ring_refs.find(method);
+    if (it == translation_table.end() || refs == ring_refs.end()) {
+        return;
+    }
+    ring_record(it->second.c_str(), &inst, args, &refs->second);
+}
+
+void Logger::ring_record(const char *command, const rttr::variant *inst, const std::vector<rttr::variant> &args, const std::unordered_set<size_t> *refs)
+{
+    if (!ring) {
+        return;
+    }
+    const uint64_t index = ring_head.fetch_add(1);
+    RingSlot &slot = ring[index % RingSlots];
+    slot.sequence.store(0, std::memory_order_release);
+    slot.count = 0;
+    uint32_t used = 0;
+    bool complete = inst == nullptr || ring_arg(slot, used, *inst, false);
+    for (size_t i = 0; complete && i < args.size(); ++i) {
+        // Like in fuzz_args, the references are counted with the instance
+        const size_t position = inst == nullptr ? i : i + 1;
+        complete = ring_arg(slot, used, args[i], refs != nullptr && refs->count(position) > 0);
+    }
+    // A truncated command could not be replayed, drop it
+    slot.command = complete ? command : nullptr;
+    slot.sequence.store(index + 1, std::memory_order_release);
+}
+
+bool Logger::ring_arg(RingSlot &slot, uint32_t &used, const rttr::variant &arg, bool skipped)
+{
+    if (slot.count == RingMaxArgs) {
+        return false;
+    }
+    ArgKind &kind = slot.kinds[slot.count];
+    ArgValue &value = slot.values[slot.count];
+    slot.count++;
+    kind = ArgKind::None;
+    const rttr::type type = arg.get_type();
+    if (skipped) {
+        return true;
+    }
+    auto store_text = [&](const char *data, size_t length) {
+        if (used + length > RingPayloadSize) {
+            return false;
+        }
+        memcpy(slot.payload + used, data, length);
+        kind = ArgKind::Text;
+        value.range[0] = used;
+        value.range[1] = uint32_t(length);
+        used += uint32_t(length);
+        return true;
+    };
+    if (type == rttr::type::get<int>()) {
+        kind = ArgKind::Int;
+        value.i = arg.get_value<int>();
+    } else if (type == rttr::type::get<double>()) {
+        kind = ArgKind::Double;
+        value.d = arg.get_value<double>();
+    } else if (type == rttr::type::get<float>()) {
+        kind = ArgKind::Double;
+        value.d = double(arg.get_value<float>());
+    } else if (type == rttr::type::get<size_t>()) {
+        kind = ArgKind::UInt;
+        value.u = arg.get_value<size_t>();
+    } else if (type == rttr::type::get<bool>()) {
+        kind = ArgKind::Int;
+        value.i = arg.get_value<bool>() ? 1 : 0;
+    } else if (type.is_enumeration()) {
+        kind = ArgKind::Int;
+        value.i = arg.convert<int>();
+    } else if (type == rttr::type::get<QString>()) {
+        // Encode in UTF-8 without allocating
+        const QString &text = arg.get_value<QString>();
+        char buffer[RingPayloadSize];
+        size_t length = 0;
+        for (const QChar &c : text) {
+            const ushort code = c.unicode();
+            const size_t size = code < 0x80 ? 1 : (code < 0x800 ? 2 : 3);
+            if (length + size > RingPayloadSize) {
+                return false;
+            }
+            if (size == 1) {
+                buffer[length++] = char(code);
+            } else if (size == 2) {
+                buffer[length++] = char(0xC0 | (code >> 6));
+                buffer[length++] = char(0x80 | (code & 0x3F));
+            } else {
+                buffer[length++] = char(0xE0 | (code >> 12));
+                buffer[length++] = char(0x80 | ((code >> 6) & 0x3F));
+                buffer[length++] = char(0x80 | (code & 0x3F));
+            }
+        }
+        return store_text(buffer, length);
+    } else if (type == rttr::type::get<std::string>()) {
+        const std::string &text = arg.get_value<std::string>();
+        return store_text(text.data(), text.size());
+    } else if (type == rttr::type::get<std::unordered_set<int>>()) {
+        const auto &set = arg.get_value<std::unordered_set<int>>();
+        if (used + set.size() * sizeof(int) > RingPayloadSize) {
+            return false;
+        }
+        kind = ArgKind::IntSet;
+        value.range[0] = used;
+        value.range[1] = uint32_t(set.size());
+        for (int v : set) {
+            memcpy(slot.payload + used, &v, sizeof(int));
+            used += uint32_t(sizeof(int));
+        }
+    } else if (type.is_pointer()) {
+        if (arg.can_convert<TimelineModel *>()) {
+            kind = ArgKind::Timeline;
+            value.ptr = arg.convert<TimelineModel *>();
+        } else if (arg.can_convert<TimelineItemModel *>()) {
+            kind = ArgKind::Timeline;
+            value.ptr = static_cast<TimelineModel *>(arg.convert<TimelineItemModel *>());
+        }
+        // There is only one binModel, the parameter is skipped since it's unambiguous
+    } else if (arg.can_convert<QString>()) {
+        // Other types convertible to text are rare, allocating is fine
+        const std::string text = arg.convert<QString>().toStdString();
+        return store_text(text.data(), text.size());
+    }
+    return true;
+}
+
+size_t Logger::ring_format(const RingSlot &slot, char *line, size_t size)
+{
+    size_t pos = 0;
+    bool ok = true;
+    auto append = [&](const char *data, size_t length) {
+        if (pos + length >= size) {
+            ok = false;
+            return;
+        }
+        memcpy(line + pos, data, length);
+        pos += length;
+    };
+    char number[32];
+    auto append_number = [&](int length) {
+        if (length > 0) {
+            append(number, size_t(length));
+        }
+    };
+    append(slot.command, strlen(slot.command));
+    for (uint32_t i = 0; i < slot.count && ok; ++i) {
+        append(" ", 1);
+        const ArgValue &value = slot.values[i];
+        switch (slot.kinds[i]) {
+        case ArgKind::None:
+            break;
+        case ArgKind::Int:
+            append_number(snprintf(number, sizeof(number), "%lld", static_cast<long long>(value.i)));
+            break;
+        case ArgKind::UInt:
+            append_number(snprintf(number, sizeof(number), "%llu", static_cast<unsigned long long>(value.u)));
+            break;
+        case ArgKind::Double:
+            // Same output as the default formatting of streams
+            append_number(snprintf(number, sizeof(number), "%g", value.d));
+            break;
+        case ArgKind::Text:
+            if (value.range[1] == 0) {
+                append("$$", 2);
+            } else {
+                append(slot.payload + value.range[0], value.range[1]);
+            }
+            break;
+        case ArgKind::IntSet:
+            append_number(snprintf(number, sizeof(number), "%u ", value.range[1]));
+            for (uint32_t j = 0; j < value.range[1]; ++j) {
+                int v;
+                memcpy(&v, slot.payload + value.range[0] + j * sizeof(int), sizeof(int));
+                append_number(snprintf(number, sizeof(number), j == 0 ? "%d" : " %d", v));
+            }
+            break;
+        case ArgKind::Timeline: {
+            size_t id = INT_MAX;
+            for (size_t j = 0; j < ring_timelines.size(); ++j) {
+                if (ring_timelines[j].first == value.ptr) {
+                    id = j;
+                    break;
+                }
+            }
+            append_number(snprintf(number, sizeof(number), "%zu", id));
+            break;
+        }
+        }
+    }
+    append("\n", 1);
+    return ok ? pos : 0;
+}
+
+bool Logger::dump_ring_buffer()
+{
+    if (!ring || ring_file.empty()) {
+        return false;
+    }
+    const int file = QT_OPEN(ring_file.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (file < 0) {
+        return false;
+    }
+    bool ok = true;
+    for (const auto &timeline : ring_timelines) {
+        ok = ok && QT_WRITE(file, timeline.second.data(), timeline.second.size()) == qint64(timeline.second.size()) && QT_WRITE(file, "\n", 1) == 1;
+    }
+    char line[2048];
+    const uint64_t head = ring_head.load(std::memory_order_acquire);
+    for (uint64_t index = head > RingSlots ? head - RingSlots : 0; index < head && ok; ++index) {
+        const RingSlot &slot = ring[index % RingSlots];
+        // Skip the records that are being written or were overwritten in the meantime
+        if (slot.sequence.load(std::memory_order_acquire) != index + 1 || slot.command == nullptr) {
+            continue;
+        }
+        const size_t length = ring_format(slot, line, sizeof(line));
+        if (length > 0 && slot.sequence.load(std::memory_order_acquire) == index + 1) {
+            ok = QT_WRITE(file, line, length) == qint64(length);
+        }
+    }
+    QT_CLOSE(file);
+    return ok;
+}
+
 void Logger::clear()
 {
     is_executing = false;
     invoks.clear();
     operations.clear();
     constr.clear();
+    ring_timelines.clear();
+    if (ring) {
+        for (size_t i = 0; i < RingSlots; ++i) {
+            ring[i].sequence = 0;
+        }
+    }
+    ring_head = 0;
 }
 
 LogGuard::LogGuard()
@@ -440,6 +736,14 @@ bool LogGuard::hasGuard() const
 
 void Logger::log_undo(bool undo)
 {
+    if (current_mode == Mode::Disabled) {
+        return;
+    }
+    if (current_mode == Mode::RingBuffer) {
+        static const std::vector<rttr::variant> noArgs;
+        ring_record(undo ? "u" : "r", nullptr, noArgs);
+        return;
+    }
     Logger::Undo u;
     u.undo = undo;
     operations.push_back(u);
@@ -20,11 +20,14 @@
  ***************************************************************************/
 
 #pragma once
+#include <atomic>
 #include <climits>
+#include <cstdint>
 #include <iostream>
 #include <memory>
 #include <mutex>
 #include <unordered_map>
+#include <unordered_set>
 
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wunused-parameter"
@@ -38,13 +41,30 @@
 /** @brief This class is meant to provide an easy way to reproduce bugs involving the model.
  * The idea is to log any modifier function involving a model class, and trace the parameters that were passed, to be able to generate a test-case producing the
  * same behaviour. Note that many modifier functions of the models are nested. We are only interested in the top-most call, and we must ignore bottom calls.
+ * The TRACE macros are compiled out when building without BUILD_MODEL_TRACING. Otherwise, the logger either keeps every operation (Full mode, used by the tests
+ * and the fuzzer), or only the last ones in a fixed-size ring buffer of fuzzer commands (RingBuffer mode), which can be dumped on crash.
  */
 class Logger
 {
 public:
+    enum class Mode { Disabled, Full, RingBuffer };
+
     /// @brief Inits the logger. Must be called at startup
     static void init();
 
+    /** @brief Selects what is recorded, Full by default. The RingBuffer mode keeps the last RingSlots operations
+     * @param dumpFile is where dump_ring_buffer writes them */
+    static void set_mode(Mode mode, const std::string &dumpFile = std::string());
+    static Mode mode();
+
+    /** @brief Writes the operations kept in the ring buffer to the dump file, in the format read by fuzz_reproduce.
+     * The records are formatted in stack buffers and written with open/write, without locking nor allocating, so that it can be called from a crash
+     * handler */
+    static bool dump_ring_buffer();
+
+    /// @brief Number of operations kept in RingBuffer mode
+    static const size_t RingSlots = 4096;
+
     /** @brief Notify the logger that the current thread wants to start logging.
      * This function returns true if this is a top-level call, meaning that we indeed want to log it. If the function returns false, the  caller must not log.
      */
@@ -109,6 +129,57 @@ protected:
     static std::unordered_map<std::string, std::vector<Constr>> constr;
     static std::vector<Invok> invoks;
     static int dump_count;
+
+    /** @brief Serializes arguments in the format of fuzz_reproduce. Parameters passed by reference (refs) are skipped */
+    static std::string fuzz_args(const std::vector<rttr::variant> &args, const std::unordered_set<size_t> &refs = {});
+    /** @brief Record an operation in the ring buffer. This does not lock, except for the constructions of timelines. The arguments are stored in binary form,
+     * and only formatted as a fuzzer command by dump_ring_buffer */
+    static void ring_constr(const std::string &type, const rttr::variant &inst, const std::vector<rttr::variant> &args);
+    static void ring_invok(const rttr::variant &inst, const std::string &method, const std::vector<rttr::variant> &args);
+    static void ring_record(const char *command, const rttr::variant *inst, const std::vector<rttr::variant> &args,
+                            const std::unordered_set<size_t> *refs = nullptr);
+
+    static const size_t RingMaxArgs = 12;
+    static const size_t RingPayloadSize = 128;
+    enum class ArgKind : uint8_t {
+        None,     // nothing is written
+        Int,      // value.i
+        UInt,     // value.u
+        Double,   // value.d
+        Text,     // range of bytes in the payload, "$$" if empty
+        IntSet,   // range of ints in the payload, written as the size followed by the values
+        Timeline, // value.ptr, written as the id of the timeline
+    };
+    union ArgValue
+    {
+        int64_t i;
+        uint64_t u;
+        double d;
+        const void *ptr;
+        uint32_t range[2];
+    };
+    struct RingSlot
+    {
+        // Index of the record + 1 once it is complete, 0 while it is written
+        std::atomic<uint64_t> sequence{0};
+        // Fuzzer code of the operation, nullptr if the arguments did not fit
+        const char *command{nullptr};
+        uint32_t count{0};
+        ArgKind kinds[RingMaxArgs];
+        ArgValue values[RingMaxArgs];
+        char payload[RingPayloadSize];
+    };
+    static bool ring_arg(RingSlot &slot, uint32_t &used, const rttr::variant &arg, bool skipped);
+    static size_t ring_format(const RingSlot &slot, char *line, size_t size);
+    static std::atomic<Mode> current_mode;
+    static std::unique_ptr<RingSlot[]> ring;
+    static std::atomic<uint64_t> ring_head;
+    static std::string ring_file;
+    // Parameters passed by reference of the traced methods, filled by init and only read afterwards
+    static std::unordered_map<std::string, std::unordered_set<size_t>> ring_refs;
+    // Construction of the timelines, which are needed to replay any other operation and are never dropped from the ring buffer.
+    // Their index is the id used by the fuzzer
+    static std::vector<std::pair<const void *, std::string>> ring_timelines;
 };
 
 /** @brief This class provides a RAII mechanism to log the execution of a function */
@@ -124,6 +195,7 @@ protected:
     bool m_hasGuard = false;
 };
 
+#ifdef KDENLIVE_MODEL_TRACING
 /// See Logger::log_constr. Note that the macro fills in the ptr instance for you.
 #define TRACE_CONSTR(ptr, ...)                                                                                                                                 \
     LogGuard __guard;                                                                                                                                          \
@@ -150,11 +222,17 @@ protected:
     if (__guard.hasGuard()) {                                                                                                                                  \
         Logger::log_res(res);                                                                                                                                  \
     }
+#else
+// Tracing is compiled out, the macros expand to nothing
+#define TRACE_CONSTR(ptr, ...)
+#define TRACE(...)
+#define TRACE_STATIC(ptr, ...)
+#define TRACE_RES(res)
+#endif
 
 /******* Implementations ***********/
 template <typename T> void Logger::log_constr(T *inst, std::vector<rttr::variant> args)
 {
-    std::unique_lock<std::mutex> lk(mut);
     for (auto &a : args) {
         // this will rewove shared/weak/unique ptrs
         if (a.get_type().is_wrapper()) {
@@ -162,20 +240,28 @@ template <typename T> void Logger::log_constr(T *inst, std::vector<rttr::variant
         }
     }
     std::string class_name = rttr::type::get<T>().get_name().to_string();
+    if (current_mode == Mode::RingBuffer) {
+        ring_constr(class_name, inst, args);
+        return;
+    }
+    std::unique_lock<std::mutex> lk(mut);
     constr[class_name].push_back({inst, std::move(args)});
     operations.emplace_back(ConstrId{class_name, constr[class_name].size() - 1});
 }
 
 template <typename T> void Logger::log(T *inst, std::string fctName, std::vector<rttr::variant> args)
 {
-    std::unique_lock<std::mutex> lk(mut);
     for (auto &a : args) {
         // this will rewove shared/weak/unique ptrs
         if (a.get_type().is_wrapper()) {
             a = a.extract_wrapped_value();
         }
     }
-    std::string class_name = rttr::type::get<T>().get_name().to_string();
+    if (current_mode == Mode::RingBuffer) {
+        ring_invok(inst, fctName, args);
+        return;
+    }
+    std::unique_lock<std::mutex> lk(mut);
     invoks.push_back({inst, std::move(fctName), std::move(args), rttr::variant()});
     operations.emplace_back(InvokId{invoks.size() - 1});
     result_awaiting = invoks.size() - 1;
@@ -184,9 +270,12 @@ template <typename T> void Logger::log(T *inst, std::string fctName, std::vector
 template <typename T> size_t Logger::get_id_from_ptr(T *ptr)
 {
     const std::string class_name = rttr::type::get<T>().get_name().to_string();
-    for (size_t i = 0; i < constr.at(class_name).size(); ++i) {
-        if (constr.at(class_name)[i].first.convert<T *>() == ptr) {
-            return i;
+    auto it = constr.find(class_name);
+    if (it != constr.end()) {
+        for (size_t i = 0; i < it->second.size(); ++i) {
+            if (it->second[i].first.convert<T *>() == ptr) {
+                return i;
+            }
         }
     }
     std::cerr << "Error: ptr of type " << class_name << " not found" << std::endl;
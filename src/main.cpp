@@ -207,6 +207,13 @@ int main(int argc, char *argv[])
 #elif defined(KF5_USE_CRASH)
     KCrash::initialize();
 #endif
+#if defined(KDENLIVE_MODEL_TRACING) && defined(KF5_USE_CRASH) && !defined(USE_DRMINGW)
+    // Only keep the last timeline operations, they are written on crash to be replayed with fuzz_reproduce
+    Logger::set_mode(Logger::Mode::RingBuffer, QDir::temp().absoluteFilePath(QStringLiteral("kdenlive-crash-trace.txt")).toStdString());
+    KCrash::setEmergencySaveFunction([](int) { Logger::dump_ring_buffer(); });
+#else
+    Logger::set_mode(Logger::Mode::Disabled);
+#endif
 
     //auto splash = new Splash(&app);
     //splash->show();
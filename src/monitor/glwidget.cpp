@@ -37,6 +37,7 @@
 #include "profiles/profilemodel.hpp"
 #include "timeline2/view/qml/timelineitems.h"
 #include <mlt++/Mlt.h>
+#include <cstring>
 
 #ifndef GL_UNPACK_ROW_LENGTH
 #ifdef GL_UNPACK_ROW_LENGTH_EXT
@@ -92,6 +93,8 @@ GLWidget::GLWidget(int id, QObject *parent)
     , m_isLoopMode(false)
     , m_offset(QPoint(0, 0))
     , m_fbo(nullptr)
+    , m_nextReadback(0)
+    , m_asyncReadback(-1)
     , m_shareContext(nullptr)
     , m_openGLSync(false)
     , m_ClientWaitSync(nullptr)
@@ -127,6 +130,7 @@ GLWidget::GLWidget(int id, QObject *parent)
 
     connect(this, &QQuickWindow::sceneGraphInitialized, this, &GLWidget::initializeGL, Qt::DirectConnection);
     connect(this, &QQuickWindow::beforeRendering, this, &GLWidget::paintGL, Qt::DirectConnection);
+    connect(this, &QQuickWindow::sceneGraphInvalidated, this, &GLWidget::releaseFrameReadbacks, Qt::DirectConnection);
 
     registerTimelineItems();
     m_proxy = new MonitorProxy(this);
@@ -516,6 +520,9 @@ void GLWidget::paintGL()
     f->glClear(GL_COLOR_BUFFER_BIT);
     check_error(f);
 
+    // Send the frames read during previous paints for analysis
+    collectFrameReadbacks(f);
+
     if (!acquireSharedFrameTextures()) return;
 
     // Bind textures.
@@ -591,9 +598,14 @@ void GLWidget::paintGL()
 
         glDrawArrays(GL_TRIANGLE_STRIP, 0, vertices.size());
         check_error(f);
-        m_fbo->release();
-        emit analyseFrame(m_fbo->toImage());
         m_sendFrame = false;
+        if (asyncReadbackSupported()) {
+            queueFrameReadback(f);
+            m_fbo->release();
+        } else {
+            m_fbo->release();
+            emit analyseFrame(m_fbo->toImage());
+        }
     }
     // Cleanup
     m_shader->disableAttributeArray(m_vertexLocation);
@@ -613,6 +625,94 @@ void GLWidget::paintGL()
     check_error(f);
 }
 
+bool GLWidget::asyncReadbackSupported()
+{
+    if (m_asyncReadback < 0) {
+        QOpenGLContext *context = openglContext();
+        const QPair<int, int> version = context->format().version();
+        if (context->isOpenGLES()) {
+            m_asyncReadback = version.first >= 3 ? 1 : 0;
+        } else {
+            m_asyncReadback = (version >= qMakePair(2, 1) || context->hasExtension("GL_ARB_pixel_buffer_object")) ? 1 : 0;
+        }
+        qCDebug(KDENLIVE_LOG) << "OpenGL asynchronous frame readback: " << (m_asyncReadback == 1);
+    }
+    return m_asyncReadback == 1;
+}
+
+void GLWidget::queueFrameReadback(QOpenGLFunctions *f)
+{
+    const int index = m_nextReadback;
+    if (m_pendingReadbacks.contains(index)) {
+        // All buffers are still in use, the analysis will use the next frame
+        m_sendFrame = true;
+        m_analyseSem.release();
+        return;
+    }
+    FrameReadback &readback = m_readbacks[index];
+    const int bytes = m_profileSize.width() * m_profileSize.height() * 4;
+    if (!readback.buffer.isCreated()) {
+        readback.buffer.setUsagePattern(QOpenGLBuffer::StreamRead);
+        readback.buffer.create();
+        readback.size = QSize();
+    }
+    readback.buffer.bind();
+    if (readback.size != m_profileSize) {
+        readback.buffer.allocate(bytes);
+        readback.size = m_profileSize;
+    }
+    // With a pixel pack buffer bound, glReadPixels returns immediately and copies into the buffer on the GPU side
+    f->glReadPixels(0, 0, m_profileSize.width(), m_profileSize.height(), GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    check_error(f);
+    readback.buffer.release();
+    m_pendingReadbacks.enqueue(index);
+    m_nextReadback = (index + 1) % 3;
+    // Make sure we get painted again to collect the frame, even if the monitor is paused
+    QMetaObject::invokeMethod(this, "update", Qt::QueuedConnection);
+}
+
+void GLWidget::collectFrameReadbacks(QOpenGLFunctions *f)
+{
+    while (!m_pendingReadbacks.isEmpty()) {
+        FrameReadback &readback = m_readbacks[m_pendingReadbacks.dequeue()];
+        const int width = readback.size.width();
+        const int height = readback.size.height();
+        readback.buffer.bind();
+        // OpenGL ES has no glMapBuffer, only glMapBufferRange
+        const void *mapped = openglContext()->isOpenGLES() ? readback.buffer.mapRange(0, width * height * 4, QOpenGLBuffer::RangeRead)
+                                                             : readback.buffer.map(QOpenGLBuffer::ReadOnly);
+        auto *pixels = static_cast<const uchar *>(mapped);
+        if (pixels == nullptr) {
+            // Mapping is not available on this driver, use synchronous reads from now on
+            qCDebug(KDENLIVE_LOG) << "OpenGL cannot map pixel buffer, disabling asynchronous frame readback";
+            readback.buffer.release();
+            releaseFrameReadbacks();
+            m_asyncReadback = 0;
+            m_sendFrame = true;
+            m_analyseSem.release();
+            return;
+        }
+        // OpenGL rows start at the bottom of the image
+        QImage image(readback.size, QImage::Format_RGBX8888);
+        for (int y = 0; y < height; ++y) {
+            memcpy(image.scanLine(height - 1 - y), pixels + y * width * 4, size_t(width) * 4);
+        }
+        readback.buffer.unmap();
+        readback.buffer.release();
+        check_error(f);
+        emit analyseFrame(image);
+    }
+}
+
+void GLWidget::releaseFrameReadbacks()
+{
+    m_pendingReadbacks.clear();
+    for (FrameReadback &readback : m_readbacks) {
+        readback.buffer.destroy();
+        readback.size = QSize();
+    }
+}
+
 void GLWidget::slotZoom(bool zoomIn)
 {
     if (zoomIn) {
@@ -22,10 +22,12 @@
 #include <QFont>
 #include <QMutex>
 #include <QOffscreenSurface>
+#include <QOpenGLBuffer>
 #include <QOpenGLContext>
 #include <QOpenGLFramebufferObject>
 #include <QOpenGLFunctions>
 #include <QOpenGLShaderProgram>
+#include <QQueue>
 #include <QQuickView>
 #include <QRect>
 #include <QSemaphore>
@@ -235,6 +237,19 @@ private:
     static void on_gl_frame_show(mlt_consumer, void *self, mlt_frame frame_ptr);
     static void on_gl_nosync_frame_show(mlt_consumer, void *self, mlt_frame frame_ptr);
     QOpenGLFramebufferObject *m_fbo;
+    /** @brief Pixel buffer used to read an analysed frame back from the GPU without waiting for it */
+    struct FrameReadback
+    {
+        QOpenGLBuffer buffer{QOpenGLBuffer::PixelPackBuffer};
+        QSize size;
+    };
+    /** Ring of pixel buffers, so that a new frame can be read while the previous one is mapped */
+    FrameReadback m_readbacks[3];
+    /** Indexes of the readbacks waiting to be mapped, in request order */
+    QQueue<int> m_pendingReadbacks;
+    int m_nextReadback;
+    /** -1 until checked, then 1 if the context supports pixel buffer objects, 0 otherwise */
+    int m_asyncReadback;
     void refreshSceneLayout();
     void resetZoneMode();
 
@@ -254,6 +269,14 @@ protected:
     QOpenGLContext *m_shareContext;
 
     bool acquireSharedFrameTextures();
+    /** @brief Returns true if frames for analysis can be read asynchronously through pixel buffer objects */
+    bool asyncReadbackSupported();
+    /** @brief Starts reading the bound framebuffer into the next pixel buffer, the pixels are collected on a later paint */
+    void queueFrameReadback(QOpenGLFunctions *f);
+    /** @brief Maps the pending pixel buffers and sends their frame for analysis */
+    void collectFrameReadbacks(QOpenGLFunctions *f);
+    /** @brief Deletes the pixel buffers, must be called with the context current */
+    void releaseFrameReadbacks();
     void bindShaderProgram();
     void createGPUAccelFragmentProg();
     void createShader();
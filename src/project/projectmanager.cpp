@@ -12,6 +12,7 @@ the Free Software Foundation, either version 3 of the License, or
 #include "bin/bin.h"
 #include "bin/projectitemmodel.h"
 #include "core.h"
+#include "doc/autosavejournal.h"
 #include "doc/kdenlivedoc.h"
 #include "jobs/jobmanager.h"
 #include "kdenlivesettings.h"
@@ -302,8 +303,7 @@ bool ProjectManager::saveFileAs(const QString &outputFileName)
     }
     QUrl url = QUrl::fromLocalFile(outputFileName);
     // Save timeline thumbnails
-    QStringList thumbKeys = pCore->window()->getMainTimeline()->controller()->getThumbKeys();
-    ThumbnailCache::get()->saveCachedThumbs(thumbKeys);
+    ThumbnailCache::get()->saveCachedThumbs(pCore->window()->getMainTimeline()->controller()->getThumbKeys());
     m_project->setUrl(url);
     // setting up autosave file in ~/.kde/data/stalefiles/kdenlive/
     // saved under file name
@@ -372,7 +372,7 @@ bool ProjectManager::saveFile()
         return saveFileAs();
     }
     bool result = saveFileAs(m_project->url().toLocalFile());
-    m_project->m_autosave->resize(0);
+    m_project->clearAutoSave();
     return result;
 }
 
@@ -434,8 +434,12 @@ bool ProjectManager::checkForBackupFile(const QUrl &url, bool newFile)
     if (orphanedFile) {
         if (KMessageBox::questionYesNo(nullptr, i18n("Auto-saved files exist. Do you want to recover them now?"), i18n("File Recovery"),
                                        KGuiItem(i18n("Recover")), KGuiItem(i18n("Do not recover"))) == KMessageBox::Yes) {
-            doOpenFile(url, orphanedFile);
-            return true;
+            // Incremental autosaves must be replayed into a project file before loading it
+            if (AutoSaveJournal::restore(orphanedFile)) {
+                doOpenFile(url, orphanedFile);
+                return true;
+            }
+            KMessageBox::sorry(nullptr, i18n("Cannot recover auto-saved file %1, it is corrupted.", orphanedFile->fileName()));
         }
     }
     // remove the stale files
@@ -643,15 +647,8 @@ void ProjectManager::slotAutoSave()
 {
     prepareSave();
     QString saveFolder = m_project->url().adjusted(QUrl::RemoveFilename | QUrl::StripTrailingSlash).toLocalFile();
-    QString scene = projectSceneList(saveFolder);
-    if (!m_replacementPattern.isEmpty()) {
-        QMapIterator<QString, QString> i(m_replacementPattern);
-        while (i.hasNext()) {
-            i.next();
-            scene.replace(i.key(), i.value());
-        }
-    }
-    m_project->slotAutoSave(scene);
+    // The replacements are done by the document, possibly on its autosave thread
+    m_project->slotAutoSave(projectSceneList(saveFolder), m_replacementPattern);
     m_lastSave.start();
 }
 
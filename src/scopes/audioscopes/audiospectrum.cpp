@@ -19,6 +19,7 @@
 #include "klocalizedstring.h"
 #include <KConfigGroup>
 #include <KSharedConfig>
+#include <algorithm>
 #include <iostream>
 
 // (defined in the header file)
@@ -205,17 +206,17 @@ QImage AudioSpectrum::renderAudioScope(uint, const audioShortVector &audioFrame,
         m_ui->labelFFTSizeNumber->setText(QVariant(fftWindow).toString());
 
         // Get the spectral power distribution of the input samples,
-        // using the given window size and function
-        auto *freqSpectrum = new float[(uint)fftWindow / 2];
+        // using the given window size and function. Channels are mixed by keeping the loudest one.
+        m_freqSpectrum.resize(fftWindow / 2);
         FFTTools::WindowType windowType = (FFTTools::WindowType)m_ui->windowFunction->itemData(m_ui->windowFunction->currentIndex()).toInt();
-        m_fftTools.fftNormalized(audioFrame, 0, (uint)num_channels, freqSpectrum, windowType, (uint)fftWindow, 0);
+        m_fftTools.fftNormalizedAllChannels(audioFrame, (uint)num_channels, m_freqSpectrum.data(), windowType, (uint)fftWindow, 0);
 
         // Store the current FFT window (for the HUD) and run the interpolation
         // for easy pixel-based dB value access
         QVector<float> dbMap;
         m_lastFFTLock.acquire();
-        m_lastFFT = QVector<float>(fftWindow / 2);
-        memcpy(m_lastFFT.data(), &(freqSpectrum[0]), (uint)fftWindow / 2 * sizeof(float));
+        m_lastFFT.resize(fftWindow / 2);
+        std::copy(m_freqSpectrum.cbegin(), m_freqSpectrum.cend(), m_lastFFT.begin());
 
         uint right = uint(((float)m_freqMax) / ((float)m_freq / 2.) * float(m_lastFFT.size() - 1));
         dbMap = FFTTools::interpolatePeakPreserving(m_lastFFT, (uint)m_innerScopeRect.width(), 0, right, -180);
@@ -224,7 +225,6 @@ QImage AudioSpectrum::renderAudioScope(uint, const audioShortVector &audioFrame,
 #ifdef DEBUG_AUDIOSPEC
         QTime drawTime = QTime::currentTime();
 #endif
-        delete[] freqSpectrum;
         // Draw the spectrum
         QImage spectrum(m_scopeRect.size(), QImage::Format_ARGB32);
         spectrum.fill(qRgba(0, 0, 0, 0));
@@ -66,6 +66,8 @@ private:
 
     FFTTools m_fftTools;
     QVector<float> m_lastFFT;
+    /** Spectrum of the last frame, kept to avoid allocating it for each frame */
+    QVector<float> m_freqSpectrum;
     QSemaphore m_lastFFTLock;
 
     QVector<float> m_peaks;
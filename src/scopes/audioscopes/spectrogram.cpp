@@ -318,19 +318,14 @@ QImage Spectrogram::renderAudioScope(uint, const audioShortVector &audioFrame, c
 
         if (newDataAvailable) {
 
-            auto *freqSpectrum = new float[(uint)fftWindow / 2];
-
             // Get the spectral power distribution of the input samples,
-            // using the given window size and function
-            FFTTools::WindowType windowType = (FFTTools::WindowType)m_ui->windowFunction->itemData(m_ui->windowFunction->currentIndex()).toInt();
-            m_fftTools.fftNormalized(audioFrame, 0, (uint)num_channels, freqSpectrum, windowType, (uint)fftWindow, 0);
-
+            // using the given window size and function. Channels are mixed by keeping the loudest one.
             // This method might be called also when a simple refresh is required.
             // In this case there is no data to append to the history. Only append new data.
             QVector<float> spectrumVector(fftWindow / 2);
-            memcpy(spectrumVector.data(), &freqSpectrum[0], (uint)fftWindow / 2 * sizeof(float));
+            FFTTools::WindowType windowType = (FFTTools::WindowType)m_ui->windowFunction->itemData(m_ui->windowFunction->currentIndex()).toInt();
+            m_fftTools.fftNormalizedAllChannels(audioFrame, (uint)num_channels, spectrumVector.data(), windowType, (uint)fftWindow, 0);
             m_fftHistory.prepend(spectrumVector);
-            delete[] freqSpectrum;
         }
 #ifdef DEBUG_SPECTROGRAM
         else {
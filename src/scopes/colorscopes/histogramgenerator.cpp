@@ -9,12 +9,14 @@
  ***************************************************************************/
 
 #include "histogramgenerator.h"
+#include "scopeparallel.h"
 
 #include "klocalizedstring.h"
 #include <QImage>
 #include <QPainter>
 #include <algorithm>
 #include <cmath>
+#include <vector>
 
 HistogramGenerator::HistogramGenerator() = default;
 
@@ -31,43 +33,72 @@ QImage HistogramGenerator::calculateHistogram(const QSize &paradeSize, const QIm
     bool drawB = (components & HistogramGenerator::ComponentB) != 0;
     bool drawSum = (components & HistogramGenerator::ComponentSum) != 0;
 
-    int r[256], g[256], b[256], y[256], s[766];
-    // Initialize the values to zero
-    std::fill(r, r + 256, 0);
-    std::fill(g, g + 256, 0);
-    std::fill(b, b + 256, 0);
-    std::fill(y, y + 256, 0);
-    std::fill(s, s + 766, 0);
-
-    const uint iw = (uint)image.bytesPerLine();
+    const QImage source = ScopeParallel::rgb32(image);
+    const int iw = source.width();
     const uint ih = (uint)image.height();
     const uint ww = (uint)paradeSize.width();
     const uint wh = (uint)paradeSize.height();
-    const uint byteCount = iw * ih;
+    // Scaling is based on the size of the frame in 32 bits per pixel
+    const uint byteCount = (uint)iw * ih * 4;
+
+    // Each band of the image is counted in its own set of tables, merged at the end
+    struct Tables
+    {
+        int r[256], g[256], b[256], y[256], s[766];
+    };
+    const int bands = ScopeParallel::bandCount((int)ih, qint64(iw) * ih / accelFactor, qint64(sizeof(Tables) / sizeof(int)));
+    std::vector<Tables> tables((size_t)bands);
 
     // Read the stats from the input image
-    for (int Y = 0; Y < image.height(); ++Y) {
-        for (int X = 0; X < image.width(); X += (int)accelFactor) {
-            QRgb col = image.pixel(X, Y);
-            r[qRed(col)]++;
-            g[qGreen(col)]++;
-            b[qBlue(col)]++;
+    ScopeParallel::forEachBand((int)ih, bands, [&](int band, int first, int end) {
+        Tables &t = tables[(size_t)band];
+        std::fill(t.r, t.r + 256, 0);
+        std::fill(t.g, t.g + 256, 0);
+        std::fill(t.b, t.b + 256, 0);
+        std::fill(t.y, t.y + 256, 0);
+        std::fill(t.s, t.s + 766, 0);
+        std::vector<uchar> luma(drawY ? (size_t)iw : 0);
+        for (int Y = first; Y < end; ++Y) {
+            const auto *row = reinterpret_cast<const QRgb *>(source.constScanLine(Y));
             if (drawY) {
-                // Use if branch to avoid expensive multiplication if Y disabled
-                if (rec == HistogramGenerator::Rec_601) {
-                    y[(int)floor(.299 * qRed(col) + .587 * qGreen(col) + .114 * qBlue(col))]++;
-                } else {
-                    y[(int)floor(.2125 * qRed(col) + .7154 * qGreen(col) + .0721 * qBlue(col))]++;
-                }
+                // Only convert the row if Y is enabled
+                ScopeParallel::lumaRow(row, iw, rec == HistogramGenerator::Rec_709, luma.data());
             }
-            if (drawSum) {
-                // Use an if branch here because the sum takes more operations than rgb
-                s[qRed(col)]++;
-                s[qGreen(col)]++;
-                s[qBlue(col)]++;
+            for (int X = 0; X < iw; X += (int)accelFactor) {
+                const QRgb col = row[X];
+                t.r[qRed(col)]++;
+                t.g[qGreen(col)]++;
+                t.b[qBlue(col)]++;
+                if (drawY) {
+                    t.y[luma[(size_t)X]]++;
+                }
+                if (drawSum) {
+                    // Use an if branch here because the sum takes more operations than rgb
+                    t.s[qRed(col)]++;
+                    t.s[qGreen(col)]++;
+                    t.s[qBlue(col)]++;
+                }
             }
         }
+    });
+    Tables &total = tables.front();
+    for (size_t band = 1; band < tables.size(); ++band) {
+        const Tables &t = tables[band];
+        for (int i = 0; i < 256; ++i) {
+            total.r[i] += t.r[i];
+            total.g[i] += t.g[i];
+            total.b[i] += t.b[i];
+            total.y[i] += t.y[i];
+        }
+        for (int i = 0; i < 766; ++i) {
+            total.s[i] += t.s[i];
+        }
     }
+    const int *r = total.r;
+    const int *g = total.g;
+    const int *b = total.b;
+    const int *y = total.y;
+    const int *s = total.s;
 
     const int nParts = (drawY ? 1 : 0) + (drawR ? 1 : 0) + (drawG ? 1 : 0) + (drawB ? 1 : 0) + (drawSum ? 1 : 0);
     if (nParts == 0) {
@@ -10,8 +10,11 @@
 
 #include "rgbparadegenerator.h"
 #include "klocalizedstring.h"
+#include "scopeparallel.h"
 #include <QColor>
+#include <QMutex>
 #include <QPainter>
+#include <vector>
 
 #define CHOP255(a) ((255) < (a) ? (255) : int(a))
 #define CHOP1255(a) ((a) < (1) ? (1) : ((a) > (255) ? (255) : (a)))
@@ -47,68 +50,64 @@ QImage RGBParadeGenerator::calculateRGBParade(const QSize &paradeSize, const QIm
 
     const uint ww = (uint)paradeSize.width();
     const uint wh = (uint)paradeSize.height();
-    const uint iw = (uint)image.bytesPerLine();
-    const uint ih = (uint)image.height();
-    const uint byteCount = iw * ih; // Note that 1 px = 4 B
+    const QImage source = ScopeParallel::rgb32(image);
+    const int iw = source.width();
+    const int ih = source.height();
 
     const uchar offset = 10;
     const uint partW = (ww - 2 * offset - distRight) / 3;
     const uint partH = wh - distBottom;
 
-    // Statistics
-    uchar minR = 255, minG = 255, minB = 255, maxR = 0, maxG = 0, maxB = 0, r, g, b;
-
     // Number of input pixels that will fall on one scope pixel.
     // Must be a float because the acceleration factor can be high, leading to <1 expected px per px.
-    const float pixelDepth = (float)((byteCount >> 2) / accelFactor) / float(partW * 255);
+    const float pixelDepth = (float)((uint)(iw * ih) / accelFactor) / float(partW * 255);
     const float gain = 255 / (8 * pixelDepth);
     //        qCDebug(KDENLIVE_LOG) << "Pixel depth: expected " << pixelDepth << "; Gain: using " << gain << " (acceleration: " << accelFactor << "x)";
 
     QImage unscaled((int)ww - distRight, 256, QImage::Format_ARGB32);
     unscaled.fill(qRgba(0, 0, 0, 0));
 
-    const float wPrediv = (float)(partW - 1) / float((int)iw - 1);
-
-    std::vector<std::vector<StructRGB>> paradeVals(partW, std::vector<StructRGB>(256, {0, 0, 0}));
-
-    const uchar *bits = image.bits();
-    const uint stepsize = uint(uint(image.depth() / 8) * accelFactor);
-
-    for (uint i = 0, x = 0; i < byteCount; i += stepsize) {
-        auto *col = (const QRgb *)(bits);
-        r = (uchar)qRed(*col);
-        g = (uchar)qGreen(*col);
-        b = (uchar)qBlue(*col);
-
-        double dx = x * (double)wPrediv;
-
-        paradeVals[(size_t)dx][r].r++;
-        paradeVals[(size_t)dx][g].g++;
-        paradeVals[(size_t)dx][b].b++;
+    // Scope column of each image column
+    std::vector<uint> columns((size_t)iw);
+    for (int x = 0; x < iw; ++x) {
+        columns[(size_t)x] = iw > 1 ? uint(x * (partW - 1) / uint(iw - 1)) : 0;
+    }
 
-        if (r < minR) {
-            minR = r;
-        }
-        if (g < minG) {
-            minG = g;
-        }
-        if (b < minB) {
-            minB = b;
-        }
-        if (r > maxR) {
-            maxR = r;
-        }
-        if (g > maxG) {
-            maxG = g;
-        }
-        if (b > maxB) {
-            maxB = b;
+    // Bands of image columns fall on distinct scope columns, so they all accumulate in the same buffer.
+    // Only the statistics of the bands have to be merged
+    std::vector<StructRGB> paradeVals(partW * 256, {0, 0, 0});
+    uchar minR = 255, minG = 255, minB = 255, maxR = 0, maxG = 0, maxB = 0;
+    QMutex statsMutex;
+    ScopeParallel::forEachColumnBand(columns, [&](int firstColumn, int endColumn) {
+        uchar bandMinR = 255, bandMinG = 255, bandMinB = 255, bandMaxR = 0, bandMaxG = 0, bandMaxB = 0;
+        // Same columns as when stepping by accelFactor from the first column of the image
+        const int start = (firstColumn + (int)accelFactor - 1) / (int)accelFactor * (int)accelFactor;
+        for (int y = 0; y < ih; ++y) {
+            const auto *row = reinterpret_cast<const QRgb *>(source.constScanLine(y));
+            for (int x = start; x < endColumn; x += (int)accelFactor) {
+                const auto r = (uchar)qRed(row[x]);
+                const auto g = (uchar)qGreen(row[x]);
+                const auto b = (uchar)qBlue(row[x]);
+                StructRGB *column = paradeVals.data() + columns[(size_t)x] * 256;
+                column[r].r++;
+                column[g].g++;
+                column[b].b++;
+                bandMinR = qMin(bandMinR, r);
+                bandMinG = qMin(bandMinG, g);
+                bandMinB = qMin(bandMinB, b);
+                bandMaxR = qMax(bandMaxR, r);
+                bandMaxG = qMax(bandMaxG, g);
+                bandMaxB = qMax(bandMaxB, b);
+            }
         }
-
-        bits += stepsize;
-        x += stepsize;
-        x %= iw; // Modulo image width, to represent the current x position in the image
-    }
+        QMutexLocker lock(&statsMutex);
+        minR = qMin(minR, bandMinR);
+        minG = qMin(minG, bandMinG);
+        minB = qMin(minB, bandMinB);
+        maxR = qMax(maxR, bandMaxR);
+        maxG = qMax(maxG, bandMaxG);
+        maxB = qMax(maxB, bandMaxB);
+    });
 
     const int offset1 = (int)partW + (int)offset;
     const int offset2 = 2 * (int)partW + 2 * (int)offset;
@@ -116,18 +115,18 @@ QImage RGBParadeGenerator::calculateRGBParade(const QSize &paradeSize, const QIm
     case PaintMode_RGB:
         for (int i = 0; i < (int)partW; ++i) {
             for (int j = 0; j < 256; ++j) {
-                unscaled.setPixel(i, j, qRgba(255, 10, 10, CHOP255(gain * (float)paradeVals[(size_t)i][(size_t)j].r)));
-                unscaled.setPixel(i + offset1, j, qRgba(10, 255, 10, CHOP255(gain * (float)paradeVals[(size_t)i][(size_t)j].g)));
-                unscaled.setPixel(i + offset2, j, qRgba(10, 10, 255, CHOP255(gain * (float)paradeVals[(size_t)i][(size_t)j].b)));
+                unscaled.setPixel(i, j, qRgba(255, 10, 10, CHOP255(gain * (float)paradeVals[(size_t)i * 256 + (size_t)j].r)));
+                unscaled.setPixel(i + offset1, j, qRgba(10, 255, 10, CHOP255(gain * (float)paradeVals[(size_t)i * 256 + (size_t)j].g)));
+                unscaled.setPixel(i + offset2, j, qRgba(10, 10, 255, CHOP255(gain * (float)paradeVals[(size_t)i * 256 + (size_t)j].b)));
             }
         }
         break;
     default:
         for (int i = 0; i < (int)partW; ++i) {
             for (int j = 0; j < 256; ++j) {
-                unscaled.setPixel(i, j, qRgba(255, 255, 255, CHOP255(gain * (float)paradeVals[(size_t)i][(size_t)j].r)));
-                unscaled.setPixel(i + offset1, j, qRgba(255, 255, 255, CHOP255(gain * (float)paradeVals[(size_t)i][(size_t)j].g)));
-                unscaled.setPixel(i + offset2, j, qRgba(255, 255, 255, CHOP255(gain * (float)paradeVals[(size_t)i][(size_t)j].b)));
+                unscaled.setPixel(i, j, qRgba(255, 255, 255, CHOP255(gain * (float)paradeVals[(size_t)i * 256 + (size_t)j].r)));
+                unscaled.setPixel(i + offset1, j, qRgba(255, 255, 255, CHOP255(gain * (float)paradeVals[(size_t)i * 256 + (size_t)j].g)));
+                unscaled.setPixel(i + offset2, j, qRgba(255, 255, 255, CHOP255(gain * (float)paradeVals[(size_t)i * 256 + (size_t)j].b)));
             }
         }
         break;
@@ -0,0 +1,117 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by the Kdenlive developers                         *
+ *   This file is part of kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#ifndef SCOPEPARALLEL_H
+#define SCOPEPARALLEL_H
+
+#include <QImage>
+#include <QPair>
+#include <QThread>
+#include <QVector>
+#include <QtConcurrent>
+#include <numeric>
+#include <vector>
+
+/**
+  Helpers shared by the color scope generators.
+
+  When the scope position of a pixel only depends on its image column (waveform,
+  RGB parade), the image is split in bands of columns falling on distinct scope
+  columns, so that all the bands accumulate in the same buffer without locking.
+  Otherwise the image is split in horizontal bands, each band accumulating into
+  its own buffers that the generator merges once all the bands are done.
+  The per row conversion helpers only use plain loops on arrays so that the
+  compiler can vectorize them.
+  */
+namespace ScopeParallel {
+
+/** @brief Returns the number of bands to use for the given number of rows (or columns).
+    When each band accumulates in its own buffer of bufferSize entries, the buffers have to be cleared and
+    merged, so the bands are limited to keep at least 8 analysed pixels per buffer entry */
+inline int bandCount(int rows, qint64 pixels = 0, qint64 bufferSize = 0)
+{
+    // Keep at least 16 rows per band, the overhead of a task is not worth it below
+    int bands = qBound(1, QThread::idealThreadCount(), qMax(1, rows / 16));
+    if (bufferSize > 0) {
+        bands = int(qBound<qint64>(1, pixels / (8 * bufferSize), bands));
+    }
+    return bands;
+}
+
+/** @brief Calls function(band, firstRow, endRow) for each band of rows, in parallel, and returns when all are processed */
+template <typename Function> void forEachBand(int rows, int bands, Function function)
+{
+    QVector<int> indexes(bands);
+    std::iota(indexes.begin(), indexes.end(), 0);
+    QtConcurrent::blockingMap(indexes, [rows, bands, &function](int band) { function(band, rows * band / bands, rows * (band + 1) / bands); });
+}
+
+/** @brief Calls function(firstColumn, endColumn) for bands of image columns, in parallel, and returns when all are processed.
+    columns holds the scope column of each image column, in increasing order. A scope column is never shared by two bands,
+    so they can all accumulate in the same buffer */
+template <typename Function> void forEachColumnBand(const std::vector<uint> &columns, Function function)
+{
+    const int width = int(columns.size());
+    const int bands = bandCount(width);
+    QVector<QPair<int, int>> ranges;
+    int first = 0;
+    for (int band = 1; band <= bands && first < width; ++band) {
+        int end = qMax(first + 1, width * band / bands);
+        while (end < width && columns[size_t(end)] == columns[size_t(end - 1)]) {
+            end++;
+        }
+        ranges.append({first, end});
+        first = end;
+    }
+    QtConcurrent::blockingMap(ranges, [&function](const QPair<int, int> &range) { function(range.first, range.second); });
+}
+
+/** @brief Returns the image in a 32 bits format, so that its pixels can be read as QRgb */
+inline QImage rgb32(const QImage &image)
+{
+    switch (image.format()) {
+    case QImage::Format_RGB32:
+    case QImage::Format_ARGB32:
+    case QImage::Format_ARGB32_Premultiplied:
+        return image;
+    default:
+        // Byte ordered formats like the ones read back from OpenGL
+        return image.convertToFormat(QImage::Format_RGB32);
+    }
+}
+
+/** @brief Computes the luma (0-255) of a row of pixels, using Rec. 601 or Rec. 709 coefficients in 16 bits fixed point */
+inline void lumaRow(const QRgb *row, int width, bool rec709, uchar *luma)
+{
+    const uint cr = rec709 ? 13926 : 19595;
+    const uint cg = rec709 ? 46885 : 38470;
+    const uint cb = rec709 ? 4725 : 7471;
+    for (int x = 0; x < width; ++x) {
+        const uint px = row[x];
+        luma[x] = uchar((cr * ((px >> 16) & 0xff) + cg * ((px >> 8) & 0xff) + cb * (px & 0xff)) >> 16);
+    }
+}
+
+/** @brief Computes the two chroma components of a row of pixels, with coefficients {ur, ug, ub, vr, vg, vb} */
+inline void chromaRow(const QRgb *row, int width, const float coefficients[6], float *u, float *v)
+{
+    for (int x = 0; x < width; ++x) {
+        const uint px = row[x];
+        const float r = float((px >> 16) & 0xff);
+        const float g = float((px >> 8) & 0xff);
+        const float b = float(px & 0xff);
+        u[x] = coefficients[0] * r + coefficients[1] * g + coefficients[2] * b;
+        v[x] = coefficients[3] * r + coefficients[4] * g + coefficients[5] * b;
+    }
+}
+
+} // namespace ScopeParallel
+
+#endif // SCOPEPARALLEL_H
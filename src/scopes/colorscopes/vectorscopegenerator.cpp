@@ -64,8 +64,10 @@ mRgb2YPbPr =                        r =
  */
 
 #include "vectorscopegenerator.h"
+#include "scopeparallel.h"
 #include <QImage>
 #include <cmath>
+#include <vector>
 
 // The maximum distance from the center for any RGB color is 0.63, so
 // no need to make the circle bigger than required.
@@ -122,47 +124,98 @@ QImage VectorscopeGenerator::calculateVectorscope(const QSize &vectorscopeSize,
     QImage scope = QImage(cw, cw, QImage::Format_ARGB32);
     scope.fill(qRgba(0, 0, 0, 0));
 
-    const uchar *bits = image.bits();
+    const QImage source = ScopeParallel::rgb32(image);
+    const int iw = source.width();
+    const int ih = source.height();
 
     double dy, dr, dg, db, dmax;
     double /*y,*/ u, v;
-    QPoint pt;
     QRgb px;
 
-    const int stepsize = int(uint(image.depth() / 8) * accelFactor);
-
     // Just an average for the number of image pixels per scope pixel.
-    // NOTE: byteCount() has to be replaced by (img.bytesPerLine()*img.height()) for Qt 4.5 to compile, see:
-    // https://doc.qt.io/qt-5/qimage.html#bytesPerLine
-    double avgPxPerPx = (double)image.depth() / 8 * (image.bytesPerLine() * image.height()) / scope.size().width() / scope.size().height() / accelFactor;
-
-    for (int i = 0; i < (image.bytesPerLine() * image.height()); i += stepsize) {
-        auto *col = (const QRgb *)(bits);
-
-        int r = qRed(*col);
-        int g = qGreen(*col);
-        int b = qBlue(*col);
-
-        switch (colorSpace) {
-        case VectorscopeGenerator::ColorSpace_YUV:
-            //             y = (double)  0.001173 * r +0.002302 * g +0.0004471* b;
-            u = (double)-0.0005781 * r - 0.001135 * g + 0.001713 * b;
-            v = (double)0.002411 * r - 0.002019 * g - 0.0003921 * b;
-            break;
-        case VectorscopeGenerator::ColorSpace_YPbPr:
-        default:
-            //             y = (double)  0.001173 * r +0.002302 * g +0.0004471* b;
-            u = (double)-0.0006671 * r - 0.001299 * g + 0.0019608 * b;
-            v = (double)0.001961 * r - 0.001642 * g - 0.0003189 * b;
-            break;
-        }
-
-        pt = mapToCircle(vectorscopeSize, QPointF(SCALING * gain * u, SCALING * gain * v));
+    double avgPxPerPx = double(iw) * ih / scope.size().width() / scope.size().height() / accelFactor;
+
+    float coefficients[6];
+    switch (colorSpace) {
+    case VectorscopeGenerator::ColorSpace_YUV:
+        //             y = (double)  0.001173 * r +0.002302 * g +0.0004471* b;
+        coefficients[0] = -0.0005781f;
+        coefficients[1] = -0.001135f;
+        coefficients[2] = 0.001713f;
+        coefficients[3] = 0.002411f;
+        coefficients[4] = -0.002019f;
+        coefficients[5] = -0.0003921f;
+        break;
+    case VectorscopeGenerator::ColorSpace_YPbPr:
+    default:
+        //             y = (double)  0.001173 * r +0.002302 * g +0.0004471* b;
+        coefficients[0] = -0.0006671f;
+        coefficients[1] = -0.001299f;
+        coefficients[2] = 0.0019608f;
+        coefficients[3] = 0.001961f;
+        coefficients[4] = -0.001642f;
+        coefficients[5] = -0.0003189f;
+        break;
+    }
 
-        if (pt.x() >= scope.width() || pt.x() < 0 || pt.y() >= scope.height() || pt.y() < 0) {
-            // Point lies outside (because of scaling), don't plot it
+    // Each band of the image records, for each scope pixel, how many image pixels fall on it
+    // and the last of them. The paint modes only depend on these two values, so the bands
+    // can be merged before painting.
+    const size_t scopePixels = size_t(cw) * size_t(cw);
+    const int bands = ScopeParallel::bandCount(ih);
+    if (m_bands.size() < size_t(bands)) {
+        m_bands.resize(size_t(bands));
+    }
+    ScopeParallel::forEachBand(ih, bands, [&](int index, int first, int end) {
+        Band &band = m_bands[(size_t)index];
+        if (band.hits.size() != scopePixels) {
+            band.hits.assign(scopePixels, 0);
+            band.last.assign(scopePixels, 0);
+            band.touched.clear();
+        }
+        std::vector<float> rowU((size_t)iw), rowV((size_t)iw);
+        for (int y = first; y < end; ++y) {
+            const auto *row = reinterpret_cast<const QRgb *>(source.constScanLine(y));
+            ScopeParallel::chromaRow(row, iw, coefficients, rowU.data(), rowV.data());
+            for (int x = 0; x < iw; x += (int)accelFactor) {
+                const QPoint pt = mapToCircle(vectorscopeSize, QPointF(SCALING * gain * rowU[(size_t)x], SCALING * gain * rowV[(size_t)x]));
+                if (pt.x() >= cw || pt.x() < 0 || pt.y() >= cw || pt.y() < 0) {
+                    // Point lies outside (because of scaling), don't plot it
+                    continue;
+                }
+                const size_t offset = size_t(pt.y()) * size_t(cw) + size_t(pt.x());
+                if (band.hits[offset]++ == 0) {
+                    band.touched.push_back(uint(offset));
+                }
+                band.last[offset] = row[x];
+            }
+        }
+    });
+    // Merge in image order, so that the last pixel of the image wins like when drawing sequentially.
+    // Only the scope pixels hit by a band are visited, and they are cleared for the next frame
+    std::vector<uint> hits(scopePixels, 0);
+    std::vector<QRgb> last(scopePixels, 0);
+    for (int index = 0; index < bands; ++index) {
+        Band &band = m_bands[(size_t)index];
+        for (uint offset : band.touched) {
+            hits[offset] += band.hits[offset];
+            last[offset] = band.last[offset];
+            band.hits[offset] = 0;
+        }
+        band.touched.clear();
+    }
 
-        } else {
+    for (int pty = 0; pty < cw; ++pty) {
+        for (int ptx = 0; ptx < cw; ++ptx) {
+            const size_t offset = size_t(pty) * size_t(cw) + size_t(ptx);
+            const uint count = hits[offset];
+            if (count == 0) {
+                continue;
+            }
+            const QRgb col = last[offset];
+            const QPoint pt(ptx, pty);
+            u = (double)coefficients[0] * qRed(col) + coefficients[1] * qGreen(col) + coefficients[2] * qBlue(col);
+            v = (double)coefficients[3] * qRed(col) + coefficients[4] * qGreen(col) + coefficients[5] * qBlue(col);
 
             // Draw the pixel using the chosen draw mode.
             switch (paintMode) {
@@ -242,27 +295,33 @@ QImage VectorscopeGenerator::calculateVectorscope(const QSize &vectorscopeSize,
                 scope.setPixel(pt, qRgba(dr, dg, db, 255));
                 break;
             case PaintMode_Original:
-                scope.setPixel(pt, *col);
+                scope.setPixel(pt, col);
                 break;
             case PaintMode_Green:
-                px = scope.pixel(pt);
-                scope.setPixel(pt, qRgba(qRed(px) + (255 - qRed(px)) / (3 * avgPxPerPx), qGreen(px) + 20 * (255 - qGreen(px)) / (avgPxPerPx),
-                                         qBlue(px) + (255 - qBlue(px)) / (avgPxPerPx), qAlpha(px) + (255 - qAlpha(px)) / (avgPxPerPx)));
-                break;
             case PaintMode_Green2:
-                px = scope.pixel(pt);
-                scope.setPixel(pt,
-                               qRgba(qRed(px) + ceil((255 - (float)qRed(px)) / (4 * avgPxPerPx)), 255,
-                                     qBlue(px) + ceil((255 - (float)qBlue(px)) / (avgPxPerPx)), qAlpha(px) + ceil((255 - (float)qAlpha(px)) / (avgPxPerPx))));
-                break;
             case PaintMode_Black:
+                // These modes brighten the scope pixel once per hit, stop as soon as it saturates
                 px = scope.pixel(pt);
-                scope.setPixel(pt, qRgba(0, 0, 0, qAlpha(px) + (255 - qAlpha(px)) / 20));
+                for (uint hit = 0; hit < count; ++hit) {
+                    QRgb next;
+                    if (paintMode == PaintMode_Green) {
+                        next = qRgba(qRed(px) + (255 - qRed(px)) / (3 * avgPxPerPx), qGreen(px) + 20 * (255 - qGreen(px)) / (avgPxPerPx),
+                                     qBlue(px) + (255 - qBlue(px)) / (avgPxPerPx), qAlpha(px) + (255 - qAlpha(px)) / (avgPxPerPx));
+                    } else if (paintMode == PaintMode_Green2) {
+                        next = qRgba(qRed(px) + ceil((255 - (float)qRed(px)) / (4 * avgPxPerPx)), 255, qBlue(px) + ceil((255 - (float)qBlue(px)) / (avgPxPerPx)),
+                                     qAlpha(px) + ceil((255 - (float)qAlpha(px)) / (avgPxPerPx)));
+                    } else {
+                        next = qRgba(0, 0, 0, qAlpha(px) + (255 - qAlpha(px)) / 20);
+                    }
+                    if (next == px) {
+                        break;
+                    }
+                    px = next;
+                }
+                scope.setPixel(pt, px);
                 break;
             }
         }
-
-        bits += stepsize;
     }
     return scope;
 }
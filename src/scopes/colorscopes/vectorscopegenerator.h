@@ -13,6 +13,7 @@
 
 #include <QImage>
 #include <QObject>
+#include <vector>
 
 class QImage;
 class QPoint;
@@ -33,6 +34,17 @@ public:
     QPoint mapToCircle(const QSize &targetSize, const QPointF &point) const;
     static const float scaling;
 
+private:
+    /** Per band buffers of the scope pixels hit by the image, kept between frames so that they are only cleared
+        where they were hit. The scope widget never computes two frames at the same time */
+    struct Band
+    {
+        std::vector<uint> hits;
+        std::vector<QRgb> last;
+        std::vector<uint> touched;
+    };
+    mutable std::vector<Band> m_bands;
+
 signals:
     void signalCalculationFinished(const QImage &image, uint ms);
 };
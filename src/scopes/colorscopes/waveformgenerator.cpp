@@ -9,6 +9,7 @@
  ***************************************************************************/
 
 #include "waveformgenerator.h"
+#include "scopeparallel.h"
 
 #include <cmath>
 
@@ -43,56 +44,42 @@ QImage WaveformGenerator::calculateWaveform(const QSize &waveformSize, const QIm
 
     const uint ww = (uint)waveformSize.width();
     const uint wh = (uint)waveformSize.height();
-    const uint iw = (uint)image.bytesPerLine();
-    const uint ih = (uint)image.height();
-    const uint byteCount = iw * ih;
-
-    std::vector<std::vector<uint>> waveValues((size_t)waveformSize.width(), std::vector<uint>((size_t)waveformSize.height(), 0));
+    const QImage source = ScopeParallel::rgb32(image);
+    const int iw = source.width();
+    const int ih = source.height();
 
     // Number of input pixels that will fall on one scope pixel.
     // Must be a float because the acceleration factor can be high, leading to <1 expected px per px.
-    const float pixelDepth = (float)((byteCount >> 2) / accelFactor) / float(ww * wh);
+    const float pixelDepth = (float)((uint)(iw * ih) / accelFactor) / float(ww * wh);
     const float gain = 255. / (8. * pixelDepth);
     // qCDebug(KDENLIVE_LOG) << "Pixel depth: expected " << pixelDepth << "; Gain: using " << gain << " (acceleration: " << accelFactor << "x)";
 
+    // Precompute the scope column of each image column and the scope row of each luma value.
     // Subtract 1 from sizes because we start counting from 0.
     // Not doing it would result in attempts to paint outside of the image.
-    const float hPrediv = (float)(wh - 1) / 255.;
-    const float wPrediv = (float)(ww - 1) / float(iw - 1);
-
-    const uchar *bits = image.bits();
-    const int bpp = image.depth() / 8;
-
-    for (uint i = 0, x = 0; i < byteCount; i += (uint)bpp) {
-
-        Q_ASSERT(bits < image.bits() + byteCount);
-
-        double dY, dx, dy;
-        auto *col = (const QRgb *)bits;
+    std::vector<uint> columns((size_t)iw);
+    for (int x = 0; x < iw; ++x) {
+        columns[(size_t)x] = iw > 1 ? uint(x * (ww - 1) / uint(iw - 1)) : 0;
+    }
+    uint lumaRows[256];
+    for (uint l = 0; l < 256; ++l) {
+        lumaRows[l] = l * (wh - 1) / 255;
+    }
 
-        if (rec == WaveformGenerator::Rec_601) {
-            // CIE 601 Luminance
-            dY = .299 * qRed(*col) + .587 * qGreen(*col) + .114 * qBlue(*col);
-        } else {
-            // CIE 709 Luminance
-            dY = .2125 * qRed(*col) + .7154 * qGreen(*col) + .0721 * qBlue(*col);
-        }
-        // dY is on [0,255] now.
-
-        dy = dY * hPrediv;
-        dx = (float)x * wPrediv;
-        waveValues[(size_t)dx][(size_t)dy]++;
-
-        bits += bpp;
-        x += (uint)bpp;
-        if (x > iw) {
-            x -= iw;
-            if (accelFactor > 1) {
-                bits += bpp * (int)iw * ((int)accelFactor - 1);
-                i += (uint)bpp * iw * (accelFactor - 1);
+    // Bands of image columns fall on distinct scope columns, so they all accumulate in the same buffer
+    std::vector<uint> waveValues(ww * wh, 0);
+    ScopeParallel::forEachColumnBand(columns, [&](int firstColumn, int endColumn) {
+        const int bandWidth = endColumn - firstColumn;
+        std::vector<uchar> luma((size_t)bandWidth);
+        for (int y = 0; y < ih; y += (int)accelFactor) {
+            const QRgb *row = reinterpret_cast<const QRgb *>(source.constScanLine(y)) + firstColumn;
+            ScopeParallel::lumaRow(row, bandWidth, rec == WaveformGenerator::Rec_709, luma.data());
+            for (int x = 0; x < bandWidth; ++x) {
+                waveValues[columns[size_t(firstColumn + x)] * wh + lumaRows[luma[(size_t)x]]]++;
             }
         }
-    }
+    });
+    auto value = [&waveValues, wh](int i, int j) { return (float)waveValues[(size_t)i * wh + (size_t)j]; };
 
     switch (paintMode) {
     case PaintMode_Green:
@@ -100,24 +87,24 @@ QImage WaveformGenerator::calculateWaveform(const QSize &waveformSize, const QIm
             for (int j = 0; j < waveformSize.height(); ++j) {
                 // Logarithmic scale. Needs fine tuning by hand, but looks great.
                 wave.setPixel(i, waveformSize.height() - j - 1,
-                              qRgba(CHOP255(52 * log(0.1 * gain * (float)waveValues[(size_t)i][(size_t)j])),
-                                    CHOP255(52 * std::log(gain * (float)waveValues[(size_t)i][(size_t)j])),
-                                    CHOP255(52 * log(.25 * gain * (float)waveValues[(size_t)i][(size_t)j])),
-                                    CHOP255(64 * std::log(gain * (float)waveValues[(size_t)i][(size_t)j]))));
+                              qRgba(CHOP255(52 * log(0.1 * gain * value(i, j))),
+                                    CHOP255(52 * std::log(gain * value(i, j))),
+                                    CHOP255(52 * log(.25 * gain * value(i, j))),
+                                    CHOP255(64 * std::log(gain * value(i, j)))));
             }
         }
         break;
     case PaintMode_Yellow:
         for (int i = 0; i < waveformSize.width(); ++i) {
             for (int j = 0; j < waveformSize.height(); ++j) {
-                wave.setPixel(i, waveformSize.height() - j - 1, qRgba(255, 242, 0, CHOP255(gain * (float)waveValues[(size_t)i][(size_t)j])));
+                wave.setPixel(i, waveformSize.height() - j - 1, qRgba(255, 242, 0, CHOP255(gain * value(i, j))));
             }
         }
         break;
     default:
         for (int i = 0; i < waveformSize.width(); ++i) {
             for (int j = 0; j < waveformSize.height(); ++j) {
-                wave.setPixel(i, waveformSize.height() - j - 1, qRgba(255, 255, 255, CHOP255(2. * gain * (float)waveValues[(size_t)i][(size_t)j])));
+                wave.setPixel(i, waveformSize.height() - j - 1, qRgba(255, 255, 255, CHOP255(2. * gain * value(i, j))));
             }
         }
         break;
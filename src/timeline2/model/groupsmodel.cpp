@@ -162,6 +162,7 @@ void GroupsModel::createGroupItem(int id)
     Q_ASSERT(m_downLink.count(id) == 0);
     m_upLink[id] = -1;
     m_downLink[id] = std::unordered_set<int>();
+    invalidateCaches();
 }
 
 Fun GroupsModel::destructGroupItem_lambda(int id)
@@ -173,6 +174,7 @@ Fun GroupsModel::destructGroupItem_lambda(int id)
         if (!ptr) Q_ASSERT(false);
         for (int child : m_downLink[id]) {
             m_upLink[child] = -1;
+            invalidateCaches();
             QModelIndex ix;
             if (ptr->isClip(child)) {
                 ix = ptr->makeClipIndexFromID(child);
@@ -189,6 +191,7 @@ Fun GroupsModel::destructGroupItem_lambda(int id)
         }
         m_downLink.erase(id);
         m_upLink.erase(id);
+        invalidateCaches();
         return true;
     };
 }
@@ -233,18 +236,29 @@ bool GroupsModel::destructGroupItem(int id)
 int GroupsModel::getRootId(int id) const
 {
     READ_LOCK();
+    QMutexLocker cacheLocker(&m_cacheMutex);
+    auto cached = m_rootCache.find(id);
+    if (cached != m_rootCache.end()) {
+        return cached->second;
+    }
+#ifdef QT_DEBUG
     std::unordered_set<int> seen; // we store visited ids to detect cycles
+#endif
+    int root = id;
     int father = -1;
     do {
-        Q_ASSERT(m_upLink.count(id) > 0);
-        Q_ASSERT(seen.count(id) == 0);
-        seen.insert(id);
-        father = m_upLink.at(id);
+        Q_ASSERT(m_upLink.count(root) > 0);
+#ifdef QT_DEBUG
+        Q_ASSERT(seen.count(root) == 0);
+        seen.insert(root);
+#endif
+        father = m_upLink.at(root);
         if (father != -1) {
-            id = father;
+            root = father;
         }
     } while (father != -1);
-    return id;
+    m_rootCache[id] = root;
+    return root;
 }
 
 bool GroupsModel::isLeaf(int id) const
@@ -302,9 +316,14 @@ std::unordered_set<int> GroupsModel::getSubtree(int id) const
     return result;
 }
 
-std::unordered_set<int> GroupsModel::getLeaves(int id) const
+const std::unordered_set<int> &GroupsModel::getLeaves(int id) const
 {
     READ_LOCK();
+    QMutexLocker cacheLocker(&m_cacheMutex);
+    auto cached = m_leavesCache.find(id);
+    if (cached != m_leavesCache.end()) {
+        return cached->second;
+    }
     std::unordered_set<int> result;
     std::queue<int> queue;
     queue.push(id);
@@ -318,7 +337,9 @@ std::unordered_set<int> GroupsModel::getLeaves(int id) const
             result.insert(current);
         }
     }
-    return result;
+    auto &leaves = m_leavesCache[id];
+    leaves = std::move(result);
+    return leaves;
 }
 
 std::unordered_set<int> GroupsModel::getDirectChildren(int id) const
@@ -344,6 +365,7 @@ void GroupsModel::setGroup(int id, int groupId, bool changeState)
     m_upLink[id] = groupId;
     if (groupId != -1) {
         m_downLink[groupId].insert(id);
+        invalidateCaches();
         auto ptr = m_parent.lock();
         if (changeState && ptr) {
             QModelIndex ix;
@@ -371,6 +393,7 @@ void GroupsModel::removeFromGroup(int id)
     if (parent != -1) {
         Q_ASSERT(getType(parent) != GroupType::Leaf);
         m_downLink[parent].erase(id);
+        invalidateCaches();
         QModelIndex ix;
         auto ptr = m_parent.lock();
         if (!ptr) Q_ASSERT(false);
@@ -387,6 +410,19 @@ void GroupsModel::removeFromGroup(int id)
         }
     }
     m_upLink[id] = -1;
+    invalidateCaches();
+}
+
+void GroupsModel::invalidateCaches()
+{
+    QMutexLocker cacheLocker(&m_cacheMutex);
+    // Swapping with empty containers also releases the buckets, so that clearing stays cheap during bulk operations
+    if (!m_rootCache.empty()) {
+        std::unordered_map<int, int>().swap(m_rootCache);
+    }
+    if (!m_leavesCache.empty()) {
+        std::unordered_map<int, std::unordered_set<int>>().swap(m_leavesCache);
+    }
 }
 
 bool GroupsModel::mergeSingleGroups(int id, Fun &undo, Fun &redo)
@@ -395,7 +431,7 @@ bool GroupsModel::mergeSingleGroups(int id, Fun &undo, Fun &redo)
     // In the process, if we find a node with only one children, we flag it for deletion
     QWriteLocker locker(&m_lock);
     Q_ASSERT(m_upLink.count(id) > 0);
-    auto leaves = getLeaves(id);
+    const auto &leaves = getLeaves(id);
     std::unordered_map<int, int> old_parents, new_parents;
     std::vector<int> to_delete;
     std::unordered_set<int> processed; // to avoid going twice along the same branch
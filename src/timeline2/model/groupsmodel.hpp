@@ -24,6 +24,7 @@
 
 #include "definitions.h"
 #include "undohelper.hpp"
+#include <QMutex>
 #include <QReadWriteLock>
 #include <memory>
 #include <unordered_map>
@@ -105,6 +106,7 @@ public:
 
     /* @brief Get the overall father of a given groupItem
        If the element has no father, it is returned as is.
+       The result is cached until the next modification of the hierarchy.
        @param id id of the groupitem
     */
     int getRootId(int id) const;
@@ -135,9 +137,11 @@ public:
 
     /* @brief Returns the id of all the leaves in the subtree of the given item
        This should correspond to the ids of the clips, since they should be the only items with no descendants
+       The result is cached until the next modification of the hierarchy, and the returned reference is only valid until then:
+       callers that modify the groups while using it, or that need to modify the set, must copy it.
        @param id of the groupItem
     */
-    std::unordered_set<int> getLeaves(int id) const;
+    const std::unordered_set<int> &getLeaves(int id) const;
 
     /* @brief Gets direct children of a given group item
        @param id of the groupItem
@@ -222,6 +226,9 @@ protected:
     
     void adjustOffset(QJsonArray &updatedNodes, QJsonObject childObject, int offset, const QMap<int, int> &trackMap);
 
+    /* @brief Drops the cached roots and leaves. Must be called whenever m_upLink or m_downLink is modified */
+    void invalidateCaches();
+
 private:
     std::weak_ptr<TimelineItemModel> m_parent;
 
@@ -230,6 +237,11 @@ private:
 
     std::unordered_map<int, GroupType> m_groupIds; // this keeps track of "real" groups (non-leaf elements), and their types
     mutable QReadWriteLock m_lock;                 // This is a lock that ensures safety in case of concurrent access
+
+    // Caches of getRootId and getLeaves. They are filled by const queries that may run concurrently under the read lock, hence their own mutex
+    mutable std::unordered_map<int, int> m_rootCache;
+    mutable std::unordered_map<int, std::unordered_set<int>> m_leavesCache;
+    mutable QMutex m_cacheMutex;
 };
 
 #endif
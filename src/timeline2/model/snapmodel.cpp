@@ -22,6 +22,7 @@
 #include <QDebug>
 #include <climits>
 #include <cstdlib>
+#include <unordered_map>
 
 
 SnapInterface::SnapInterface() = default;
@@ -68,6 +69,44 @@ int SnapModel::getClosestPoint(int position)
     return (int)next;
 }
 
+int SnapModel::getClosestPoint(int position, const std::vector<int> &ignored) const
+{
+    // A point is visible if it has more elements than the number of times it is ignored
+    std::unordered_map<int, int> ignoredCount;
+    for (int point : ignored) {
+        ++ignoredCount[point];
+    }
+    auto visible = [&ignoredCount](const std::pair<const int, int> &point) {
+        auto it = ignoredCount.find(point.first);
+        return it == ignoredCount.end() || point.second > it->second;
+    };
+    auto start = m_snaps.lower_bound(position);
+    long long int prev = INT_MIN, next = INT_MAX;
+    bool found = false;
+    for (auto it = start; it != m_snaps.end(); ++it) {
+        if (visible(*it)) {
+            next = (*it).first;
+            found = true;
+            break;
+        }
+    }
+    for (auto it = start; it != m_snaps.begin();) {
+        --it;
+        if (visible(*it)) {
+            prev = (*it).first;
+            found = true;
+            break;
+        }
+    }
+    if (!found) {
+        return -1;
+    }
+    if (std::llabs((long long)position - prev) < std::llabs((long long)position - next)) {
+        return (int)prev;
+    }
+    return (int)next;
+}
+
 int SnapModel::getNextPoint(int position)
 {
     if (m_snaps.empty()) {
@@ -111,44 +150,26 @@ void SnapModel::unIgnore()
     m_ignore.clear();
 }
 
-int SnapModel::proposeSize(int in, int out, int size, bool right, int maxSnapDist)
+int SnapModel::proposeSize(int in, int out, int size, bool right, int maxSnapDist) const
 {
-    ignore({in, out});
-    int proposed_size = -1;
-    if (right) {
-        int target_pos = in + size - 1;
-        int snapped_pos = getClosestPoint(target_pos);
-        if (snapped_pos != -1 && qAbs(target_pos - snapped_pos) <= maxSnapDist) {
-            proposed_size = snapped_pos - in;
-        }
-    } else {
-        int target_pos = out + 1 - size;
-        int snapped_pos = getClosestPoint(target_pos);
-        if (snapped_pos != -1 && qAbs(target_pos - snapped_pos) <= maxSnapDist) {
-            proposed_size = out - snapped_pos;
-        }
-    }
-    unIgnore();
-    return proposed_size;
+    return proposeSize(in, out, {in, out}, size, right, maxSnapDist);
 }
 
-int SnapModel::proposeSize(int in, int out, const std::vector<int> boundaries, int size, bool right, int maxSnapDist)
+int SnapModel::proposeSize(int in, int out, const std::vector<int> &boundaries, int size, bool right, int maxSnapDist) const
 {
-    ignore(boundaries);
     int proposed_size = -1;
     if (right) {
         int target_pos = in + size - 1;
-        int snapped_pos = getClosestPoint(target_pos);
+        int snapped_pos = getClosestPoint(target_pos, boundaries);
         if (snapped_pos != -1 && qAbs(target_pos - snapped_pos) <= maxSnapDist) {
             proposed_size = snapped_pos - in;
         }
     } else {
         int target_pos = out + 1 - size;
-        int snapped_pos = getClosestPoint(target_pos);
+        int snapped_pos = getClosestPoint(target_pos, boundaries);
         if (snapped_pos != -1 && qAbs(target_pos - snapped_pos) <= maxSnapDist) {
             proposed_size = out - snapped_pos;
         }
     }
-    unIgnore();
     return proposed_size;
 }
@@ -61,6 +61,12 @@ public:
     /* @brief Retrieves closest point. Returns -1 if there is no snappoint available */
     int getClosestPoint(int position);
 
+    /* @brief Retrieves closest point, skipping the given points without modifying the model. Returns -1 if there is no snappoint available
+       Each occurrence of a position in the ignored list hides one of the elements snapping at this position, like ignore() does
+       @param ignored list of points to skip
+    */
+    int getClosestPoint(int position, const std::vector<int> &ignored) const;
+
     /* @brief Retrieves next snap point. Returns position if there is no snappoint available */
     int getNextPoint(int position);
 
@@ -85,8 +91,8 @@ public:
        @param right true if we resize the right end of the item
        @param maxSnapDist maximal number of frames we are allowed to snap to
     */
-    int proposeSize(int in, int out, int size, bool right, int maxSnapDist);
-    int proposeSize(int in, int out, const std::vector<int> boundaries, int size, bool right, int maxSnapDist);
+    int proposeSize(int in, int out, int size, bool right, int maxSnapDist) const;
+    int proposeSize(int in, int out, const std::vector<int> &boundaries, int size, bool right, int maxSnapDist) const;
 
     // For testing only
     std::map<int, int> _snaps() { return m_snaps; }
@@ -290,6 +290,7 @@ bool TimelineFunctions::breakAffectedGroups(const std::shared_ptr<TimelineItemMo
     for (int item : affectedItems) {
         if (timeline->m_groups->isInGroup(item)) {
             int groupId = timeline->m_groups->getRootId(item);
+            // Copied, since ungrouping the children modifies the groups
             std::unordered_set<int> all_children = timeline->m_groups->getLeaves(groupId);
             for (int child: all_children) {
                 int childTrackId = timeline->getItemTrackId(child);
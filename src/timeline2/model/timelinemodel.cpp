@@ -89,7 +89,7 @@ RTTR_REGISTRATION
             parameter_names("clipId", "trackId", "position", "updateView", "logUndo", "invalidateTimeline"))
         .method("requestFakeGroupMove", select_overload<bool(int, int, int, int, bool, bool)>(&TimelineModel::requestFakeGroupMove))(
             parameter_names("clipId", "groupId", "delta_track", "delta_pos", "updateView", "logUndo"))
-        .method("suggestClipMove", &TimelineModel::suggestClipMove)(parameter_names("clipId", "trackId", "position", "cursorPosition", "snapDistance", "moveMirrorTracks"))
+        .method("suggestClipMove", &TimelineModel::suggestClipMove)(parameter_names("clipId", "trackId", "position", "cursorPosition", "snapDistance", "moveMirrorTracks", "preview"))
         .method("suggestCompositionMove",
                 &TimelineModel::suggestCompositionMove)(parameter_names("compoId", "trackId", "position", "cursorPosition", "snapDistance"))
         // .method("addSnap", &TimelineModel::addSnap)(parameter_names("pos"))
@@ -178,12 +178,7 @@ int TimelineModel::getTrackIndexFromPosition(int pos) const
 {
     Q_ASSERT(pos >= 0 && pos < (int)m_allTracks.size());
     READ_LOCK();
-    auto it = m_allTracks.cbegin();
-    while (pos > 0) {
-        it++;
-        pos--;
-    }
-    return (*it)->getId();
+    return m_trackIds[(size_t)pos];
 }
 
 int TimelineModel::getClipsCount() const
@@ -316,9 +311,17 @@ int TimelineModel::getTrackPosition(int trackId) const
 {
     READ_LOCK();
     Q_ASSERT(isTrack(trackId));
-    auto it = m_allTracks.cbegin();
-    int pos = (int)std::distance(it, (decltype(it))m_iteratorTable.at(trackId));
-    return pos;
+    return m_trackPositions.at(trackId);
+}
+
+void TimelineModel::updateTrackPositions()
+{
+    m_trackIds.clear();
+    m_trackPositions.clear();
+    for (const auto &track : m_allTracks) {
+        m_trackPositions[track->getId()] = (int)m_trackIds.size();
+        m_trackIds.push_back(track->getId());
+    }
 }
 
 int TimelineModel::getTrackMltIndex(int trackId) const
@@ -637,6 +640,56 @@ bool TimelineModel::requestFakeClipMove(int clipId, int trackId, int position, b
     return res;
 }
 
+bool TimelineModel::requestClipMovePreview(int clipId, int trackId, int &position, bool moveMirrorTracks)
+{
+    QWriteLocker locker(&m_lock);
+    std::unordered_map<int, std::pair<int, int>> landing;
+    if (!checkClipMove(clipId, trackId, position, moveMirrorTracks, landing)) {
+        return false;
+    }
+    for (const auto &item : landing) {
+        if (!isClip(item.first)) {
+            // Compositions have no fake position, they follow their group on drop
+            continue;
+        }
+        const auto &clip = m_allClips[item.first];
+        QVector<int> roles;
+        if (clip->getFakePosition() != item.second.second) {
+            clip->setFakePosition(item.second.second);
+            roles << FakePositionRole;
+        }
+        if (clip->getFakeTrackId() != item.second.first) {
+            clip->setFakeTrackId(item.second.first);
+            roles << FakeTrackIdRole;
+        }
+        QModelIndex modelIndex = makeClipIndexFromID(item.first);
+        if (!roles.isEmpty() && modelIndex.isValid()) {
+            notifyChange(modelIndex, modelIndex, roles);
+        }
+    }
+    return true;
+}
+
+void TimelineModel::resetFakeMove(int clipId)
+{
+    QWriteLocker locker(&m_lock);
+    Q_ASSERT(isClip(clipId));
+    const std::unordered_set<int> single = {clipId};
+    const auto &items = m_groups->isInGroup(clipId) ? m_groups->getLeaves(m_groups->getRootId(clipId)) : single;
+    for (int itemId : items) {
+        if (!isClip(itemId)) {
+            continue;
+        }
+        const auto &clip = m_allClips[itemId];
+        clip->setFakePosition(clip->getPosition());
+        clip->setFakeTrackId(-1);
+        QModelIndex modelIndex = makeClipIndexFromID(itemId);
+        if (modelIndex.isValid()) {
+            notifyChange(modelIndex, modelIndex, {FakePositionRole, FakeTrackIdRole});
+        }
+    }
+}
+
 bool TimelineModel::requestClipMove(int clipId, int trackId, int position, bool moveMirrorTracks, bool updateView, bool logUndo, bool invalidateTimeline)
 {
     QWriteLocker locker(&m_lock);
@@ -694,6 +747,230 @@ bool TimelineModel::requestClipMoveAttempt(int clipId, int trackId, int position
     return res;
 }
 
+bool TimelineModel::isItemPlacementPossible(int itemId, int trackId, int position, const std::unordered_set<int> &moving) const
+{
+    READ_LOCK();
+    if (position < 0 || !isTrack(trackId)) {
+        return false;
+    }
+    int currentTrackId = getItemTrackId(itemId);
+    if (currentTrackId != -1 && getTrackById_const(currentTrackId)->isLocked()) {
+        return false;
+    }
+    const auto track = getTrackById_const(trackId);
+    if (track->isLocked()) {
+        return false;
+    }
+    std::unordered_set<int> overlapping;
+    if (isClip(itemId)) {
+        const auto &clip = m_allClips.at(itemId);
+        // Same audio / video rules as requestClipMove
+        if (clip->clipState() == PlaylistState::Disabled) {
+            if (track->trackType() == PlaylistState::AudioOnly && !clip->canBeAudio()) {
+                return false;
+            }
+            if (track->trackType() == PlaylistState::VideoOnly && !clip->canBeVideo()) {
+                return false;
+            }
+        } else if (track->trackType() != clip->clipState()) {
+            return false;
+        }
+        overlapping = track->getClipsInRange(position, position + clip->getPlaytime());
+    } else {
+        overlapping = track->getCompositionsInRange(position, position + m_allCompositions.at(itemId)->getPlaytime());
+    }
+    return std::all_of(overlapping.begin(), overlapping.end(), [&moving](int id) { return moving.count(id) > 0; });
+}
+
+int TimelineModel::getAllowedGroupTrackDelta(int itemId, const std::unordered_set<int> &items, int delta_track) const
+{
+    READ_LOCK();
+    if (delta_track == 0) {
+        return 0;
+    }
+    int lowerTrack = -1;
+    int upperTrack = -1;
+    for (int affectedItemId : items) {
+        const int trackPos = getTrackPosition(getItemTrackId(affectedItemId));
+        if (lowerTrack == -1 || lowerTrack > trackPos) {
+            lowerTrack = trackPos;
+        }
+        if (upperTrack == -1 || upperTrack < trackPos) {
+            upperTrack = trackPos;
+        }
+    }
+    bool masterIsAudio = getTrackById_const(getItemTrackId(itemId))->isAudioTrack();
+    if (delta_track < 0) {
+        if (!masterIsAudio) {
+            // Case 1, dragging a video clip down
+            bool lowerTrackIsAudio = getTrackById_const(getTrackIndexFromPosition(lowerTrack))->isAudioTrack();
+            int lowerPos = lowerTrackIsAudio ? lowerTrack - delta_track : lowerTrack + delta_track;
+            if (lowerPos < 0) {
+                // No space below
+                delta_track = 0;
+            } else if (!lowerTrackIsAudio) {
+                // Moving a group of video clips
+                if (getTrackById_const(getTrackIndexFromPosition(lowerPos))->isAudioTrack()) {
+                    // Moving to a non matching track (video on audio track)
+                    delta_track = 0;
+                }
+            }
+        } else if (lowerTrack + delta_track < 0) {
+            // Case 2, dragging an audio clip down
+            delta_track = 0;
+        }
+    } else if (delta_track > 0) {
+        if (!masterIsAudio) {
+            // Case 1, dragging a video clip up
+            int upperPos = upperTrack + delta_track;
+            if (upperPos >= getTracksCount()) {
+                // Moving above top track, not allowed
+                delta_track = 0;
+            } else if (getTrackById_const(getTrackIndexFromPosition(upperPos))->isAudioTrack()) {
+                // Trying to move to a non matching track (video clip on audio track)
+                delta_track = 0;
+            }
+        } else {
+            bool upperTrackIsAudio = getTrackById_const(getTrackIndexFromPosition(upperTrack))->isAudioTrack();
+            if (!upperTrackIsAudio) {
+                // Dragging an audio clip up, check that upper video clip has an available video track
+                int targetPos = upperTrack - delta_track;
+                if (targetPos <0 || getTrackById_const(getTrackIndexFromPosition(targetPos))->isAudioTrack()) {
+                    delta_track = 0;
+                }
+            } else {
+                int targetPos = upperTrack + delta_track;
+                if (targetPos >= getTracksCount() || !getTrackById_const(getTrackIndexFromPosition(targetPos))->isAudioTrack()) {
+                    // Trying to drag audio above topmost track or on video track
+                    delta_track = 0;
+                }
+            }
+        }
+    }
+    return delta_track;
+}
+
+bool TimelineModel::getAllowedGroupPositionDelta(const std::unordered_set<int> &items, int &delta_pos, const QVector<int> &allowedTracks) const
+{
+    READ_LOCK();
+    if (delta_pos == 0) {
+        return true;
+    }
+    // Only the leading clip of each track, in the move direction, can meet an obstacle
+    std::unordered_map<int, int> leadingClips;
+    for (int itemId : items) {
+        if (!isClip(itemId)) {
+            continue;
+        }
+        int tid = getClipTrackId(itemId);
+        if (tid == -1 || (!allowedTracks.isEmpty() && !allowedTracks.contains(tid))) {
+            continue;
+        }
+        auto it = leadingClips.find(tid);
+        if (it == leadingClips.end() || (delta_pos > 0) == (getClipPosition(itemId) > getClipPosition(it->second))) {
+            leadingClips[tid] = itemId;
+        }
+    }
+    for (const auto &leading : leadingClips) {
+        const auto track = getTrackById_const(leading.first);
+        int current_in = getClipPosition(leading.second);
+        int playtime = getClipPlaytime(leading.second);
+        int current_out = current_in + playtime;
+        int target_position = current_in + delta_pos;
+        // Only the landing range is checked, but the obstacles are searched between the clip and its landing range
+        int landingStart = delta_pos < 0 ? target_position : qMax(current_out, target_position);
+        int searchStart = delta_pos < 0 ? target_position : current_out;
+        int searchEnd = delta_pos < 0 ? current_in : target_position + playtime;
+        bool blocked = false;
+        int limit = delta_pos < 0 ? INT_MIN : INT_MAX;
+        for (int id : track->getClipsInRange(searchStart, searchEnd)) {
+            if (items.count(id) > 0) {
+                continue;
+            }
+            int in = getClipPosition(id);
+            int out = in + getClipPlaytime(id);
+            blocked = blocked || (out > landingStart && in < target_position + playtime);
+            limit = delta_pos < 0 ? qMax(limit, out) : qMin(limit, in);
+        }
+        if (!blocked) {
+            continue;
+        }
+        if ((delta_pos < 0 && limit >= current_in) || (delta_pos > 0 && limit <= current_out)) {
+            // No move possible
+            return false;
+        }
+        delta_pos = delta_pos < 0 ? qMax(delta_pos, limit - current_in) : qMin(delta_pos, limit - current_out);
+    }
+    return true;
+}
+
+bool TimelineModel::checkClipMove(int clipId, int trackId, int &position, bool moveMirrorTracks) const
+{
+    std::unordered_map<int, std::pair<int, int>> landing;
+    return checkClipMove(clipId, trackId, position, moveMirrorTracks, landing);
+}
+
+bool TimelineModel::checkClipMove(int clipId, int trackId, int &position, bool moveMirrorTracks, std::unordered_map<int, std::pair<int, int>> &landing) const
+{
+    READ_LOCK();
+    Q_ASSERT(isClip(clipId));
+    if (!isTrack(trackId)) {
+        return false;
+    }
+    int currentTrackId = getClipTrackId(clipId);
+    int currentPos = getClipPosition(clipId);
+    bool groupMove = currentTrackId != -1 && m_groups->isInGroup(clipId);
+    const std::unordered_set<int> single = {clipId};
+    const auto &all_items = groupMove ? m_groups->getLeaves(m_groups->getRootId(clipId)) : single;
+    if (currentPos == position && currentTrackId == trackId) {
+        for (int itemId : all_items) {
+            landing[itemId] = {getItemTrackId(itemId), getItemPosition(itemId)};
+        }
+        return true;
+    }
+    if (!groupMove) {
+        if (!isItemPlacementPossible(clipId, trackId, position, all_items)) {
+            return false;
+        }
+        landing[clipId] = {trackId, position};
+        return true;
+    }
+    int delta_pos = position - currentPos;
+    int delta_track = getAllowedGroupTrackDelta(clipId, all_items, getTrackPosition(trackId) - getTrackPosition(currentTrackId));
+    // Like requestGroupMove, the group stops against the first obstacle met on each track
+    if (delta_track == 0 && !getAllowedGroupPositionDelta(all_items, delta_pos)) {
+        return false;
+    }
+    int audio_delta = 0, video_delta = 0;
+    if (delta_track != 0) {
+        bool masterIsAudio = getTrackById_const(currentTrackId)->isAudioTrack();
+        audio_delta = video_delta = delta_track;
+        if (masterIsAudio) {
+            video_delta = moveMirrorTracks ? -delta_track : 0;
+        } else {
+            audio_delta = moveMirrorTracks ? -delta_track : 0;
+        }
+    }
+    for (int itemId : all_items) {
+        int itemTrackId = getItemTrackId(itemId);
+        int targetTrackId = itemTrackId;
+        if (delta_track != 0) {
+            int target_track_position = getTrackPosition(itemTrackId) + (getTrackById_const(itemTrackId)->isAudioTrack() ? audio_delta : video_delta);
+            if (target_track_position < 0 || target_track_position >= getTracksCount()) {
+                return false;
+            }
+            targetTrackId = getTrackIndexFromPosition(target_track_position);
+        }
+        int targetPosition = getItemPosition(itemId) + delta_pos;
+        if (!isItemPlacementPossible(itemId, targetTrackId, targetPosition, all_items)) {
+            return false;
+        }
+        landing[itemId] = {targetTrackId, targetPosition};
+    }
+    position = currentPos + delta_pos;
+    return true;
+}
+
 int TimelineModel::suggestItemMove(int itemId, int trackId, int position, int cursorPosition, int snapDistance)
 {
     if (isClip(itemId)) {
@@ -702,7 +979,7 @@ int TimelineModel::suggestItemMove(int itemId, int trackId, int position, int cu
     return suggestCompositionMove(itemId, trackId, position, cursorPosition, snapDistance);
 }
 
-int TimelineModel::suggestClipMove(int clipId, int trackId, int position, int cursorPosition, int snapDistance, bool moveMirrorTracks)
+int TimelineModel::suggestClipMove(int clipId, int trackId, int position, int cursorPosition, int snapDistance, bool moveMirrorTracks, bool preview)
 {
     QWriteLocker locker(&m_lock);
     TRACE(clipId, trackId, position, cursorPosition, snapDistance);
@@ -714,7 +991,12 @@ int TimelineModel::suggestClipMove(int clipId, int trackId, int position, int cu
         // Trying move on incompatible track type, stay on same track
         trackId = sourceTrackId;
     }
+    preview = preview && m_editMode == TimelineMode::NormalEdit;
     if (currentPos == position && m_editMode == TimelineMode::NormalEdit && sourceTrackId == trackId) {
+        if (preview) {
+            // Dragged back to its place
+            requestClipMovePreview(clipId, trackId, position, moveMirrorTracks);
+        }
         TRACE_RES(position);
         return position;
     }
@@ -722,11 +1004,8 @@ int TimelineModel::suggestClipMove(int clipId, int trackId, int position, int cu
     if (snapDistance > 0) {
         // For snapping, we must ignore all in/outs of the clips of the group being moved
         std::vector<int> ignored_pts;
-        std::unordered_set<int> all_items = {clipId};
-        if (m_groups->isInGroup(clipId)) {
-            int groupId = m_groups->getRootId(clipId);
-            all_items = m_groups->getLeaves(groupId);
-        }
+        const std::unordered_set<int> single = {clipId};
+        const auto &all_items = m_groups->isInGroup(clipId) ? m_groups->getLeaves(m_groups->getRootId(clipId)) : single;
         for (int current_clipId : all_items) {
             if (getItemTrackId(current_clipId) != -1) {
                 int in = getItemPosition(current_clipId);
@@ -743,20 +1022,28 @@ int TimelineModel::suggestClipMove(int clipId, int trackId, int position, int cu
             position = snapped;
         }
     }
+    // Moves are first validated on our own structures, so that the positions where the clip cannot go never reach MLT
+    auto tryMove = [this, clipId, moveMirrorTracks, preview](int tid, int &pos) {
+        if (preview) {
+            return requestClipMovePreview(clipId, tid, pos, moveMirrorTracks);
+        }
+        return checkClipMove(clipId, tid, pos, moveMirrorTracks) && requestClipMove(clipId, tid, pos, moveMirrorTracks, true, false, false);
+    };
+    // A previewed clip that cannot go further stays where it is shown
+    int failedPos = currentPos;
+    if (preview && m_allClips[clipId]->getFakeTrackId() > -1) {
+        failedPos = m_allClips[clipId]->getFakePosition();
+    }
     // we check if move is possible
-    bool possible = (m_editMode == TimelineMode::NormalEdit) ? requestClipMove(clipId, trackId, position, moveMirrorTracks, true, false, false)
-                                                           : requestFakeClipMove(clipId, trackId, position, true, false, false);
-    /*} else {
-        possible = requestClipMoveAttempt(clipId, trackId, position);
-    }*/
+    bool possible = (m_editMode == TimelineMode::NormalEdit) ? tryMove(trackId, position) : requestFakeClipMove(clipId, trackId, position, true, false, false);
     if (possible) {
         TRACE_RES(position);
         return position;
     }
     if (sourceTrackId == -1) {
         // not clear what to do hear, if the current move doesn't work. We could try to find empty space, but it might end up being far away...
-        TRACE_RES(currentPos);
-        return currentPos;
+        TRACE_RES(failedPos);
+        return failedPos;
     }
     // Find best possible move
     if (!m_groups->isInGroup(clipId)) {
@@ -764,7 +1051,7 @@ int TimelineModel::suggestClipMove(int clipId, int trackId, int position, int cu
         if (trackId != sourceTrackId && sourceTrackId != -1) {
             qDebug() << "// TESTING SAME TRACVK MOVE: " << trackId << " = " << sourceTrackId;
             trackId = sourceTrackId;
-            possible = requestClipMove(clipId, trackId, position, moveMirrorTracks, true, false, false);
+            possible = tryMove(trackId, position);
             if (!possible) {
                 qDebug() << "CANNOT MOVE CLIP : " << clipId << " ON TK: " << trackId << ", AT POS: " << position;
             } else {
@@ -782,21 +1069,21 @@ int TimelineModel::suggestClipMove(int clipId, int trackId, int position, int cu
                 position = currentPos - blank_length;
             }
         } else {
-            TRACE_RES(currentPos);
-            return currentPos;
+            TRACE_RES(failedPos);
+            return failedPos;
         }
-        possible = requestClipMove(clipId, trackId, position, moveMirrorTracks, true, false, false);
-        TRACE_RES(possible ? position : currentPos);
-        return possible ? position : currentPos;
+        possible = tryMove(trackId, position);
+        TRACE_RES(possible ? position : failedPos);
+        return possible ? position : failedPos;
     }
     if (trackId != sourceTrackId) {
         // Try same track move
-        possible = requestClipMove(clipId, sourceTrackId, position, moveMirrorTracks, true, false, false);
-        return possible ? position : currentPos;
+        possible = tryMove(sourceTrackId, position);
+        return possible ? position : failedPos;
     }
     // find best pos for groups
     int groupId = m_groups->getRootId(clipId);
-    std::unordered_set<int> all_items = m_groups->getLeaves(groupId);
+    const auto &all_items = m_groups->getLeaves(groupId);
     QMap<int, int> trackPosition;
 
     // First pass, sort clips by track and keep only the first / last depending on move direction
@@ -853,14 +1140,14 @@ int TimelineModel::suggestClipMove(int clipId, int trackId, int position, int cu
     }
     if (blank_length != 0) {
         int updatedPos = currentPos + (after ? blank_length : -blank_length);
-        possible = requestClipMove(clipId, trackId, updatedPos, moveMirrorTracks, true, false, false);
+        possible = tryMove(trackId, updatedPos);
         if (possible) {
             TRACE_RES(updatedPos);
             return updatedPos;
         }
     }
-    TRACE_RES(currentPos);
-    return currentPos;
+    TRACE_RES(failedPos);
+    return failedPos;
 }
 
 int TimelineModel::suggestCompositionMove(int compoId, int trackId, int position, int cursorPosition, int snapDistance)
@@ -885,7 +1172,7 @@ int TimelineModel::suggestCompositionMove(int compoId, int trackId, int position
         std::vector<int> ignored_pts;
         if (m_groups->isInGroup(compoId)) {
             int groupId = m_groups->getRootId(compoId);
-            auto all_items = m_groups->getLeaves(groupId);
+            const auto &all_items = m_groups->getLeaves(groupId);
             for (int current_compoId : all_items) {
                 // TODO: fix for composition
                 int in = getItemPosition(current_compoId);
@@ -1283,7 +1570,7 @@ bool TimelineModel::requestFakeGroupMove(int clipId, int groupId, int delta_trac
     QWriteLocker locker(&m_lock);
     Q_ASSERT(m_allGroups.count(groupId) > 0);
     bool ok = true;
-    auto all_items = m_groups->getLeaves(groupId);
+    const auto &all_items = m_groups->getLeaves(groupId);
     Q_ASSERT(all_items.size() > 1);
     Fun local_undo = []() { return true; };
     Fun local_redo = []() { return true; };
@@ -1391,27 +1678,15 @@ bool TimelineModel::requestGroupMove(int itemId, int groupId, int delta_track, i
         return false;
     }
     bool ok = true;
-    auto all_items = m_groups->getLeaves(groupId);
+    const auto &all_items = m_groups->getLeaves(groupId);
     Q_ASSERT(all_items.size() > 1);
     Fun local_undo = []() { return true; };
     Fun local_redo = []() { return true; };
     std::vector< std::pair<int, int> > sorted_clips;
     std::vector< std::pair<int, std::pair<int, int> > > sorted_compositions;
-    int lowerTrack = -1;
-    int upperTrack = -1;
 
-    // Separate clips from compositions to sort and check source tracks
+    // Separate clips from compositions to sort them
     for (int affectedItemId : all_items) {
-        if (delta_track != 0) {
-            // Check if an upper / lower move is possible
-            const int trackPos = getTrackPosition(getItemTrackId(affectedItemId));
-            if (lowerTrack == -1 || lowerTrack > trackPos) {
-                lowerTrack = trackPos;
-            }
-            if (upperTrack == -1 || upperTrack < trackPos) {
-                upperTrack = trackPos;
-            }
-        }
         if (isClip(affectedItemId)) {
             sorted_clips.push_back({affectedItemId, m_allClips[affectedItemId]->getPosition()});
         } else {
@@ -1449,53 +1724,7 @@ bool TimelineModel::requestGroupMove(int itemId, int groupId, int delta_track, i
     int audio_delta, video_delta;
     audio_delta = video_delta = delta_track;
     bool masterIsAudio = getTrackById_const(getItemTrackId(itemId))->isAudioTrack();
-    if (delta_track < 0) {
-        if (!masterIsAudio) {
-            // Case 1, dragging a video clip down
-            bool lowerTrackIsAudio = getTrackById_const(getTrackIndexFromPosition(lowerTrack))->isAudioTrack();
-            int lowerPos = lowerTrackIsAudio ? lowerTrack - delta_track : lowerTrack + delta_track;
-            if (lowerPos < 0) {
-                // No space below
-                delta_track = 0;
-            } else if (!lowerTrackIsAudio) {
-                // Moving a group of video clips
-                if (getTrackById_const(getTrackIndexFromPosition(lowerPos))->isAudioTrack()) {
-                    // Moving to a non matching track (video on audio track)
-                    delta_track = 0;
-                }
-            }
-        } else if (lowerTrack + delta_track < 0) {
-            // Case 2, dragging an audio clip down
-            delta_track = 0;
-        }
-    } else if (delta_track > 0) {
-        if (!masterIsAudio) {
-            // Case 1, dragging a video clip up
-            int upperPos = upperTrack + delta_track;
-            if (upperPos >= getTracksCount()) {
-                // Moving above top track, not allowed
-                delta_track = 0;
-            } else if (getTrackById_const(getTrackIndexFromPosition(upperPos))->isAudioTrack()) {
-                // Trying to move to a non matching track (video clip on audio track)
-                delta_track = 0;
-            }
-        } else {
-            bool upperTrackIsAudio = getTrackById_const(getTrackIndexFromPosition(upperTrack))->isAudioTrack();
-            if (!upperTrackIsAudio) {
-                // Dragging an audio clip up, check that upper video clip has an available video track
-                int targetPos = upperTrack - delta_track;
-                if (targetPos <0 || getTrackById_const(getTrackIndexFromPosition(targetPos))->isAudioTrack()) {
-                    delta_track = 0;
-                }
-            } else {
-                int targetPos = upperTrack + delta_track;
-                if (targetPos >= getTracksCount() || !getTrackById_const(getTrackIndexFromPosition(targetPos))->isAudioTrack()) {
-                    // Trying to drag audio above topmost track or on video track
-                    delta_track = 0;
-                }
-            }
-        }
-    }
+    delta_track = getAllowedGroupTrackDelta(itemId, all_items, delta_track);
 
     if (delta_track == 0 && updateView) {
         updateView = false;
@@ -1568,45 +1797,11 @@ bool TimelineModel::requestGroupMove(int itemId, int groupId, int delta_track, i
     if (delta_track == 0) {
         // Special case, we are moving on same track, avoid too many calculations
         // First pass, check for collisions and suggest better delta
-        QVector <int> processedTracks;
-        for (const std::pair<int, int> &item : sorted_clips) {
-            int current_track_id = getClipTrackId(item.first);
-            if (processedTracks.contains(current_track_id)) {
-                // We only check the first clip for each track since they are sorted depending on the move direction
-                continue;
-            }
-            processedTracks << current_track_id;
-            if (!allowedTracks.isEmpty() && !allowedTracks.contains(current_track_id)) {
-                continue;
-            }
-            int current_in = item.second;
-            int playtime = getClipPlaytime(item.first);
-            int target_position = current_in + delta_pos;
-            if (delta_pos < 0) {
-                if (!getTrackById_const(current_track_id)->isAvailable(target_position, playtime)) {
-                    int newStart = getTrackById_const(current_track_id)->getBlankStart(current_in - 1);
-                    if (newStart == current_in - 1) {
-                        // No move possible, abort
-                        bool undone = local_undo();
-                        Q_ASSERT(undone);
-                        return false;
-                    }
-                    delta_pos = qMax(delta_pos, newStart - current_in);
-                }
-            } else {
-                int moveEnd = target_position + playtime;
-                int moveStart = qMax(current_in + playtime, target_position);
-                if (!getTrackById_const(current_track_id)->isAvailable(moveStart, moveEnd - moveStart)) {
-                    int newStart = getTrackById_const(current_track_id)->getBlankEnd(current_in + playtime);
-                    if (newStart == current_in + playtime) {
-                        // No move possible, abort
-                        bool undone = local_undo();
-                        Q_ASSERT(undone);
-                        return false;
-                    }
-                    delta_pos = qMin(delta_pos, newStart - (current_in + playtime));
-                }
-            }
+        if (!getAllowedGroupPositionDelta(all_items, delta_pos, allowedTracks)) {
+            // No move possible, abort
+            bool undone = local_undo();
+            Q_ASSERT(undone);
+            return false;
         }
         for (const std::pair<int, int> &item : sorted_clips) {
             int current_track_id = getClipTrackId(item.first);
@@ -1779,7 +1974,7 @@ const QVariantList TimelineModel::getGroupData(int itemId)
     }
     int groupId = m_groups->getRootId(itemId);
     QVariantList result;
-    std::unordered_set<int> items = m_groups->getLeaves(groupId);
+    const auto &items = m_groups->getLeaves(groupId);
     for (int id : items) {
         result << id << getItemPosition(id) << getItemPlaytime(id);
     }
@@ -2396,6 +2591,7 @@ void TimelineModel::registerTrack(std::shared_ptr<TrackModel> track, int pos, bo
     // it now contains the iterator to the inserted element, we store it
     Q_ASSERT(m_iteratorTable.count(id) == 0); // check that id is not used (shouldn't happen)
     m_iteratorTable[id] = it;
+    updateTrackPositions();
     beginInsertRows(QModelIndex(), pos, pos);
     endInsertRows();
     int cache = (int)QThread::idealThreadCount() + ((int)m_allTracks.size() + 1) * 2;
@@ -2430,6 +2626,7 @@ Fun TimelineModel::deregisterTrack_lambda(int id)
         // send update to the model
         m_allTracks.erase(it);     // actual deletion of object
         m_iteratorTable.erase(id); // clean table
+        updateTrackPositions();
         beginRemoveRows(QModelIndex(), index, index);
         endRemoveRows();
         int cache = (int)QThread::idealThreadCount() + ((int)m_allTracks.size() + 1) * 2;
@@ -2645,16 +2842,20 @@ int TimelineModel::suggestSnapPoint(int pos, int snapDistance)
     return (qAbs(snapped - pos) < snapDistance ? snapped : pos);
 }
 
-int TimelineModel::getBestSnapPos(int pos, int length, const std::vector<int> &pts, int cursorPosition, int snapDistance)
+int TimelineModel::getBestSnapPos(int pos, int length, const std::vector<int> &pts, int cursorPosition, int snapDistance) const
 {
-    if (!pts.empty()) {
-        m_snaps->ignore(pts);
-    }
-    m_snaps->addPoint(cursorPosition);
-    int snapped_start = m_snaps->getClosestPoint(pos);
-    int snapped_end = m_snaps->getClosestPoint(pos + length);
-    m_snaps->unIgnore();
-    m_snaps->removePoint(cursorPosition);
+    // This is called on each mouse move of a drag, so the snap model is only queried: the ignored points are skipped and the cursor is an extra candidate
+    auto closestPoint = [this, &pts, cursorPosition](int position) {
+        int snapped = m_snaps->getClosestPoint(position, pts);
+        int snapDiff = qAbs(position - snapped);
+        int cursorDiff = qAbs(position - cursorPosition);
+        if (snapped == -1 || cursorDiff < snapDiff || (cursorDiff == snapDiff && cursorPosition > snapped)) {
+            return cursorPosition;
+        }
+        return snapped;
+    };
+    int snapped_start = closestPoint(pos);
+    int snapped_end = closestPoint(pos + length);
 
     int startDiff = qAbs(pos - snapped_start);
     int endDiff = qAbs(pos + length - snapped_end);
@@ -3051,6 +3252,12 @@ bool TimelineModel::checkConsistency()
 {
     for (const auto &tck : m_iteratorTable) {
         auto track = (*tck.second);
+        // Check the cached position of the track
+        if (m_trackPositions.at(tck.first) != (int)std::distance(m_allTracks.begin(), tck.second) ||
+            m_trackIds[(size_t)m_trackPositions.at(tck.first)] != tck.first) {
+            qDebug() << "Wrong cached position for track" << tck.first;
+            return false;
+        }
         // Check parent/children link for tracks
         if (auto ptr = track->m_parent.lock()) {
             if (ptr.get() != this) {
@@ -3526,7 +3733,7 @@ bool TimelineModel::requestClearSelection(bool onDeletion)
         std::unordered_set<int> items = m_groups->getLeaves(m_currentSelection);
         for (auto &id : items) {
             if (isGroup(id)) {
-                std::unordered_set<int> children = m_groups->getLeaves(id);
+                const auto &children = m_groups->getLeaves(id);
                 items.insert(children.begin(), children.end());
             } else if (isClip(id)) {
                 m_allClips[id]->clearOffset();
@@ -3674,8 +3881,8 @@ void TimelineModel::setSelected(int itemId, bool sel)
     } else if (isComposition(itemId)) {
         m_allCompositions[itemId]->setSelected(sel);
     } else if (isGroup(itemId)) {
-        auto leaves = m_groups->getLeaves(itemId);
-        for (auto &id : leaves) {
+        const auto &leaves = m_groups->getLeaves(itemId);
+        for (int id : leaves) {
             setSelected(id, true);
         }
     }
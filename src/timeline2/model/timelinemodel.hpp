@@ -366,6 +366,23 @@ public:
     bool requestFakeGroupMove(int clipId, int groupId, int delta_track, int delta_pos, bool updateView = true, bool logUndo = true);
     bool requestFakeGroupMove(int clipId, int groupId, int delta_track, int delta_pos, bool updateView, bool finalMove, Fun &undo, Fun &redo,
                               bool allowViewRefresh = true);
+    /* @brief In normal edit mode, a drag is previewed with the fake position and track of the moved clips, so that the timeline is only modified on drop.
+       The move is checked like checkClipMove, and nothing is changed if it is not possible
+       @param position is the requested position of the clip, it receives the position where the clip is shown
+       @return true if the move is possible
+    */
+    bool requestClipMovePreview(int clipId, int trackId, int &position, bool moveMirrorTracks);
+    /* @brief Ends the fake move of a clip and of the clips grouped with it: they are shown at their timeline position again */
+    Q_INVOKABLE void resetFakeMove(int clipId);
+
+    /* @brief Checks whether a clip move would succeed, without modifying the timeline.
+       Only our own structures are read (position index of the tracks, groups, track types), so this is cheap enough to be called on each mouse
+       move of a drag. If the clip is grouped, the whole group is checked with the same track rules as requestGroupMove
+       @param position is the requested position of the clip. When a group moves along its tracks, it receives the position where the group stops
+       against its neighbours, like requestGroupMove does
+       @return true if the move is possible
+    */
+    bool checkClipMove(int clipId, int trackId, int &position, bool moveMirrorTracks = true) const;
 
     /* @brief Given an intended move, try to suggest a more valid one
        (accounting for snaps and missing UI calls)
@@ -376,9 +393,11 @@ public:
        @param snapDistance the maximum distance for a snap result, -1 for no snapping
         of the clip
        @param dontRefreshMasterClip when false, no view refresh is attempted
+       @param preview in normal edit mode, only show the clip at the suggested position (see requestClipMovePreview)
         */
     Q_INVOKABLE int suggestItemMove(int itemId, int trackId, int position, int cursorPosition, int snapDistance = -1);
-    Q_INVOKABLE int suggestClipMove(int clipId, int trackId, int position, int cursorPosition, int snapDistance = -1, bool moveMirrorTracks = true);
+    Q_INVOKABLE int suggestClipMove(int clipId, int trackId, int position, int cursorPosition, int snapDistance = -1, bool moveMirrorTracks = true,
+                                    bool preview = false);
     Q_INVOKABLE int suggestCompositionMove(int compoId, int trackId, int position, int cursorPosition, int snapDistance = -1);
 
     /* @brief Request clip insertion at given position. This action is undoable
@@ -545,7 +564,7 @@ protected:
        @param snapDistance the maximum distance for a snap result, -1 for no snapping
        @returns best snap position or -1 if no snap point is near
      */
-    int getBestSnapPos(int pos, int length, const std::vector<int> &pts = std::vector<int>(), int cursorPosition = 0, int snapDistance = -1);
+    int getBestSnapPos(int pos, int length, const std::vector<int> &pts = std::vector<int>(), int cursorPosition = 0, int snapDistance = -1) const;
 
     /* @brief Returns the best possible size for a clip on resize
      */
@@ -711,6 +730,10 @@ protected:
      */
     void deregisterGroup(int id);
 
+    /* @brief Rebuilds the cached positions of the tracks. Must be called whenever m_allTracks is modified
+     */
+    void updateTrackPositions();
+
     /* @brief Helper function to get a pointer to the track, given its id
      */
     std::shared_ptr<TrackModel> getTrackById(int trackId);
@@ -746,6 +769,16 @@ protected:
     /** @brief Attempt to make a clip move without ever updating the view */
     bool requestClipMoveAttempt(int clipId, int trackId, int position);
 
+    /** @brief Returns true if the item fits at the given position of the track. The items listed in moving are moved along with it, so they are not obstacles */
+    bool isItemPlacementPossible(int itemId, int trackId, int position, const std::unordered_set<int> &moving) const;
+    /** @brief Returns the track offset that a group move can apply: 0 if some of its items would leave the tracks or land on a track of the wrong type */
+    int getAllowedGroupTrackDelta(int itemId, const std::unordered_set<int> &items, int delta_track) const;
+    /** @brief Reduces delta_pos so that a group moving along its tracks stops against the first clip met by its leading clip on each track.
+        Only the tracks listed in allowedTracks are checked, unless it is empty. Returns false if the group cannot move at all in this direction */
+    bool getAllowedGroupPositionDelta(const std::unordered_set<int> &items, int &delta_pos, const QVector<int> &allowedTracks = QVector<int>()) const;
+    /** @brief Same as checkClipMove, and fills landing with the target track and position of each moved item */
+    bool checkClipMove(int clipId, int trackId, int &position, bool moveMirrorTracks, std::unordered_map<int, std::pair<int, int>> &landing) const;
+
 public:
     /* @brief Debugging function that checks consistency with Mlt objects */
     bool checkConsistency();
@@ -782,6 +815,9 @@ protected:
     std::unordered_map<int, std::list<std::shared_ptr<TrackModel>>::iterator>
         m_iteratorTable; // this logs the iterator associated which each track id. This allows easy access of a track based on its id.
 
+    std::unordered_map<int, int> m_trackPositions; // cached position of each track in m_allTracks, so that we don't have to walk the list
+    std::vector<int> m_trackIds;                   // ids of the tracks, in the order of m_allTracks
+
     std::unordered_map<int, std::shared_ptr<ClipModel>> m_allClips; // the keys are the clip id, and the values are the corresponding pointers
 
     std::unordered_map<int, std::shared_ptr<CompositionModel>>
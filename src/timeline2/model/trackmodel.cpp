@@ -145,7 +145,9 @@ Fun TrackModel::requestClipInsertion_lambda(int clipId, int position, bool updat
             m_allClips[clip->getId()] = clip; // store clip
             // update clip position and track
             clip->setPosition(position);
+            indexClip(clipId, position);
             clip->setSubPlaylistIndex(subPlaylist);
+            m_subPlaylistClips[std::max(0, subPlaylist)]++;
             int new_in = clip->getPosition();
             int new_out = new_in + clip->getPlaytime();
             ptr->m_snaps->addPoint(new_in);
@@ -315,7 +317,9 @@ Fun TrackModel::requestClipDeletion_lambda(int clipId, bool updateView, bool fin
         auto prod = m_playlists[target_track].replace_with_blank(target_clip);
         if (prod != nullptr) {
             m_playlists[target_track].consolidate_blanks();
+            unindexClip(clipId, clip_position);
             m_allClips[clipId]->setCurrentTrackId(-1);
+            m_subPlaylistClips[std::max(0, target_track)]--;
             m_allClips[clipId]->setSubPlaylistIndex(-1);
             m_allClips.erase(clipId);
             delete prod;
@@ -560,7 +564,9 @@ Fun TrackModel::requestClipResize_lambda(int clipId, int in, int out, bool right
             // The second is parameter is delta - 1 because this function expects an out time, which is basically size - 1
             m_playlists[target_track].insert_blank(blank_index, delta - 1);
             if (!right) {
+                unindexClip(clipId, clip_position);
                 m_allClips[clipId]->setPosition(clip_position + delta);
+                indexClip(clipId, clip_position + delta);
                 // Because we inserted blank before, the index of our clip has increased
                 target_clip_mutable++;
             }
@@ -643,7 +649,9 @@ Fun TrackModel::requestClipResize_lambda(int clipId, int in, int out, bool right
                     err = m_playlists[target_track].resize_clip(target_clip_mutable, in, out);
                 }
                 if (!right && err == 0) {
+                    unindexClip(clipId, m_allClips[clipId]->getPosition());
                     m_allClips[clipId]->setPosition(m_playlists[target_track].clip_start(target_clip_mutable));
+                    indexClip(clipId, m_allClips[clipId]->getPosition());
                 }
                 if (err == 0) {
                     update_snaps(m_allClips[clipId]->getPosition(), m_allClips[clipId]->getPosition() + out - in + 1);
@@ -718,23 +726,64 @@ int TrackModel::getClipByRow(int row) const
     return (*it).first;
 }
 
-std::unordered_set<int> TrackModel::getClipsInRange(int position, int end)
+std::unordered_set<int> TrackModel::getClipsInRange(int position, int end) const
+{
+    int visited = 0;
+    return getClipsInRange(position, end, visited);
+}
+
+std::unordered_set<int> TrackModel::getClipsInRange(int position, int end, int &visited) const
 {
     READ_LOCK();
     std::unordered_set<int> ids;
-    for (const auto &clp : m_allClips) {
-        int pos = clp.second->getPosition();
-        int length = clp.second->getPlaytime();
-        if (end > -1 && pos >= end) {
+    visited = 0;
+    // First, collect all the clips starting inside the range
+    auto start = m_clipsPos.lower_bound(position);
+    for (auto it = start; it != m_clipsPos.end() && (end < 0 || it->first < end); ++it) {
+        ids.insert(it->second);
+        visited++;
+    }
+    // Then look for the clips starting before the range but overlapping it. Clips never overlap inside a sub-playlist,
+    // so we can stop looking in a given sub-playlist as soon as we find one of its clips ending before the range.
+    // A sub-playlist without clips has nothing to look for
+    bool finished[2] = {m_subPlaylistClips[0] == 0, m_subPlaylistClips[1] == 0};
+    for (auto it = start; it != m_clipsPos.begin() && !(finished[0] && finished[1]);) {
+        --it;
+        visited++;
+        const auto &clip = m_allClips.at(it->second);
+        int subPlaylist = std::max(0, clip->getSubPlaylistIndex());
+        if (finished[subPlaylist]) {
             continue;
         }
-        if (pos >= position || pos + length - 1 >= position) {
-            ids.insert(clp.first);
+        if (it->first + clip->getPlaytime() - 1 >= position) {
+            if (end < 0 || it->first < end) {
+                ids.insert(it->second);
+            }
+        } else {
+            finished[subPlaylist] = true;
         }
     }
     return ids;
 }
 
+void TrackModel::indexClip(int clipId, int position)
+{
+    m_clipsPos.emplace(position, clipId);
+}
+
+void TrackModel::unindexClip(int clipId, int position)
+{
+    auto range = m_clipsPos.equal_range(position);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second == clipId) {
+            m_clipsPos.erase(it);
+            return;
+        }
+    }
+    qDebug() << "Error : clip" << clipId << "was not indexed at position" << position;
+    Q_ASSERT(false);
+}
+
 int TrackModel::getRowfromClip(int clipId) const
 {
     READ_LOCK();
@@ -742,20 +791,23 @@ int TrackModel::getRowfromClip(int clipId) const
     return (int)std::distance(m_allClips.begin(), m_allClips.find(clipId));
 }
 
-std::unordered_set<int> TrackModel::getCompositionsInRange(int position, int end)
+std::unordered_set<int> TrackModel::getCompositionsInRange(int position, int end) const
 {
     READ_LOCK();
     // TODO: this function doesn't take into accounts the fact that there are two tracks
     std::unordered_set<int> ids;
-    for (const auto &compo : m_allCompositions) {
-        int pos = compo.second->getPosition();
-        int length = compo.second->getPlaytime();
-        if (end > -1 && pos >= end) {
-            continue;
+    auto start = m_compoPos.lower_bound(position);
+    for (auto it = start; it != m_compoPos.end() && (end < 0 || it->first < end); ++it) {
+        ids.insert(it->second);
+    }
+    // Compositions of a track cannot overlap, so only the ones directly preceding the range may intersect it
+    for (auto it = start; it != m_compoPos.begin();) {
+        --it;
+        if (it->first + m_allCompositions.at(it->second)->getPlaytime() - 1 < position) {
+            break;
         }
-        if (pos >= position || pos + length - 1 >= position) {
-            
-            ids.insert(compo.first);
+        if (end < 0 || it->first < end) {
+            ids.insert(it->second);
         }
     }
     return ids;
@@ -911,6 +963,24 @@ bool TrackModel::checkConsistency()
         return false;
     }
 
+    // We check the position index of the clips
+    if (m_allClips.size() != m_clipsPos.size()) {
+        qDebug() << "Error: the number of indexed clips positions doesn't match number of clips";
+        return false;
+    }
+    int subPlaylistClips[2] = {0, 0};
+    for (const auto &pos : m_clipsPos) {
+        if (m_allClips.count(pos.second) == 0 || m_allClips[pos.second]->getPosition() != pos.first) {
+            qDebug() << "Error: the position of clip " << pos.second << " is not properly indexed";
+            return false;
+        }
+        subPlaylistClips[std::max(0, m_allClips[pos.second]->getSubPlaylistIndex())]++;
+    }
+    if (subPlaylistClips[0] != m_subPlaylistClips[0] || subPlaylistClips[1] != m_subPlaylistClips[1]) {
+        qDebug() << "Error: the number of clips of the sub-playlists is not properly counted";
+        return false;
+    }
+
     // We now check compositions positions
     if (m_allCompositions.size() != m_compoPos.size()) {
         qDebug() << "Error: the number of compositions position doesn't match number of compositions";
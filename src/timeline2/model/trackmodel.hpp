@@ -26,6 +26,7 @@
 #include "undohelper.hpp"
 #include <QReadWriteLock>
 #include <QSharedPointer>
+#include <map>
 #include <memory>
 #include <mlt++/MltPlaylist.h>
 #include <mlt++/MltTractor.h>
@@ -257,10 +258,14 @@ protected:
 
     int trackDuration() const;
 
-    /* @brief Returns the list of the ids of the clips that intersect the given range */
-    std::unordered_set<int> getClipsInRange(int position, int end = -1);
-    /* @brief Returns the list of the ids of the compositions that intersect the given range */
-    std::unordered_set<int> getCompositionsInRange(int position, int end);
+    /* @brief Returns the list of the ids of the clips that intersect the given range
+       The lookup uses the position index of the track, so it runs in O(log n + k) where k is the number of returned clips
+       @param end is excluded from the range. If it is -1, the range extends to the end of the track
+    */
+    std::unordered_set<int> getClipsInRange(int position, int end = -1) const;
+    /* @brief Returns the list of the ids of the compositions that intersect the given range
+       Same as getClipsInRange, the lookup is performed on the ordered positions of the compositions */
+    std::unordered_set<int> getCompositionsInRange(int position, int end) const;
 
     /* @brief Import effects from a service that contains some (another track) */
     bool importEffects(std::weak_ptr<Mlt::Service> service);
@@ -269,6 +274,13 @@ protected:
     
     bool isAvailable(int position, int duration);
 
+private:
+    /* @brief Same as getClipsInRange, and sets visited to the number of indexed clips that were looked at */
+    std::unordered_set<int> getClipsInRange(int position, int end, int &visited) const;
+    /* @brief Add / remove a clip from the position index. These must be called each time a clip of the track is inserted, deleted or moved */
+    void indexClip(int clipId, int position);
+    void unindexClip(int clipId, int position);
+
 public slots:
     /*Delete the current track and all its associated clips */
     void slotDelete();
@@ -288,6 +300,10 @@ private:
         m_allCompositions; /*this is important to keep an
                                    ordered structure to store the clips, since we use their ids order as row order*/
 
+    std::multimap<int, int> m_clipsPos; // Ordered index of the clips by start position, used to answer range queries without iterating over all clips.
+                                        // This is a multimap because clips from the two sub-playlists may start on the same frame
+    int m_subPlaylistClips[2] = {0, 0}; // Number of clips in each sub-playlist
+
     std::map<int, int> m_compoPos; // We store the positions of the compositions. In Melt, the compositions are not inserted at the track level, but we keep
                                    // those positions here to check for moves and resize
 
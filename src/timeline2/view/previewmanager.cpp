@@ -30,6 +30,7 @@
 #include <QProcess>
 #include <QStandardPaths>
 #include <QCollator>
+#include <QThread>
 
 PreviewManager::PreviewManager(TimelineController *controller, Mlt::Tractor *tractor)
     : QObject()
@@ -43,8 +44,6 @@ PreviewManager::PreviewManager(TimelineController *controller, Mlt::Tractor *tra
 {
     m_previewGatherTimer.setSingleShot(true);
     m_previewGatherTimer.setInterval(200);
-    QObject::connect(&m_previewProcess, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), this, &PreviewManager::processEnded);
-
 
     // Find path for Kdenlive renderer
 #ifdef Q_OS_WIN
@@ -58,8 +57,6 @@ PreviewManager::PreviewManager(TimelineController *controller, Mlt::Tractor *tra
             m_renderer = QStringLiteral("kdenlive_render");
         }
     }
-    connect(this, &PreviewManager::abortPreview, &m_previewProcess, &QProcess::kill, Qt::DirectConnection);
-    connect(&m_previewProcess, &QProcess::readyReadStandardError, this, &PreviewManager::receivedStderr);
 }
 
 PreviewManager::~PreviewManager()
@@ -460,12 +457,12 @@ void PreviewManager::addPreviewRange(const QPoint zone, bool add)
     if (add) {
         qDebug() << "CHUNKS CHANGED: " << m_dirtyChunks;
         m_controller->dirtyChunksChanged();
-        if (m_previewProcess.state() == QProcess::NotRunning && KdenliveSettings::autopreview()) {
+        if (!isRendering() && KdenliveSettings::autopreview()) {
             m_previewTimer.start();
         }
     } else {
         // Remove processed chunks
-        bool isRendering = m_previewProcess.state() != QProcess::NotRunning;
+        bool wasRendering = isRendering();
         m_previewGatherTimer.stop();
         abortRendering();
         m_tractor->lock();
@@ -487,7 +484,7 @@ void PreviewManager::addPreviewRange(const QPoint zone, bool add)
         m_controller->renderedChunksChanged();
         m_controller->dirtyChunksChanged();
         m_tractor->unlock();
-        if (isRendering || KdenliveSettings::autopreview()) {
+        if (wasRendering || KdenliveSettings::autopreview()) {
             m_previewTimer.start();
         }
     }
@@ -495,20 +492,34 @@ void PreviewManager::addPreviewRange(const QPoint zone, bool add)
 
 void PreviewManager::abortRendering()
 {
-    if (m_previewProcess.state() == QProcess::NotRunning) {
+    if (!isRendering()) {
         return;
     }
     qDebug() << "/// ABORTING RENDEIGN 1\nRRRRRRRRRR";
-    emit abortPreview();
-    m_previewProcess.waitForFinished();
-    if (m_previewProcess.state() != QProcess::NotRunning) {
-        m_previewProcess.kill();
-        m_previewProcess.waitForFinished();
-    }
+    stopProcesses();
     // Re-init time estimation
     emit previewRender(-1, QString(), 1000);
 }
 
+bool PreviewManager::isRendering() const
+{
+    return !m_previewProcesses.isEmpty();
+}
+
+void PreviewManager::stopProcesses()
+{
+    // Processes are only scheduled for deletion when they end, so the pointers stay valid here
+    const QList<QProcess *> processes = m_previewProcesses;
+    emit abortPreview();
+    for (QProcess *process : processes) {
+        process->waitForFinished();
+        if (process->state() != QProcess::NotRunning) {
+            process->kill();
+            process->waitForFinished();
+        }
+    }
+}
+
 void PreviewManager::startPreviewRender()
 {
     QMutexLocker lock(&m_previewMutex);
@@ -529,28 +540,56 @@ void PreviewManager::startPreviewRender()
     }
 }
 
-void PreviewManager::receivedStderr()
+void PreviewManager::receivedStderr(QProcess *process)
 {
-    QStringList resultList = QString::fromLocal8Bit(m_previewProcess.readAllStandardError()).split(QLatin1Char('\n'));
+    QStringList resultList = QString::fromLocal8Bit(process->readAllStandardError()).split(QLatin1Char('\n'));
     for (auto &result : resultList) {
         qDebug() << "GOT PROCESS RESULT: " << result;
         if (result.startsWith(QLatin1String("START:"))) {
-            workingPreview = result.section(QLatin1String("START:"), 1).simplified().toInt();
+            m_workingChunks.insert(process, result.section(QLatin1String("START:"), 1).simplified().toInt());
+            updateWorkingPreview();
             qDebug() << "// GOT START INFO: " << workingPreview;
-            m_controller->workingPreviewChanged();
         } else if (result.startsWith(QLatin1String("DONE:"))) {
             int chunk = result.section(QLatin1String("DONE:"), 1).simplified().toInt();
-            m_processedChunks++;
-            QString fileName = QStringLiteral("%1.%2").arg(chunk).arg(m_extension);
-            qDebug() << "---------------\nJOB PROGRRESS: " << m_chunksToRender << ", " << m_processedChunks << " = "
-                     << (100 * m_processedChunks / m_chunksToRender);
-            emit previewRender(chunk, m_cacheDir.absoluteFilePath(fileName), 1000 * m_processedChunks / m_chunksToRender);
+            m_workingChunks.remove(process);
+            m_processChunks[process].removeAll(chunk);
+            m_finishedChunks.insert(chunk);
+            releaseFinishedChunks();
+            updateWorkingPreview();
         } else {
             m_errorLog.append(result);
         }
     }
 }
 
+void PreviewManager::releaseFinishedChunks()
+{
+    // Workers complete their chunks in any order, but the ruler and progress expect them in timeline order
+    while (!m_pendingChunks.isEmpty() && m_finishedChunks.contains(m_pendingChunks.first())) {
+        int chunk = m_pendingChunks.takeFirst();
+        m_finishedChunks.remove(chunk);
+        m_processedChunks++;
+        QString fileName = QStringLiteral("%1.%2").arg(chunk).arg(m_extension);
+        qDebug() << "---------------\nJOB PROGRRESS: " << m_chunksToRender << ", " << m_processedChunks << " = "
+                 << (100 * m_processedChunks / m_chunksToRender);
+        emit previewRender(chunk, m_cacheDir.absoluteFilePath(fileName), 1000 * m_processedChunks / m_chunksToRender);
+    }
+}
+
+void PreviewManager::updateWorkingPreview()
+{
+    int first = -1;
+    for (int chunk : m_workingChunks) {
+        if (first == -1 || chunk < first) {
+            first = chunk;
+        }
+    }
+    if (first != workingPreview) {
+        workingPreview = first;
+        m_controller->workingPreviewChanged();
+    }
+}
+
 void PreviewManager::doPreviewRender(const QString &scene)
 {
     // initialize progress bar
@@ -558,51 +597,80 @@ void PreviewManager::doPreviewRender(const QString &scene)
     if (m_dirtyChunks.isEmpty()) {
         return;
     }
-    Q_ASSERT(m_previewProcess.state() == QProcess::NotRunning);
+    Q_ASSERT(!isRendering());
 
-    QStringList chunks;
-    for (QVariant &frame : m_dirtyChunks) {
-        chunks << frame.toString();
-    }
     m_chunksToRender = m_dirtyChunks.count();
     m_processedChunks = 0;
+    m_pendingChunks.clear();
+    m_finishedChunks.clear();
+    m_workingChunks.clear();
+    m_processChunks.clear();
+    int workers = KdenliveSettings::previewworkers() > 0 ? KdenliveSettings::previewworkers() : QThread::idealThreadCount();
+    workers = qBound(1, workers, m_chunksToRender);
+    // Interleave the chunks between the workers so that they all progress along the timeline together
+    QVector<QStringList> shards(workers);
+    for (int i = 0; i < m_dirtyChunks.count(); i++) {
+        shards[i % workers] << m_dirtyChunks.at(i).toString();
+        m_pendingChunks << m_dirtyChunks.at(i).toInt();
+    }
     int chunkSize = KdenliveSettings::timelinechunks();
-    QStringList args{KdenliveSettings::rendererpath(),
-                     scene,
-                     m_cacheDir.absolutePath(),
-                     QStringLiteral("-split"),
-                     chunks.join(QLatin1Char(',')),
-                     QString::number(chunkSize - 1),
-                     pCore->getCurrentProfilePath(),
-                     m_extension,
-                     m_consumerParams.join(QLatin1Char(' '))};
-    qDebug() << " -  - -STARTING PREVIEW JOBS: " << args;
     pCore->currentDoc()->previewProgress(0);
-    m_previewProcess.start(m_renderer, args);
-    if (m_previewProcess.waitForStarted()) {
-        qDebug() << " -  - -STARTING PREVIEW JOBS . . . STARTED";
-    }
-}
-
-void PreviewManager::processEnded(int, QProcess::ExitStatus status)
+    for (const QStringList &chunks : shards) {
+        auto *process = new QProcess(this);
+        for (const QString &chunk : chunks) {
+            m_processChunks[process] << chunk.toInt();
+        }
+        connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), this,
+                [this, process](int, QProcess::ExitStatus status) { processEnded(process, status); });
+        connect(process, &QProcess::readyReadStandardError, this, [this, process]() { receivedStderr(process); });
+        connect(this, &PreviewManager::abortPreview, process, &QProcess::kill, Qt::DirectConnection);
+        m_previewProcesses << process;
+        QStringList args{KdenliveSettings::rendererpath(),
+                         scene,
+                         m_cacheDir.absolutePath(),
+                         QStringLiteral("-split"),
+                         chunks.join(QLatin1Char(',')),
+                         QString::number(chunkSize - 1),
+                         pCore->getCurrentProfilePath(),
+                         m_extension,
+                         m_consumerParams.join(QLatin1Char(' '))};
+        qDebug() << " -  - -STARTING PREVIEW JOBS: " << args;
+        process->start(m_renderer, args);
+        if (process->waitForStarted()) {
+            qDebug() << " -  - -STARTING PREVIEW JOBS . . . STARTED";
+        }
+    }
+}
+
+void PreviewManager::processEnded(QProcess *process, QProcess::ExitStatus status)
 {
     qDebug() << "// PROCESS IS FINISHED!!!";
-    const QString sceneList = m_cacheDir.absoluteFilePath(QStringLiteral("preview.mlt"));
-    QFile::remove(sceneList);
-    if (status == QProcess::QProcess::CrashExit) {
+    m_previewProcesses.removeAll(process);
+    // Chunks that this process did not render stay dirty, don't wait for them before reporting the following ones
+    for (int chunk : m_processChunks.take(process)) {
+        m_pendingChunks.removeAll(chunk);
+    }
+    int working = m_workingChunks.contains(process) ? m_workingChunks.take(process) : -1;
+    process->deleteLater();
+    if (status == QProcess::CrashExit) {
         qDebug() << "// PROCESS CRASHED!!!!!!";
         pCore->currentDoc()->previewProgress(-1);
-        if (workingPreview >= 0) {
-            const QString fileName = QStringLiteral("%1.%2").arg(workingPreview).arg(m_extension);
+        if (working >= 0) {
+            const QString fileName = QStringLiteral("%1.%2").arg(working).arg(m_extension);
             if (m_cacheDir.exists(fileName)) {
                 m_cacheDir.remove(fileName);
             }
         }
-    } else {
-        pCore->currentDoc()->previewProgress(1000);
     }
-    workingPreview = -1;
-    m_controller->workingPreviewChanged();
+    releaseFinishedChunks();
+    updateWorkingPreview();
+    if (m_previewProcesses.isEmpty()) {
+        const QString sceneList = m_cacheDir.absoluteFilePath(QStringLiteral("preview.mlt"));
+        QFile::remove(sceneList);
+        if (status != QProcess::CrashExit) {
+            pCore->currentDoc()->previewProgress(1000);
+        }
+    }
 }
 
 void PreviewManager::slotProcessDirtyChunks()
@@ -740,8 +808,7 @@ void PreviewManager::gotPreviewRender(int frame, const QString &file, int progre
 
 void PreviewManager::corruptedChunk(int frame, const QString &fileName)
 {
-    emit abortPreview();
-    m_previewProcess.waitForFinished();
+    stopProcesses();
     if (workingPreview >= 0) {
         workingPreview = -1;
         m_controller->workingPreviewChanged();
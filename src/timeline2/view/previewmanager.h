@@ -24,8 +24,10 @@
 
 #include <QDir>
 #include <QFuture>
+#include <QMap>
 #include <QMutex>
 #include <QProcess>
+#include <QSet>
 #include <QTimer>
 
 class TimelineController;
@@ -84,7 +86,7 @@ public:
     int setOverlayTrack(Mlt::Playlist *overlay);
     /** @brief Remove the effect compare overlay track */
     void removeOverlayTrack();
-    /** @brief The current preview chunk being processed, -1 if none */
+    /** @brief The first preview chunk being processed, -1 if none */
     int workingPreview;
     /** @brief Returns the list of existing chunks */
     QPair<QStringList, QStringList> previewChunks() const;
@@ -100,8 +102,16 @@ private:
     int m_previewTrackIndex;
     /** @brief: The kdenlive renderer app. */
     QString m_renderer;
-    /** @brief: The kdenlive timeline preview process. */
-    QProcess m_previewProcess;
+    /** @brief: The kdenlive timeline preview processes, each one rendering its own share of the dirty chunks. */
+    QList<QProcess *> m_previewProcesses;
+    /** @brief: The chunks that each preview process still has to render. */
+    QMap<QProcess *, QList<int>> m_processChunks;
+    /** @brief: The chunk currently rendered by each preview process. */
+    QMap<QProcess *, int> m_workingChunks;
+    /** @brief: The chunks of the current render, in timeline order, that were not yet reported to the ruler. */
+    QList<int> m_pendingChunks;
+    /** @brief: Chunks rendered out of order, waiting for the previous chunks to be reported. */
+    QSet<int> m_finishedChunks;
     /** @brief: The directory used to store the preview files. */
     QDir m_cacheDir;
     /** @brief: The directory used to store undo history of preview files (child of m_cacheDir). */
@@ -130,7 +140,14 @@ private:
     void enable();
     /** @brief: Temporarily disable timeline preview track. */
     void disable();
-
+    /** @brief: Returns true if at least one preview process is running. */
+    bool isRendering() const;
+    /** @brief: Kill all the preview processes and wait until they are finished. */
+    void stopProcesses();
+    /** @brief: Report the rendered chunks to the ruler, in timeline order. */
+    void releaseFinishedChunks();
+    /** @brief: Update the working preview from the chunks currently processed. */
+    void updateWorkingPreview();
 private slots:
     /** @brief: To avoid filling the hard drive, remove preview undo history after 5 steps. */
     void doCleanupOldPreviews();
@@ -141,8 +158,8 @@ private slots:
     /** @brief: When the timer collecting invalid zones is done, process. */
     void slotProcessDirtyChunks();
     /** @brief: Process preview rendering output. */
-    void receivedStderr();
-    void processEnded(int, QProcess::ExitStatus status);
+    void receivedStderr(QProcess *process);
+    void processEnded(QProcess *process, QProcess::ExitStatus status);
 
 public slots:
     /** @brief: Prepare and start rendering. */
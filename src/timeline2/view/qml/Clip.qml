@@ -56,6 +56,7 @@ Rectangle {
     property int trackId: -1 // Id of the parent track in the model
     property int fakeTid: -1
     property int fakePosition: 0
+    property var trackParent: null // Parent of the clip while it is not dragged
     property int originalTrackId: -1
     property int originalX: x
     property int originalDuration: clipDuration
@@ -150,12 +151,19 @@ Rectangle {
         if (clipRoot.fakeTid > -1 && parentTrack) {
             if (clipRoot.parent != dragContainer) {
                 var pos = clipRoot.mapToGlobal(clipRoot.x, clipRoot.y);
+                clipRoot.trackParent = clipRoot.parent
                 clipRoot.parent = dragContainer
                 pos = clipRoot.mapFromGlobal(pos.x, pos.y)
                 clipRoot.x = pos.x
                 clipRoot.y = pos.y
             }
             clipRoot.y = Logic.getTrackById(clipRoot.fakeTid).y
+        } else if (clipRoot.fakeTid == -1 && clipRoot.trackParent && clipRoot.parent == dragContainer) {
+            // Fake move ended without changing track, back to our track
+            clipRoot.parent = clipRoot.trackParent
+            clipRoot.trackParent = null
+            clipRoot.x = clipRoot.fakePosition * timeScale
+            clipRoot.y = 0
         }
     }
 
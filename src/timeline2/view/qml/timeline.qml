@@ -1216,7 +1216,7 @@ Rectangle {
                                         var posx = Math.round((parent.x)/ root.timeScale)
                                         var posy = Math.min(Math.max(0, mouse.y + parent.y - dragProxy.verticalOffset), tracksContainerArea.height)
                                         var tId = Logic.getTrackIdFromPos(posy)
-                                        if (dragProxy.masterObject && tId == dragProxy.masterObject.trackId) {
+                                        if (dragProxy.masterObject && tId == timeline.getItemMovingTrack(dragProxy.draggedItem)) {
                                             if (posx == dragFrame && controller.normalEdit()) {
                                                 return
                                             }
@@ -1233,7 +1233,7 @@ Rectangle {
                                                 dragProxy.masterObject.y = pos.y
                                                 //console.log('bringing item to front')
                                             }
-                                            dragFrame = controller.suggestClipMove(dragProxy.draggedItem, tId, posx, root.consumerPosition, Math.floor(root.snapping), moveMirrorTracks)
+                                            dragFrame = controller.suggestClipMove(dragProxy.draggedItem, tId, posx, root.consumerPosition, Math.floor(root.snapping), moveMirrorTracks, true)
                                             timeline.activeTrack = timeline.getItemMovingTrack(dragProxy.draggedItem)
                                         }
                                         var delta = dragFrame - dragProxy.sourceFrame
@@ -1254,7 +1254,9 @@ Rectangle {
                                             controller.requestCompositionMove(dragProxy.draggedItem, tId, dragFrame , true, true, true)
                                         } else {
                                             if (controller.normalEdit()) {
-                                                controller.requestClipMove(dragProxy.draggedItem, dragProxy.sourceTrack, dragProxy.sourceFrame, moveMirrorTracks, true, false, false)
+                                                // The drag was only previewed, move the clip once
+                                                tId = timeline.getItemMovingTrack(dragProxy.draggedItem)
+                                                controller.resetFakeMove(dragProxy.draggedItem)
                                                 controller.requestClipMove(dragProxy.draggedItem, tId, dragFrame , moveMirrorTracks, true, true, true)
                                             } else {
                                                 // Fake move, only process final move
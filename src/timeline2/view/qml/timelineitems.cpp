@@ -23,10 +23,19 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "kdenlivesettings.h"
 #include "core.h"
 #include "bin/projectitemmodel.h"
+#include "lib/audio/audioLevels.h"
+#include <QFontMetrics>
+#include <QGuiApplication>
 #include <QPainter>
 #include <QPainterPath>
 #include <QQuickPaintedItem>
+#include <QQuickWindow>
+#include <QSGFlatColorMaterial>
+#include <QSGGeometryNode>
+#include <QSGSimpleTextureNode>
+#include <QSGTransformNode>
 #include <cmath>
+#include <vector>
 
 const QStringList chanelNames{"L", "R", "C", "LFE", "BL", "BR"};
 
@@ -74,7 +83,241 @@ private:
     QColor m_color;
 };
 
-class TimelineWaveform : public QQuickPaintedItem
+namespace {
+// Creates a node drawing a geometry with a flat color, owning both
+QSGGeometryNode *flatColorNode(QSGGeometry *geometry, const QColor &color)
+{
+    auto *node = new QSGGeometryNode;
+    node->setGeometry(geometry);
+    node->setFlag(QSGNode::OwnsGeometry);
+    auto *material = new QSGFlatColorMaterial;
+    material->setColor(color);
+    node->setMaterial(material);
+    node->setFlag(QSGNode::OwnsMaterial);
+    return node;
+}
+
+void setNodeColor(QSGGeometryNode *node, const QColor &color)
+{
+    auto *material = static_cast<QSGFlatColorMaterial *>(node->material());
+    if (material->color() != color) {
+        material->setColor(color);
+        node->markDirty(QSGNode::DirtyMaterial);
+    }
+}
+
+QColor withAlpha(QColor color, qreal alpha)
+{
+    color.setAlphaF(color.alphaF() * alpha);
+    return color;
+}
+
+/* Root node of a waveform. The peaks are uploaded in level units (x is the entry of the zoom level,
+   y is normalized to the item height) below a transform node mapping them to pixels, so that a new
+   geometry is only built when the selected zoom level or range of entries changes. */
+class WaveformNode : public QSGNode
+{
+public:
+    struct Key
+    {
+        const AudioLevels *levels{nullptr};
+        int zoom{-1};
+        int first{0};
+        int last{-1};
+        // Exact range of the item, which can start or end in the middle of an entry
+        double from{0};
+        double to{0};
+        int channels{0};
+        bool separate{false};
+        bool operator==(const Key &other) const
+        {
+            return levels == other.levels && zoom == other.zoom && first == other.first && last == other.last && qFuzzyIsNull(from - other.from) &&
+                   qFuzzyIsNull(to - other.to) && channels == other.channels && separate == other.separate;
+        }
+    };
+
+    WaveformNode()
+    {
+        // Channel backgrounds and median lines are in normalized coordinates
+        m_frame = new QSGTransformNode;
+        appendChildNode(m_frame);
+        m_peaks = new QSGTransformNode;
+        appendChildNode(m_peaks);
+    }
+
+    void setPeaks(const AudioLevels &levels, const Key &key, const QColor &color)
+    {
+        if (key == m_key) {
+            for (QSGGeometryNode *node : m_fills) {
+                setNodeColor(node, color);
+            }
+            return;
+        }
+        m_key = key;
+        m_fills.clear();
+        while (QSGNode *child = m_peaks->firstChild()) {
+            m_peaks->removeChildNode(child);
+            delete child;
+        }
+        const int count = key.last - key.first + 1;
+        if (count <= 0) {
+            return;
+        }
+        if (!key.separate) {
+            // Merged channels: area between the bottom and the highest peak
+            auto *geometry = new QSGGeometry(QSGGeometry::defaultAttributes_Point2D(), 2 * count);
+            geometry->setDrawingMode(QSGGeometry::DrawTriangleStrip);
+            QSGGeometry::Point2D *points = geometry->vertexDataAsPoint2D();
+            for (int entry = key.first; entry <= key.last; ++entry) {
+                int level = 0;
+                for (int channel = 0; channel < key.channels; ++channel) {
+                    level = qMax(level, int(levels.level(entry, channel, key.zoom)));
+                }
+                const auto x = float(qBound(key.from, double(entry), key.to));
+                points++->set(x, 1);
+                points++->set(x, float(1. - level / 256.));
+            }
+            m_fills.push_back(flatColorNode(geometry, color));
+            m_peaks->appendChildNode(m_fills.back());
+            return;
+        }
+        // Separate channels: peaks mirrored around the median line of each channel
+        const double channelHeight = 1. / (2 * key.channels);
+        for (int channel = 0; channel < key.channels; ++channel) {
+            const double y = 1. - (2 * channel + 1) * channelHeight;
+            auto *geometry = new QSGGeometry(QSGGeometry::defaultAttributes_Point2D(), 2 * count);
+            geometry->setDrawingMode(QSGGeometry::DrawTriangleStrip);
+            QSGGeometry::Point2D *points = geometry->vertexDataAsPoint2D();
+            for (int entry = key.first; entry <= key.last; ++entry) {
+                const double level = levels.level(entry, channel, key.zoom) * channelHeight / 256.;
+                const auto x = float(qBound(key.from, double(entry), key.to));
+                points++->set(x, float(y - level));
+                points++->set(x, float(y + level));
+            }
+            m_fills.push_back(flatColorNode(geometry, color));
+            m_peaks->appendChildNode(m_fills.back());
+        }
+    }
+
+    void setFrame(int channels, bool separate, const QColor &color)
+    {
+        if (channels == m_frameChannels && separate == m_frameSeparate) {
+            if (m_lines) {
+                setNodeColor(m_lines, withAlpha(color, 0.2));
+            }
+            return;
+        }
+        m_frameChannels = channels;
+        m_frameSeparate = separate;
+        m_lines = nullptr;
+        while (QSGNode *child = m_frame->firstChild()) {
+            m_frame->removeChildNode(child);
+            delete child;
+        }
+        if (!separate || channels <= 0) {
+            return;
+        }
+        const float channelHeight = 1.f / (2 * channels);
+        // Dark background on odd channels
+        const int backgrounds = (channels + 1) / 2;
+        auto *background = new QSGGeometry(QSGGeometry::defaultAttributes_Point2D(), 6 * backgrounds);
+        background->setDrawingMode(QSGGeometry::DrawTriangles);
+        QSGGeometry::Point2D *points = background->vertexDataAsPoint2D();
+        for (int channel = 0; channel < channels; channel += 2) {
+            const float bottom = 1.f - 2 * channel * channelHeight;
+            const float top = bottom - 2 * channelHeight;
+            points++->set(0, top);
+            points++->set(1, top);
+            points++->set(0, bottom);
+            points++->set(1, top);
+            points++->set(1, bottom);
+            points++->set(0, bottom);
+        }
+        m_frame->appendChildNode(flatColorNode(background, QColor(0, 0, 0, 51)));
+        // Channel median lines
+        auto *lines = new QSGGeometry(QSGGeometry::defaultAttributes_Point2D(), 2 * channels);
+        lines->setDrawingMode(QSGGeometry::DrawLines);
+        lines->setLineWidth(1);
+        points = lines->vertexDataAsPoint2D();
+        for (int channel = 0; channel < channels; ++channel) {
+            const float y = 1.f - (2 * channel + 1) * channelHeight;
+            points++->set(0, y);
+            points++->set(1, y);
+        }
+        m_lines = flatColorNode(lines, withAlpha(color, 0.2));
+        m_frame->appendChildNode(m_lines);
+    }
+
+    /* Maps entries firstEntry to lastEntry (which can be reversed) to the width of the item */
+    void setTransform(double firstEntry, double lastEntry, const QSizeF &size)
+    {
+        QMatrix4x4 frame;
+        frame.scale(float(size.width()), float(size.height()));
+        if (frame != m_frame->matrix()) {
+            m_frame->setMatrix(frame);
+        }
+        QMatrix4x4 peaks;
+        if (!qFuzzyIsNull(lastEntry - firstEntry)) {
+            peaks.scale(float(size.width() / (lastEntry - firstEntry)), float(size.height()));
+            peaks.translate(float(-firstEntry), 0);
+        }
+        if (peaks != m_peaks->matrix()) {
+            m_peaks->setMatrix(peaks);
+        }
+    }
+
+    /* Channel names are rendered once in a texture, only when their layout or color changes */
+    void setLabels(QQuickWindow *window, int channels, const QSizeF &size, const QColor &color, const QFont &font)
+    {
+        const bool show = window != nullptr && channels > 1 && channels < 7 && size.height() / (2 * channels) > 2;
+        const QString key = show ? QStringLiteral("%1:%2:%3").arg(channels).arg(size.height()).arg(color.name(QColor::HexArgb)) : QString();
+        if (key == m_labelsKey) {
+            return;
+        }
+        m_labelsKey = key;
+        if (m_labels) {
+            removeChildNode(m_labels);
+            delete m_labels;
+            m_labels = nullptr;
+        }
+        if (!show) {
+            return;
+        }
+        const double channelHeight = size.height() / (2 * channels);
+        QFont labelFont = font;
+        labelFont.setPixelSize(int(channelHeight - 1));
+        const int width = QFontMetrics(labelFont).boundingRect(QStringLiteral("LFE")).width() + 4;
+        QImage image(width, int(std::ceil(size.height())), QImage::Format_ARGB32_Premultiplied);
+        image.fill(Qt::transparent);
+        QPainter painter(&image);
+        painter.setFont(labelFont);
+        painter.setPen(color);
+        for (int channel = 0; channel < channels; ++channel) {
+            const double y = size.height() - (2 * channel * channelHeight) - channelHeight;
+            painter.drawText(QPointF(2, y + channelHeight), chanelNames[channel]);
+        }
+        painter.end();
+        m_labels = new QSGSimpleTextureNode;
+        m_labels->setTexture(window->createTextureFromImage(image));
+        m_labels->setOwnsTexture(true);
+        m_labels->setRect(0, 0, image.width(), image.height());
+        appendChildNode(m_labels);
+    }
+
+private:
+    QSGTransformNode *m_frame;
+    QSGTransformNode *m_peaks;
+    Key m_key;
+    std::vector<QSGGeometryNode *> m_fills;
+    int m_frameChannels{-1};
+    bool m_frameSeparate{false};
+    QSGGeometryNode *m_lines{nullptr};
+    QString m_labelsKey;
+    QSGSimpleTextureNode *m_labels{nullptr};
+};
+} // namespace
+
+class TimelineWaveform : public QQuickItem
 {
     Q_OBJECT
     Q_PROPERTY(QColor fillColor MEMBER m_color NOTIFY propertyChanged)
@@ -89,24 +332,22 @@ class TimelineWaveform : public QQuickPaintedItem
 public:
     TimelineWaveform()
     {
-        setAntialiasing(false);
-        // setClip(true);
+        // The waveform is drawn by the scene graph from the peaks, zooming and scrolling only select another range of the peak pyramid
+        setFlag(QQuickItem::ItemHasContents, true);
         setEnabled(false);
         m_showItem = false;
-        //setRenderTarget(QQuickPaintedItem::FramebufferObject);
-        //setMipmap(true);
-        setTextureSize(QSize(1, 1));
         connect(this, &TimelineWaveform::levelsChanged, [&]() {
-            if (!m_binId.isEmpty() && m_audioLevels.isEmpty()) {
+            if (!m_binId.isEmpty() && !m_audioLevels) {
                 m_audioLevels = pCore->projectItemModel()->getAudioLevelsByBinID(m_binId);
                 update();
             }
         });
-        connect(this, &TimelineWaveform::propertyChanged, [&]() {
-            update();
-        });
+        connect(this, &TimelineWaveform::propertyChanged, this, &QQuickItem::update);
+        connect(this, &TimelineWaveform::audioChannelsChanged, this, &QQuickItem::update);
+        connect(this, &QQuickItem::widthChanged, this, &QQuickItem::update);
+        connect(this, &QQuickItem::heightChanged, this, &QQuickItem::update);
     }
-    
+
     bool showItem() const
     {
         return m_showItem;
@@ -114,102 +355,54 @@ public:
     void setShowItem(bool show)
     {
         m_showItem = show;
-        if (show) {
-            setTextureSize(QSize(width(), height()));
-            update();
-        } else {
-            // Free memory
-            setTextureSize(QSize(1, 1));
-        }
+        // Hidden items drop their node and its geometry to free memory
+        update();
     }
 
-    void paint(QPainter *painter) override
+    QSGNode *updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *) override
     {
-        if (!m_showItem || m_binId.isEmpty()) {
-            return;
+        if (!m_showItem || m_binId.isEmpty() || m_channels <= 0 || width() <= 0) {
+            delete oldNode;
+            return nullptr;
         }
-        if (m_audioLevels.isEmpty()) {
+        if (!m_audioLevels) {
             m_audioLevels = pCore->projectItemModel()->getAudioLevelsByBinID(m_binId);
-            if (m_audioLevels.isEmpty()) {
-                return;
-            }
         }
-        qreal indicesPrPixel = qreal(m_outPoint - m_inPoint) / width();
-        QPen pen = painter->pen();
-        pen.setColor(m_color);
-        pen.setWidthF(0);
-        painter->setBrush(m_color);
-        if (!KdenliveSettings::displayallchannels()) {
-            // Draw merged channels
-            QPainterPath path;
-            path.moveTo(-1, height());
-            double i = 0;
-            double increment = qMax(1., 1 / qAbs(indicesPrPixel));
-            double level;
-            int lastIdx = -1;
-            for (; i <= width(); i += increment) {
-                int idx = m_inPoint + int(i * indicesPrPixel);
-                if (idx + m_channels >= m_audioLevels.length() || idx < 0) {
-                    break;
-                }
-                if (lastIdx == idx) {
-                    continue;
-                }
-                lastIdx = idx;
-                level = m_audioLevels.at(idx) / 256;
-                for (int j = 1; j < m_channels; j++) {
-                    level = qMax(level, m_audioLevels.at(idx + j) / 256);
-                }
-                path.lineTo(i, height() - level * height());
-            }
-            path.lineTo(i, height());
-            painter->drawPath(path);
-        } else {
-            double channelHeight = height() / (2 * m_channels);
-            QFont font = painter->font();
-            font.setPixelSize(channelHeight - 1);
-            painter->setFont(font);
-            // Draw separate channels
-            double i = 0;
-            double increment = qMax(1., 1 / indicesPrPixel);
-            double level;
-            QRectF bgRect(0, 0, width(), 2 * channelHeight);
-            QVector<QPainterPath> channelPaths(m_channels);
-            for (int channel = 0; channel < m_channels; channel++) {
-                double y = height() - (2 * channel * channelHeight) - channelHeight;
-                channelPaths[channel].moveTo(-1, y);
-                painter->setOpacity(0.2);
-                if (channel % 2 == 0) {
-                    // Add dark background on odd channels
-                    bgRect.moveTo(0, y - channelHeight);
-                    painter->fillRect(bgRect, Qt::black);
-                }
-                // Draw channel median line
-                painter->setPen(pen);
-                painter->drawLine(QLineF(0., y, width(), y));
-                painter->setOpacity(1);
-                int lastIdx = -1;
-                for (i = 0; i <= width(); i += increment) {
-                    int idx = m_inPoint + ceil(i * indicesPrPixel);
-                    if (lastIdx == idx) {
-                        continue;
-                    }
-                    lastIdx = idx;
-                    idx += channel;
-                    if (idx >= m_audioLevels.length() || idx < 0) break;
-                    level = m_audioLevels.at(idx) * channelHeight / 256;
-                    channelPaths[channel].lineTo(i, y - level);
-                }
-                if (m_firstChunk && m_channels > 1 && m_channels < 7) {
-                    painter->drawText(2, y + channelHeight, chanelNames[channel]);
-                }
-                channelPaths[channel].lineTo(i, y);
-                painter->setPen(Qt::NoPen);
-                painter->drawPath(channelPaths.value(channel));
-                QTransform tr(1, 0, 0, -1, 0, 2 * y);
-                painter->drawPath(tr.map(channelPaths.value(channel)));
-            }
+        if (!m_audioLevels) {
+            delete oldNode;
+            return nullptr;
+        }
+        // An audio thumb job may switch the levels to memory while we read them
+        QReadLocker levelsLock(&m_audioLevels->dataLock());
+        if (m_audioLevels->isEmpty()) {
+            delete oldNode;
+            return nullptr;
+        }
+        auto *node = static_cast<WaveformNode *>(oldNode);
+        if (!node) {
+            node = new WaveformNode;
         }
+        const qreal indicesPrPixel = qreal(m_outPoint - m_inPoint) / width();
+        // When zoomed out, use the precomputed peaks of the matching zoom level instead of every frame
+        const int zoom = m_audioLevels->zoomForScale(qAbs(indicesPrPixel) / m_channels);
+        const double zoomFactor = 1 << zoom;
+        const double firstEntry = m_inPoint / double(m_channels) / zoomFactor;
+        const double lastEntry = m_outPoint / double(m_channels) / zoomFactor;
+        const bool separate = KdenliveSettings::displayallchannels();
+        WaveformNode::Key key;
+        key.levels = m_audioLevels.get();
+        key.zoom = zoom;
+        key.from = qMin(firstEntry, lastEntry);
+        key.to = qMax(firstEntry, lastEntry);
+        key.first = qMax(0, int(std::floor(key.from)));
+        key.last = qMin(m_audioLevels->frames(zoom) - 1, int(std::ceil(key.to)));
+        key.channels = m_channels;
+        key.separate = separate;
+        node->setFrame(m_channels, separate, m_color);
+        node->setPeaks(*m_audioLevels, key, m_color);
+        node->setTransform(firstEntry, lastEntry, size());
+        node->setLabels(separate && m_firstChunk ? window() : nullptr, m_channels, size(), m_color, QGuiApplication::font());
+        return node;
     }
 
 signals:
@@ -220,7 +413,7 @@ signals:
     void audioChannelsChanged();
 
 private:
-    QVector<double> m_audioLevels;
+    std::shared_ptr<AudioLevels> m_audioLevels;
     int m_inPoint;
     int m_outPoint;
     QString m_binId;
@@ -24,75 +24,194 @@
 
 #include <QCryptographicHash>
 #include <QDebug>
-#include <QQuickImageProvider>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QQuickImageResponse>
+#include <QRunnable>
+#include <QThread>
+#include <algorithm>
+#include <climits>
 #include <mlt++/MltFilter.h>
 #include <mlt++/MltProfile.h>
+#include <unordered_map>
+#include <vector>
+
+class ThumbnailResponse;
+
+/** @brief A thumbnail extraction, shared by the identical requests received while it is pending */
+struct ThumbnailRequest
+{
+    QString key;
+    QString binId;
+    int frameNumber;
+    QSize size;
+    std::vector<ThumbnailResponse *> responses;
+};
+
+/** @brief The pending extractions of a provider, shared with its responses and tasks */
+class ThumbnailRequests
+{
+public:
+    QMutex mutex; // This mutex protects the pending requests and the responses attached to them
+    std::unordered_map<QString, std::shared_ptr<ThumbnailRequest>> pending;
+    int sequence = 0;
+};
+
+class ThumbnailResponse : public QQuickImageResponse
+{
+public:
+    explicit ThumbnailResponse(std::shared_ptr<ThumbnailRequests> requests)
+        : m_requests(std::move(requests))
+    {
+    }
+    ~ThumbnailResponse() override
+    {
+        QMutexLocker lock(&m_requests->mutex);
+        detach();
+    }
+    QQuickTextureFactory *textureFactory() const override { return QQuickTextureFactory::textureFactoryForImage(m_image); }
+    /** @brief Called when QML does not need the image anymore, the extraction is dropped if nobody else waits for it */
+    void cancel() override
+    {
+        QMutexLocker lock(&m_requests->mutex);
+        if (m_finished) {
+            return;
+        }
+        detach();
+        m_finished = true;
+        lock.unlock();
+        emit finished();
+    }
+    /** @brief Attaches the response to a request, must be called with the requests locked */
+    void attach(const std::shared_ptr<ThumbnailRequest> &request)
+    {
+        m_request = request;
+        request->responses.push_back(this);
+    }
+    /** @brief Delivers the image, must be called with the requests locked */
+    void setImage(const QImage &image)
+    {
+        if (m_finished) {
+            return;
+        }
+        m_image = image;
+        m_request.reset();
+        m_finished = true;
+        emit finished();
+    }
+
+private:
+    void detach()
+    {
+        if (m_request) {
+            auto &responses = m_request->responses;
+            responses.erase(std::remove(responses.begin(), responses.end(), this), responses.end());
+            m_request.reset();
+        }
+    }
+    std::shared_ptr<ThumbnailRequests> m_requests;
+    std::shared_ptr<ThumbnailRequest> m_request;
+    QImage m_image;
+    bool m_finished = false;
+};
+
+class ThumbnailTask : public QRunnable
+{
+public:
+    ThumbnailTask(std::shared_ptr<ThumbnailRequests> requests, std::shared_ptr<ThumbnailRequest> request)
+        : m_requests(std::move(requests))
+        , m_request(std::move(request))
+    {
+    }
+    void run() override
+    {
+        {
+            QMutexLocker lock(&m_requests->mutex);
+            if (m_request->responses.empty()) {
+                // All the requests were cancelled before we started
+                m_requests->pending.erase(m_request->key);
+                return;
+            }
+        }
+        const QImage result = ThumbnailProvider::thumbnail(m_request->binId, m_request->frameNumber, m_request->size);
+        QMutexLocker lock(&m_requests->mutex);
+        m_requests->pending.erase(m_request->key);
+        // Responses can still join the request until it leaves the pending list
+        std::vector<ThumbnailResponse *> responses;
+        std::swap(responses, m_request->responses);
+        for (ThumbnailResponse *response : responses) {
+            response->setImage(result);
+        }
+    }
+
+private:
+    std::shared_ptr<ThumbnailRequests> m_requests;
+    std::shared_ptr<ThumbnailRequest> m_request;
+};
 
 ThumbnailProvider::ThumbnailProvider()
-    : QQuickImageProvider(QQmlImageProviderBase::Image, QQmlImageProviderBase::ForceAsynchronousImageLoading)
-//, m_profile(pCore->getCurrentProfilePath().toUtf8().constData())
+    : m_requests(std::make_shared<ThumbnailRequests>())
 {
+    // Each clip has a few thumbnail producers, more threads would mostly wait for them
+    m_pool.setMaxThreadCount(qMax(2, QThread::idealThreadCount() / 2));
 }
 
-ThumbnailProvider::~ThumbnailProvider() = default;
+ThumbnailProvider::~ThumbnailProvider()
+{
+    m_pool.clear();
+    m_pool.waitForDone();
+}
 
-QImage ThumbnailProvider::requestImage(const QString &id, QSize *size, const QSize &requestedSize)
+QQuickImageResponse *ThumbnailProvider::requestImageResponse(const QString &id, const QSize &requestedSize)
 {
-    QImage result;
     // id is binID/#frameNumber
     QString binId = id.section('/', 0, 0);
     bool ok;
     int frameNumber = id.section('#', -1).toInt(&ok);
-    if (ok) {
-        if (ThumbnailCache::get()->hasThumbnail(binId, frameNumber, false)) {
-            result = ThumbnailCache::get()->getThumbnail(binId, frameNumber);
-            *size = result.size();
-            return result;
-        }
-        std::shared_ptr<ProjectClip> binClip = pCore->projectItemModel()->getClipByBinID(binId);
-        if (binClip) {
-            std::shared_ptr<Mlt::Producer> prod = binClip->thumbProducer();
-            if (prod && prod->is_valid()) {
-                result = makeThumbnail(prod, frameNumber, requestedSize);
-                ThumbnailCache::get()->storeThumbnail(binId, frameNumber, result, false);
-            }
-        }
+    if (!ok) {
+        frameNumber = -1;
+    }
+    auto *response = new ThumbnailResponse(m_requests);
+    const QString key = QStringLiteral("%1#%2#%3x%4").arg(binId).arg(frameNumber).arg(requestedSize.width()).arg(requestedSize.height());
+    QMutexLocker lock(&m_requests->mutex);
+    auto it = m_requests->pending.find(key);
+    if (it != m_requests->pending.end()) {
+        // The same thumbnail is already being extracted
+        response->attach(it->second);
+        return response;
+    }
+    auto request = std::make_shared<ThumbnailRequest>();
+    request->key = key;
+    request->binId = binId;
+    request->frameNumber = frameNumber;
+    request->size = requestedSize;
+    response->attach(request);
+    m_requests->pending[key] = request;
+    // Most recent requests first, they are the ones currently visible in the timeline
+    m_requests->sequence = (m_requests->sequence + 1) & 0xffffff;
+    m_pool.start(new ThumbnailTask(m_requests, request), m_requests->sequence);
+    return response;
+}
 
-        /*if (m_producers.contains(binId.toInt())) {
-            producer = m_producers.object(binId.toInt());
-        } else {
-            m_binClip->thumbProducer();
-            if (!resource.isEmpty()) {
-                producer = new Mlt::Producer(m_profile, service.toUtf8().constData(), resource.toUtf8().constData());
-            } else {
-                producer = new Mlt::Producer(m_profile, service.toUtf8().constData());
-            }
-            std::shared_ptr<ProjectClip> binClip = pCore->projectItemModel()->getClipByBinID(binId);
-            if (binClip) {
-                std::shared_ptr<Mlt::Producer> projectProducer = binClip->originalProducer();
-                Mlt::Properties original(projectProducer->get_properties());
-                Mlt::Properties cloneProps(producer->get_properties());
-                cloneProps.pass_list(original, "video_index,force_aspect_num,force_aspect_den,force_aspect_ratio,force_fps,force_progressive,force_tff,"
-                "force_colorspace,set.force_full_luma,templatetext,autorotate,xmldata");
-            }
-            Mlt::Filter scaler(m_profile, "swscale");
-            Mlt::Filter padder(m_profile, "resize");
-            Mlt::Filter converter(m_profile, "avcolor_space");
-            producer->attach(scaler);
-            producer->attach(padder);
-            producer->attach(converter);
-            m_producers.insert(binId.toInt(), producer);
-        }
-        if ((producer != nullptr) && producer->is_valid()) {
-            // result = KThumb::getFrame(producer, frameNumber, 0, 0);
-            result = makeThumbnail(producer, frameNumber, requestedSize);
+// static
+QImage ThumbnailProvider::thumbnail(const QString &binId, int frameNumber, const QSize &requestedSize)
+{
+    QImage result;
+    if (frameNumber < 0) {
+        return result;
+    }
+    if (ThumbnailCache::get()->hasThumbnail(binId, frameNumber, false)) {
+        return ThumbnailCache::get()->getThumbnail(binId, frameNumber);
+    }
+    std::shared_ptr<ProjectClip> binClip = pCore->projectItemModel()->getClipByBinID(binId);
+    if (binClip) {
+        // Rather leave this thumbnail empty, and uncached, than block the provider threads when the producers of the clip are all in use
+        std::shared_ptr<Mlt::Producer> prod = binClip->thumbProducer(5000);
+        if (prod && prod->is_valid()) {
+            result = makeThumbnail(prod, frameNumber, requestedSize);
             ThumbnailCache::get()->storeThumbnail(binId, frameNumber, result, false);
-            //m_cache->insertImage(key, result);
-        } else {
-            qDebug() << "INVALID PRODUCER; " << service << " / " << resource;
-        }*/
+        }
     }
-    if (size) *size = result.size();
     return result;
 }
 
@@ -114,21 +233,25 @@ QString ThumbnailProvider::cacheKey(Mlt::Properties &properties, const QString &
     return key;
 }
 
+// static
 QImage ThumbnailProvider::makeThumbnail(const std::shared_ptr<Mlt::Producer> &producer, int frameNumber, const QSize &requestedSize)
 {
-    Q_UNUSED(requestedSize)
     producer->seek(frameNumber);
     QScopedPointer<Mlt::Frame> frame(producer->get_frame());
     if (frame == nullptr || !frame->is_valid()) {
         return QImage();
     }
-    int ow = 0; // requestedSize.width();
-    int oh = 0; // requestedSize.height();
-    /*if (ow > 0 && oh > 0) {
-        frame->set("rescale.interp", "fastest");
-        frame->set("deinterlace_method", "onefield");
-        frame->set("top_field_first", -1);
-    }*/
+    // Let MLT scale the frame to the thumbnail size instead of converting the full frame
+    QSize target(pCore->thumbProfile()->width(), pCore->thumbProfile()->height());
+    if (requestedSize.width() > 0 || requestedSize.height() > 0) {
+        target.scale(requestedSize.width() > 0 ? requestedSize.width() : INT_MAX, requestedSize.height() > 0 ? requestedSize.height() : INT_MAX,
+                     Qt::KeepAspectRatio);
+    }
+    int ow = target.width();
+    int oh = target.height();
+    frame->set("rescale.interp", "nearest");
+    frame->set("deinterlace_method", "onefield");
+    frame->set("top_field_first", -1);
     mlt_image_format format = mlt_image_rgb24a;
     const uchar *image = frame->get_image(format, ow, oh);
     if (image) {
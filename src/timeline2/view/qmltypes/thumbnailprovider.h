@@ -19,24 +19,35 @@
 #ifndef THUMBNAILPROVIDER_H
 #define THUMBNAILPROVIDER_H
 
-#include <KImageCache>
-#include <QCache>
-#include <QQuickImageProvider>
+#include <QQuickAsyncImageProvider>
+#include <QThreadPool>
 #include <memory>
 #include <mlt++/MltProducer.h>
 #include <mlt++/MltProfile.h>
 
-class ThumbnailProvider : public QQuickImageProvider
+class ThumbnailRequests;
+
+/** @brief Provides the thumbnails of the timeline clips.
+    Thumbnails are extracted on a thread pool, most recent requests first since they are the ones currently visible.
+    Identical requests pending at the same time share a single extraction, and the requests cancelled by QML because
+    their image left the view are dropped if their extraction did not start yet.
+ */
+class ThumbnailProvider : public QQuickAsyncImageProvider
 {
 public:
     explicit ThumbnailProvider();
     ~ThumbnailProvider() override;
-    QImage requestImage(const QString &id, QSize *size, const QSize &requestedSize) override;
+    QQuickImageResponse *requestImageResponse(const QString &id, const QSize &requestedSize) override;
+
+    /** @brief Returns the thumbnail of a clip, from the cache or extracted with one of the clip's thumbnail producers */
+    static QImage thumbnail(const QString &binId, int frameNumber, const QSize &requestedSize);
 
 private:
     QString cacheKey(Mlt::Properties &properties, const QString &service, const QString &resource, const QString &hash, int frameNumber);
-    QImage makeThumbnail(const std::shared_ptr<Mlt::Producer> &producer, int frameNumber, const QSize &requestedSize);
-    QCache<int, Mlt::Producer> m_producers;
+    /** @brief Decodes a frame directly at the requested size, or at the size of the thumbnail profile */
+    static QImage makeThumbnail(const std::shared_ptr<Mlt::Producer> &producer, int frameNumber, const QSize &requestedSize);
+    std::shared_ptr<ThumbnailRequests> m_requests;
+    QThreadPool m_pool;
 };
 
 #endif // THUMBNAILPROVIDER_H
@@ -54,6 +54,7 @@
 #include <QApplication>
 #include <QClipboard>
 #include <QQuickItem>
+#include <algorithm>
 #include <memory>
 #include <unistd.h>
 
@@ -2009,7 +2010,7 @@ void TimelineController::pasteEffects(int targetId)
         }
         for (int s : sel) {
             if (m_model->isGroup(s)) {
-                std::unordered_set<int> sub = m_model->m_groups->getLeaves(s);
+                const auto &sub = m_model->m_groups->getLeaves(s);
                 for (int current_id : sub) {
                     if (m_model->isClip(current_id)) {
                         targetIds.insert(current_id);
@@ -2024,7 +2025,7 @@ void TimelineController::pasteEffects(int targetId)
             targetId = m_model->m_groups->getRootId(targetId);
         }
         if (m_model->isGroup(targetId)) {
-            std::unordered_set<int> sub = m_model->m_groups->getLeaves(targetId);
+            const auto &sub = m_model->m_groups->getLeaves(targetId);
             for (int current_id : sub) {
                 if (m_model->isClip(current_id)) {
                     targetIds.insert(current_id);
@@ -2250,7 +2251,7 @@ void TimelineController::grabCurrent()
     int mainId = -1;
     for (int i : ids) {
         if (m_model->isGroup(i)) {
-            std::unordered_set<int> children = m_model->m_groups->getLeaves(i);
+            const auto &children = m_model->m_groups->getLeaves(i);
             items_list.insert(children.begin(), children.end());
         } else {
             items_list.insert(i);
@@ -2283,10 +2284,7 @@ void TimelineController::grabCurrent()
 int TimelineController::getItemMovingTrack(int itemId) const
 {
     if (m_model->isClip(itemId)) {
-        int trackId = -1;
-        if (m_model->m_editMode != TimelineMode::NormalEdit) {
-            trackId = m_model->m_allClips[itemId]->getFakeTrackId();
-        }
+        int trackId = m_model->m_allClips[itemId]->getFakeTrackId();
         return trackId < 0 ? m_model->m_allClips[itemId]->getCurrentTrackId() : trackId;
     }
     return m_model->m_allCompositions[itemId]->getCurrentTrackId();
@@ -2333,7 +2331,7 @@ bool TimelineController::endFakeMove(int clipId, int position, bool updateView,
     if (res) {
         // Terminate fake move
         if (m_model->isClip(clipId)) {
-            m_model->m_allClips[clipId]->setFakeTrackId(-1);
+            m_model->resetFakeMove(clipId);
         }
         if (logUndo) {
             pCore->pushUndo(undo, redo, i18n("Move item"));
@@ -2353,7 +2351,7 @@ bool TimelineController::endFakeGroupMove(int clipId, int groupId, int delta_tra
     if (res && logUndo) {
         // Terminate fake move
         if (m_model->isClip(clipId)) {
-            m_model->m_allClips[clipId]->setFakeTrackId(-1);
+            m_model->resetFakeMove(clipId);
         }
         pCore->pushUndo(undo, redo, i18n("Move group"));
     }
@@ -2364,13 +2362,13 @@ bool TimelineController::endFakeGroupMove(int clipId, int groupId, int delta_tra
 {
     Q_ASSERT(m_model->m_allGroups.count(groupId) > 0);
     bool ok = true;
-    auto all_items = m_model->m_groups->getLeaves(groupId);
+    const auto &all_items = m_model->m_groups->getLeaves(groupId);
     Q_ASSERT(all_items.size() > 1);
     Fun local_undo = []() { return true; };
     Fun local_redo = []() { return true; };
 
     // Sort clips. We need to delete from right to left to avoid confusing the view
-    std::vector<int> sorted_clips{std::make_move_iterator(std::begin(all_items)), std::make_move_iterator(std::end(all_items))};
+    std::vector<int> sorted_clips(all_items.begin(), all_items.end());
     std::sort(sorted_clips.begin(), sorted_clips.end(), [this](const int &clipId1, const int &clipId2) {
         int p1 = m_model->isClip(clipId1) ? m_model->m_allClips[clipId1]->getPosition() : m_model->m_allCompositions[clipId1]->getPosition();
         int p2 = m_model->isClip(clipId2) ? m_model->m_allClips[clipId2]->getPosition() : m_model->m_allCompositions[clipId2]->getPosition();
@@ -2468,16 +2466,16 @@ bool TimelineController::endFakeGroupMove(int clipId, int groupId, int delta_tra
     return true;
 }
 
-QStringList TimelineController::getThumbKeys()
+std::vector<std::pair<QString, int>> TimelineController::getThumbKeys()
 {
-    QStringList result;
+    std::vector<std::pair<QString, int>> result;
     for (const auto &clp : m_model->m_allClips) {
         const QString binId = getClipBinId(clp.first);
-        std::shared_ptr<ProjectClip> binClip = pCore->bin()->getBinClip(binId);
-        result << binClip->hash() + QLatin1Char('#') + QString::number(clp.second->getIn()) + QStringLiteral(".png");
-        result << binClip->hash() + QLatin1Char('#') + QString::number(clp.second->getOut()) + QStringLiteral(".png");
+        result.emplace_back(binId, clp.second->getIn());
+        result.emplace_back(binId, clp.second->getOut());
     }
-    result.removeDuplicates();
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
     return result;
 }
 
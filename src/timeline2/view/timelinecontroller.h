@@ -456,8 +456,8 @@ public:
     Q_INVOKABLE const QString getAssetName(const QString &assetId, bool isTransition);
     /** @brief Set keyboard grabbing on current selection */
     Q_INVOKABLE void grabCurrent();
-    /** @brief Returns keys for all used thumbnails */
-    QStringList getThumbKeys();
+    /** @brief Returns the (binId, position) of all used thumbnails */
+    std::vector<std::pair<QString, int>> getThumbKeys();
     /** @brief Returns true if a drag operation is currently running in timeline */
     bool dragOperationRunning();
     /** @brief Disconnect some stuff before closing project */
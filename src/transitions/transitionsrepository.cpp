@@ -23,6 +23,7 @@
 #include "core.h"
 #include "kdenlivesettings.h"
 #include "xml/xml.hpp"
+#include <QDir>
 #include <QFile>
 #include <QStandardPaths>
 
@@ -113,6 +114,11 @@ QStringList TransitionsRepository::assetDirs() const
     return QStandardPaths::locateAll(QStandardPaths::AppDataLocation, QStringLiteral("transitions"), QStandardPaths::LocateDirectory);
 }
 
+QString TransitionsRepository::assetCachePath() const
+{
+    return QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation)).absoluteFilePath(QStringLiteral("transitions.cache"));
+}
+
 void TransitionsRepository::parseType(QScopedPointer<Mlt::Properties> &metadata, Info &res)
 {
     Mlt::Properties tags((mlt_properties)metadata->get_data("tags"));
@@ -68,6 +68,9 @@ protected:
     /* @brief Returns the paths where the custom transitions' descriptions are stored */
     QStringList assetDirs() const override;
 
+    /* @brief Returns the path of the file caching the parsed transitions*/
+    QString assetCachePath() const override;
+
     /* @brief Returns the path to the transitions' blacklist*/
     QString assetBlackListPath() const override;
 
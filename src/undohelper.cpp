@@ -23,6 +23,77 @@
 #include "logger.hpp"
 #include <QDebug>
 #include <utility>
+
+OperationJournal::OperationJournal(Fun first)
+{
+    m_operations.push_back({std::move(first), Mode::Always, 0});
+}
+
+OperationJournal &OperationJournal::journal(Fun &lambda)
+{
+    auto *result = lambda.target<OperationJournal>();
+    if (result == nullptr) {
+        lambda = OperationJournal(std::move(lambda));
+        result = lambda.target<OperationJournal>();
+    }
+    return *result;
+}
+
+void OperationJournal::append(Fun &lambda, Fun operation, bool gated)
+{
+    OperationJournal &ops = journal(lambda);
+    // The gate covers all the operations already in the journal
+    ops.m_operations.push_back({std::move(operation), gated ? Mode::AfterSuccess : Mode::Always, ops.m_operations.size()});
+}
+
+void OperationJournal::prepend(Fun &lambda, Fun operation, bool gated)
+{
+    OperationJournal &ops = journal(lambda);
+    ops.m_operations.push_front({std::move(operation), gated ? Mode::Guard : Mode::Always, ops.m_operations.size()});
+}
+
+size_t OperationJournal::memoryCost(const Fun &lambda)
+{
+    size_t cost = sizeof(Fun);
+    if (const auto *ops = lambda.target<OperationJournal>()) {
+        for (const Operation &op : ops->m_operations) {
+            cost += sizeof(Operation) - sizeof(Fun) + memoryCost(op.function);
+        }
+    }
+    return cost;
+}
+
+bool OperationJournal::operator()() const
+{
+    // Since the spans of the operations are nested like the lambdas they replace, the operations preceding an AfterSuccess one
+    // succeeded if the last failure happened before its span
+    const size_t count = m_operations.size();
+    bool failed = false;
+    size_t lastFailure = 0;
+    size_t i = 0;
+    while (i < count) {
+        const Operation &op = m_operations[i];
+        if (op.mode == Mode::AfterSuccess && failed && lastFailure + op.span >= i) {
+            ++i;
+            continue;
+        }
+        if (!op.function()) {
+            failed = true;
+            lastFailure = i;
+            if (op.mode == Mode::Guard) {
+                i += op.span;
+            }
+        }
+        ++i;
+    }
+    return !failed;
+}
+
+size_t OperationJournal::size() const
+{
+    return m_operations.size();
+}
+
 FunctionalUndoCommand::FunctionalUndoCommand(Fun undo, Fun redo, const QString &text, QUndoCommand *parent)
     : QUndoCommand(parent)
     , m_undo(std::move(undo))
@@ -30,6 +101,7 @@ FunctionalUndoCommand::FunctionalUndoCommand(Fun undo, Fun redo, const QString &
     , m_undone(false)
 {
     setText(text);
+    m_memoryCost = sizeof(FunctionalUndoCommand) + OperationJournal::memoryCost(m_undo) + OperationJournal::memoryCost(m_redo);
 }
 
 void FunctionalUndoCommand::undo()
@@ -50,3 +122,8 @@ void FunctionalUndoCommand::redo()
         Q_ASSERT(res);
     }
 }
+
+size_t FunctionalUndoCommand::memoryCost() const
+{
+    return m_memoryCost;
+}
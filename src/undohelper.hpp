@@ -21,25 +21,66 @@
 
 #ifndef UNDOHELPER_H
 #define UNDOHELPER_H
+#include <deque>
 #include <functional>
 
 using Fun = std::function<bool(void)>;
 
-/* @brief this macro executes an operation after a given lambda
+/* @brief This class is a list of operations that are executed one after the other, used to build undo and redo functions.
+   Adding an operation to a function used to wrap the function in a new lambda calling it, so that executing n operations
+   needed n nested calls and every step allocated a new closure. The macros below instead turn the function into an
+   OperationJournal the first time an operation is added to it, and the next operations are appended to (or prepended to) its list,
+   which is executed iteratively.
+   Each operation remembers the neighbours that the nested version would have skipped after a failure, so the result and the
+   executed operations are the same as with nested lambdas.
  */
-#define PUSH_LAMBDA(operation, lambda)                                                                                                                         \
-    lambda = [lambda, operation]() {                                                                                                                           \
-        bool v = lambda();                                                                                                                                     \
-        return v && operation();                                                                                                                               \
+class OperationJournal
+{
+public:
+    /* @brief Adds operation after the ones of lambda
+       @param gated if true, operation is only executed if all the previous ones succeeded
+    */
+    static void append(Fun &lambda, Fun operation, bool gated);
+    /* @brief Adds operation before the ones of lambda
+       @param gated if true, the previous operations are only executed if this one succeeds
+    */
+    static void prepend(Fun &lambda, Fun operation, bool gated);
+
+    /* @brief Memory used by a function and by the operations of its nested journals.
+       The captures that std::function allocates separately cannot be measured and are not counted */
+    static size_t memoryCost(const Fun &lambda);
+
+    /* @brief Executes the operations, returns true if none of them failed */
+    bool operator()() const;
+
+    size_t size() const;
+
+private:
+    explicit OperationJournal(Fun first);
+    // Returns the journal stored in lambda, converting lambda if needed
+    static OperationJournal &journal(Fun &lambda);
+
+    enum class Mode {
+        Always,       // always executed
+        AfterSuccess, // only executed if the span operations before it succeeded
+        Guard         // the span operations after it are skipped if it fails
+    };
+    struct Operation
+    {
+        Fun function;
+        Mode mode;
+        size_t span;
     };
+    std::deque<Operation> m_operations;
+};
+
+/* @brief this macro executes an operation after a given lambda
+ */
+#define PUSH_LAMBDA(operation, lambda) OperationJournal::append(lambda, operation, true);
 
 /* @brief this macro executes an operation before a given lambda
  */
-#define PUSH_FRONT_LAMBDA(operation, lambda)                                                                                                                   \
-    lambda = [lambda, operation]() {                                                                                                                           \
-        bool v = operation();                                                                                                                                  \
-        return v && lambda();                                                                                                                                  \
-    };
+#define PUSH_FRONT_LAMBDA(operation, lambda) OperationJournal::prepend(lambda, operation, true);
 
 #include <QUndoCommand>
 
@@ -55,9 +96,13 @@ public:
     void undo() override;
     void redo() override;
 
+    /* @brief Memory used by the undo and redo functions, see OperationJournal::memoryCost */
+    size_t memoryCost() const;
+
 private:
     Fun m_undo, m_redo;
     bool m_undone;
+    size_t m_memoryCost;
 };
 
 #endif
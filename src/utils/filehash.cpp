@@ -0,0 +1,276 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by the Kdenlive developers                         *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include "filehash.hpp"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QtConcurrent>
+#include <algorithm>
+
+std::unique_ptr<FileHashCache> FileHashCache::instance;
+std::once_flag FileHashCache::m_onceFlag;
+
+namespace {
+const quint32 CacheMagic = 0x4b444648; // KDFH
+const quint32 CacheVersion = 1;
+// Size of the parts hashed at the beginning and at the end of a file
+const qint64 HashedPartSize = 1000000;
+} // namespace
+
+std::unique_ptr<FileHashCache> &FileHashCache::get()
+{
+    std::call_once(m_onceFlag, [] {
+        QDir dir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation));
+        dir.mkpath(QStringLiteral("."));
+        instance.reset(new FileHashCache(dir.absoluteFilePath(QStringLiteral("filehashes"))));
+    });
+    return instance;
+}
+
+FileHashCache::FileHashCache(const QString &cacheFile)
+    : m_cacheFile(cacheFile)
+    , m_useCounter(0)
+    , m_dirty(false)
+{
+    load();
+}
+
+FileHashCache::~FileHashCache()
+{
+    save();
+}
+
+// static
+QString FileHashCache::computeHash(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QString();
+    }
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    /*
+     * 1 MB = 1 second per 450 files (or faster)
+     * 10 MB = 9 seconds per 450 files (or faster)
+     */
+    if (file.size() > 2 * HashedPartSize) {
+        hash.addData(file.read(HashedPartSize));
+        if (file.seek(file.size() - HashedPartSize)) {
+            hash.addData(file.readAll());
+        }
+    } else {
+        hash.addData(file.readAll());
+    }
+    return QString::fromLatin1(hash.result().toHex());
+}
+
+QString FileHashCache::hash(const QString &path, qint64 *size)
+{
+    const QFileInfo info(path);
+    if (!info.isFile()) {
+        return QString();
+    }
+    const qint64 fileSize = info.size();
+    const qint64 modified = info.lastModified().toMSecsSinceEpoch();
+    if (size) {
+        *size = fileSize;
+    }
+    {
+        QMutexLocker lock(&m_mutex);
+        auto it = m_entries.find(path);
+        if (it != m_entries.end() && it->size == fileSize && it->modified == modified) {
+            it->lastUse = ++m_useCounter;
+            return it->hash;
+        }
+    }
+    // Read the file without holding the lock, several files can be hashed in parallel
+    const QString result = computeHash(path);
+    if (!result.isEmpty()) {
+        QMutexLocker lock(&m_mutex);
+        m_entries.insert(path, Entry{fileSize, modified, result, ++m_useCounter});
+        m_dirty = true;
+    }
+    return result;
+}
+
+bool FileHashCache::contains(const QString &path) const
+{
+    const QFileInfo info(path);
+    QMutexLocker lock(&m_mutex);
+    auto it = m_entries.constFind(path);
+    return it != m_entries.constEnd() && info.isFile() && it->size == info.size() && it->modified == info.lastModified().toMSecsSinceEpoch();
+}
+
+int FileHashCache::count() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_entries.count();
+}
+
+void FileHashCache::load()
+{
+    QFile file(m_cacheFile);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_9);
+    quint32 magic;
+    quint32 version;
+    quint32 entries;
+    stream >> magic >> version >> entries;
+    if (magic != CacheMagic || version != CacheVersion) {
+        return;
+    }
+    QMutexLocker lock(&m_mutex);
+    for (quint32 i = 0; i < entries && stream.status() == QDataStream::Ok; ++i) {
+        QString path;
+        Entry entry;
+        stream >> path >> entry.size >> entry.modified >> entry.hash;
+        if (stream.status() == QDataStream::Ok) {
+            entry.lastUse = ++m_useCounter;
+            m_entries.insert(path, entry);
+        }
+    }
+}
+
+void FileHashCache::save()
+{
+    QMutexLocker lock(&m_mutex);
+    if (!m_dirty) {
+        return;
+    }
+    if (m_entries.count() > MaxEntries) {
+        // Drop the hashes that were not used for the longest time
+        std::vector<quint64> uses;
+        uses.reserve(size_t(m_entries.count()));
+        for (const Entry &entry : m_entries) {
+            uses.push_back(entry.lastUse);
+        }
+        auto limit = uses.end() - MaxEntries;
+        std::nth_element(uses.begin(), limit, uses.end());
+        const quint64 oldest = *limit;
+        for (auto it = m_entries.begin(); it != m_entries.end();) {
+            if (it->lastUse < oldest) {
+                it = m_entries.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    QSaveFile file(m_cacheFile);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return;
+    }
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_9);
+    stream << CacheMagic << CacheVersion << quint32(m_entries.count());
+    for (auto it = m_entries.constBegin(); it != m_entries.constEnd(); ++it) {
+        stream << it.key() << it->size << it->modified << it->hash;
+    }
+    if (file.commit()) {
+        m_dirty = false;
+    }
+}
+
+FileIndex::FileIndex(const QString &root)
+    : m_count(0)
+{
+    QDirIterator it(root, QDir::Files | QDir::Readable, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        it.next();
+        m_bySize[it.fileInfo().size()].push_back(it.filePath());
+        m_count++;
+    }
+}
+
+void FileIndex::prepare(const std::vector<qint64> &sizes) const
+{
+    QStringList files;
+    for (qint64 size : sizes) {
+        if (size < 0) {
+            files.clear();
+            for (const auto &entry : m_bySize) {
+                for (const QString &path : entry.second) {
+                    files << path;
+                }
+            }
+            break;
+        }
+        auto it = m_bySize.find(size);
+        if (it != m_bySize.end()) {
+            for (const QString &path : it->second) {
+                files << path;
+            }
+        }
+    }
+    files.removeDuplicates();
+    QtConcurrent::blockingMap(files, [](const QString &path) { FileHashCache::get()->hash(path); });
+}
+
+QString FileIndex::find(qint64 size, const QString &hash, const QString &fileName) const
+{
+    std::vector<QString> matches = candidates(size);
+    // Check the files with the searched name first, they are the most likely to match
+    const QString name = QFileInfo(fileName).fileName();
+    std::stable_partition(matches.begin(), matches.end(), [&name](const QString &path) { return QFileInfo(path).fileName() == name; });
+    for (const QString &path : matches) {
+        if (FileHashCache::get()->hash(path) == hash) {
+            return path;
+        }
+    }
+    return QString();
+}
+
+std::vector<QString> FileIndex::candidates(qint64 size) const
+{
+    if (size < 0) {
+        std::vector<QString> result;
+        result.reserve(size_t(m_count));
+        for (const auto &entry : m_bySize) {
+            result.insert(result.end(), entry.second.begin(), entry.second.end());
+        }
+        return result;
+    }
+    auto it = m_bySize.find(size);
+    return it == m_bySize.end() ? std::vector<QString>() : it->second;
+}
+
+// static
+qint64 FileIndex::sizeFromString(const QString &size)
+{
+    bool ok = false;
+    const qint64 result = size.toLongLong(&ok);
+    return ok ? result : -1;
+}
+
+int FileIndex::count() const
+{
+    return m_count;
+}
@@ -0,0 +1,113 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by the Kdenlive developers                         *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#pragma once
+
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+/** @brief This class computes and caches the hashes used to identify the media files of a project.
+    The hash of a file is the MD5 of its first and last megabytes, as stored in the kdenlive:file_hash property of clips.
+    Hashes are kept in a persistent cache, keyed by path and validated with the size and modification time of the file,
+    so that a file is only read again when it changed.
+    All functions are thread safe, so that hashes can be computed by the jobs.
+ * Note that this class is a Singleton
+ */
+class FileHashCache
+{
+public:
+    // Returns the instance of the Singleton
+    static std::unique_ptr<FileHashCache> &get();
+
+    /** @brief Creates a cache stored in the given file, loading its content */
+    explicit FileHashCache(const QString &cacheFile);
+    ~FileHashCache();
+
+    /** @brief Reads the file and returns its partial hash as an hexadecimal string, or an empty string if it cannot be read */
+    static QString computeHash(const QString &path);
+
+    /* @brief Returns the hash of a file, reading it only if it changed since it was last hashed
+       @param size if not null, receives the size of the file
+    */
+    QString hash(const QString &path, qint64 *size = nullptr);
+    /** @brief Returns true if the hash of the file is cached and still valid */
+    bool contains(const QString &path) const;
+    /** @brief Number of cached hashes */
+    int count() const;
+    /** @brief Writes the cache to disk if it changed */
+    void save();
+
+    /** @brief Maximum number of hashes kept on disk, the least recently used are dropped */
+    static const int MaxEntries = 100000;
+
+private:
+    struct Entry
+    {
+        qint64 size;
+        qint64 modified;
+        QString hash;
+        quint64 lastUse;
+    };
+    void load();
+
+    static std::unique_ptr<FileHashCache> instance;
+    static std::once_flag m_onceFlag; // flag to create the cache only once;
+    QString m_cacheFile;
+    mutable QMutex m_mutex; // This mutex protects the entries below
+    QHash<QString, Entry> m_entries;
+    quint64 m_useCounter;
+    bool m_dirty;
+};
+
+/** @brief This class indexes the files of a folder tree by size, to quickly find the files matching a clip hash.
+    It is built with one traversal of the tree, files are only read (through the FileHashCache) when their size matches
+    the one of a searched clip. It is used to relink all the missing clips of a project in one pass.
+ */
+class FileIndex
+{
+public:
+    /** @brief Indexes the files of the folder and of its subfolders */
+    explicit FileIndex(const QString &root);
+
+    /** @brief Hashes in parallel all the files with one of the given sizes, so that find() does not have to read them.
+        A negative size is unknown and matches all the files */
+    void prepare(const std::vector<qint64> &sizes) const;
+    /* @brief Returns the path of a file with the given size and hash, or an empty string
+       @param size the size of the file, negative if it is unknown
+       @param fileName if a file with this name matches, it is preferred over the other matches
+    */
+    QString find(qint64 size, const QString &hash, const QString &fileName = QString()) const;
+    /** @brief Returns the paths of the files with a given size, or of all the files if the size is negative */
+    std::vector<QString> candidates(qint64 size) const;
+    /** @brief Converts a size stored in a project, where an empty string means that the size is unknown */
+    static qint64 sizeFromString(const QString &size);
+    /** @brief Number of indexed files */
+    int count() const;
+
+private:
+    std::unordered_map<qint64, std::vector<QString>> m_bySize;
+    int m_count;
+};
@@ -0,0 +1,247 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by the Kdenlive developers                         *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include "mediaprobecache.hpp"
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QtConcurrent>
+#include <algorithm>
+#include <mlt++/MltProducer.h>
+#include <vector>
+
+std::unique_ptr<MediaProbeCache> MediaProbeCache::instance;
+std::once_flag MediaProbeCache::m_onceFlag;
+
+namespace {
+const quint32 CacheMagic = 0x4b444d50; // KDMP
+const quint32 CacheVersion = 1;
+} // namespace
+
+std::unique_ptr<MediaProbeCache> &MediaProbeCache::get()
+{
+    std::call_once(m_onceFlag, [] {
+        QDir dir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation));
+        dir.mkpath(QStringLiteral("."));
+        instance.reset(new MediaProbeCache(dir.absoluteFilePath(QStringLiteral("mediaprobes"))));
+    });
+    return instance;
+}
+
+MediaProbeCache::MediaProbeCache(const QString &cacheFile)
+    : m_cacheFile(cacheFile)
+    , m_useCounter(0)
+    , m_dirty(false)
+    , m_shutdown(false)
+{
+    // Checks are not urgent, do not compete with the load jobs for the disk
+    m_revalidationPool.setMaxThreadCount(1);
+    load();
+}
+
+MediaProbeCache::~MediaProbeCache()
+{
+    shutdown();
+}
+
+void MediaProbeCache::shutdown()
+{
+    {
+        QMutexLocker lock(&m_mutex);
+        m_shutdown = true;
+    }
+    m_revalidationPool.clear();
+    m_revalidationPool.waitForDone();
+    save();
+}
+
+// static
+QMap<QString, QString> MediaProbeCache::probedProperties(Mlt::Producer &producer)
+{
+    QMap<QString, QString> properties;
+    const int count = producer.count();
+    for (int i = 0; i < count; ++i) {
+        const char *name = producer.get_name(i);
+        // Data properties have no string value
+        const char *value = producer.get(i);
+        if (name == nullptr || value == nullptr || name[0] == '_') {
+            continue;
+        }
+        const QString key = QString::fromUtf8(name);
+        if (key.startsWith(QLatin1String("kdenlive:")) || key == QLatin1String("resource") || key == QLatin1String("mlt_service") ||
+            key == QLatin1String("mlt_type")) {
+            continue;
+        }
+        properties.insert(key, QString::fromUtf8(value));
+    }
+    return properties;
+}
+
+QMap<QString, QString> MediaProbeCache::lookup(const QString &path, const QString &profileKey)
+{
+    const QFileInfo info(path);
+    if (!info.isFile()) {
+        return QMap<QString, QString>();
+    }
+    const qint64 modified = info.lastModified().toMSecsSinceEpoch();
+    QMutexLocker lock(&m_mutex);
+    auto it = m_entries.find(path);
+    if (it == m_entries.end() || it->size != info.size() || it->modified != modified || it->profileKey != profileKey) {
+        return QMap<QString, QString>();
+    }
+    it->lastUse = ++m_useCounter;
+    return it->properties;
+}
+
+void MediaProbeCache::store(const QString &path, const QString &profileKey, Mlt::Producer &producer)
+{
+    update(path, profileKey, probedProperties(producer));
+}
+
+bool MediaProbeCache::update(const QString &path, const QString &profileKey, const QMap<QString, QString> &properties)
+{
+    const QFileInfo info(path);
+    if (!info.isFile() || properties.isEmpty()) {
+        return false;
+    }
+    Entry entry{info.size(), info.lastModified().toMSecsSinceEpoch(), profileKey, properties, 0};
+    QMutexLocker lock(&m_mutex);
+    auto it = m_entries.find(path);
+    const bool changed = it == m_entries.end() || it->size != entry.size || it->modified != entry.modified || it->profileKey != profileKey ||
+                         it->properties != properties;
+    if (changed) {
+        entry.lastUse = ++m_useCounter;
+        m_entries.insert(path, entry);
+        m_dirty = true;
+    }
+    return changed;
+}
+
+int MediaProbeCache::count() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_entries.count();
+}
+
+void MediaProbeCache::revalidate(const QString &path, const QString &profileKey, std::function<std::shared_ptr<Mlt::Producer>()> open,
+                                 std::function<void()> changed)
+{
+    QMutexLocker lock(&m_mutex);
+    if (m_shutdown || m_revalidated.contains(path)) {
+        return;
+    }
+    m_revalidated.insert(path);
+    // Queue the check with the mutex held, so that shutdown() cannot miss it
+    QtConcurrent::run(&m_revalidationPool, [this, path, profileKey, open, changed]() {
+        std::shared_ptr<Mlt::Producer> producer = open();
+        if (!producer || !producer->is_valid()) {
+            // The file cannot be opened anymore, the probe must not be used
+            QMutexLocker lock(&m_mutex);
+            m_entries.remove(path);
+            m_dirty = true;
+            lock.unlock();
+            changed();
+            return;
+        }
+        if (update(path, profileKey, probedProperties(*producer.get()))) {
+            changed();
+        }
+    });
+}
+
+void MediaProbeCache::waitForRevalidation()
+{
+    m_revalidationPool.waitForDone();
+}
+
+void MediaProbeCache::load()
+{
+    QFile file(m_cacheFile);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_9);
+    quint32 magic;
+    quint32 version;
+    QString mltVersion;
+    quint32 entries;
+    stream >> magic >> version >> mltVersion >> entries;
+    // Another MLT version may probe files differently
+    if (magic != CacheMagic || version != CacheVersion || mltVersion != QString::fromLatin1(mlt_version_get_string())) {
+        return;
+    }
+    QMutexLocker lock(&m_mutex);
+    for (quint32 i = 0; i < entries && stream.status() == QDataStream::Ok; ++i) {
+        QString path;
+        Entry entry;
+        stream >> path >> entry.size >> entry.modified >> entry.profileKey >> entry.properties;
+        if (stream.status() == QDataStream::Ok) {
+            entry.lastUse = ++m_useCounter;
+            m_entries.insert(path, entry);
+        }
+    }
+}
+
+void MediaProbeCache::save()
+{
+    QMutexLocker lock(&m_mutex);
+    if (!m_dirty) {
+        return;
+    }
+    if (m_entries.count() > MaxEntries) {
+        // Drop the probes that were not used for the longest time
+        std::vector<quint64> uses;
+        uses.reserve(size_t(m_entries.count()));
+        for (const Entry &entry : m_entries) {
+            uses.push_back(entry.lastUse);
+        }
+        auto limit = uses.end() - MaxEntries;
+        std::nth_element(uses.begin(), limit, uses.end());
+        const quint64 oldest = *limit;
+        for (auto it = m_entries.begin(); it != m_entries.end();) {
+            if (it->lastUse < oldest) {
+                it = m_entries.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    QSaveFile file(m_cacheFile);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return;
+    }
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_9);
+    stream << CacheMagic << CacheVersion << QString::fromLatin1(mlt_version_get_string()) << quint32(m_entries.count());
+    for (auto it = m_entries.constBegin(); it != m_entries.constEnd(); ++it) {
+        stream << it.key() << it->size << it->modified << it->profileKey << it->properties;
+    }
+    if (file.commit()) {
+        m_dirty = false;
+    }
+}
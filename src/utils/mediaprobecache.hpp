@@ -0,0 +1,112 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by the Kdenlive developers                         *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#pragma once
+
+#include <QHash>
+#include <QMap>
+#include <QMutex>
+#include <QSet>
+#include <QString>
+#include <QThreadPool>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+namespace Mlt {
+class Producer;
+}
+
+/** @brief This class keeps the properties probed by MLT when opening media files, so that
+    the clips of a project can be loaded again without opening each file.
+    Probes are stored in a persistent cache keyed by path, and are only used if the size and
+    modification time of the file did not change, and if the frame rate of the project is the one
+    used when probing (the length of the clip depends on it).
+    Restored probes are checked again in the background, opening the files one at a time.
+    All functions are thread safe, so that probes can be used by the load jobs.
+ * Note that this class is a Singleton
+ */
+class MediaProbeCache
+{
+public:
+    // Returns the instance of the Singleton
+    static std::unique_ptr<MediaProbeCache> &get();
+
+    /** @brief Creates a cache stored in the given file, loading its content */
+    explicit MediaProbeCache(const QString &cacheFile);
+    ~MediaProbeCache();
+
+    /** @brief Returns the properties set by MLT when opening a file: stream layout, length, codecs...
+        Kdenlive's own properties, and the internal and data properties are ignored. */
+    static QMap<QString, QString> probedProperties(Mlt::Producer &producer);
+
+    /* @brief Returns the cached probe of a file, or an empty map if there is none or if it is outdated
+       @param profileKey identifies the frame rate of the project
+    */
+    QMap<QString, QString> lookup(const QString &path, const QString &profileKey);
+    /** @brief Stores the properties of a producer that was just opened from the given file */
+    void store(const QString &path, const QString &profileKey, Mlt::Producer &producer);
+    /** @brief Number of cached probes */
+    int count() const;
+    /** @brief Writes the cache to disk if it changed */
+    void save();
+
+    /* @brief Probes a file again in the background, once per session, and updates its entry
+       @param open opens the file, it is called on a worker thread
+       @param changed called on the worker thread if the probe does not match the cached one
+    */
+    void revalidate(const QString &path, const QString &profileKey, std::function<std::shared_ptr<Mlt::Producer>()> open, std::function<void()> changed);
+    /** @brief Waits until the background checks are done */
+    void waitForRevalidation();
+    /** @brief Drops the pending checks, waits for the running one and writes the cache.
+        The callbacks of the checks may use the core, so this must be called before it is destroyed.
+        Later checks are ignored. */
+    void shutdown();
+
+    /** @brief Maximum number of probes kept on disk, the least recently used are dropped */
+    static const int MaxEntries = 20000;
+
+private:
+    struct Entry
+    {
+        qint64 size;
+        qint64 modified;
+        QString profileKey;
+        QMap<QString, QString> properties;
+        quint64 lastUse;
+    };
+
+    void load();
+    /** @brief Stores a probe, returns true if it differs from the cached one */
+    bool update(const QString &path, const QString &profileKey, const QMap<QString, QString> &properties);
+
+    static std::unique_ptr<MediaProbeCache> instance;
+    static std::once_flag m_onceFlag; // flag to create the cache only once;
+    QString m_cacheFile;
+    mutable QMutex m_mutex; // This mutex protects the members below
+    QHash<QString, Entry> m_entries;
+    // Files already checked in this session
+    QSet<QString> m_revalidated;
+    quint64 m_useCounter;
+    bool m_dirty;
+    bool m_shutdown;
+    QThreadPool m_revalidationPool;
+};
@@ -0,0 +1,109 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by the Kdenlive developers                         *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include "producerpool.hpp"
+
+#include <QDeadlineTimer>
+#include <QMutexLocker>
+#include <climits>
+#include <mlt++/MltProducer.h>
+
+ProducerPool::ProducerPool(Factory factory, int maxProducers)
+    : m_factory(std::move(factory))
+    , m_maxProducers(qMax(1, maxProducers))
+    , m_busy(0)
+    , m_generation(0)
+{
+}
+
+std::shared_ptr<ProducerPool> ProducerPool::construct(Factory factory, int maxProducers)
+{
+    return std::shared_ptr<ProducerPool>(new ProducerPool(std::move(factory), maxProducers));
+}
+
+std::shared_ptr<Mlt::Producer> ProducerPool::acquire(int timeout)
+{
+    QDeadlineTimer deadline(timeout);
+    QMutexLocker lock(&m_mutex);
+    std::shared_ptr<Mlt::Producer> producer;
+    while (m_idle.empty() && m_busy >= m_maxProducers) {
+        if (!m_released.wait(&m_mutex, deadline.isForever() ? ULONG_MAX : static_cast<unsigned long>(deadline.remainingTime()))) {
+            return nullptr;
+        }
+    }
+    m_busy++;
+    const quint64 generation = m_generation;
+    if (!m_idle.empty()) {
+        producer = std::move(m_idle.back());
+        m_idle.pop_back();
+    } else {
+        // Opening the media can be slow, let the other threads use the idle producers meanwhile
+        lock.unlock();
+        producer = m_factory();
+        lock.relock();
+        if (!producer) {
+            m_busy--;
+            m_released.wakeOne();
+            return nullptr;
+        }
+    }
+    // The returned pointer gives the producer back to the pool instead of deleting it
+    std::weak_ptr<ProducerPool> pool = shared_from_this();
+    return std::shared_ptr<Mlt::Producer>(producer.get(), [pool, producer, generation](Mlt::Producer *) {
+        if (auto ptr = pool.lock()) {
+            ptr->release(producer, generation);
+        }
+    });
+}
+
+void ProducerPool::release(const std::shared_ptr<Mlt::Producer> &producer, quint64 generation)
+{
+    QMutexLocker lock(&m_mutex);
+    m_busy--;
+    if (generation == m_generation) {
+        m_idle.push_back(producer);
+    }
+    m_released.wakeOne();
+}
+
+void ProducerPool::clear()
+{
+    QMutexLocker lock(&m_mutex);
+    m_generation++;
+    m_idle.clear();
+}
+
+int ProducerPool::size() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_busy + int(m_idle.size());
+}
+
+int ProducerPool::idleCount() const
+{
+    QMutexLocker lock(&m_mutex);
+    return int(m_idle.size());
+}
+
+int ProducerPool::maxProducers() const
+{
+    return m_maxProducers;
+}
@@ -0,0 +1,76 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by the Kdenlive developers                         *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#pragma once
+
+#include <QMutex>
+#include <QWaitCondition>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace Mlt {
+class Producer;
+}
+
+/** @brief This class is a bounded pool of producers reading the same media, used to extract thumbnails from several threads.
+    A producer obtained with acquire() is used exclusively by the caller, so that concurrent requests do not seek each other's producer.
+    It goes back to the pool when the last copy of the returned pointer is destroyed.
+    When all the producers are in use and the pool is full, acquire() waits for one to be released.
+ */
+class ProducerPool : public std::enable_shared_from_this<ProducerPool>
+{
+public:
+    using Factory = std::function<std::shared_ptr<Mlt::Producer>()>;
+
+    /* @brief Creates a pool
+       @param factory creates a new producer, it is called without holding the lock of the pool and may return nullptr
+       @param maxProducers the maximum number of producers that exist at the same time
+    */
+    static std::shared_ptr<ProducerPool> construct(Factory factory, int maxProducers);
+
+    /* @brief Returns a producer for the exclusive use of the caller, or nullptr if none could be created
+       @param timeout maximum time to wait for a producer in milliseconds, -1 to wait forever
+    */
+    std::shared_ptr<Mlt::Producer> acquire(int timeout = -1);
+
+    /** @brief Drops all the producers, for example when the clip changed. Producers currently in use are dropped when released */
+    void clear();
+
+    /** @brief Returns the number of producers that currently exist, idle or in use */
+    int size() const;
+    /** @brief Returns the number of producers waiting in the pool */
+    int idleCount() const;
+    int maxProducers() const;
+
+protected:
+    ProducerPool(Factory factory, int maxProducers);
+    void release(const std::shared_ptr<Mlt::Producer> &producer, quint64 generation);
+
+    Factory m_factory;
+    const int m_maxProducers;
+    mutable QMutex m_mutex; // This mutex protects the members below
+    QWaitCondition m_released;
+    std::vector<std::shared_ptr<Mlt::Producer>> m_idle;
+    int m_busy;
+    /** @brief Incremented by clear(), producers of a previous generation are not reused */
+    quint64 m_generation;
+};
@@ -24,117 +24,309 @@
 #include "bin/projectitemmodel.h"
 #include "core.h"
 #include "doc/kdenlivedoc.h"
+#include "kdenlivesettings.h"
 #include <QDir>
 #include <QMutexLocker>
+#include <algorithm>
 #include <list>
 
 std::unique_ptr<ThumbnailCache> ThumbnailCache::instance;
 std::once_flag ThumbnailCache::m_onceFlag;
 
-class ThumbnailCache::Cache_t
+class ThumbnailCache::Shard
 {
 public:
-    Cache_t(int maxCost)
+    Shard(qint64 maxCost)
         : m_maxCost(maxCost)
     {
     }
 
-    bool contains(const QString &key) const { return m_cache.count(key) > 0; }
+    bool contains(const QString &binId, int pos) const
+    {
+        QMutexLocker locker(&m_mutex);
+        return find(binId, pos) != m_data.end();
+    }
 
-    void remove(const QString &key)
+    QImage get(const QString &binId, int pos, bool *found)
     {
-        if (!contains(key)) {
-            return;
+        QMutexLocker locker(&m_mutex);
+        auto it = find(binId, pos);
+        *found = it != m_data.end();
+        if (!*found) {
+            return QImage();
         }
-        auto it = m_cache.at(key);
-        m_currentCost -= (*it).second.second;
-        m_data.erase(it);
-        m_cache.erase(key);
+        // when a get operation occurs, we put the corresponding list item in front to remember last access
+        m_data.splice(m_data.begin(), m_data, it);
+        return it->image;
     }
 
-    void insert(const QString &key, const QImage &img, int cost)
+    // Stores an image, replacing the previous one at this position. Returns the number of images dropped to stay in the budget
+    int insert(const QString &binId, int pos, const QImage &img)
     {
+        QMutexLocker locker(&m_mutex);
+        remove(find(binId, pos));
+        const qint64 cost = img.sizeInBytes();
         if (cost > m_maxCost) {
-            return;
+            return 0;
         }
-        m_data.push_front({key, {img, cost}});
-        auto it = m_data.begin();
-        m_cache[key] = it;
+        m_data.push_front({binId, pos, img, cost});
+        m_index[binId][pos] = m_data.begin();
         m_currentCost += cost;
+        int evicted = 0;
         while (m_currentCost > m_maxCost) {
-            remove(m_data.back().first);
+            remove(std::prev(m_data.end()));
+            evicted++;
         }
+        return evicted;
     }
 
-    QImage get(const QString &key)
+    void removeClip(const QString &binId)
     {
-        if (!contains(key)) {
-            return QImage();
+        QMutexLocker locker(&m_mutex);
+        auto clip = m_index.find(binId);
+        if (clip == m_index.end()) {
+            return;
         }
-        // when a get operation occurs, we put the corresponding list item in front to remember last access
-        std::pair<QString, std::pair<QImage, int>> data;
-        auto it = m_cache.at(key);
-        std::swap(data, (*it));                                         // take data out without copy
-        QImage result = data.second.first;                              // a copy occurs here
-        m_data.erase(it);                                               // delete old iterator
-        m_cache[key] = m_data.emplace(m_data.begin(), std::move(data)); // reinsert without copy and store iterator
-        return result;
+        for (const auto &item : clip->second) {
+            m_currentCost -= item.second->cost;
+            m_data.erase(item.second);
+        }
+        m_index.erase(clip);
     }
+
     void clear()
     {
+        QMutexLocker locker(&m_mutex);
         m_data.clear();
-        m_cache.clear();
+        m_index.clear();
         m_currentCost = 0;
     }
 
+    void addStatistics(Statistics &stats) const
+    {
+        QMutexLocker locker(&m_mutex);
+        stats.bytes += m_currentCost;
+        stats.count += int(m_data.size());
+    }
+
 protected:
-    int m_maxCost;
-    int m_currentCost{0};
+    struct Entry
+    {
+        QString binId;
+        int pos;
+        QImage image;
+        qint64 cost;
+    };
+    using Data = std::list<Entry>;
 
-    std::list<std::pair<QString, std::pair<QImage, int>>> m_data; // the data is stored as (key,(image, cost))
-    std::unordered_map<QString, decltype(m_data.begin())> m_cache;
+    Data::iterator find(const QString &binId, int pos)
+    {
+        auto clip = m_index.find(binId);
+        if (clip == m_index.end()) {
+            return m_data.end();
+        }
+        auto item = clip->second.find(pos);
+        return item == clip->second.end() ? m_data.end() : item->second;
+    }
+    Data::const_iterator find(const QString &binId, int pos) const { return const_cast<Shard *>(this)->find(binId, pos); }
+
+    // Drops an entry, along with its clip in the index if it was its last stored position
+    void remove(Data::iterator it)
+    {
+        if (it == m_data.end()) {
+            return;
+        }
+        auto clip = m_index.find(it->binId);
+        clip->second.erase(it->pos);
+        if (clip->second.empty()) {
+            m_index.erase(clip);
+        }
+        m_currentCost -= it->cost;
+        m_data.erase(it);
+    }
+
+    mutable QMutex m_mutex;
+    qint64 m_maxCost;
+    qint64 m_currentCost{0};
+
+    Data m_data; // most recently used first
+    std::unordered_map<QString, std::unordered_map<int, Data::iterator>> m_index;
 };
 
 ThumbnailCache::ThumbnailCache()
-    : m_volatileCache(new Cache_t(10000000))
+    : ThumbnailCache(qint64(KdenliveSettings::thumbnailcachesize()) * 1024 * 1024)
 {
 }
 
+ThumbnailCache::ThumbnailCache(qint64 maxBytes)
+{
+    for (auto &shard : m_shards) {
+        shard.reset(new Shard(maxBytes / ShardCount));
+    }
+}
+
 std::unique_ptr<ThumbnailCache> &ThumbnailCache::get()
 {
     std::call_once(m_onceFlag, [] { instance.reset(new ThumbnailCache()); });
     return instance;
 }
 
-bool ThumbnailCache::hasThumbnail(const QString &binId, int pos, bool volatileOnly) const
+ThumbnailCache::Shard &ThumbnailCache::shard(const QString &binId, int pos) const
+{
+    // Consecutive positions of a clip are spread over all the shards
+    const uint hash = qHash(binId) ^ (uint(pos) * 2654435761u);
+    return *m_shards[hash % ShardCount];
+}
+
+std::shared_ptr<ThumbnailPack> ThumbnailCache::getPack(const QString &binId, bool create) const
 {
-    QMutexLocker locker(&m_mutex);
     bool ok = false;
-    auto key = pos < 0 ? getAudioKey(binId, &ok) : getKey(binId, pos, &ok);
-    if (ok && m_volatileCache->contains(key)) {
+    const QString key = getPackKey(binId, &ok);
+    if (!ok) {
+        return nullptr;
+    }
+    QDir thumbFolder = getDir(false, &ok);
+    if (!ok) {
+        return nullptr;
+    }
+    const QString path = thumbFolder.absoluteFilePath(key);
+    QMutexLocker locker(&m_diskMutex);
+    // Two packs must never write to the same file, so wait if another thread is opening it
+    while (m_openingPacks.count(path) > 0) {
+        m_packOpened.wait(&m_diskMutex);
+    }
+    auto it = std::find_if(m_packs.begin(), m_packs.end(), [&binId](const PackEntry &entry) { return entry.binId == binId; });
+    if (it != m_packs.end()) {
+        // The clip hash changes when its file is modified
+        if (it->path == path && (it->pack || !create)) {
+            m_packs.splice(m_packs.begin(), m_packs, it);
+            return it->pack;
+        }
+        m_packs.erase(it);
+    }
+    // A pack dropped from the recently used ones may still be used by another thread
+    std::shared_ptr<ThumbnailPack> pack;
+    auto live = m_livePacks.find(path);
+    if (live != m_livePacks.end()) {
+        pack = live->second.lock();
+    }
+    if (!pack) {
+        // Open it without holding the lock, only the threads needing this pack have to wait
+        m_openingPacks.insert(path);
+        locker.unlock();
+        pack = openPack(thumbFolder, key, create);
+        locker.relock();
+        m_openingPacks.erase(path);
+        m_packOpened.wakeAll();
+        if (pack) {
+            m_livePacks[path] = pack;
+        }
+        m_packs.remove_if([&binId](const PackEntry &entry) { return entry.binId == binId; });
+    }
+    m_packs.push_front({binId, path, pack});
+    if (int(m_packs.size()) > MaxOpenPacks) {
+        m_packs.pop_back();
+        for (auto entry = m_livePacks.begin(); entry != m_livePacks.end();) {
+            if (entry->second.expired()) {
+                entry = m_livePacks.erase(entry);
+            } else {
+                ++entry;
+            }
+        }
+    }
+    return pack;
+}
+
+// static
+std::shared_ptr<ThumbnailPack> ThumbnailCache::openPack(const QDir &thumbFolder, const QString &key, bool create)
+{
+    const QString path = thumbFolder.absoluteFilePath(key);
+    const QStringList legacy = legacyThumbnails(thumbFolder, key);
+    if (!create && legacy.isEmpty() && !QFile::exists(path)) {
+        return nullptr;
+    }
+    std::shared_ptr<ThumbnailPack> pack = ThumbnailPack::open(path);
+    if (!pack || legacy.isEmpty()) {
+        return pack;
+    }
+    // Older versions stored one <clip hash>#<position>.png file per thumbnail, move them to the pack
+    std::vector<std::pair<int, QImage>> images;
+    QStringList imported;
+    for (int i = 0; i < legacy.size(); ++i) {
+        bool ok = false;
+        const int pos = legacy.at(i).section(QLatin1Char('#'), -1).section(QLatin1Char('.'), 0, 0).toInt(&ok);
+        if (ok && !pack->contains(pos)) {
+            QImage img(thumbFolder.absoluteFilePath(legacy.at(i)));
+            if (!img.isNull()) {
+                images.emplace_back(pos, img);
+            }
+        }
+        imported << legacy.at(i);
+        // Write by batches, not to keep all the images of a long clip in memory
+        if (images.size() >= 100 || i == legacy.size() - 1) {
+            if (!pack->append(images)) {
+                return pack;
+            }
+            images.clear();
+            for (const QString &file : imported) {
+                QFile::remove(thumbFolder.absoluteFilePath(file));
+            }
+            imported.clear();
+        }
+    }
+    return pack;
+}
+
+// static
+QStringList ThumbnailCache::legacyThumbnails(const QDir &thumbFolder, const QString &key)
+{
+    const QString hash = key.left(key.lastIndexOf(QLatin1Char('.')));
+    return thumbFolder.entryList({hash + QStringLiteral("#*.png")}, QDir::Files);
+}
+
+bool ThumbnailCache::hasThumbnail(const QString &binId, int pos, bool volatileOnly) const
+{
+    if (binId.isEmpty()) {
+        return false;
+    }
+    if (shard(binId, pos).contains(binId, pos)) {
         return true;
     }
-    if (!ok || volatileOnly) {
+    if (volatileOnly) {
         return false;
     }
-    QDir thumbFolder = getDir(pos < 0, &ok);
-    return ok && thumbFolder.exists(key);
+    bool ok = false;
+    if (pos < 0) {
+        auto key = getAudioKey(binId, &ok);
+        QDir thumbFolder = getDir(true, &ok);
+        return ok && thumbFolder.exists(key);
+    }
+    auto pack = getPack(binId, false);
+    return pack && pack->contains(pos);
 }
 
 QImage ThumbnailCache::getAudioThumbnail(const QString &binId, bool volatileOnly) const
 {
-    QMutexLocker locker(&m_mutex);
+    bool found = false;
+    QImage result = shard(binId, -1).get(binId, -1, &found);
+    if (found) {
+        m_hits++;
+        return result;
+    }
+    m_misses++;
+    if (volatileOnly) {
+        return QImage();
+    }
     bool ok = false;
     auto key = getAudioKey(binId, &ok);
-    if (ok && m_volatileCache->contains(key)) {
-        return m_volatileCache->get(key);
-    }
-    if (!ok || volatileOnly) {
+    if (!ok) {
         return QImage();
     }
     QDir thumbFolder = getDir(true, &ok);
     if (ok && thumbFolder.exists(key)) {
-        m_storedOnDisk[binId].push_back(-1);
+        m_diskMutex.lock();
+        m_audioStoredOnDisk.insert(binId);
+        m_diskMutex.unlock();
         return QImage(thumbFolder.absoluteFilePath(key));
     }
     return QImage();
@@ -142,7 +334,6 @@ QImage ThumbnailCache::getAudioThumbnail(const QString &binId, bool volatileOnly
 
 const QUrl ThumbnailCache::getAudioThumbPath(const QString &binId) const
 {
-    QMutexLocker locker(&m_mutex);
     bool ok = false;
     auto key = getAudioKey(binId, &ok);
     QDir thumbFolder = getDir(true, &ok);
@@ -154,118 +345,154 @@ const QUrl ThumbnailCache::getAudioThumbPath(const QString &binId) const
 
 QImage ThumbnailCache::getThumbnail(const QString &binId, int pos, bool volatileOnly) const
 {
-    QMutexLocker locker(&m_mutex);
-    bool ok = false;
-    auto key = getKey(binId, pos, &ok);
-    if (ok && m_volatileCache->contains(key)) {
-        return m_volatileCache->get(key);
+    if (binId.isEmpty()) {
+        return QImage();
     }
-    if (!ok || volatileOnly) {
+    bool found = false;
+    QImage result = shard(binId, pos).get(binId, pos, &found);
+    if (found) {
+        m_hits++;
+        return result;
+    }
+    m_misses++;
+    if (volatileOnly) {
         return QImage();
     }
-    QDir thumbFolder = getDir(false, &ok);
-    if (ok && thumbFolder.exists(key)) {
-        m_storedOnDisk[binId].push_back(pos);
-        return QImage(thumbFolder.absoluteFilePath(key));
+    auto pack = getPack(binId, false);
+    if (!pack) {
+        return QImage();
     }
-    return QImage();
+    result = pack->image(pos);
+    if (!result.isNull()) {
+        // Keep it in memory, decoding is much slower than a lookup
+        m_evictions += quint64(shard(binId, pos).insert(binId, pos, result));
+    }
+    return result;
 }
 
 void ThumbnailCache::storeThumbnail(const QString &binId, int pos, const QImage &img, bool persistent)
 {
-    QMutexLocker locker(&m_mutex);
-    bool ok = false;
-    const QString key = getKey(binId, pos, &ok);
-    if (!ok) {
+    if (binId.isEmpty()) {
         return;
     }
     if (persistent) {
-        QDir thumbFolder = getDir(false, &ok);
-        if (ok) {
-            if (!img.save(thumbFolder.absoluteFilePath(key))) {
-                qDebug() << ".............\nAAAAAAAAAAAARGH ERROR SAVING THUMB";
-            }
-            m_storedOnDisk[binId].push_back(pos);
-            // if volatile cache also contains this entry, update it
-            if (m_volatileCache->contains(key)) {
-                m_volatileCache->remove(key);
-            } else {
-                m_storedVolatile[binId].push_back(pos);
-            }
-            m_volatileCache->insert(key, img, (int)img.sizeInBytes());
+        auto pack = getPack(binId, true);
+        if (!pack) {
+            return;
+        }
+        if (!pack->append(pos, img)) {
+            qDebug() << ".............\nAAAAAAAAAAAARGH ERROR SAVING THUMB";
         }
-    } else {
-        m_volatileCache->insert(key, img, (int)img.sizeInBytes());
-        m_storedVolatile[binId].push_back(pos);
     }
+    m_evictions += quint64(shard(binId, pos).insert(binId, pos, img));
 }
 
-void ThumbnailCache::saveCachedThumbs(QStringList keys)
+void ThumbnailCache::storeThumbnails(const QString &binId, const std::vector<std::pair<int, QImage>> &images)
 {
-    bool ok;
-    QDir thumbFolder = getDir(false, &ok);
-    if (!ok) {
+    if (binId.isEmpty() || images.empty()) {
         return;
     }
-    for (const QString &key : keys) {
-        if (!thumbFolder.exists(key) && m_volatileCache->contains(key)) {
-            QImage img = m_volatileCache->get(key);
-            if (!img.save(thumbFolder.absoluteFilePath(key))) {
-                qDebug() << "// Error writing thumbnails to " << thumbFolder.absolutePath();
-                break;
-            }
+    auto pack = getPack(binId, true);
+    if (pack && !pack->append(images)) {
+        qDebug() << "// Error writing thumbnails to " << pack->path();
+    }
+}
+
+void ThumbnailCache::saveCachedThumbs(const std::vector<std::pair<QString, int>> &thumbs)
+{
+    // Group the thumbnails by clip, to write each pack once
+    std::unordered_map<QString, std::vector<std::pair<int, QImage>>> images;
+    std::unordered_map<QString, std::shared_ptr<ThumbnailPack>> packs;
+    for (const auto &thumb : thumbs) {
+        auto it = packs.find(thumb.first);
+        if (it == packs.end()) {
+            it = packs.emplace(thumb.first, getPack(thumb.first, true)).first;
+        }
+        if (!it->second || it->second->contains(thumb.second)) {
+            continue;
+        }
+        bool found = false;
+        QImage img = shard(thumb.first, thumb.second).get(thumb.first, thumb.second, &found);
+        if (found) {
+            images[thumb.first].emplace_back(thumb.second, img);
+        }
+    }
+    for (const auto &clip : images) {
+        if (!packs.at(clip.first)->append(clip.second)) {
+            qDebug() << "// Error writing thumbnails to " << packs.at(clip.first)->path();
+            break;
         }
     }
 }
 
 void ThumbnailCache::invalidateThumbsForClip(const QString &binId, bool reloadAudio)
 {
-    QMutexLocker locker(&m_mutex);
-    if (m_storedVolatile.find(binId) != m_storedVolatile.end()) {
-        bool ok = false;
-        for (int pos : m_storedVolatile.at(binId)) {
-            auto key = getKey(binId, pos, &ok);
-            if (ok) {
-                m_volatileCache->remove(key);
-            }
-        }
-        m_storedVolatile.erase(binId);
+    for (auto &shard : m_shards) {
+        shard->removeClip(binId);
     }
+    // Remove persistent cache. The pack is deleted without being opened, unless it is in use
     bool ok = false;
-    // Video thumbs
+    const QString key = getPackKey(binId, &ok);
     QDir thumbFolder = getDir(false, &ok);
-    QDir audioThumbFolder = getDir(true, &ok);
-    if (ok && m_storedOnDisk.find(binId) != m_storedOnDisk.end()) {
-        // Remove persistent cache
-        for (int pos : m_storedOnDisk.at(binId)) {
-            if (pos < 0) {
-                if (reloadAudio) {
-                    auto key = getAudioKey(binId, &ok);
-                    if (ok) {
-                        QFile::remove(audioThumbFolder.absoluteFilePath(key));
-                    }
-                }
-            } else {
-                auto key = getKey(binId, pos, &ok);
-                if (ok) {
-                    QFile::remove(thumbFolder.absoluteFilePath(key));
-                }
-            }
+    const QString path = ok && !key.isEmpty() ? thumbFolder.absoluteFilePath(key) : QString();
+    std::shared_ptr<ThumbnailPack> pack;
+    m_diskMutex.lock();
+    while (!path.isEmpty() && m_openingPacks.count(path) > 0) {
+        m_packOpened.wait(&m_diskMutex);
+    }
+    m_packs.remove_if([&binId](const PackEntry &entry) { return entry.binId == binId; });
+    auto live = m_livePacks.find(path);
+    if (live != m_livePacks.end()) {
+        pack = live->second.lock();
+        m_livePacks.erase(live);
+    }
+    const bool audioStored = m_audioStoredOnDisk.erase(binId) > 0;
+    m_diskMutex.unlock();
+    if (pack) {
+        // Other users of the pack cannot write to it anymore
+        pack->remove();
+    } else if (!path.isEmpty()) {
+        QFile::remove(path);
+    }
+    if (!path.isEmpty()) {
+        // Outdated thumbnails of older versions must not be imported later
+        for (const QString &file : legacyThumbnails(thumbFolder, key)) {
+            QFile::remove(thumbFolder.absoluteFilePath(file));
+        }
+    }
+    if (audioStored && reloadAudio) {
+        QDir audioThumbFolder = getDir(true, &ok);
+        auto audioKey = getAudioKey(binId, &ok);
+        if (ok) {
+            QFile::remove(audioThumbFolder.absoluteFilePath(audioKey));
         }
-        m_storedOnDisk.erase(binId);
     }
 }
 
 void ThumbnailCache::clearCache()
 {
-    QMutexLocker locker(&m_mutex);
-    m_volatileCache->clear();
-    m_storedVolatile.clear();
-    m_storedOnDisk.clear();
+    for (auto &shard : m_shards) {
+        shard->clear();
+    }
+    QMutexLocker locker(&m_diskMutex);
+    m_packs.clear();
+    m_audioStoredOnDisk.clear();
+}
+
+ThumbnailCache::Statistics ThumbnailCache::statistics() const
+{
+    Statistics stats;
+    stats.hits = m_hits;
+    stats.misses = m_misses;
+    stats.evictions = m_evictions;
+    for (const auto &shard : m_shards) {
+        shard->addStatistics(stats);
+    }
+    return stats;
 }
 
 // static
-QString ThumbnailCache::getKey(const QString &binId, int pos, bool *ok)
+QString ThumbnailCache::getPackKey(const QString &binId, bool *ok)
 {
     if (binId.isEmpty()) {
         *ok = false;
@@ -273,7 +500,7 @@ QString ThumbnailCache::getKey(const QString &binId, int pos, bool *ok)
     }
     auto binClip = pCore->projectItemModel()->getClipByBinID(binId);
     *ok = binClip != nullptr;
-    return *ok ? binClip->hash() + QLatin1Char('#') + QString::number(pos) + QStringLiteral(".png") : QString();
+    return *ok ? binClip->hash() + QStringLiteral(".thumbs") : QString();
 }
 
 // static
@@ -22,21 +22,31 @@
 #pragma once
 
 #include "definitions.h"
+#include "thumbnailpack.hpp"
 #include <QDir>
 #include <QUrl>
 #include <QImage>
 #include <QMutex>
+#include <QWaitCondition>
+#include <array>
+#include <atomic>
+#include <list>
 #include <memory>
 #include <mutex>
 #include <unordered_map>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
 /** @brief This class class is an interface to the caches that store thumbnails.
     In Kdenlive, we use two such caches, a persistent that is stored on disk to allow thumbnails to be reused when reopening.
+    The persistent cache of video thumbnails uses one pack file per clip (see ThumbnailPack) instead of one file per frame.
     The other one is a volatile LRU cache that lives in memory.
     Note that for the volatile cache uses a custom implementation.
     QCache is not suitable since it operates on pointers and since the object is removed from the cache when accessed.
     KImageCache is not suitable since it lacks a way to remove objects from the cache.
+    The volatile cache is split in shards, each with its own lock and its own share of the memory budget, so that
+    the thumbnail jobs and the timeline can query it concurrently. Thumbnails are keyed by (binId, position).
  * Note that this class is a Singleton
  */
 
@@ -44,6 +54,16 @@ class ThumbnailCache
 {
 
 public:
+    /** @brief Activity counters of the volatile cache */
+    struct Statistics
+    {
+        quint64 hits{0};
+        quint64 misses{0};
+        quint64 evictions{0};
+        qint64 bytes{0};
+        int count{0};
+    };
+
     // Returns the instance of the Singleton
     static std::unique_ptr<ThumbnailCache> &get();
 
@@ -70,21 +90,34 @@ public:
     */
     void storeThumbnail(const QString &binId, int pos, const QImage &img, bool persistent = false);
 
+    /* @brief Store several thumbnails of a clip in the persistent cache, with a single disk write
+       @param binId is the id of the clip
+       @param images is a list of (position, image) pairs
+    */
+    void storeThumbnails(const QString &binId, const std::vector<std::pair<int, QImage>> &images);
+
     /* @brief Removes all the thumbnails for a given clip */
     void invalidateThumbsForClip(const QString &binId, bool reloadAudio);
 
-    /* @brief Save all cached thumbs to disk */
-    void saveCachedThumbs(QStringList keys);
+    /* @brief Save cached thumbs to disk
+       @param thumbs is a list of (binId, position) pairs
+    */
+    void saveCachedThumbs(const std::vector<std::pair<QString, int>> &thumbs);
 
     /* @brief Reset cache (discarding all thumbs stored in memory) */
     void clearCache();
 
+    /* @brief Returns the hit, miss and eviction counters of the volatile cache, and its current content */
+    Statistics statistics() const;
+
 protected:
     // Constructor is protected because class is a Singleton
     ThumbnailCache();
+    // Builds a cache holding at most maxBytes of images in memory
+    explicit ThumbnailCache(qint64 maxBytes);
 
-    // Return the key associated to a thumbnail
-    static QString getKey(const QString &binId, int pos, bool *ok);
+    // Return the file name of the thumbnail pack of a clip
+    static QString getPackKey(const QString &binId, bool *ok);
     static QString getAudioKey(const QString &binId, bool *ok);
 
     // Return the dir where the persistent cache lives
@@ -93,12 +126,45 @@ protected:
     static std::unique_ptr<ThumbnailCache> instance;
     static std::once_flag m_onceFlag; // flag to create the repository only once;
 
-    class Cache_t;
-    std::unique_ptr<Cache_t> m_volatileCache;
-    mutable QMutex m_mutex;
+    static const int ShardCount = 16;
+    class Shard;
+    // Returns the shard of the volatile cache storing a given thumbnail. Audio thumbnails use position -1
+    Shard &shard(const QString &binId, int pos) const;
+    std::array<std::unique_ptr<Shard>, ShardCount> m_shards;
+
+    mutable std::atomic<quint64> m_hits{0};
+    mutable std::atomic<quint64> m_misses{0};
+    mutable std::atomic<quint64> m_evictions{0};
 
-    // the following maps keeps track of the positions that we store for each clip in volatile caches.
-    // Note that we don't track deletions due to items dropped from the cache. So the maps can contain more items that are currently stored.
-    std::unordered_map<QString, std::vector<int>> m_storedVolatile;
-    mutable std::unordered_map<QString, std::vector<int>> m_storedOnDisk;
+    // Maximum number of thumbnail packs kept open
+    static const int MaxOpenPacks = 32;
+    /* @brief Returns the thumbnail pack of a clip, nullptr if it cannot be opened
+       @param create if false, returns nullptr when the clip has no pack on disk yet
+    */
+    std::shared_ptr<ThumbnailPack> getPack(const QString &binId, bool create) const;
+    /* @brief Opens the pack file key of thumbFolder, importing the thumbnails stored in separate files by older versions
+       @param create if false, returns nullptr when there is neither a pack nor older thumbnails
+    */
+    static std::shared_ptr<ThumbnailPack> openPack(const QDir &thumbFolder, const QString &key, bool create);
+    // Returns the thumbnail files of older versions for the clip of a pack file
+    static QStringList legacyThumbnails(const QDir &thumbFolder, const QString &key);
+
+    // The following members are protected by m_diskMutex, which is never held during disk accesses
+    mutable QMutex m_diskMutex;
+    // Signaled when a pack has been opened
+    mutable QWaitCondition m_packOpened;
+    // Paths of the packs being opened
+    mutable std::unordered_set<QString> m_openingPacks;
+    // All the packs in use, by path, so that a pack dropped from m_packs is not opened twice
+    mutable std::unordered_map<QString, std::weak_ptr<ThumbnailPack>> m_livePacks;
+    // Recently used packs, first is the most recent. A null pack means that the clip has no pack on disk
+    struct PackEntry
+    {
+        QString binId;
+        QString path;
+        std::shared_ptr<ThumbnailPack> pack;
+    };
+    mutable std::list<PackEntry> m_packs;
+    // Clips for which we read an audio thumbnail from the persistent cache
+    mutable std::unordered_set<QString> m_audioStoredOnDisk;
 };
@@ -0,0 +1,226 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by the Kdenlive developers                         *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include "thumbnailpack.hpp"
+
+#include <QBuffer>
+#include <QDebug>
+#include <QMutexLocker>
+#include <QtEndian>
+#include <cstring>
+
+namespace {
+const char packMagic[4] = {'K', 'D', 'T', 'P'};
+const int headerSize = 16;
+const int recordHeaderSize = 8;
+// Thumbnails are small, anything bigger is a corrupted size
+const quint32 maxImageSize = 64 * 1024 * 1024;
+
+QByteArray encode(const QImage &img)
+{
+    QByteArray data;
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::WriteOnly);
+    if (img.hasAlphaChannel()) {
+        img.save(&buffer, "PNG");
+    } else {
+        img.save(&buffer, "JPG", 90);
+    }
+    return data;
+}
+} // namespace
+
+ThumbnailPack::ThumbnailPack(const QString &path)
+    : m_file(path)
+{
+}
+
+ThumbnailPack::~ThumbnailPack()
+{
+    if (m_map != nullptr) {
+        m_file.unmap(m_map);
+    }
+}
+
+std::unique_ptr<ThumbnailPack> ThumbnailPack::open(const QString &path)
+{
+    std::unique_ptr<ThumbnailPack> pack(new ThumbnailPack(path));
+    if (!pack->m_file.open(QIODevice::ReadWrite) || !pack->scan()) {
+        qDebug() << "Cannot open thumbnail pack" << path;
+        return nullptr;
+    }
+    pack->remap();
+    return pack;
+}
+
+bool ThumbnailPack::scan()
+{
+    const qint64 size = m_file.size();
+    char header[headerSize] = {};
+    if (size < headerSize || m_file.read(header, headerSize) != headerSize || memcmp(header, packMagic, 4) != 0 ||
+        qFromLittleEndian<quint32>(header + 4) != FormatVersion) {
+        // Empty, invalid or older pack: start a new one
+        memset(header, 0, headerSize);
+        memcpy(header, packMagic, 4);
+        qToLittleEndian<quint32>(FormatVersion, header + 4);
+        if (!m_file.resize(0) || !m_file.seek(0) || m_file.write(header, headerSize) != headerSize || !m_file.flush()) {
+            return false;
+        }
+        m_end = headerSize;
+        return true;
+    }
+    uchar *map = size > 0 ? m_file.map(0, size) : nullptr;
+    if (map == nullptr) {
+        return false;
+    }
+    qint64 offset = headerSize;
+    while (offset + recordHeaderSize <= size) {
+        const int pos = qFromLittleEndian<qint32>(map + offset);
+        const quint32 length = qFromLittleEndian<quint32>(map + offset + 4);
+        if (length > maxImageSize || offset + recordHeaderSize + length > size) {
+            break;
+        }
+        m_index[pos] = {offset + recordHeaderSize, length};
+        offset += recordHeaderSize + length;
+    }
+    m_file.unmap(map);
+    m_end = offset;
+    if (m_end < size) {
+        qDebug() << "Dropping truncated record of thumbnail pack" << m_file.fileName();
+        return m_file.resize(m_end);
+    }
+    return true;
+}
+
+void ThumbnailPack::remap()
+{
+    if (m_map != nullptr) {
+        m_file.unmap(m_map);
+        m_map = nullptr;
+        m_mapSize = 0;
+    }
+    if (m_end > headerSize) {
+        m_map = m_file.map(0, m_end);
+        m_mapSize = m_map != nullptr ? m_end : 0;
+    }
+}
+
+const QString ThumbnailPack::path() const
+{
+    return m_file.fileName();
+}
+
+bool ThumbnailPack::contains(int pos) const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_index.count(pos) > 0;
+}
+
+std::vector<int> ThumbnailPack::positions() const
+{
+    QMutexLocker locker(&m_mutex);
+    std::vector<int> result;
+    result.reserve(m_index.size());
+    for (const auto &record : m_index) {
+        result.push_back(record.first);
+    }
+    return result;
+}
+
+QImage ThumbnailPack::image(int pos) const
+{
+    QByteArray data;
+    {
+        QMutexLocker locker(&m_mutex);
+        auto it = m_index.find(pos);
+        if (it == m_index.end()) {
+            return QImage();
+        }
+        const qint64 offset = it->second.first;
+        const int length = int(it->second.second);
+        if (offset + length <= m_mapSize) {
+            data = QByteArray(reinterpret_cast<const char *>(m_map + offset), length);
+        } else {
+            // The mapping failed, read the file instead
+            if (m_file.seek(offset)) {
+                data = m_file.read(length);
+            }
+        }
+    }
+    // Decoding is the slow part, do it without holding the lock
+    return QImage::fromData(data);
+}
+
+bool ThumbnailPack::append(const std::vector<std::pair<int, QImage>> &images)
+{
+    QByteArray records;
+    std::vector<std::pair<int, qint64>> offsets;
+    for (const auto &image : images) {
+        if (image.second.isNull()) {
+            continue;
+        }
+        const QByteArray data = encode(image.second);
+        char header[recordHeaderSize];
+        qToLittleEndian<qint32>(image.first, header);
+        qToLittleEndian<quint32>(quint32(data.size()), header + 4);
+        records.append(header, recordHeaderSize);
+        offsets.emplace_back(image.first, records.size());
+        records.append(data);
+    }
+    if (records.isEmpty()) {
+        return true;
+    }
+    QMutexLocker locker(&m_mutex);
+    if (!m_file.isOpen()) {
+        return false;
+    }
+    if (!m_file.seek(m_end) || m_file.write(records) != records.size() || !m_file.flush()) {
+        qDebug() << "Error writing thumbnail pack" << m_file.fileName();
+        // Drop the partial write so that the next records stay readable
+        m_file.resize(m_end);
+        return false;
+    }
+    for (size_t i = 0; i < offsets.size(); ++i) {
+        const qint64 next = i + 1 < offsets.size() ? offsets[i + 1].second - recordHeaderSize : records.size();
+        m_index[offsets[i].first] = {m_end + offsets[i].second, quint32(next - offsets[i].second)};
+    }
+    m_end += records.size();
+    remap();
+    return true;
+}
+
+bool ThumbnailPack::append(int pos, const QImage &img)
+{
+    return append(std::vector<std::pair<int, QImage>>{{pos, img}});
+}
+
+void ThumbnailPack::remove()
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_map != nullptr) {
+        m_file.unmap(m_map);
+        m_map = nullptr;
+        m_mapSize = 0;
+    }
+    m_index.clear();
+    m_end = 0;
+    m_file.remove();
+}
@@ -0,0 +1,85 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by the Kdenlive developers                         *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#pragma once
+
+#include <QFile>
+#include <QImage>
+#include <QMutex>
+#include <QString>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/** @brief This class stores all the persistent thumbnails of a clip in a single file.
+    The pack file is a small header followed by records appended one after the other:
+      header: char[4] magic "KDTP", quint32 version, quint32[2] reserved
+      record: qint32 frame position, quint32 data size, encoded image (JPEG, or PNG for images with transparency)
+    all values in little endian. The record headers form the index of the pack, they are scanned once
+    when opening it. A position stored several times resolves to its last record.
+    The file is memory-mapped for reading, and a truncated last record (for example after a crash) is dropped.
+    All methods are thread safe.
+ */
+class ThumbnailPack
+{
+public:
+    /** Version of the pack file format, bump it when changing the layout */
+    static const quint32 FormatVersion = 1;
+
+    ~ThumbnailPack();
+
+    /* @brief Opens the pack at path, creating it if needed. Returns nullptr if the file cannot be opened
+       Files that are not valid packs of the current version are reset */
+    static std::unique_ptr<ThumbnailPack> open(const QString &path);
+
+    const QString path() const;
+    bool contains(int pos) const;
+    /* @brief Returns the stored positions, in no particular order */
+    std::vector<int> positions() const;
+    /* @brief Decodes the thumbnail stored at pos, returns a null image if there is none */
+    QImage image(int pos) const;
+
+    /* @brief Appends thumbnails to the pack, with a single write to the disk
+       @param images is a list of (position, image) pairs
+    */
+    bool append(const std::vector<std::pair<int, QImage>> &images);
+    bool append(int pos, const QImage &img);
+
+    /* @brief Deletes the pack file. The pack is empty and cannot be used anymore afterwards */
+    void remove();
+
+protected:
+    explicit ThumbnailPack(const QString &path);
+    // Reads the header and the record index, truncating what follows the last valid record
+    bool scan();
+    // Maps the current content of the file
+    void remap();
+
+    mutable QMutex m_mutex;
+    mutable QFile m_file;
+    uchar *m_map{nullptr};
+    qint64 m_mapSize{0};
+    // End of the last valid record, where the next one is appended
+    qint64 m_end{0};
+    // position -> (offset of the encoded image, size)
+    std::unordered_map<int, std::pair<qint64, quint32>> m_index;
+};
@@ -0,0 +1,170 @@
+#include "catch.hpp"
+#include "core.h"
+#include "effects/effectsrepository.hpp"
+#include <QDir>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <atomic>
+#include <utility>
+#include <mlt++/MltRepository.h>
+
+namespace {
+// Effects repository reading a few MLT filters and the custom effects of a given folder, counting the parsing done
+class TestRepository : public AbstractAssetsRepository<EffectType>
+{
+public:
+    TestRepository(const QString &dir, const QString &cache, QStringList services = {QStringLiteral("volume"), QStringLiteral("brightness"), QStringLiteral("sepia")})
+        : m_dir(dir)
+        , m_cache(cache)
+        , m_services(std::move(services))
+    {
+        init();
+    }
+
+    mutable std::atomic<int> metadataQueries{0};
+    mutable std::atomic<int> parsedFiles{0};
+
+protected:
+    Mlt::Properties *retrieveListFromMlt() const override
+    {
+        auto *list = new Mlt::Properties();
+        for (const QString &name : m_services) {
+            list->set(name.toUtf8().constData(), 1);
+        }
+        return list;
+    }
+
+    Mlt::Properties *getMetadata(const QString &assetId) const override
+    {
+        metadataQueries++;
+        return pCore->getMltRepository()->metadata(filter_type, assetId.toLatin1().data());
+    }
+
+    void parseCustomAssetFile(const QString &file_name, std::unordered_map<QString, Info> &customAssets) const override
+    {
+        parsedFiles++;
+        QFile file(file_name);
+        QDomDocument doc;
+        doc.setContent(&file, false);
+        QDomNodeList effects = doc.elementsByTagName(QStringLiteral("effect"));
+        for (int i = 0; i < effects.count(); ++i) {
+            Info result;
+            if (parseInfoFromXml(effects.item(i).toElement(), result)) {
+                result.xml = effects.item(i).toElement();
+                result.type = EffectType::Custom;
+                customAssets[result.id] = result;
+            }
+        }
+    }
+
+    void parseType(QScopedPointer<Mlt::Properties> &, Info &res) override { res.type = EffectType::Video; }
+    QStringList assetDirs() const override { return {m_dir}; }
+    QString assetBlackListPath() const override { return QString(); }
+    QString assetPreferredListPath() const override { return QString(); }
+    QString assetCachePath() const override { return m_cache; }
+
+private:
+    QString m_dir;
+    QString m_cache;
+    QStringList m_services;
+};
+
+void writeEffect(const QString &path, const QString &tag, const QString &id, const QString &name)
+{
+    QFile file(path);
+    REQUIRE(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    QTextStream stream(&file);
+    stream << QStringLiteral("<effect tag=\"%1\" id=\"%2\"><name>%3</name></effect>").arg(tag, id, name);
+}
+
+QString xmlString(const QDomElement &element)
+{
+    QString result;
+    QTextStream stream(&result);
+    element.save(stream, 0);
+    stream.flush();
+    return result;
+}
+} // namespace
+
+TEST_CASE("Assets cache", "[Assets]")
+{
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+    const QString assetDir = dir.filePath(QStringLiteral("effects"));
+    REQUIRE(QDir().mkpath(assetDir));
+    const QString cache = dir.filePath(QStringLiteral("effects.cache"));
+    writeEffect(QDir(assetDir).filePath(QStringLiteral("loud.xml")), QStringLiteral("volume"), QStringLiteral("loud"), QStringLiteral("Loud"));
+    writeEffect(QDir(assetDir).filePath(QStringLiteral("old.xml")), QStringLiteral("sepia"), QStringLiteral("old"), QStringLiteral("Old"));
+
+    // The first start parses everything and creates the cache
+    TestRepository first(assetDir, cache);
+    REQUIRE(first.metadataQueries == 3);
+    REQUIRE(first.parsedFiles == 2);
+    REQUIRE(first.initStats().mltParsed == 3);
+    REQUIRE(first.initStats().filesParsed == 2);
+    REQUIRE(first.exists(QStringLiteral("brightness")));
+    REQUIRE(first.getName(QStringLiteral("loud")) == QStringLiteral("Loud"));
+    REQUIRE(QFile::exists(cache));
+
+    // The next start only reads the cache, and gives the same assets
+    TestRepository second(assetDir, cache);
+    REQUIRE(second.metadataQueries == 0);
+    REQUIRE(second.parsedFiles == 0);
+    REQUIRE(second.initStats().mltCached == 3);
+    REQUIRE(second.initStats().filesCached == 2);
+    REQUIRE(second.getNames() == first.getNames());
+    for (const QString &id : {QStringLiteral("volume"), QStringLiteral("brightness"), QStringLiteral("sepia"), QStringLiteral("loud"), QStringLiteral("old")}) {
+        REQUIRE(second.getType(id) == first.getType(id));
+        REQUIRE(second.getDescription(id) == first.getDescription(id));
+        REQUIRE(xmlString(second.getXml(id)) == xmlString(first.getXml(id)));
+    }
+    REQUIRE(second.getType(QStringLiteral("old")) == EffectType::Custom);
+
+    SECTION("Modified custom files are parsed again")
+    {
+        writeEffect(QDir(assetDir).filePath(QStringLiteral("old.xml")), QStringLiteral("sepia"), QStringLiteral("old"), QStringLiteral("Very old"));
+        TestRepository repository(assetDir, cache);
+        REQUIRE(repository.metadataQueries == 0);
+        REQUIRE(repository.parsedFiles == 1);
+        REQUIRE(repository.getName(QStringLiteral("old")) == QStringLiteral("Very old"));
+        REQUIRE(repository.getName(QStringLiteral("loud")) == QStringLiteral("Loud"));
+    }
+
+    SECTION("Removed custom files are dropped")
+    {
+        REQUIRE(QFile::remove(QDir(assetDir).filePath(QStringLiteral("loud.xml"))));
+        TestRepository repository(assetDir, cache);
+        REQUIRE(repository.parsedFiles == 0);
+        REQUIRE_FALSE(repository.exists(QStringLiteral("loud")));
+        REQUIRE(repository.exists(QStringLiteral("old")));
+    }
+
+    SECTION("Custom files are parsed again when the MLT assets change")
+    {
+        TestRepository withoutSepia(assetDir, cache, {QStringLiteral("volume"), QStringLiteral("brightness")});
+        REQUIRE(withoutSepia.metadataQueries == 0);
+        REQUIRE(withoutSepia.parsedFiles == 2);
+        REQUIRE_FALSE(withoutSepia.exists(QStringLiteral("old")));
+        REQUIRE(withoutSepia.exists(QStringLiteral("loud")));
+
+        // The file depending on sepia was cached without assets, it must be parsed when sepia is back
+        TestRepository withSepia(assetDir, cache);
+        REQUIRE(withSepia.metadataQueries == 1);
+        REQUIRE(withSepia.parsedFiles == 2);
+        REQUIRE(withSepia.getName(QStringLiteral("old")) == QStringLiteral("Old"));
+    }
+
+    SECTION("A corrupted cache is ignored")
+    {
+        QFile file(cache);
+        REQUIRE(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+        file.write("garbage");
+        file.close();
+        TestRepository repository(assetDir, cache);
+        REQUIRE(repository.metadataQueries == 3);
+        REQUIRE(repository.parsedFiles == 2);
+        REQUIRE(repository.getName(QStringLiteral("old")) == QStringLiteral("Old"));
+    }
+}
@@ -0,0 +1,103 @@
+#include "catch.hpp"
+#include "lib/audio/audioCorrelation.h"
+#include "lib/audio/audioCorrelationInfo.h"
+#include "lib/audio/fftCorrelation.h"
+#include <QtConcurrent>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <random>
+#include <vector>
+
+namespace {
+// Synthetic envelope, one positive value per frame like the sums of absolute samples
+std::vector<qint64> randomEnvelope(size_t size, unsigned seed)
+{
+    std::default_random_engine gen(seed);
+    std::uniform_int_distribution<qint64> dist(0, 1000);
+    std::vector<qint64> envelope(size);
+    for (qint64 &value : envelope) {
+        value = dist(gen);
+    }
+    return envelope;
+}
+
+// Part of the main envelope starting at shift, padded with other data where it does not overlap the main envelope
+std::vector<qint64> shiftedEnvelope(const std::vector<qint64> &main, int shift, size_t size)
+{
+    std::vector<qint64> envelope = randomEnvelope(size, unsigned(shift + 1000));
+    for (size_t i = 0; i < size; ++i) {
+        int pos = shift + int(i);
+        if (pos >= 0 && pos < int(main.size())) {
+            envelope[i] = main[size_t(pos)];
+        }
+    }
+    return envelope;
+}
+
+// Shift found by the correlation, as computed by AudioCorrelation::getShift
+int correlationShift(const AudioCorrelationInfo &info, size_t subSize)
+{
+    return int(info.maxIndex()) - int(subSize);
+}
+} // namespace
+
+TEST_CASE("Audio envelopes correlation", "[AudioCorrelation]")
+{
+    const std::vector<qint64> main = randomEnvelope(20000, 42);
+    FFTCorrelation::Reference reference(main.data(), main.size());
+    REQUIRE(reference.size() == main.size());
+
+    SECTION("Shifted envelopes are found")
+    {
+        for (int shift : {0, 1234, 7000, 18000, -100}) {
+            const size_t size = 1500;
+            const std::vector<qint64> sub = shiftedEnvelope(main, shift, size);
+            AudioCorrelationInfo info(main.size(), size);
+            reference.correlate(sub.data(), size, info.correlationVector());
+            REQUIRE(correlationShift(info, size) == shift);
+        }
+    }
+
+    SECTION("Cached reference gives the same result as a single correlation")
+    {
+        for (size_t size : {300, 5000, 30000}) {
+            const std::vector<qint64> sub = shiftedEnvelope(main, 250, size);
+            std::vector<float> expected(main.size() + size + 1);
+            std::vector<float> result(main.size() + size + 1);
+            FFTCorrelation::correlate(main.data(), main.size(), sub.data(), size, expected.data());
+            reference.correlate(sub.data(), size, result.data());
+            const float peak = *std::max_element(expected.begin(), expected.end());
+            for (size_t i = 0; i < expected.size(); ++i) {
+                REQUIRE(std::abs(result[i] - expected[i]) <= 1e-4f * peak);
+            }
+        }
+    }
+
+    SECTION("Many children can be correlated in parallel")
+    {
+        QList<int> shifts;
+        for (int i = 0; i < 40; ++i) {
+            shifts << i * 400 - 200;
+        }
+        // Children of different lengths use different FFT sizes
+        std::function<int(int)> align = [&main, &reference](int shift) {
+            const size_t size = 800 + size_t(qAbs(shift) % 3) * 2000;
+            const std::vector<qint64> sub = shiftedEnvelope(main, shift, size);
+            AudioCorrelationInfo info(main.size(), size);
+            reference.correlate(sub.data(), size, info.correlationVector());
+            return correlationShift(info, size);
+        };
+        const QList<int> found = QtConcurrent::blockingMapped<QList<int>>(shifts, align);
+        REQUIRE(found == shifts);
+    }
+
+    SECTION("Short envelopes use the direct correlation")
+    {
+        const size_t size = 150;
+        const std::vector<qint64> sub = shiftedEnvelope(main, 4321, size);
+        AudioCorrelationInfo info(main.size(), size);
+        AudioCorrelation::correlate(main.data(), main.size(), sub.data(), size, info.correlationVector());
+        REQUIRE(correlationShift(info, size) == 4321);
+    }
+}
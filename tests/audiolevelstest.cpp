@@ -0,0 +1,230 @@
+#include "catch.hpp"
+#include "lib/audio/audioLevels.h"
+#include <QImage>
+#include <QTemporaryDir>
+#include <QThread>
+#include <QtConcurrent>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+
+namespace {
+// Build the image used by older versions to cache the levels: 4 values packed in each pixel, column by column
+QImage legacyImage(const QVector<double> &levels, int channels)
+{
+    int count = levels.size();
+    QImage image((int)lrint((count + 3) / 4.0 / channels), channels, QImage::Format_ARGB32);
+    int n = image.width() * image.height();
+    for (int i = 0; i < n; i++) {
+        int last = (int)levels.last();
+        int r = (4 * i + 0) < count ? (int)levels.at(4 * i + 0) : last;
+        int g = (4 * i + 1) < count ? (int)levels.at(4 * i + 1) : last;
+        int b = (4 * i + 2) < count ? (int)levels.at(4 * i + 2) : last;
+        int a = (4 * i + 3) < count ? (int)levels.at(4 * i + 3) : last;
+        image.setPixel(i / channels, i % channels, qRgba(r, g, b, a));
+    }
+    return image;
+}
+
+QVector<double> randomLevels(int frames, int channels)
+{
+    std::default_random_engine gen(42);
+    std::uniform_int_distribution<int> dist(0, 255);
+    QVector<double> levels(frames * channels);
+    for (double &level : levels) {
+        level = dist(gen);
+    }
+    return levels;
+}
+} // namespace
+
+TEST_CASE("Audio levels cache", "[AudioLevels]")
+{
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+    const QString path = dir.filePath(QStringLiteral("levels"));
+    const int channels = 2;
+    const int frames = 1001;
+    QVector<double> levels = randomLevels(frames, channels);
+
+    SECTION("Zoom pyramid")
+    {
+        auto data = AudioLevels::fromLevels(levels, channels);
+        REQUIRE(data);
+        REQUIRE(data->channels() == channels);
+        REQUIRE(data->frames() == frames);
+        REQUIRE(data->frames(1) == (frames + 1) / 2);
+        REQUIRE(data->frames(data->zoomLevels() - 1) == 1);
+        for (int zoom = 1; zoom < data->zoomLevels(); zoom++) {
+            for (int i = 0; i < data->frames(zoom); i++) {
+                for (int c = 0; c < channels; c++) {
+                    quint8 expected = data->level(2 * i, c, zoom - 1);
+                    if (2 * i + 1 < data->frames(zoom - 1)) {
+                        expected = std::max(expected, data->level(2 * i + 1, c, zoom - 1));
+                    }
+                    REQUIRE(data->level(i, c, zoom) == expected);
+                }
+            }
+        }
+        REQUIRE(data->zoomForScale(0.5) == 0);
+        REQUIRE(data->zoomForScale(1) == 0);
+        REQUIRE(data->zoomForScale(3) == 1);
+        REQUIRE(data->zoomForScale(4) == 2);
+        REQUIRE(data->zoomForScale(1e9) == data->zoomLevels() - 1);
+    }
+
+    SECTION("Save and map")
+    {
+        auto data = AudioLevels::fromLevels(levels, channels);
+        REQUIRE(data->save(path));
+        auto loaded = AudioLevels::load(path);
+        REQUIRE(loaded);
+        REQUIRE(loaded->channels() == channels);
+        REQUIRE(loaded->zoomLevels() == data->zoomLevels());
+        for (int zoom = 0; zoom < data->zoomLevels(); zoom++) {
+            REQUIRE(loaded->frames(zoom) == data->frames(zoom));
+            REQUIRE(memcmp(loaded->data(zoom), data->data(zoom), size_t(data->frames(zoom) * channels)) == 0);
+        }
+        // Out of range values
+        REQUIRE(loaded->level(-1, 0) == 0);
+        REQUIRE(loaded->level(frames, 0) == 0);
+        REQUIRE(loaded->level(0, channels) == 0);
+    }
+
+    SECTION("Mapped files can be removed and rewritten")
+    {
+        auto data = AudioLevels::fromLevels(levels, channels);
+        REQUIRE(data->save(path));
+        auto first = AudioLevels::load(path);
+        auto second = AudioLevels::load(path);
+        REQUIRE(first);
+        REQUIRE(second);
+
+        // Rewriting the file keeps the existing levels valid, with their previous content
+        QVector<double> other = levels;
+        std::reverse(other.begin(), other.end());
+        REQUIRE(AudioLevels::fromLevels(other, channels)->save(path));
+        REQUIRE(memcmp(first->data(), data->data(), size_t(frames * channels)) == 0);
+        REQUIRE(AudioLevels::load(path)->level(0, 0) == quint8(other.at(0)));
+
+        AudioLevels::releaseMappings(path);
+        REQUIRE(QFile::remove(path));
+        REQUIRE_FALSE(AudioLevels::load(path));
+        for (int zoom = 0; zoom < data->zoomLevels(); zoom++) {
+            REQUIRE(memcmp(second->data(zoom), data->data(zoom), size_t(data->frames(zoom) * channels)) == 0);
+        }
+    }
+
+    SECTION("Mapped files are rewritten after the readers are done")
+    {
+        REQUIRE(AudioLevels::fromLevels(levels, channels)->save(path));
+        auto mapped = AudioLevels::load(path);
+        REQUIRE(mapped);
+        std::atomic<bool> saved{false};
+        QFuture<void> writer;
+        {
+            QReadLocker lock(&mapped->dataLock());
+            const quint8 *values = mapped->data();
+            writer = QtConcurrent::run([&]() { saved = AudioLevels::fromLevels(levels, channels)->save(path); });
+            QThread::msleep(100);
+            REQUIRE_FALSE(saved);
+            REQUIRE(values[0] == quint8(levels.at(0)));
+        }
+        writer.waitForFinished();
+        REQUIRE(saved);
+        REQUIRE(mapped->level(0, 0) == quint8(levels.at(0)));
+    }
+
+    SECTION("Invalid files are rejected")
+    {
+        REQUIRE_FALSE(AudioLevels::load(dir.filePath(QStringLiteral("missing"))));
+        QFile file(path);
+        REQUIRE(file.open(QIODevice::WriteOnly));
+        file.write(QByteArray(64, 'x'));
+        file.close();
+        REQUIRE_FALSE(AudioLevels::load(path));
+
+        // File from a previous format version
+        REQUIRE(AudioLevels::fromLevels(levels, channels)->save(path));
+        REQUIRE(file.open(QIODevice::ReadWrite));
+        file.seek(4);
+        const char previousVersion[4] = {char(AudioLevels::FormatVersion - 1), 0, 0, 0};
+        file.write(previousVersion, 4);
+        file.close();
+        REQUIRE_FALSE(AudioLevels::load(path));
+
+        // Truncated file
+        REQUIRE(AudioLevels::fromLevels(levels, channels)->save(path));
+        REQUIRE(file.resize(file.size() - 1));
+        REQUIRE_FALSE(AudioLevels::load(path));
+    }
+
+    SECTION("Migration from legacy image")
+    {
+        auto data = AudioLevels::fromLegacyImage(legacyImage(levels, channels), channels);
+        REQUIRE(data);
+        REQUIRE(data->frames() >= frames);
+        for (int i = 0; i < frames; i++) {
+            for (int c = 0; c < channels; c++) {
+                REQUIRE(data->level(i, c) == quint8(levels.at(i * channels + c)));
+            }
+        }
+    }
+}
+
+TEST_CASE("Audio peaks reduction", "[AudioLevels]")
+{
+    std::default_random_engine gen(42);
+    std::uniform_int_distribution<int> dist(-32768, 32767);
+    for (int channels : {1, 2, 3, 5, 6, 8, 10}) {
+        for (int frames : {0, 1, 7, 8, 9, 100, 1001}) {
+            std::vector<qint16> samples(size_t(frames * channels));
+            for (auto &sample : samples) {
+                sample = qint16(dist(gen));
+            }
+            if (!samples.empty()) {
+                samples[samples.size() / 2] = -32768;
+            }
+            std::vector<int> expected(size_t(channels), 0);
+            for (size_t i = 0; i < samples.size(); i++) {
+                expected[i % size_t(channels)] = std::max(expected[i % size_t(channels)], std::abs(int(samples[i])));
+            }
+            std::vector<int> peaks(size_t(channels), 0);
+            AudioLevels::accumulatePeaks(samples.data(), frames, channels, peaks.data());
+            REQUIRE(peaks == expected);
+        }
+    }
+}
+
+TEST_CASE("Audio levels loading benchmark", "[.][AudioLevels][benchmark]")
+{
+    // Levels of a 2 hours stereo clip at 25 fps
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+    const int channels = 2;
+    QVector<double> levels = randomLevels(2 * 3600 * 25, channels);
+    const QString imagePath = dir.filePath(QStringLiteral("levels.png"));
+    const QString path = dir.filePath(QStringLiteral("levels"));
+    REQUIRE(legacyImage(levels, channels).save(imagePath));
+    REQUIRE(AudioLevels::fromLevels(levels, channels)->save(path));
+
+    BENCHMARK("Legacy image cache")
+    {
+        QImage image(imagePath);
+        QVector<double> result;
+        int n = image.width() * image.height();
+        for (int i = 0; i < n; i++) {
+            QRgb p = image.pixel(i / channels, i % channels);
+            result << qRed(p) << qGreen(p) << qBlue(p) << qAlpha(p);
+        }
+        REQUIRE(result.size() >= levels.size());
+    }
+
+    BENCHMARK("Mapped levels cache")
+    {
+        auto data = AudioLevels::load(path);
+        REQUIRE(data);
+    }
+}
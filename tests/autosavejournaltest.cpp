@@ -0,0 +1,135 @@
+#include "catch.hpp"
+#include "doc/autosavejournal.h"
+#include <QFile>
+#include <QTemporaryDir>
+
+namespace {
+QByteArray readFile(const QString &path)
+{
+    QFile file(path);
+    file.open(QIODevice::ReadOnly);
+    return file.readAll();
+}
+
+// Synthetic scene with many producers, the edits change the in point of one of them
+QString sceneWithEdit(int producers, int edited, int in)
+{
+    QString scene = QStringLiteral("<?xml version='1.0' encoding='utf-8'?>\n<mlt>\n");
+    for (int i = 0; i < producers; ++i) {
+        scene += QStringLiteral("<producer id=\"producer%1\" in=\"%2\" out=\"250\"><property name=\"resource\">/media/clip%1.mp4</property></producer>\n")
+                     .arg(i)
+                     .arg(i == edited ? in : 0);
+    }
+    scene += QStringLiteral("</mlt>\n");
+    return scene;
+}
+} // namespace
+
+TEST_CASE("Autosave journal", "[AutoSave]")
+{
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+    const QString fileName = dir.filePath(QStringLiteral("autosave.kdenlive"));
+
+    SECTION("Journal replays to the last saved scene")
+    {
+        AutoSaveJournal journal;
+        QString scene;
+        for (int i = 0; i < 20; ++i) {
+            scene = sceneWithEdit(300, (i * 37) % 300, i + 1);
+            journal.save(fileName, scene, {}, QStringLiteral("Move clip %1").arg(i));
+        }
+        journal.waitForDone();
+        const QByteArray data = readFile(fileName);
+        REQUIRE(AutoSaveJournal::isJournal(data));
+        // Only the first save wrote the whole scene
+        REQUIRE(data.size() < scene.toUtf8().size() * 2);
+
+        QStringList operations;
+        bool ok = false;
+        REQUIRE(AutoSaveJournal::replay(data, &operations, &ok) == scene.toUtf8());
+        REQUIRE(ok);
+        REQUIRE(operations.size() == 20);
+        REQUIRE(operations.last() == QStringLiteral("Move clip 19"));
+    }
+
+    SECTION("Replacements are applied")
+    {
+        AutoSaveJournal journal;
+        QMap<QString, QString> replacements;
+        replacements.insert(QStringLiteral("/media/"), QStringLiteral("/backup/"));
+        const QString scene = sceneWithEdit(10, 2, 5);
+        journal.save(fileName, scene, replacements, QString());
+        journal.waitForDone();
+        QString expected = scene;
+        expected.replace(QStringLiteral("/media/"), QStringLiteral("/backup/"));
+        REQUIRE(AutoSaveJournal::replay(readFile(fileName)) == expected.toUtf8());
+    }
+
+    SECTION("Journal is compacted into a snapshot")
+    {
+        AutoSaveJournal journal;
+        QString scene;
+        for (int i = 0; i < AutoSaveJournal::MaxRecords + 10; ++i) {
+            scene = sceneWithEdit(5, i % 5, i + 1);
+            journal.save(fileName, scene, {}, QStringLiteral("Edit %1").arg(i));
+        }
+        journal.waitForDone();
+        QStringList operations;
+        REQUIRE(AutoSaveJournal::replay(readFile(fileName), &operations) == scene.toUtf8());
+        REQUIRE(operations.size() < AutoSaveJournal::MaxRecords);
+    }
+
+    SECTION("Truncated journal replays its complete records")
+    {
+        AutoSaveJournal journal;
+        const QString first = sceneWithEdit(50, 1, 10);
+        journal.save(fileName, first, {}, QString());
+        journal.waitForDone();
+        const int firstSize = readFile(fileName).size();
+        journal.save(fileName, sceneWithEdit(50, 1, 20), {}, QString());
+        journal.waitForDone();
+        const QByteArray data = readFile(fileName);
+        REQUIRE(data.size() > firstSize);
+        // The application stopped while writing the second record
+        for (int size = firstSize; size < data.size(); size += 3) {
+            bool ok = false;
+            REQUIRE(AutoSaveJournal::replay(data.left(size), nullptr, &ok) == first.toUtf8());
+            REQUIRE(ok);
+        }
+        bool ok = true;
+        AutoSaveJournal::replay(data.left(10), nullptr, &ok);
+        REQUIRE_FALSE(ok);
+    }
+
+    SECTION("Restore a journal as a project file")
+    {
+        AutoSaveJournal journal;
+        const QString scene = sceneWithEdit(50, 4, 12);
+        journal.save(fileName, sceneWithEdit(50, 3, 2), {}, QString());
+        journal.save(fileName, scene, {}, QString());
+        journal.waitForDone();
+        QFile file(fileName);
+        REQUIRE(file.open(QIODevice::ReadWrite));
+        REQUIRE(AutoSaveJournal::restore(&file));
+        REQUIRE(file.readAll() == scene.toUtf8());
+        file.close();
+
+        // A project file is left untouched
+        REQUIRE(file.open(QIODevice::ReadWrite));
+        REQUIRE(AutoSaveJournal::restore(&file));
+        REQUIRE(file.readAll() == scene.toUtf8());
+    }
+
+    SECTION("Reset starts a new snapshot")
+    {
+        AutoSaveJournal journal;
+        journal.save(fileName, sceneWithEdit(20, 1, 1), {}, QString());
+        journal.reset();
+        QFile::remove(fileName);
+        const QString scene = sceneWithEdit(20, 2, 2);
+        journal.save(fileName, scene, {}, QString());
+        journal.waitForDone();
+        REQUIRE(AutoSaveJournal::replay(readFile(fileName)) == scene.toUtf8());
+    }
+}
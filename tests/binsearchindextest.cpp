@@ -0,0 +1,106 @@
+#include "catch.hpp"
+#include "bin/binsearchindex.h"
+#include <random>
+
+namespace {
+BinSearchIndex::Entry makeEntry(const QString &name, const QString &tag = QString(), int type = 1)
+{
+    BinSearchIndex::Entry entry;
+    entry.texts << name << QStringLiteral("2020-05-04") << QString();
+    entry.tag = tag;
+    entry.type = type;
+    return entry;
+}
+
+// Reference implementation, equivalent to the former filter of the bin proxy
+bool linearMatch(const BinSearchIndex::Entry &entry, const QString &text, const QString &tag, int type)
+{
+    if ((type > 0 && entry.type != type) || !entry.tag.contains(tag, Qt::CaseInsensitive)) {
+        return false;
+    }
+    for (const QString &t : entry.texts) {
+        if (t.contains(text, Qt::CaseInsensitive)) {
+            return true;
+        }
+    }
+    return false;
+}
+} // namespace
+
+TEST_CASE("Bin search index", "[BinSearchIndex]")
+{
+    BinSearchIndex index;
+    index.update(1, makeEntry(QStringLiteral("Interview Camera A.mp4"), QStringLiteral("#ff0000"), 1));
+    index.update(2, makeEntry(QStringLiteral("interview camera b.mp4"), QStringLiteral("#00ff00"), 1));
+    index.update(3, makeEntry(QStringLiteral("Music.ogg"), QString(), 2));
+    index.update(4, makeEntry(QStringLiteral("Titles"), QString(), 0));
+    REQUIRE(index.count() == 4);
+
+    SECTION("Matching rules")
+    {
+        REQUIRE(index.match(QStringLiteral("camera"), QString(), 0) == std::unordered_set<int>{1, 2});
+        REQUIRE(index.match(QStringLiteral("CAMERA A"), QString(), 0) == std::unordered_set<int>{1});
+        REQUIRE(index.match(QStringLiteral("camera"), QStringLiteral("#00FF"), 0) == std::unordered_set<int>{2});
+        REQUIRE(index.match(QString(), QString(), 2) == std::unordered_set<int>{3});
+        REQUIRE(index.match(QStringLiteral("mp"), QString(), 0) == std::unordered_set<int>{1, 2});
+        REQUIRE(index.match(QStringLiteral("2020-05"), QString(), 0).size() == 4);
+        REQUIRE(index.match(QString(), QString(), 0).size() == 4);
+        REQUIRE(index.match(QStringLiteral("unknown"), QString(), 0).empty());
+        // All the trigrams are present, but not in the same item
+        REQUIRE(index.match(QStringLiteral("music camera"), QString(), 0).empty());
+    }
+
+    SECTION("Updates change the revision only when the searched data changes")
+    {
+        quint64 revision = index.revision();
+        index.update(3, makeEntry(QStringLiteral("Music.ogg"), QString(), 2));
+        REQUIRE(index.revision() == revision);
+        index.update(3, makeEntry(QStringLiteral("Soundtrack.ogg"), QString(), 2));
+        REQUIRE(index.revision() > revision);
+        REQUIRE(index.match(QStringLiteral("music"), QString(), 0).empty());
+        REQUIRE(index.match(QStringLiteral("soundtrack"), QString(), 0) == std::unordered_set<int>{3});
+
+        revision = index.revision();
+        index.remove(1);
+        REQUIRE(index.revision() > revision);
+        REQUIRE(index.match(QStringLiteral("camera"), QString(), 0) == std::unordered_set<int>{2});
+        revision = index.revision();
+        index.remove(1);
+        REQUIRE(index.revision() == revision);
+
+        index.clear();
+        REQUIRE(index.count() == 0);
+        REQUIRE(index.match(QString(), QString(), 0).empty());
+    }
+
+    SECTION("Same results as a linear scan")
+    {
+        std::default_random_engine gen(42);
+        std::uniform_int_distribution<int> letter(0, 5);
+        auto randomString = [&](int size) {
+            QString result;
+            for (int i = 0; i < size; ++i) {
+                result.append(QChar('a' + letter(gen) + (i % 3 == 0 ? 'A' - 'a' : 0)));
+            }
+            return result;
+        };
+        std::vector<BinSearchIndex::Entry> entries;
+        index.clear();
+        for (int i = 0; i < 300; ++i) {
+            entries.push_back(makeEntry(randomString(12), randomString(2), 1 + i % 3));
+            index.update(i, entries.back());
+        }
+        for (int i = 0; i < 200; ++i) {
+            const QString text = randomString(1 + i % 5);
+            const QString tag = i % 4 == 0 ? randomString(1) : QString();
+            const int type = i % 4;
+            std::unordered_set<int> expected;
+            for (int j = 0; j < int(entries.size()); ++j) {
+                if (linearMatch(entries[size_t(j)], text, tag, type)) {
+                    expected.insert(j);
+                }
+            }
+            REQUIRE(index.match(text, tag, type) == expected);
+        }
+    }
+}
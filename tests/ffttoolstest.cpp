@@ -0,0 +1,101 @@
+#include "catch.hpp"
+#include "lib/audio/fftTools.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+namespace {
+// Interleaved frame with a full scale sine on one channel and quiet noise on the others
+audioShortVector sineFrame(uint numChannels, uint sineChannel, int samples, double period)
+{
+    std::default_random_engine gen(42);
+    std::uniform_int_distribution<int> noise(-30, 30);
+    audioShortVector frame(samples * int(numChannels));
+    for (int i = 0; i < samples; ++i) {
+        for (uint channel = 0; channel < numChannels; ++channel) {
+            frame[i * int(numChannels) + int(channel)] =
+                channel == sineChannel ? qint16(std::lround(32767 * std::sin(2 * M_PI * i / period))) : qint16(noise(gen));
+        }
+    }
+    return frame;
+}
+} // namespace
+
+TEST_CASE("FFT of a sine", "[FFTTools]")
+{
+    FFTTools tools;
+    const uint windowSize = 1024;
+    // The period fits an integer number of times in the window, so that all the power is in one bin
+    const audioShortVector frame = sineFrame(2, 0, int(windowSize), windowSize / 64.);
+    std::vector<float> spectrum(windowSize / 2);
+
+    tools.fftNormalized(frame, 0, 2, spectrum.data(), FFTTools::Window_Rect, windowSize);
+    REQUIRE(std::max_element(spectrum.begin(), spectrum.end()) - spectrum.begin() == 64);
+    REQUIRE(std::abs(spectrum[64]) < 0.01f);
+    REQUIRE(spectrum[10] < -100);
+
+    // Window functions reduce the peak, but its scale factor compensates it
+    tools.fftNormalized(frame, 0, 2, spectrum.data(), FFTTools::Window_Hamming, windowSize);
+    REQUIRE(std::max_element(spectrum.begin(), spectrum.end()) - spectrum.begin() == 64);
+    REQUIRE(std::abs(spectrum[64]) < 0.5f);
+
+    // The second channel only contains noise
+    tools.fftNormalized(frame, 1, 2, spectrum.data(), FFTTools::Window_Rect, windowSize);
+    REQUIRE(spectrum[64] < -40);
+
+    // Frames shorter than the window are padded with silence
+    const audioShortVector shortFrame = sineFrame(1, 0, 300, windowSize / 64.);
+    tools.fftNormalized(shortFrame, 0, 1, spectrum.data(), FFTTools::Window_Rect, windowSize);
+    REQUIRE(std::max_element(spectrum.begin(), spectrum.end()) - spectrum.begin() == 64);
+}
+
+TEST_CASE("FFT of all channels keeps the loudest one", "[FFTTools]")
+{
+    FFTTools tools;
+    const uint windowSize = 2048;
+    const audioShortVector frame = sineFrame(6, 4, int(windowSize), windowSize / 100.);
+    std::vector<float> all(windowSize / 2);
+    std::vector<float> single(windowSize / 2);
+
+    tools.fftNormalizedAllChannels(frame, 6, all.data(), FFTTools::Window_Triangle, windowSize);
+    REQUIRE(std::max_element(all.begin(), all.end()) - all.begin() == 100);
+    for (uint channel = 0; channel < 6; ++channel) {
+        tools.fftNormalized(frame, channel, 6, single.data(), FFTTools::Window_Triangle, windowSize);
+        for (uint i = 0; i < windowSize / 2; ++i) {
+            REQUIRE(single[i] <= all[i]);
+        }
+        if (channel == 4) {
+            REQUIRE(single[100] == Approx(all[100]));
+        }
+    }
+
+    // Plans are rebuilt when the window size changes
+    std::vector<float> small(256);
+    tools.fftNormalizedAllChannels(frame, 6, small.data(), FFTTools::Window_Rect, 512);
+    REQUIRE(std::max_element(small.begin(), small.end()) - small.begin() == 25);
+}
+
+TEST_CASE("Decibels of FFT values", "[FFTTools]")
+{
+    std::default_random_engine gen(42);
+    std::uniform_real_distribution<float> exponent(-6, 3);
+    std::uniform_real_distribution<float> ratio(-1, 1);
+    std::vector<kiss_fft_cpx> values(10000);
+    for (kiss_fft_cpx &value : values) {
+        const float magnitude = std::pow(10.f, exponent(gen));
+        value.r = magnitude * ratio(gen);
+        value.i = magnitude * ratio(gen);
+    }
+    values[0].r = values[0].i = 0;
+    std::vector<float> db(values.size());
+    FFTTools::decibels(values.data(), db.data(), uint(values.size()), 4096, 1.85f);
+
+    // Silence gives a very low value instead of -inf
+    REQUIRE(std::isfinite(db[0]));
+    REQUIRE(db[0] < -250);
+    for (size_t i = 1; i < values.size(); ++i) {
+        const double magnitude = std::sqrt(double(values[i].r) * values[i].r + double(values[i].i) * values[i].i);
+        const double expected = 20 * std::log10(2 * magnitude * 1.85 / 4096);
+        REQUIRE(std::abs(db[i] - expected) < 0.01);
+    }
+}
@@ -0,0 +1,114 @@
+#include "catch.hpp"
+#include "utils/filehash.hpp"
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QTemporaryDir>
+#include <random>
+
+namespace {
+QByteArray randomData(int size, unsigned seed)
+{
+    std::default_random_engine gen(seed);
+    std::uniform_int_distribution<int> dist(0, 255);
+    QByteArray data(size, Qt::Uninitialized);
+    for (int i = 0; i < size; ++i) {
+        data[i] = char(dist(gen));
+    }
+    return data;
+}
+
+void writeFile(const QString &path, const QByteArray &data)
+{
+    QFile file(path);
+    REQUIRE(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    REQUIRE(file.write(data) == data.size());
+}
+
+QString md5(const QByteArray &data)
+{
+    return QString::fromLatin1(QCryptographicHash::hash(data, QCryptographicHash::Md5).toHex());
+}
+} // namespace
+
+TEST_CASE("File hashes", "[FileHash]")
+{
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+
+    SECTION("Hash of small and large files")
+    {
+        const QByteArray small = randomData(5000, 1);
+        writeFile(dir.filePath(QStringLiteral("small.mp4")), small);
+        REQUIRE(FileHashCache::computeHash(dir.filePath(QStringLiteral("small.mp4"))) == md5(small));
+
+        // Only the first and last megabytes of large files are hashed, as in kdenlive:file_hash
+        const QByteArray large = randomData(3500000, 2);
+        writeFile(dir.filePath(QStringLiteral("large.mp4")), large);
+        REQUIRE(FileHashCache::computeHash(dir.filePath(QStringLiteral("large.mp4"))) == md5(large.left(1000000) + large.right(1000000)));
+
+        REQUIRE(FileHashCache::computeHash(dir.filePath(QStringLiteral("missing.mp4"))).isEmpty());
+    }
+
+    SECTION("Cached hashes are persistent and follow file changes")
+    {
+        const QString cacheFile = dir.filePath(QStringLiteral("cache"));
+        const QString path = dir.filePath(QStringLiteral("clip.mp4"));
+        const QByteArray data = randomData(10000, 3);
+        writeFile(path, data);
+        {
+            FileHashCache cache(cacheFile);
+            REQUIRE_FALSE(cache.contains(path));
+            qint64 size = 0;
+            REQUIRE(cache.hash(path, &size) == md5(data));
+            REQUIRE(size == data.size());
+            REQUIRE(cache.contains(path));
+        }
+        FileHashCache cache(cacheFile);
+        REQUIRE(cache.count() == 1);
+        REQUIRE(cache.contains(path));
+        REQUIRE(cache.hash(path) == md5(data));
+
+        // A modified file is hashed again
+        const QByteArray other = randomData(12000, 4);
+        writeFile(path, other);
+        REQUIRE_FALSE(cache.contains(path));
+        REQUIRE(cache.hash(path) == md5(other));
+    }
+
+    SECTION("Index finds files by size and hash")
+    {
+        QDir root(dir.path());
+        REQUIRE(root.mkpath(QStringLiteral("a/b")));
+        REQUIRE(root.mkpath(QStringLiteral("c")));
+        const QByteArray clip1 = randomData(8000, 5);
+        const QByteArray clip2 = randomData(8000, 6);
+        const QByteArray clip3 = randomData(9000, 7);
+        writeFile(root.filePath(QStringLiteral("a/b/clip1.mp4")), clip1);
+        writeFile(root.filePath(QStringLiteral("c/clip2.mp4")), clip2);
+        writeFile(root.filePath(QStringLiteral("c/clip3.mp4")), clip3);
+        // Same content under another name
+        writeFile(root.filePath(QStringLiteral("c/copy.mp4")), clip3);
+
+        FileIndex index(root.path());
+        REQUIRE(index.count() == 4);
+        REQUIRE(index.candidates(8000).size() == 2);
+        REQUIRE(index.candidates(1234).empty());
+        index.prepare({8000, 9000});
+        REQUIRE(FileHashCache::get()->contains(root.filePath(QStringLiteral("c/clip2.mp4"))));
+
+        REQUIRE(index.find(8000, md5(clip1)) == root.filePath(QStringLiteral("a/b/clip1.mp4")));
+        REQUIRE(index.find(8000, md5(clip2)) == root.filePath(QStringLiteral("c/clip2.mp4")));
+        REQUIRE(index.find(8000, md5(clip3)).isEmpty());
+        // The file with the same name is preferred
+        REQUIRE(index.find(9000, md5(clip3), QStringLiteral("/old/drive/copy.mp4")) == root.filePath(QStringLiteral("c/copy.mp4")));
+        REQUIRE(index.find(9000, md5(clip3), QStringLiteral("/old/drive/clip3.mp4")) == root.filePath(QStringLiteral("c/clip3.mp4")));
+
+        // Projects may not store the size of a clip, all the files are then candidates
+        REQUIRE(FileIndex::sizeFromString(QString()) < 0);
+        REQUIRE(FileIndex::sizeFromString(QStringLiteral("0")) == 0);
+        REQUIRE(index.candidates(-1).size() == 4);
+        REQUIRE(index.find(FileIndex::sizeFromString(QString()), md5(clip2)) == root.filePath(QStringLiteral("c/clip2.mp4")));
+        REQUIRE(index.find(0, md5(clip2)).isEmpty());
+    }
+}
@@ -109,6 +109,22 @@ TEST_CASE("Functional test of the group hierarchy", "[GroupsModel]")
         }
     }
 
+    SECTION("Cached queries follow the hierarchy changes")
+    {
+        // Fill the caches, then modify the hierarchy
+        REQUIRE(groups.getRootId(9) == 2);
+        REQUIRE(groups.getLeaves(2) == std::unordered_set<int>({0, 4, 6, 7, 9}));
+        groups.setGroup(3, 5);
+        REQUIRE(groups.getRootId(9) == 5);
+        REQUIRE(groups.getLeaves(2) == std::unordered_set<int>({0}));
+        REQUIRE(groups.getLeaves(5) == std::unordered_set<int>({4, 6, 7, 8, 9}));
+        groups.removeFromGroup(9);
+        REQUIRE(groups.getRootId(9) == 9);
+        REQUIRE_FALSE(groups.isInGroup(9));
+        REQUIRE(groups.getLeaves(5) == std::unordered_set<int>({4, 6, 7, 8}));
+        REQUIRE(groups.getLeaves(3) == std::unordered_set<int>({4, 6, 7}));
+    }
+
     groups.setGroup(3, 8);
     SECTION("Test leaf nodes 2")
     {
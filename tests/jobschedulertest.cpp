@@ -0,0 +1,70 @@
+#include "catch.hpp"
+#include "jobs/jobscheduler.h"
+#include <QMutex>
+#include <QSemaphore>
+#include <vector>
+
+TEST_CASE("Job scheduler lanes and priorities", "[JobScheduler]")
+{
+    REQUIRE(JobScheduler::laneForJob(AbstractClipJob::THUMBJOB) == JobScheduler::Lane::Light);
+    REQUIRE(JobScheduler::laneForJob(AbstractClipJob::LOADJOB) == JobScheduler::Lane::Light);
+    REQUIRE(JobScheduler::laneForJob(AbstractClipJob::PROXYJOB) == JobScheduler::Lane::Heavy);
+    REQUIRE(JobScheduler::laneForJob(AbstractClipJob::TRANSCODEJOB) == JobScheduler::Lane::Heavy);
+    REQUIRE(JobScheduler::priorityForJob(AbstractClipJob::LOADJOB) > JobScheduler::priorityForJob(AbstractClipJob::THUMBJOB));
+    REQUIRE(JobScheduler::priorityForJob(AbstractClipJob::THUMBJOB) > JobScheduler::priorityForJob(AbstractClipJob::AUDIOTHUMBJOB));
+    REQUIRE(JobScheduler::priorityForJob(AbstractClipJob::TRANSCODEJOB) > JobScheduler::priorityForJob(AbstractClipJob::PROXYJOB));
+
+    JobScheduler scheduler(2, 1);
+    REQUIRE(scheduler.maxThreadCount(JobScheduler::Lane::Light) == 2);
+    REQUIRE(scheduler.maxThreadCount(JobScheduler::Lane::Heavy) == 1);
+
+    QMutex mutex;
+    std::vector<QString> order;
+    auto record = [&mutex, &order](const QString &id) {
+        return [&mutex, &order, id]() {
+            QMutexLocker lock(&mutex);
+            order.push_back(id);
+        };
+    };
+
+    // Occupy the only thread of the heavy lane, so that the next jobs stay queued
+    QSemaphore blocker(0);
+    QSemaphore blockerStarted(0);
+    scheduler.schedule(AbstractClipJob::STABILIZEJOB, QStringLiteral("0"), [&]() {
+        blockerStarted.release();
+        blocker.acquire();
+    });
+    REQUIRE(blockerStarted.tryAcquire(1, 5000));
+
+    SECTION("Queued jobs start by priority")
+    {
+        scheduler.schedule(AbstractClipJob::PROXYJOB, QStringLiteral("1"), record(QStringLiteral("1")));
+        scheduler.schedule(AbstractClipJob::TRANSCODEJOB, QStringLiteral("2"), record(QStringLiteral("2")));
+        scheduler.schedule(AbstractClipJob::PROXYJOB, QStringLiteral("3"), record(QStringLiteral("3")));
+
+        // Light jobs are not delayed by the heavy ones
+        QSemaphore lightDone(0);
+        scheduler.schedule(AbstractClipJob::THUMBJOB, QStringLiteral("4"), [&]() { lightDone.release(); });
+        REQUIRE(lightDone.tryAcquire(1, 5000));
+
+        blocker.release();
+        REQUIRE(scheduler.waitForDone(5000));
+        REQUIRE(order == std::vector<QString>{QStringLiteral("2"), QStringLiteral("1"), QStringLiteral("3")});
+    }
+
+    SECTION("Jobs of visible clips are promoted")
+    {
+        scheduler.schedule(AbstractClipJob::TRANSCODEJOB, QStringLiteral("1"), record(QStringLiteral("1")));
+        scheduler.schedule(AbstractClipJob::PROXYJOB, QStringLiteral("2"), record(QStringLiteral("2")));
+        scheduler.schedule(AbstractClipJob::PROXYJOB, QStringLiteral("3"), record(QStringLiteral("3")));
+        // Promote a queued job
+        scheduler.setPriorityClips({QStringLiteral("3")});
+        // Jobs queued after the promotion are also promoted
+        scheduler.schedule(AbstractClipJob::PROXYJOB, QStringLiteral("3"), record(QStringLiteral("3b")));
+        scheduler.schedule(AbstractClipJob::PROXYJOB, QStringLiteral("4"), record(QStringLiteral("4")));
+
+        blocker.release();
+        REQUIRE(scheduler.waitForDone(5000));
+        REQUIRE(order == std::vector<QString>{QStringLiteral("3"), QStringLiteral("3b"), QStringLiteral("1"), QStringLiteral("2"), QStringLiteral("4")});
+    }
+}
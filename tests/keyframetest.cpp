@@ -251,6 +251,95 @@ TEST_CASE("Keyframe model", "[KeyframeModel]")
         undoStack->undo();
         state1(6.1);
     }
+    SECTION("Interpolation matches MLT")
+    {
+        const double fps = pCore->getCurrentFps();
+        REQUIRE(model->addKeyframe(GenTime(10, fps), KeyframeType::Linear, 40));
+        REQUIRE(model->addKeyframe(GenTime(30, fps), KeyframeType::Curve, -20));
+        REQUIRE(model->addKeyframe(GenTime(45, fps), KeyframeType::Curve, 75));
+        REQUIRE(model->addKeyframe(GenTime(60, fps), KeyframeType::Discrete, 10));
+        REQUIRE(model->addKeyframe(GenTime(80, fps), KeyframeType::Linear, 55));
+
+        auto check = [&]() {
+            Mlt::Properties prop;
+            prop.set("key", model->getAnimProperty().toUtf8().constData());
+            const std::vector<double> values = model->evaluateRange(0, 100);
+            REQUIRE(values.size() == 100);
+            for (int frame = 0; frame < 100; ++frame) {
+                const double expected = prop.anim_get_double("key", frame);
+                REQUIRE(values[size_t(frame)] == Approx(expected).margin(1e-6));
+                REQUIRE(model->getInterpolatedValue(frame).toDouble() == Approx(expected).margin(1e-6));
+            }
+        };
+        check();
+
+        // The cached values follow the changes of the keyframes
+        REQUIRE(model->updateKeyframe(GenTime(30, fps), 5));
+        check();
+        REQUIRE(model->removeKeyframe(GenTime(45, fps)));
+        check();
+        undoStack->undo();
+        check();
+        REQUIRE(model->evaluateRange(20, 10).empty());
+    }
+
     pCore->m_projectManager = nullptr;
     Logger::print_trace();
 }
+
+TEST_CASE("Keyframe interpolation benchmark", "[.][KeyframeModel][benchmark]")
+{
+    std::shared_ptr<DocUndoStack> undoStack = std::make_shared<DocUndoStack>(nullptr);
+    Mock<ProjectManager> pmMock;
+    When(Method(pmMock, undoStack)).AlwaysReturn(undoStack);
+    ProjectManager &mocked = pmMock.get();
+    pCore->m_projectManager = &mocked;
+
+    Mlt::Profile pr;
+    std::shared_ptr<Mlt::Producer> producer = std::make_shared<Mlt::Producer>(pr, "color", "red");
+    auto effectstack = EffectStackModel::construct(producer, {ObjectType::TimelineClip, 0}, undoStack);
+    effectstack->appendEffect(QStringLiteral("audiobalance"));
+    auto effect = std::dynamic_pointer_cast<EffectItemModel>(effectstack->getEffectStackRow(0));
+    effect->prepareKeyframes();
+    auto model = std::make_shared<KeyframeModel>(effect, effect->index(0, 0), undoStack);
+
+    const double fps = pCore->getCurrentFps();
+    const KeyframeType types[] = {KeyframeType::Linear, KeyframeType::Curve, KeyframeType::Discrete};
+    for (int i = 1; i < 200; ++i) {
+        model->addKeyframe(GenTime(i * 25, fps), types[i % 3], (i * 37) % 100);
+    }
+    const int length = 200 * 25;
+
+    double sum = 0;
+    BENCHMARK("Per frame interpolation through Mlt::Properties")
+    {
+        // This is how the values were computed before the interpolator: two keyframes set in a new Mlt::Properties for each frame
+        for (int frame = 0; frame < length; ++frame) {
+            bool ok;
+            auto prev = model->getPrevKeyframe(GenTime(frame, fps), &ok);
+            auto next = model->getNextKeyframe(GenTime(frame, fps), &ok);
+            if (!ok) {
+                continue;
+            }
+            Mlt::Properties prop;
+            int p1 = prev.first.frames(fps);
+            int p2 = next.first.frames(fps);
+            prop.anim_set("keyframe", model->m_keyframeList.at(prev.first).second.toDouble(), p1, p2, mlt_keyframe_linear);
+            prop.anim_set("keyframe", model->m_keyframeList.at(next.first).second.toDouble(), p2, p2, mlt_keyframe_linear);
+            sum += prop.anim_get_double("keyframe", frame);
+        }
+    }
+    BENCHMARK("Per frame getInterpolatedValue")
+    {
+        for (int frame = 0; frame < length; ++frame) {
+            sum += model->getInterpolatedValue(frame).toDouble();
+        }
+    }
+    BENCHMARK("Bulk evaluateRange")
+    {
+        const std::vector<double> values = model->evaluateRange(0, length);
+        sum += values.back();
+    }
+    REQUIRE(sum != 0);
+    pCore->m_projectManager = nullptr;
+}
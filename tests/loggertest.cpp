@@ -0,0 +1,95 @@
+#include "test_utils.hpp"
+#include <QTemporaryDir>
+#include <fstream>
+
+Mlt::Profile profile_logger;
+
+namespace {
+bool startsWith(const std::string &line, const std::string &prefix)
+{
+    return line.compare(0, prefix.size(), prefix) == 0;
+}
+} // namespace
+
+TEST_CASE("Ring buffer of the model operations", "[Logger]")
+{
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+    const std::string dumpFile = dir.filePath(QStringLiteral("trace.txt")).toStdString();
+    Logger::set_mode(Logger::Mode::RingBuffer, dumpFile);
+    Logger::clear();
+    auto readDump = [&dumpFile]() {
+        std::vector<std::string> lines;
+        if (Logger::dump_ring_buffer()) {
+            std::ifstream file(dumpFile);
+            std::string line;
+            while (std::getline(file, line)) {
+                lines.push_back(line);
+            }
+        }
+        return lines;
+    };
+
+    SECTION("Only the last operations are kept")
+    {
+        for (size_t i = 0; i < Logger::RingSlots + 11; ++i) {
+            Logger::log_undo(i % 2 == 0);
+        }
+        const std::vector<std::string> lines = readDump();
+        REQUIRE(lines.size() == Logger::RingSlots);
+        REQUIRE(lines.front() == "r");
+        REQUIRE(lines.back() == "u");
+    }
+
+    SECTION("Arguments are formatted when dumping")
+    {
+        Logger::log_create_producer("test_producer", {std::string("blue"), 25, true});
+        Logger::log_create_producer("test_producer", {std::string(), 2.5, false});
+        // A command that does not fit in a record is dropped rather than truncated
+        Logger::log_create_producer("test_producer", {std::string(500, 'a'), 10, false});
+        Logger::log_undo(true);
+        const std::string code = Logger::translation_table.at("constr_test_producer");
+        const std::vector<std::string> lines = readDump();
+        REQUIRE(lines.size() == 3);
+        REQUIRE(lines[0] == code + " blue 25 1");
+        REQUIRE(lines[1] == code + " $$ 2.5 0");
+        REQUIRE(lines[2] == "u");
+    }
+
+#ifdef KDENLIVE_MODEL_TRACING
+    SECTION("Timeline operations are recorded as fuzzer commands")
+    {
+        auto binModel = pCore->projectItemModel();
+        binModel->clean();
+        std::shared_ptr<DocUndoStack> undoStack = std::make_shared<DocUndoStack>(nullptr);
+        std::shared_ptr<MarkerListModel> guideModel = std::make_shared<MarkerListModel>(undoStack);
+        Mock<ProjectManager> pmMock;
+        When(Method(pmMock, undoStack)).AlwaysReturn(undoStack);
+        ProjectManager &mocked = pmMock.get();
+        pCore->m_projectManager = &mocked;
+
+        std::shared_ptr<TimelineItemModel> timeline = TimelineItemModel::construct(&profile_logger, guideModel, undoStack);
+        QString binId = createProducer(profile_logger, "red", binModel);
+        int tid = TrackModel::construct(timeline);
+        int cid = -1;
+        REQUIRE(timeline->requestClipInsertion(binId, tid, 0, cid));
+        REQUIRE(timeline->requestClipMove(cid, tid, 30));
+        undoStack->undo();
+
+        const std::vector<std::string> lines = readDump();
+        REQUIRE(lines.size() == 6);
+        // The timeline construction is always dumped first
+        REQUIRE(startsWith(lines[0], Logger::translation_table.at("constr_TimelineModel")));
+        REQUIRE(startsWith(lines[1], Logger::translation_table.at("constr_test_producer") + " red"));
+        // Methods of the timeline get the id of the timeline as first argument
+        REQUIRE(startsWith(lines[3], Logger::translation_table.at("requestClipInsertion") + " 0 "));
+        REQUIRE(startsWith(lines[4], Logger::translation_table.at("requestClipMove") + " 0 "));
+        REQUIRE(lines[5] == "u");
+        binModel->clean();
+        pCore->m_projectManager = nullptr;
+    }
+#endif
+
+    Logger::set_mode(Logger::Mode::Full);
+    Logger::clear();
+}
@@ -0,0 +1,113 @@
+#include "catch.hpp"
+#include "utils/mediaprobecache.hpp"
+#include <QDir>
+#include <QFile>
+#include <QTemporaryDir>
+#include <atomic>
+#include <mlt++/MltProducer.h>
+#include <mlt++/MltProfile.h>
+
+namespace {
+void writeFile(const QString &path, const QByteArray &data)
+{
+    QFile file(path);
+    REQUIRE(file.open(QIODevice::WriteOnly | QIODevice::Append));
+    file.write(data);
+}
+} // namespace
+
+TEST_CASE("Media probe cache", "[MediaProbeCache]")
+{
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+    const QString cacheFile = dir.filePath(QStringLiteral("probes"));
+    const QString media = dir.filePath(QStringLiteral("media.mp4"));
+    writeFile(media, QByteArray(1000, 'a'));
+
+    // The test system may not have avformat, any producer gives properties to cache
+    Mlt::Profile profile;
+    Mlt::Producer producer(profile, "color", "red");
+    REQUIRE(producer.is_valid());
+    producer.set("meta.media.nb_streams", 2);
+    producer.set("kdenlive:clipname", "clip");
+    producer.set("_internal", "1");
+
+    const QMap<QString, QString> properties = MediaProbeCache::probedProperties(producer);
+    REQUIRE(properties.value(QStringLiteral("meta.media.nb_streams")) == QStringLiteral("2"));
+    REQUIRE(properties.contains(QStringLiteral("length")));
+    REQUIRE_FALSE(properties.contains(QStringLiteral("resource")));
+    REQUIRE_FALSE(properties.contains(QStringLiteral("mlt_service")));
+    REQUIRE_FALSE(properties.contains(QStringLiteral("kdenlive:clipname")));
+    REQUIRE_FALSE(properties.contains(QStringLiteral("_internal")));
+
+    {
+        MediaProbeCache cache(cacheFile);
+        REQUIRE(cache.lookup(media, QStringLiteral("25/1")).isEmpty());
+        cache.store(media, QStringLiteral("25/1"), producer);
+        REQUIRE(cache.lookup(media, QStringLiteral("25/1")) == properties);
+        // Lengths depend on the frame rate
+        REQUIRE(cache.lookup(media, QStringLiteral("30000/1001")).isEmpty());
+    }
+
+    SECTION("Probes are kept on disk")
+    {
+        MediaProbeCache cache(cacheFile);
+        REQUIRE(cache.count() == 1);
+        REQUIRE(cache.lookup(media, QStringLiteral("25/1")) == properties);
+    }
+
+    SECTION("Probes of modified files are not used")
+    {
+        writeFile(media, QByteArray(10, 'b'));
+        MediaProbeCache cache(cacheFile);
+        REQUIRE(cache.lookup(media, QStringLiteral("25/1")).isEmpty());
+    }
+
+    SECTION("Probes are checked in the background once")
+    {
+        MediaProbeCache cache(cacheFile);
+        std::atomic<int> opened{0};
+        std::atomic<int> changed{0};
+        auto open = [&]() {
+            opened++;
+            auto fresh = std::make_shared<Mlt::Producer>(profile, "color", "red");
+            fresh->set("meta.media.nb_streams", 3);
+            return fresh;
+        };
+        cache.revalidate(media, QStringLiteral("25/1"), open, [&]() { changed++; });
+        cache.revalidate(media, QStringLiteral("25/1"), open, [&]() { changed++; });
+        cache.waitForRevalidation();
+        REQUIRE(opened == 1);
+        REQUIRE(changed == 1);
+        REQUIRE(cache.lookup(media, QStringLiteral("25/1")).value(QStringLiteral("meta.media.nb_streams")) == QStringLiteral("3"));
+    }
+
+    SECTION("Unchanged probes are not reported")
+    {
+        MediaProbeCache cache(cacheFile);
+        std::atomic<int> changed{0};
+        auto open = [&]() {
+            auto fresh = std::make_shared<Mlt::Producer>(profile, "color", "red");
+            fresh->set("meta.media.nb_streams", 2);
+            return fresh;
+        };
+        cache.revalidate(media, QStringLiteral("25/1"), open, [&]() { changed++; });
+        cache.waitForRevalidation();
+        REQUIRE(changed == 0);
+    }
+
+    SECTION("No check runs after shutdown")
+    {
+        MediaProbeCache cache(cacheFile);
+        std::atomic<int> opened{0};
+        auto open = [&]() {
+            opened++;
+            return std::make_shared<Mlt::Producer>(profile, "color", "red");
+        };
+        cache.shutdown();
+        cache.revalidate(media, QStringLiteral("25/1"), open, []() {});
+        cache.waitForRevalidation();
+        REQUIRE(opened == 0);
+        REQUIRE(cache.lookup(media, QStringLiteral("25/1")) == properties);
+    }
+}
@@ -68,6 +68,10 @@ TEST_CASE("Basic creation/deletion of a track", "[TrackModel]")
     REQUIRE(timeline->requestTrackDeletion(id1));
     REQUIRE(timeline->checkConsistency());
     REQUIRE(timeline->getTracksCount() == 2);
+    REQUIRE(timeline->getTrackPosition(id4) == 0);
+    REQUIRE(timeline->getTrackPosition(id2) == 1);
+    REQUIRE(timeline->getTrackIndexFromPosition(0) == id4);
+    REQUIRE(timeline->getTrackIndexFromPosition(1) == id2);
     RESET(timMock);
 
     REQUIRE(timeline->requestTrackDeletion(id4));
@@ -2067,3 +2071,190 @@ TEST_CASE("Operations under locked tracks", "[Locked]")
     pCore->m_projectManager = nullptr;
     Logger::print_trace();
 }
+
+TEST_CASE("Range queries on tracks", "[TrackModel]")
+{
+    Logger::clear();
+    auto binModel = pCore->projectItemModel();
+    binModel->clean();
+    std::shared_ptr<DocUndoStack> undoStack = std::make_shared<DocUndoStack>(nullptr);
+    std::shared_ptr<MarkerListModel> guideModel = std::make_shared<MarkerListModel>(undoStack);
+
+    // Here we do some trickery to enable testing.
+    // We mock the project class so that the undoStack function returns our undoStack
+
+    Mock<ProjectManager> pmMock;
+    When(Method(pmMock, undoStack)).AlwaysReturn(undoStack);
+
+    ProjectManager &mocked = pmMock.get();
+    pCore->m_projectManager = &mocked;
+
+    // We also mock timeline object to spy few functions and mock others
+    TimelineItemModel tim(&profile_model, undoStack);
+    Mock<TimelineItemModel> timMock(tim);
+    auto timeline = std::shared_ptr<TimelineItemModel>(&timMock.get(), [](...) {});
+    TimelineItemModel::finishConstruct(timeline, guideModel);
+
+    RESET(timMock);
+
+    QString binId = createProducer(profile_model, "red", binModel, 20, false);
+    int tid1 = TrackModel::construct(timeline);
+
+    // Reference implementation: linear scan over all the clips of the track
+    auto linearScan = [&](int position, int end) {
+        std::unordered_set<int> ids;
+        for (const auto &clp : timeline->getTrackById(tid1)->m_allClips) {
+            int pos = clp.second->getPosition();
+            int length = clp.second->getPlaytime();
+            if (end > -1 && pos >= end) {
+                continue;
+            }
+            if (pos + length - 1 >= position) {
+                ids.insert(clp.first);
+            }
+        }
+        return ids;
+    };
+    auto checkRanges = [&]() {
+        REQUIRE(timeline->checkConsistency());
+        for (int position = 0; position < 220; position += 7) {
+            for (int end : {-1, position, position + 1, position + 5, position + 30}) {
+                REQUIRE(timeline->getTrackById(tid1)->getClipsInRange(position, end) == linearScan(position, end));
+            }
+        }
+    };
+
+    std::vector<int> clips;
+    std::uniform_int_distribution<int> pos_dist(0, 200);
+    std::uniform_int_distribution<int> size_dist(1, 20);
+    std::bernoulli_distribution coin(0.5);
+
+    for (int i = 0; i < 30; i++) {
+        int cid = -1;
+        if (timeline->requestClipInsertion(binId, tid1, pos_dist(g), cid)) {
+            clips.push_back(cid);
+        }
+        checkRanges();
+    }
+    REQUIRE(clips.size() > 0);
+    for (int i = 0; i < 60; i++) {
+        int cid = clips[(size_t)i % clips.size()];
+        if (coin(g)) {
+            timeline->requestClipMove(cid, tid1, pos_dist(g));
+        } else {
+            timeline->requestItemResize(cid, size_dist(g), coin(g));
+        }
+        checkRanges();
+    }
+    while (undoStack->canUndo()) {
+        undoStack->undo();
+        checkRanges();
+    }
+
+    // On a track filled with adjacent clips, the lookup only looks at the returned clips and the one just before
+    REQUIRE(timeline->getTrackById(tid1)->m_allClips.empty());
+    for (int i = 0; i < 40; i++) {
+        int cid = -1;
+        REQUIRE(timeline->requestClipInsertion(binId, tid1, 20 * i, cid));
+    }
+    checkRanges();
+    int visited = 0;
+    REQUIRE(timeline->getTrackById(tid1)->getClipsInRange(700, 720, visited).size() == 1);
+    REQUIRE(visited == 2);
+    REQUIRE(timeline->getTrackById(tid1)->getClipsInRange(705, 745, visited).size() == 3);
+    REQUIRE(visited == 4);
+    binModel->clean();
+    pCore->m_projectManager = nullptr;
+    Logger::print_trace();
+}
+
+TEST_CASE("Move validation without side effects", "[TrackModel]")
+{
+    Logger::clear();
+    auto binModel = pCore->projectItemModel();
+    binModel->clean();
+    std::shared_ptr<DocUndoStack> undoStack = std::make_shared<DocUndoStack>(nullptr);
+    std::shared_ptr<MarkerListModel> guideModel = std::make_shared<MarkerListModel>(undoStack);
+
+    // Here we do some trickery to enable testing.
+    // We mock the project class so that the undoStack function returns our undoStack
+
+    Mock<ProjectManager> pmMock;
+    When(Method(pmMock, undoStack)).AlwaysReturn(undoStack);
+
+    ProjectManager &mocked = pmMock.get();
+    pCore->m_projectManager = &mocked;
+
+    // We also mock timeline object to spy few functions and mock others
+    TimelineItemModel tim(&profile_model, undoStack);
+    Mock<TimelineItemModel> timMock(tim);
+    auto timeline = std::shared_ptr<TimelineItemModel>(&timMock.get(), [](...) {});
+    TimelineItemModel::finishConstruct(timeline, guideModel);
+
+    RESET(timMock);
+
+    QString binId = createProducer(profile_model, "red", binModel, 20, false);
+    int tid1 = TrackModel::construct(timeline);
+    int tid2 = TrackModel::construct(timeline);
+
+    std::vector<int> clips;
+    std::uniform_int_distribution<int> pos_dist(0, 300);
+    std::bernoulli_distribution coin(0.5);
+    for (int i = 0; i < 24; i++) {
+        int cid = -1;
+        if (timeline->requestClipInsertion(binId, coin(g) ? tid1 : tid2, pos_dist(g), cid)) {
+            clips.push_back(cid);
+        }
+    }
+    REQUIRE(clips.size() > 6);
+    // Some moves are checked on groups, spanning one or both tracks
+    REQUIRE(timeline->requestClipsGroup({clips[0], clips[1]}));
+    REQUIRE(timeline->requestClipsGroup({clips[2], clips[3], clips[4]}));
+
+    for (int i = 0; i < 300; i++) {
+        int cid = clips[(size_t)i % clips.size()];
+        int tid = coin(g) ? tid1 : tid2;
+        int pos = pos_dist(g);
+        int landing = pos;
+        bool possible = timeline->checkClipMove(cid, tid, landing);
+        // The actual move is the reference
+        REQUIRE(possible == timeline->requestClipMoveAttempt(cid, tid, pos));
+        if (!possible) {
+            REQUIRE(landing == pos);
+        } else if (coin(g)) {
+            REQUIRE(timeline->requestClipMove(cid, tid, pos));
+            REQUIRE(timeline->getClipPosition(cid) == landing);
+        }
+        REQUIRE(timeline->checkConsistency());
+    }
+
+    // A previewed drag only changes the fake position of the clips, the move is requested on drop
+    for (int i = 0; i < 100; i++) {
+        int cid = clips[(size_t)i % clips.size()];
+        int tid = coin(g) ? tid1 : tid2;
+        int pos = pos_dist(g);
+        int landing = pos;
+        bool possible = timeline->checkClipMove(cid, tid, landing);
+        int oldPos = timeline->getClipPosition(cid);
+        int oldTrack = timeline->getClipTrackId(cid);
+        int previewed = pos;
+        REQUIRE(timeline->requestClipMovePreview(cid, tid, previewed, true) == possible);
+        REQUIRE(timeline->getClipPosition(cid) == oldPos);
+        REQUIRE(timeline->getClipTrackId(cid) == oldTrack);
+        if (possible) {
+            REQUIRE(previewed == landing);
+            REQUIRE(timeline->m_allClips[cid]->getFakePosition() == landing);
+            int movingTrack = timeline->m_allClips[cid]->getFakeTrackId();
+            timeline->resetFakeMove(cid);
+            REQUIRE(timeline->m_allClips[cid]->getFakeTrackId() == -1);
+            REQUIRE(timeline->m_allClips[cid]->getFakePosition() == oldPos);
+            REQUIRE(timeline->requestClipMove(cid, movingTrack, landing));
+            REQUIRE(timeline->getClipPosition(cid) == landing);
+            REQUIRE(timeline->getClipTrackId(cid) == movingTrack);
+        }
+        REQUIRE(timeline->checkConsistency());
+    }
+    binModel->clean();
+    pCore->m_projectManager = nullptr;
+    Logger::print_trace();
+}
@@ -0,0 +1,112 @@
+#include "catch.hpp"
+#include "utils/producerpool.hpp"
+#include <QAtomicInt>
+#include <QtConcurrent>
+#include <mlt++/MltProducer.h>
+#include <mlt++/MltProfile.h>
+#include <set>
+
+Mlt::Profile profile_pool;
+
+TEST_CASE("Thumbnail producers pool", "[ProducerPool]")
+{
+    QAtomicInt created(0);
+    auto pool = ProducerPool::construct(
+        [&created]() {
+            created.ref();
+            return std::make_shared<Mlt::Producer>(profile_pool, "color", "red");
+        },
+        2);
+    REQUIRE(pool->maxProducers() == 2);
+    REQUIRE(pool->size() == 0);
+
+    SECTION("Producers are exclusive and reused")
+    {
+        auto p1 = pool->acquire();
+        auto p2 = pool->acquire();
+        REQUIRE(p1);
+        REQUIRE(p2);
+        REQUIRE(p1.get() != p2.get());
+        REQUIRE(pool->size() == 2);
+        // The pool is full
+        REQUIRE(pool->acquire(50) == nullptr);
+
+        Mlt::Producer *first = p1.get();
+        p1.reset();
+        REQUIRE(pool->idleCount() == 1);
+        auto p3 = pool->acquire(50);
+        REQUIRE(p3.get() == first);
+        REQUIRE(created.load() == 2);
+    }
+
+    SECTION("Cleared producers are not reused")
+    {
+        auto p1 = pool->acquire();
+        pool->acquire().reset();
+        REQUIRE(pool->idleCount() == 1);
+        pool->clear();
+        REQUIRE(pool->idleCount() == 0);
+        p1.reset();
+        REQUIRE(pool->size() == 0);
+        auto p2 = pool->acquire();
+        REQUIRE(p2);
+        REQUIRE(created.load() == 3);
+    }
+
+    SECTION("Concurrent users never share a producer")
+    {
+        // Catch assertions are not thread safe, failures are counted and checked afterwards
+        QAtomicInt failures(0);
+        QAtomicInt inUse(0);
+        QAtomicInt maxInUse(0);
+        QMutex mutex;
+        std::set<Mlt::Producer *> seen;
+        QList<int> frames;
+        for (int i = 0; i < 200; ++i) {
+            frames << i;
+        }
+        QtConcurrent::blockingMap(frames, [&](int frame) {
+            auto producer = pool->acquire();
+            if (!producer) {
+                failures.ref();
+                return;
+            }
+            int current = inUse.fetchAndAddOrdered(1) + 1;
+            int max = maxInUse.load();
+            while (current > max && !maxInUse.testAndSetOrdered(max, current)) {
+                max = maxInUse.load();
+            }
+            producer->seek(frame);
+            if (producer->position() != frame) {
+                failures.ref();
+            }
+            {
+                QMutexLocker lock(&mutex);
+                seen.insert(producer.get());
+            }
+            inUse.deref();
+        });
+        REQUIRE(failures.load() == 0);
+        REQUIRE(maxInUse.load() <= 2);
+        REQUIRE(seen.size() <= 2);
+        REQUIRE(created.load() <= 2);
+    }
+
+    SECTION("Producers outlive the pool")
+    {
+        auto p1 = pool->acquire();
+        pool.reset();
+        REQUIRE(p1->is_valid());
+        p1.reset();
+    }
+}
+
+TEST_CASE("Producers that cannot be opened", "[ProducerPool]")
+{
+    // The factory returns nullptr for media that cannot be opened, the slot must not stay busy
+    auto pool = ProducerPool::construct([]() { return std::shared_ptr<Mlt::Producer>(); }, 1);
+    for (int i = 0; i < 3; i++) {
+        REQUIRE(pool->acquire(50) == nullptr);
+        REQUIRE(pool->size() == 0);
+    }
+}
@@ -0,0 +1,167 @@
+#include "catch.hpp"
+#include "scopes/colorscopes/histogramgenerator.h"
+#include "scopes/colorscopes/rgbparadegenerator.h"
+#include "scopes/colorscopes/vectorscopegenerator.h"
+#include "scopes/colorscopes/waveformgenerator.h"
+#include <QImage>
+#include <random>
+
+namespace {
+// Synthetic frame with random pixels, so that all the scope bins get hit
+QImage randomFrame(int width, int height)
+{
+    std::default_random_engine gen(42);
+    std::uniform_int_distribution<uint> dist(0, 0xffffff);
+    QImage frame(width, height, QImage::Format_RGB32);
+    for (int y = 0; y < height; ++y) {
+        auto *row = reinterpret_cast<QRgb *>(frame.scanLine(y));
+        for (int x = 0; x < width; ++x) {
+            row[x] = 0xff000000 | dist(gen);
+        }
+    }
+    return frame;
+}
+
+// Returns the number of non transparent pixels of the image
+int paintedPixels(const QImage &image)
+{
+    int count = 0;
+    for (int y = 0; y < image.height(); ++y) {
+        for (int x = 0; x < image.width(); ++x) {
+            if (qAlpha(image.pixel(x, y)) > 0) {
+                count++;
+            }
+        }
+    }
+    return count;
+}
+} // namespace
+
+TEST_CASE("Waveform of solid frames", "[Scopes]")
+{
+    WaveformGenerator generator;
+    const QSize size(100, 256);
+    QImage frame(320, 240, QImage::Format_RGB32);
+    frame.fill(qRgb(255, 0, 0));
+
+    // All the pixels have the same luma, so only one row of the waveform is painted
+    QImage wave = generator.calculateWaveform(size, frame, WaveformGenerator::PaintMode_Yellow, false, WaveformGenerator::Rec_601, 1);
+    REQUIRE(wave.size() == size);
+    const int lumaRow = size.height() - 1 - 76;
+    for (int x = 0; x < size.width(); ++x) {
+        REQUIRE(qAlpha(wave.pixel(x, lumaRow)) > 0);
+    }
+    REQUIRE(paintedPixels(wave) == size.width());
+
+    // Rec. 709 gives a lower luma for red
+    wave = generator.calculateWaveform(size, frame, WaveformGenerator::PaintMode_Yellow, false, WaveformGenerator::Rec_709, 1);
+    REQUIRE(qAlpha(wave.pixel(0, size.height() - 1 - 54)) > 0);
+    REQUIRE(paintedPixels(wave) == size.width());
+}
+
+TEST_CASE("Scopes do not depend on the frame format", "[Scopes]")
+{
+    const QImage frame = randomFrame(333, 217);
+    const QImage packed = frame.convertToFormat(QImage::Format_RGB888);
+
+    WaveformGenerator waveform;
+    // Frames read back from the monitor with OpenGL are byte ordered
+    REQUIRE(waveform.calculateWaveform(QSize(200, 150), frame, WaveformGenerator::PaintMode_White, false, WaveformGenerator::Rec_709, 1) ==
+            waveform.calculateWaveform(QSize(200, 150), frame.convertToFormat(QImage::Format_RGBX8888), WaveformGenerator::PaintMode_White, false,
+                                       WaveformGenerator::Rec_709, 1));
+    REQUIRE(waveform.calculateWaveform(QSize(200, 150), frame, WaveformGenerator::PaintMode_White, false, WaveformGenerator::Rec_709, 1) ==
+            waveform.calculateWaveform(QSize(200, 150), packed, WaveformGenerator::PaintMode_White, false, WaveformGenerator::Rec_709, 1));
+
+    HistogramGenerator histogram;
+    const int components = HistogramGenerator::ComponentY | HistogramGenerator::ComponentR | HistogramGenerator::ComponentSum;
+    REQUIRE(histogram.calculateHistogram(QSize(300, 400), frame, components, HistogramGenerator::Rec_601, true, 1) ==
+            histogram.calculateHistogram(QSize(300, 400), packed, components, HistogramGenerator::Rec_601, true, 1));
+
+    RGBParadeGenerator parade;
+    REQUIRE(parade.calculateRGBParade(QSize(400, 300), frame, RGBParadeGenerator::PaintMode_RGB, true, false, 2) ==
+            parade.calculateRGBParade(QSize(400, 300), packed, RGBParadeGenerator::PaintMode_RGB, true, false, 2));
+
+    VectorscopeGenerator vectorscope;
+    REQUIRE(vectorscope.calculateVectorscope(QSize(256, 256), frame, 1, VectorscopeGenerator::PaintMode_Green2, VectorscopeGenerator::ColorSpace_YUV, false, 1) ==
+            vectorscope.calculateVectorscope(QSize(256, 256), packed, 1, VectorscopeGenerator::PaintMode_Green2, VectorscopeGenerator::ColorSpace_YUV, false, 1));
+}
+
+TEST_CASE("Scopes reuse their buffers between frames", "[Scopes]")
+{
+    // Results must not depend on the previous frames, nor on the scope size used before
+    const QImage first = randomFrame(640, 360);
+    QImage second(333, 217, QImage::Format_RGB32);
+    second.fill(qRgb(200, 30, 90));
+
+    VectorscopeGenerator vectorscope;
+    vectorscope.calculateVectorscope(QSize(300, 300), first, 1, VectorscopeGenerator::PaintMode_Green2, VectorscopeGenerator::ColorSpace_YUV, false, 1);
+    vectorscope.calculateVectorscope(QSize(256, 256), first, 1, VectorscopeGenerator::PaintMode_Green2, VectorscopeGenerator::ColorSpace_YUV, false, 1);
+    REQUIRE(vectorscope.calculateVectorscope(QSize(256, 256), second, 1, VectorscopeGenerator::PaintMode_Green2, VectorscopeGenerator::ColorSpace_YUV, false, 1) ==
+            VectorscopeGenerator().calculateVectorscope(QSize(256, 256), second, 1, VectorscopeGenerator::PaintMode_Green2, VectorscopeGenerator::ColorSpace_YUV,
+                                                        false, 1));
+
+    // Image columns falling on the same scope column are counted together whatever the bands
+    WaveformGenerator waveform;
+    const QImage narrow = randomFrame(1000, 50);
+    const QImage wave = waveform.calculateWaveform(QSize(7, 256), narrow, WaveformGenerator::PaintMode_White, false, WaveformGenerator::Rec_709, 1);
+    REQUIRE(wave == waveform.calculateWaveform(QSize(7, 256), narrow.convertToFormat(QImage::Format_RGB888), WaveformGenerator::PaintMode_White, false,
+                                               WaveformGenerator::Rec_709, 1));
+}
+
+TEST_CASE("Vectorscope of gray frames", "[Scopes]")
+{
+    VectorscopeGenerator generator;
+    QImage frame(320, 240, QImage::Format_RGB32);
+    frame.fill(qRgb(128, 128, 128));
+
+    // Gray has no chroma, all the pixels fall on the center of the scope
+    const QImage scope =
+        generator.calculateVectorscope(QSize(201, 201), frame, 1, VectorscopeGenerator::PaintMode_Original, VectorscopeGenerator::ColorSpace_YPbPr, false, 1);
+    REQUIRE(paintedPixels(scope) == 1);
+    bool found = false;
+    for (int y = 99; y <= 101; ++y) {
+        for (int x = 99; x <= 101; ++x) {
+            if (qAlpha(scope.pixel(x, y)) > 0) {
+                REQUIRE(scope.pixel(x, y) == qRgb(128, 128, 128));
+                found = true;
+            }
+        }
+    }
+    REQUIRE(found);
+
+    // Many hits saturate the pixel
+    const QImage black =
+        generator.calculateVectorscope(QSize(201, 201), frame, 1, VectorscopeGenerator::PaintMode_Black, VectorscopeGenerator::ColorSpace_YPbPr, false, 1);
+    REQUIRE(paintedPixels(black) == 1);
+}
+
+TEST_CASE("Scopes benchmark", "[.][Scopes][benchmark]")
+{
+    // Full HD synthetic frame, analysed at the default scope sizes
+    const QImage frame = randomFrame(1920, 1080);
+    WaveformGenerator waveform;
+    HistogramGenerator histogram;
+    RGBParadeGenerator parade;
+    VectorscopeGenerator vectorscope;
+    QImage result;
+
+    BENCHMARK("Waveform")
+    {
+        result = waveform.calculateWaveform(QSize(720, 400), frame, WaveformGenerator::PaintMode_Yellow, true, WaveformGenerator::Rec_709, 1);
+    }
+    BENCHMARK("Histogram")
+    {
+        result = histogram.calculateHistogram(QSize(720, 400), frame, HistogramGenerator::ComponentY | HistogramGenerator::ComponentR | HistogramGenerator::ComponentG |
+                                                                        HistogramGenerator::ComponentB | HistogramGenerator::ComponentSum,
+                                            HistogramGenerator::Rec_709, false, 1);
+    }
+    BENCHMARK("RGB Parade")
+    {
+        result = parade.calculateRGBParade(QSize(720, 400), frame, RGBParadeGenerator::PaintMode_RGB, true, true, 1);
+    }
+    BENCHMARK("Vectorscope")
+    {
+        result = vectorscope.calculateVectorscope(QSize(400, 400), frame, 1, VectorscopeGenerator::PaintMode_Green2, VectorscopeGenerator::ColorSpace_YUV, false, 1);
+    }
+    REQUIRE(!result.isNull());
+}
@@ -123,4 +123,39 @@ TEST_CASE("Snap points model test", "[SnapModel]")
         REQUIRE(snap.getClosestPoint(9) == 15);
         REQUIRE(snap.getClosestPoint(999) == 15);
     }
+
+    SECTION("Ignoring points without modifying the model")
+    {
+        REQUIRE(snap.getClosestPoint(10, {}) == -1);
+
+        snap.addPoint(10);
+        snap.addPoint(10);
+        snap.addPoint(15);
+        const auto points = snap._snaps();
+
+        // Each ignored occurrence hides one element
+        REQUIRE(snap.getClosestPoint(11, {10}) == 10);
+        REQUIRE(snap.getClosestPoint(11, {10, 10}) == 15);
+        REQUIRE(snap.getClosestPoint(0, {10, 10}) == 15);
+        REQUIRE(snap.getClosestPoint(999, {15}) == 10);
+        REQUIRE(snap.getClosestPoint(13, {15}) == 10);
+        REQUIRE(snap.getClosestPoint(13, {10, 15, 10}) == -1);
+        // Ignoring a point that is not in the model has no effect
+        REQUIRE(snap.getClosestPoint(13, {14}) == 15);
+
+        // Same results as the mutating version
+        for (int pos = 0; pos < 20; ++pos) {
+            snap.ignore({15});
+            int expected = snap.getClosestPoint(pos);
+            snap.unIgnore();
+            REQUIRE(snap.getClosestPoint(pos, {15}) == expected);
+        }
+        REQUIRE(snap._snaps() == points);
+
+        // Proposed sizes ignore the boundaries of the resized item
+        REQUIRE(snap.proposeSize(10, 15, 12, true, 3) == -1);
+        snap.addPoint(24);
+        REQUIRE(snap.proposeSize(10, 15, 15, true, 3) == 14);
+        REQUIRE(snap._snaps().size() == points.size() + 1);
+    }
 }
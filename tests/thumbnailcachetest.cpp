@@ -0,0 +1,303 @@
+#include "catch.hpp"
+#include "jobs/cachejob.hpp"
+#include "utils/thumbnailcache.hpp"
+#include "utils/thumbnailpack.hpp"
+#include <QFile>
+#include <QImage>
+#include <QTemporaryDir>
+#include <QtConcurrent>
+
+namespace {
+// Gives access to the protected constructor, to use a cache with a known budget
+class TestThumbnailCache : public ThumbnailCache
+{
+public:
+    explicit TestThumbnailCache(qint64 maxBytes)
+        : ThumbnailCache(maxBytes)
+    {
+    }
+    using ThumbnailCache::legacyThumbnails;
+    using ThumbnailCache::openPack;
+};
+
+QImage thumbnail(int value)
+{
+    // 64x64 RGB32 images use 16kB
+    QImage img(64, 64, QImage::Format_RGB32);
+    img.fill(qRgb(value % 256, 0, 0));
+    return img;
+}
+} // namespace
+
+TEST_CASE("Volatile thumbnail cache", "[ThumbnailCache]")
+{
+    // 16 shards of 64kB, each holding 4 thumbnails
+    TestThumbnailCache cache(16 * 4 * 16384);
+
+    SECTION("Stored thumbnails are found")
+    {
+        cache.storeThumbnail(QStringLiteral("2"), 10, thumbnail(10));
+        cache.storeThumbnail(QStringLiteral("3"), 10, thumbnail(20));
+        REQUIRE(cache.hasThumbnail(QStringLiteral("2"), 10, true));
+        REQUIRE_FALSE(cache.hasThumbnail(QStringLiteral("2"), 11, true));
+        REQUIRE(cache.getThumbnail(QStringLiteral("2"), 10, true) == thumbnail(10));
+        REQUIRE(cache.getThumbnail(QStringLiteral("3"), 10, true) == thumbnail(20));
+        REQUIRE(cache.getThumbnail(QStringLiteral("4"), 10, true).isNull());
+
+        // Storing again replaces the thumbnail without using more memory
+        cache.storeThumbnail(QStringLiteral("2"), 10, thumbnail(30));
+        REQUIRE(cache.getThumbnail(QStringLiteral("2"), 10, true) == thumbnail(30));
+
+        auto stats = cache.statistics();
+        REQUIRE(stats.hits == 3);
+        REQUIRE(stats.misses == 1);
+        REQUIRE(stats.evictions == 0);
+        REQUIRE(stats.count == 2);
+        REQUIRE(stats.bytes == 2 * 16384);
+    }
+
+    SECTION("Memory budget is enforced")
+    {
+        for (int i = 0; i < 1000; ++i) {
+            cache.storeThumbnail(QStringLiteral("2"), i, thumbnail(i));
+        }
+        auto stats = cache.statistics();
+        REQUIRE(stats.bytes <= 16 * 4 * 16384);
+        REQUIRE(stats.count == stats.bytes / 16384);
+        REQUIRE(stats.evictions == quint64(1000 - stats.count));
+        // The last stored thumbnail is still there
+        REQUIRE(cache.hasThumbnail(QStringLiteral("2"), 999, true));
+
+        // Images larger than a shard are not kept
+        cache.storeThumbnail(QStringLiteral("3"), 0, QImage(256, 256, QImage::Format_RGB32));
+        REQUIRE_FALSE(cache.hasThumbnail(QStringLiteral("3"), 0, true));
+    }
+
+    SECTION("Least recently used thumbnails are evicted first")
+    {
+        cache.storeThumbnail(QStringLiteral("2"), 0, thumbnail(0));
+        for (int i = 1; i < 1000; ++i) {
+            cache.storeThumbnail(QStringLiteral("3"), i, thumbnail(i));
+            // A thumbnail that keeps being used is never evicted
+            REQUIRE(cache.getThumbnail(QStringLiteral("2"), 0, true) == thumbnail(0));
+        }
+        REQUIRE_FALSE(cache.hasThumbnail(QStringLiteral("3"), 1, true));
+    }
+
+    SECTION("Invalidating a clip removes all its thumbnails")
+    {
+        for (int i = 0; i < 20; ++i) {
+            cache.storeThumbnail(QStringLiteral("2"), i, thumbnail(i));
+            cache.storeThumbnail(QStringLiteral("3"), i, thumbnail(i));
+        }
+        cache.invalidateThumbsForClip(QStringLiteral("2"), false);
+        for (int i = 0; i < 20; ++i) {
+            REQUIRE_FALSE(cache.hasThumbnail(QStringLiteral("2"), i, true));
+            REQUIRE(cache.hasThumbnail(QStringLiteral("3"), i, true));
+        }
+        REQUIRE(cache.statistics().count == 20);
+        REQUIRE(cache.statistics().bytes == 20 * 16384);
+
+        cache.clearCache();
+        REQUIRE(cache.statistics().count == 0);
+        REQUIRE(cache.statistics().bytes == 0);
+    }
+
+    SECTION("Concurrent accesses")
+    {
+        QList<int> clips;
+        for (int i = 0; i < 8; ++i) {
+            clips << i;
+        }
+        QtConcurrent::blockingMap(clips, [&cache](int clip) {
+            const QString binId = QString::number(clip);
+            for (int i = 0; i < 200; ++i) {
+                cache.storeThumbnail(binId, i, thumbnail(i));
+                cache.getThumbnail(binId, i / 2, true);
+                if (i % 50 == 0) {
+                    cache.invalidateThumbsForClip(binId, false);
+                }
+            }
+        });
+        auto stats = cache.statistics();
+        REQUIRE(stats.hits + stats.misses == 8 * 200);
+        REQUIRE(stats.bytes <= 16 * 4 * 16384);
+        REQUIRE(stats.count == stats.bytes / 16384);
+    }
+}
+
+TEST_CASE("Thumbnail pack files", "[ThumbnailCache]")
+{
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+    const QString path = dir.filePath(QStringLiteral("clip.thumbs"));
+    // Images with transparency are stored losslessly
+    QImage transparent(32, 24, QImage::Format_ARGB32);
+    transparent.fill(qRgba(10, 20, 30, 128));
+
+    {
+        auto pack = ThumbnailPack::open(path);
+        REQUIRE(pack);
+        REQUIRE(pack->positions().empty());
+        REQUIRE(pack->append(5, thumbnail(100)));
+        REQUIRE(pack->append({{10, transparent}, {20, thumbnail(200)}}));
+        REQUIRE(pack->contains(10));
+        REQUIRE_FALSE(pack->contains(11));
+        REQUIRE(pack->image(10) == transparent);
+        REQUIRE(pack->image(11).isNull());
+    }
+
+    SECTION("Thumbnails are found when reopening the pack")
+    {
+        auto pack = ThumbnailPack::open(path);
+        REQUIRE(pack);
+        REQUIRE(pack->positions().size() == 3);
+        REQUIRE(pack->image(10) == transparent);
+        // JPEG is lossy, only check that the image looks right
+        const QImage img = pack->image(20);
+        REQUIRE(img.size() == QSize(64, 64));
+        REQUIRE(qAbs(qRed(img.pixel(32, 32)) - 200) < 8);
+
+        // A position stored again uses the last image
+        REQUIRE(pack->append(10, thumbnail(50)));
+        pack = ThumbnailPack::open(path);
+        REQUIRE(pack->positions().size() == 3);
+        REQUIRE(qAbs(qRed(pack->image(10).pixel(0, 0)) - 50) < 8);
+    }
+
+    SECTION("A truncated record is dropped")
+    {
+        QFile file(path);
+        const qint64 size = file.size();
+        REQUIRE(file.resize(size - 10));
+        auto pack = ThumbnailPack::open(path);
+        REQUIRE(pack);
+        REQUIRE(pack->contains(10));
+        REQUIRE_FALSE(pack->contains(20));
+        // New records are appended after the last valid one
+        REQUIRE(pack->append(30, transparent));
+        pack = ThumbnailPack::open(path);
+        REQUIRE(pack->positions().size() == 3);
+        REQUIRE(pack->image(30) == transparent);
+    }
+
+    SECTION("Invalid files are reset")
+    {
+        QFile file(path);
+        REQUIRE(file.open(QIODevice::WriteOnly));
+        file.write("not a thumbnail pack");
+        file.close();
+        auto pack = ThumbnailPack::open(path);
+        REQUIRE(pack);
+        REQUIRE(pack->positions().empty());
+    }
+
+    SECTION("Removed packs are deleted")
+    {
+        auto pack = ThumbnailPack::open(path);
+        pack->remove();
+        REQUIRE_FALSE(QFile::exists(path));
+        REQUIRE_FALSE(pack->contains(10));
+        REQUIRE_FALSE(pack->append(10, transparent));
+    }
+}
+
+TEST_CASE("Thumbnails of older versions", "[ThumbnailCache]")
+{
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+    QDir folder(dir.path());
+    const QString key = QStringLiteral("clip.thumbs");
+    // Older versions stored one <clip hash>#<position>.png file per thumbnail
+    for (int i = 0; i < 150; ++i) {
+        REQUIRE(thumbnail(i).save(folder.absoluteFilePath(QStringLiteral("clip#%1.png").arg(i * 10))));
+    }
+    REQUIRE(thumbnail(0).save(folder.absoluteFilePath(QStringLiteral("other#10.png"))));
+    REQUIRE(TestThumbnailCache::legacyThumbnails(folder, key).size() == 150);
+
+    SECTION("Without thumbnails, no pack is created")
+    {
+        REQUIRE_FALSE(TestThumbnailCache::openPack(folder, QStringLiteral("none.thumbs"), false));
+        REQUIRE_FALSE(QFile::exists(folder.absoluteFilePath(QStringLiteral("none.thumbs"))));
+    }
+
+    SECTION("They are imported in the pack")
+    {
+        auto pack = TestThumbnailCache::openPack(folder, key, false);
+        REQUIRE(pack);
+        REQUIRE(pack->positions().size() == 150);
+        REQUIRE(qAbs(qRed(pack->image(1000).pixel(0, 0)) - 100) < 8);
+        REQUIRE(TestThumbnailCache::legacyThumbnails(folder, key).isEmpty());
+        // Thumbnails of other clips are kept
+        REQUIRE(QFile::exists(folder.absoluteFilePath(QStringLiteral("other#10.png"))));
+        pack.reset();
+        pack = TestThumbnailCache::openPack(folder, key, false);
+        REQUIRE(pack);
+        REQUIRE(pack->positions().size() == 150);
+    }
+
+    SECTION("Thumbnails already in the pack are not replaced")
+    {
+        {
+            auto pack = ThumbnailPack::open(folder.absoluteFilePath(key));
+            REQUIRE(pack->append(10, thumbnail(200)));
+        }
+        auto pack = TestThumbnailCache::openPack(folder, key, true);
+        REQUIRE(pack->positions().size() == 150);
+        REQUIRE(qAbs(qRed(pack->image(10).pixel(0, 0)) - 200) < 8);
+    }
+}
+
+TEST_CASE("Thumbnail decoding plan", "[ThumbnailCache]")
+{
+    using Action = ThumbnailDecodePlanner::Action;
+    ThumbnailDecodePlanner planner(5);
+    REQUIRE(planner.position() == -1);
+
+    // The first thumbnail always seeks, to the exact position
+    auto step = planner.next(100);
+    REQUIRE(step.action == Action::Seek);
+    REQUIRE(step.position == 100);
+    planner.done(step, 40., 1);
+    REQUIRE(planner.position() == 100);
+    REQUIRE(planner.seekCost() == Approx(40.));
+
+    SECTION("Close thumbnails reuse the last frame")
+    {
+        step = planner.next(104);
+        REQUIRE(step.action == Action::Reuse);
+        REQUIRE(step.position == 100);
+    }
+
+    SECTION("Without measures, short jumps decode forward")
+    {
+        step = planner.next(110);
+        REQUIRE(step.action == Action::Forward);
+        // Decoding stops as soon as we are within tolerance
+        REQUIRE(step.position == 105);
+        REQUIRE(planner.next(130).action == Action::Seek);
+    }
+
+    SECTION("Measured costs decide between seeking and decoding forward")
+    {
+        step = planner.next(110);
+        planner.done(step, 10., 5);
+        REQUIRE(planner.frameCost() == Approx(2.));
+        REQUIRE(planner.position() == 105);
+        // 15 frames at 2ms are cheaper than a 40ms seek
+        step = planner.next(125);
+        REQUIRE(step.action == Action::Forward);
+        REQUIRE(step.position == 120);
+        // 25 frames are not
+        step = planner.next(150);
+        REQUIRE(step.action == Action::Seek);
+        REQUIRE(step.position == 150);
+    }
+
+    SECTION("Going backwards seeks")
+    {
+        step = planner.next(50);
+        REQUIRE(step.action == Action::Seek);
+        REQUIRE(step.position == 50);
+    }
+}
@@ -0,0 +1,249 @@
+#include "test_utils.hpp"
+#include "macros.hpp"
+#include "undohelper.hpp"
+
+Mlt::Profile profile_undo;
+
+namespace {
+// The nested lambdas that OperationJournal replaces, used as reference
+void nestedPushBack(Fun &lambda, Fun operation)
+{
+    lambda = [lambda, operation]() {
+        bool v = lambda();
+        return v && operation();
+    };
+}
+void nestedPushFront(Fun &lambda, Fun operation)
+{
+    lambda = [lambda, operation]() {
+        bool v = operation();
+        return v && lambda();
+    };
+}
+void nestedUpdate(Fun &undo, Fun &redo, Fun operation, Fun reverse)
+{
+    undo = [reverse, undo]() {
+        bool v = reverse();
+        return undo() && v;
+    };
+    redo = [operation, redo]() {
+        bool v = redo();
+        return operation() && v;
+    };
+}
+} // namespace
+
+TEST_CASE("Operation journal", "[Undo]")
+{
+    SECTION("Journals behave like nested lambdas")
+    {
+        std::default_random_engine gen(42);
+        std::uniform_int_distribution<int> kind(0, 4);
+        std::bernoulli_distribution failure(0.15);
+
+        for (int run = 0; run < 50; ++run) {
+            std::vector<int> trace;
+            std::vector<bool> fails;
+            auto makeOperation = [&trace, &fails](int id) {
+                return [&trace, &fails, id]() {
+                    trace.push_back(id);
+                    return !fails[size_t(id)];
+                };
+            };
+            Fun nestedUndo = []() { return true; };
+            Fun nestedRedo = []() { return true; };
+            Fun undo = []() { return true; };
+            Fun redo = []() { return true; };
+            int id = 0;
+            for (int step = 0; step < 60; ++step) {
+                switch (kind(gen)) {
+                case 0:
+                    nestedPushBack(nestedUndo, makeOperation(id));
+                    PUSH_LAMBDA(Fun(makeOperation(id)), undo);
+                    break;
+                case 1:
+                    nestedPushFront(nestedUndo, makeOperation(id));
+                    PUSH_FRONT_LAMBDA(Fun(makeOperation(id)), undo);
+                    break;
+                case 2: {
+                    nestedUpdate(nestedUndo, nestedRedo, makeOperation(id), makeOperation(id + 1));
+                    Fun operation = makeOperation(id);
+                    Fun reverse = makeOperation(id + 1);
+                    UPDATE_UNDO_REDO_NOLOCK(operation, reverse, undo, redo);
+                    id++;
+                    break;
+                }
+                case 3:
+                    nestedPushBack(nestedRedo, makeOperation(id));
+                    PUSH_LAMBDA(Fun(makeOperation(id)), redo);
+                    break;
+                default: {
+                    // Nest the current functions in each other, like local undo/redo merged in the caller's ones
+                    Fun nestedLocal = nestedRedo;
+                    Fun local = redo;
+                    nestedPushFront(nestedUndo, nestedLocal);
+                    PUSH_FRONT_LAMBDA(local, undo);
+                    break;
+                }
+                }
+                id++;
+            }
+            for (int attempt = 0; attempt < 20; ++attempt) {
+                fails.clear();
+                for (int i = 0; i < id; ++i) {
+                    fails.push_back(failure(gen));
+                }
+                for (auto functions : {std::make_pair(&nestedUndo, &undo), std::make_pair(&nestedRedo, &redo)}) {
+                    trace.clear();
+                    bool expectedResult = (*functions.first)();
+                    std::vector<int> expectedTrace = trace;
+                    trace.clear();
+                    REQUIRE((*functions.second)() == expectedResult);
+                    REQUIRE(trace == expectedTrace);
+                }
+            }
+        }
+    }
+
+    SECTION("Long journals are executed without nesting")
+    {
+        // With nested lambdas, this would need hundreds of thousands of stack frames
+        const int count = 500000;
+        int value = 0;
+        Fun undo = []() { return true; };
+        Fun redo = []() { return true; };
+        for (int i = 0; i < count; ++i) {
+            Fun operation = [&value]() {
+                value++;
+                return true;
+            };
+            Fun reverse = [&value]() {
+                value--;
+                return true;
+            };
+            UPDATE_UNDO_REDO_NOLOCK(operation, reverse, undo, redo);
+        }
+        REQUIRE(redo());
+        REQUIRE(value == count);
+        REQUIRE(undo());
+        REQUIRE(value == 0);
+    }
+}
+
+TEST_CASE("Undo stack memory limit", "[Undo]")
+{
+    DocUndoStack stack(nullptr);
+    stack.setMemoryLimit(0);
+    int value = 0;
+    auto pushCommand = [&stack, &value](int operations) {
+        Fun undo = []() { return true; };
+        Fun redo = []() { return true; };
+        for (int i = 0; i < operations; ++i) {
+            Fun operation = [&value]() {
+                value++;
+                return true;
+            };
+            Fun reverse = [&value]() {
+                value--;
+                return true;
+            };
+            operation();
+            UPDATE_UNDO_REDO_NOLOCK(operation, reverse, undo, redo);
+        }
+        auto *command = new FunctionalUndoCommand(undo, redo, QStringLiteral("test"));
+        stack.push(command);
+        return command;
+    };
+
+    std::vector<FunctionalUndoCommand *> commands;
+    for (int i = 0; i < 10; ++i) {
+        commands.push_back(pushCommand(100));
+    }
+    REQUIRE(value == 1000);
+    const size_t commandCost = commands.front()->memoryCost();
+    REQUIRE(commandCost > 100 * sizeof(Fun));
+    REQUIRE(stack.memoryCost() == 10 * commandCost);
+    stack.setClean();
+
+    // Keep room for about 4 commands, the oldest ones are removed
+    stack.setMemoryLimit(4 * commandCost + commandCost / 2);
+    REQUIRE(stack.count() == 4);
+    REQUIRE(stack.index() == 4);
+    REQUIRE(stack.isClean());
+    REQUIRE(stack.memoryCost() == 4 * commandCost);
+    REQUIRE(value == 1000);
+
+    // The kept commands still work
+    stack.undo();
+    stack.undo();
+    REQUIRE(value == 800);
+    stack.redo();
+    REQUIRE(value == 900);
+    REQUIRE_FALSE(stack.isClean());
+
+    // Undone commands are kept, since they can be redone
+    stack.setMemoryLimit(1);
+    REQUIRE(stack.count() == 2);
+    REQUIRE(stack.index() == 1);
+    REQUIRE(stack.memoryCost() == 2 * commandCost);
+    // The saved state is still reachable
+    REQUIRE(stack.cleanIndex() == 2);
+    stack.redo();
+    REQUIRE(value == 1000);
+    stack.undo();
+    stack.undo();
+    REQUIRE_FALSE(stack.canUndo());
+    REQUIRE(value == 800);
+
+    // Pushing a command deletes the undone ones
+    stack.setMemoryLimit(0);
+    pushCommand(100);
+    REQUIRE(stack.count() == 1);
+    REQUIRE(stack.memoryCost() == commandCost);
+    stack.clear();
+    REQUIRE(stack.memoryCost() == 0);
+}
+
+TEST_CASE("Large group moves", "[Undo]")
+{
+    auto binModel = pCore->projectItemModel();
+    binModel->clean();
+    std::shared_ptr<DocUndoStack> undoStack = std::make_shared<DocUndoStack>(nullptr);
+    std::shared_ptr<MarkerListModel> guideModel = std::make_shared<MarkerListModel>(undoStack);
+
+    Mock<ProjectManager> pmMock;
+    When(Method(pmMock, undoStack)).AlwaysReturn(undoStack);
+
+    ProjectManager &mocked = pmMock.get();
+    pCore->m_projectManager = &mocked;
+    std::shared_ptr<TimelineItemModel> timeline = TimelineItemModel::construct(&profile_undo, guideModel, undoStack);
+
+    QString binId = createProducer(profile_undo, "red", binModel, 20, false);
+    int tid1 = TrackModel::construct(timeline);
+
+    // Each clip move adds operations to the undo and redo functions of the group move
+    const int count = 2000;
+    std::unordered_set<int> clips;
+    for (int i = 0; i < count; ++i) {
+        int cid = -1;
+        REQUIRE(timeline->requestClipInsertion(binId, tid1, i * 20, cid, false));
+        clips.insert(cid);
+    }
+    int gid = timeline->requestClipsGroup(clips, false);
+    REQUIRE(gid > -1);
+    const int first = *clips.begin();
+    const int position = timeline->getClipPosition(first);
+
+    REQUIRE(timeline->requestGroupMove(first, gid, 0, 100));
+    REQUIRE(timeline->getClipPosition(first) == position + 100);
+    REQUIRE(timeline->checkConsistency());
+
+    undoStack->undo();
+    REQUIRE(timeline->getClipPosition(first) == position);
+    REQUIRE(timeline->checkConsistency());
+
+    undoStack->redo();
+    REQUIRE(timeline->getClipPosition(first) == position + 100);
+    REQUIRE(timeline->checkConsistency());
+    pCore->m_projectManager = nullptr;
+}